@@ -0,0 +1,143 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <string.h>
+
+#include "gedit-snippets-arena.h"
+
+#define SNIPPET_ARENA_ALIGN (sizeof(gpointer))
+
+struct SnippetArenaChunk
+{
+	SnippetArenaChunk *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+SnippetArena *snippet_arena_new(size_t chunk_size)
+{
+	SnippetArena *self=g_new0(SnippetArena,1);
+	self->chunk_size=chunk_size;
+	self->strings=g_hash_table_new(g_str_hash,g_str_equal);
+
+	return self;
+}
+
+void snippet_arena_free(SnippetArena *self)
+{
+	if(!self)
+	{
+		return;
+	}
+
+	SnippetArenaChunk *chunk=self->chunks;
+
+	while(chunk)
+	{
+		SnippetArenaChunk *next=chunk->next;
+		g_free(chunk);
+		chunk=next;
+	}
+
+	g_hash_table_destroy(self->strings);
+	g_free(self);
+}
+
+static SnippetArenaChunk *snippet_arena_chunk_new(SnippetArena *self, size_t size)
+{
+	SnippetArenaChunk *chunk=g_malloc0(sizeof(SnippetArenaChunk)+size);
+	chunk->size=size;
+
+	self->reserved_bytes+=sizeof(SnippetArenaChunk)+size;
+
+	return chunk;
+}
+
+/**
+	Returns zeroed memory that stays valid until the arena is freed.
+*/
+gpointer snippet_arena_alloc(SnippetArena *self, size_t size)
+{
+	size=(size+SNIPPET_ARENA_ALIGN-1)&~(SNIPPET_ARENA_ALIGN-1);
+
+	SnippetArenaChunk *chunk=self->chunks;
+
+	if(!chunk || chunk->size-chunk->used<size)
+	{
+		if(size>self->chunk_size/4)
+		{
+			//big bodies get a chunk of their own, behind the one being filled
+			chunk=snippet_arena_chunk_new(self,size);
+
+			if(self->chunks)
+			{
+				chunk->next=self->chunks->next;
+				self->chunks->next=chunk;
+			}
+			else
+			{
+				self->chunks=chunk;
+			}
+		}
+		else
+		{
+			chunk=snippet_arena_chunk_new(self,self->chunk_size);
+			chunk->next=self->chunks;
+			self->chunks=chunk;
+		}
+	}
+
+	gpointer ptr=chunk->data+chunk->used;
+	chunk->used+=size;
+	self->used_bytes+=size;
+
+	return ptr;
+}
+
+char *snippet_arena_strndup(SnippetArena *self, const char *str, size_t len)
+{
+	char *copy=snippet_arena_alloc(self,len+1);
+	memcpy(copy,str,len);
+
+	return copy;
+}
+
+/**
+	Returns one shared copy per distinct string, so language names and bodies
+	that occur in several files are only stored once.
+*/
+const char *snippet_arena_intern(SnippetArena *self, const char *str)
+{
+	if(!str)
+	{
+		return NULL;
+	}
+
+	char *interned=g_hash_table_lookup(self->strings,str);
+
+	if(!interned)
+	{
+		interned=snippet_arena_strndup(self,str,strlen(str));
+		g_hash_table_add(self->strings,interned);
+	}
+
+	return interned;
+}
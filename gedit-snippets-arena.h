@@ -0,0 +1,50 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct SnippetArenaChunk SnippetArenaChunk;
+
+/**
+	Bump allocator for everything that lives as long as one load of the snippets.
+	Nothing is freed on its own, the whole arena is dropped at once on reload.
+*/
+typedef struct SnippetArena
+{
+	SnippetArenaChunk *chunks; ///< the chunk being filled is first
+	size_t chunk_size;
+	size_t used_bytes; ///< handed out by snippet_arena_alloc
+	size_t reserved_bytes; ///< allocated from the system
+	GHashTable *strings; ///< interned strings, the key is also the value
+}SnippetArena;
+
+SnippetArena *snippet_arena_new(size_t chunk_size);
+void snippet_arena_free(SnippetArena *self);
+
+gpointer snippet_arena_alloc(SnippetArena *self, size_t size);
+char *snippet_arena_strndup(SnippetArena *self, const char *str, size_t len);
+const char *snippet_arena_intern(SnippetArena *self, const char *str);
+
+#define snippet_arena_new0(arena,type,n) ((type *)snippet_arena_alloc((arena),sizeof(type)*(n)))
+
+G_END_DECLS
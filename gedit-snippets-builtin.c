@@ -0,0 +1,81 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <string.h>
+
+#include "gedit-snippets-builtin.h"
+
+//the table generated by snippets-compile replaces this one when the build links it in
+__attribute__((weak)) const SnippetBuiltinTable *GLOBAL_SNIPPET_BUILTIN_TABLE=NULL;
+
+/**
+	fnv-1a over the lowercase language and the trigger, with a finalizer so that
+	another seed spreads the keys of a bucket differently. snippets-compile places
+	the keys with the same function.
+*/
+guint32 snippet_builtin_hash(const char *language, const char *trigger, guint32 seed)
+{
+	guint32 hash=2166136261u^(seed*0x9e3779b9u);
+	
+	for(const char *p=language;*p;p++)
+	{
+		hash=(hash^(guchar)g_ascii_tolower(*p))*16777619u;
+	}
+	
+	//0xff is never in UTF-8, so "ab"+"c" and "a"+"bc" differ
+	hash=(hash^0xffu)*16777619u;
+	
+	for(const char *p=trigger;*p;p++)
+	{
+		hash=(hash^(guchar)*p)*16777619u;
+	}
+	
+	hash^=hash>>16;
+	hash*=0x85ebca6bu;
+	hash^=hash>>13;
+	hash*=0xc2b2ae35u;
+	hash^=hash>>16;
+	
+	return hash;
+}
+
+/**
+	The compiled snippet for trigger in language, or NULL. One probe, the slot either
+	holds this key or no key of the table would hash there.
+*/
+SnippetTranslation *snippet_builtin_lookup(const char *language, const char *trigger)
+{
+	const SnippetBuiltinTable *table=GLOBAL_SNIPPET_BUILTIN_TABLE;
+	
+	if(!table || table->keys_len==0 || !language || !trigger)
+	{
+		return NULL;
+	}
+	
+	const guint32 seed=table->seeds[snippet_builtin_hash(language,trigger,0)%table->seeds_len];
+	const SnippetBuiltinKey *key=&table->keys[snippet_builtin_hash(language,trigger,seed)%table->keys_len];
+	
+	if(strcmp(key->trigger,trigger)!=0 || g_ascii_strcasecmp(key->language,language)!=0)
+	{
+		return NULL;
+	}
+	
+	return &table->snippets[key->snippet];
+}
@@ -0,0 +1,58 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+#include "gedit-snippets-configuration.h"
+
+G_BEGIN_DECLS
+
+typedef struct SnippetBuiltinKey
+{
+	const char *language; ///< lowercase
+	const char *trigger;
+	guint snippet; ///< index into SnippetBuiltinTable.snippets
+}SnippetBuiltinKey;
+
+/**
+	Snippets compiled into the plugin by snippets-compile, so they need no file and no
+	parsing at startup. The keys are placed by a minimal perfect hash: the language and
+	trigger hashed with seed 0 pick a bucket, hashed again with the seed of the bucket
+	they pick the only slot the key can be in.
+*/
+typedef struct SnippetBuiltinTable
+{
+	SnippetTranslation *snippets; ///< not const, the usage counts are kept in them
+	guint snippets_len;
+	const SnippetBuiltinKey *keys; ///< one slot per key
+	guint keys_len;
+	const guint32 *seeds; ///< per bucket
+	guint seeds_len;
+	const guint *trigger_lens; ///< in characters, longest first
+	guint trigger_lens_len;
+}SnippetBuiltinTable;
+
+extern const SnippetBuiltinTable *GLOBAL_SNIPPET_BUILTIN_TABLE; ///< NULL when the build has none
+
+guint32 snippet_builtin_hash(const char *language, const char *trigger, guint32 seed);
+SnippetTranslation *snippet_builtin_lookup(const char *language, const char *trigger);
+
+G_END_DECLS
@@ -23,19 +23,56 @@ freely, subject to the following restrictions:
 #include <string.h>
 
 #include "gedit-snippets-configuration.h"
+#include "gedit-snippets-variables.h"
+#include "gedit-snippets-builtin.h"
 
 //@TODO change to a trie and have a file-structure?
 GPtrArray *GLOBAL_SNIPPETS = NULL;
 GHashTable *GLOBAL_XML_FILE_INFO = NULL;
+SnippetArena *GLOBAL_SNIPPET_ARENA = NULL;
+guint GLOBAL_SNIPPETS_GENERATION = 0;
+GStrv GLOBAL_SNIPPET_LAYERS = NULL;
+GPtrArray *GLOBAL_SHADOWED_SNIPPETS = NULL;
 
-void snippet_translation_free(SnippetTranslation *self)
+static GHashTable *GLOBAL_SNIPPET_LANGUAGE_INDEXES = NULL; ///< lowercase language -> SnippetLanguageIndex
+
+//gtksourceview language id -> the one whose snippets it also gets, the chain ends with the global snippets
+static const char *const SNIPPET_LANGUAGE_PARENTS[][2]={
+	{"chdr","c"},
+	{"cpp","c"},
+	{"cpphdr","cpp"},
+	{"objc","c"},
+	{"cuda","cpp"},
+	{"typescript","js"},
+	{"python3","python"},
+	{"bash","sh"},
+	{"zsh","sh"}
+};
+
+typedef struct SnippetSlot
 {
-	g_free(self->from);
-	g_free(self->to);
-	g_free(self->description);
-	
-	g_ptr_array_free(self->programming_languages,TRUE);
+	SnippetTranslation *sntran; ///< NULL while the slot is free
+	guint32 generation; ///< bumped when the slot is freed, so old handles stop working
+	guint32 next_free; ///< the next free slot plus one, 0 ends the list
+}SnippetSlot;
+
+static GArray *GLOBAL_SNIPPET_SLOTS = NULL; ///< SnippetSlot, the handles point into it
+static guint32 GLOBAL_SNIPPET_FREE_SLOT = 0; ///< the first free slot plus one, 0 when there is none
+static GHashTable *GLOBAL_SNIPPETS_BY_TRIGGER = NULL; ///< trigger -> GPtrArray of the SnippetTranslation in the index that have it
+static guint GLOBAL_SNIPPET_SEQUENCE = 0; ///< the sequence of the last snippet that came into the index
+
+static SnippetTriggerFunc GLOBAL_SNIPPET_TRIGGER_FUNC = NULL;
+static gpointer GLOBAL_SNIPPET_TRIGGER_DATA = NULL;
+static SnippetAddedFunc GLOBAL_SNIPPET_ADDED_FUNC = NULL;
+static gpointer GLOBAL_SNIPPET_ADDED_DATA = NULL;
+static guint GLOBAL_SNIPPET_PARSER_THREADS = 0;
+
+#define SNIPPET_ARENA_CHUNK_SIZE (64*1024)
 
+static void snippet_block_free(SnippetBlock *self)
+{
+	//the nodes themselves live in GLOBAL_SNIPPET_ARENA
+	g_ptr_array_free(self->nodes,TRUE);
 	g_free(self);
 }
 
@@ -47,138 +84,888 @@ static gint sort_snippet_block(gconstpointer a, gconstpointer b)
   return entry2->str_len-entry1->str_len;
 }
 
-const char *get_programming_language(GeditWindow *window)
+SnippetBlock *get_or_create_block(size_t str_len)
 {
-	GeditTab *tab= gedit_window_get_active_tab(window);
+	//the longest tags first, so blocks created after a load (import, add) do not need a resort
+	guint low = 0;
+	guint high = GLOBAL_SNIPPETS->len;
 	
-	if(tab)
+	while (low < high)
 	{
-		GeditDocument *doc = gedit_tab_get_document(tab);
+		const guint middle = low + (high - low) / 2;
+		SnippetBlock *block = g_ptr_array_index(GLOBAL_SNIPPETS, middle);
+		
+		if (block->str_len == str_len)
+			return block;
+		else if (block->str_len > str_len)
+			low = middle + 1;
+		else
+			high = middle;
+	}
 	
-		GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
-		GtkSourceBuffer *sbuffer = GTK_SOURCE_BUFFER(buffer);
-		GtkSourceLanguage *language = gtk_source_buffer_get_language(sbuffer);
-		if (language)
+	const guint insert_pos = low;
+
+	SnippetBlock *new_block = g_malloc(sizeof(SnippetBlock));
+	new_block->str_len = str_len;
+	new_block->nodes = g_ptr_array_new();
+	g_ptr_array_insert(GLOBAL_SNIPPETS, insert_pos, new_block);
+
+	return new_block;
+}
+
+/**
+	Call after reordering the nodes of a block, from is the first one that moved.
+*/
+void renumber_snippet_block(SnippetBlock *self, guint from)
+{
+	for (guint i = from; i < self->nodes->len; i++)
+	{
+		((SnippetTranslation *)g_ptr_array_index(self->nodes, i))->node_index = i;
+	}
+}
+
+gboolean language_exists_in_obj(SnippetTranslation *self, const gchar *target)
+{
+	const char **const array=self->programming_languages;
+
+	for (guint i = 0; array[i]; i++)
+	{
+		const gchar *item = array[i];
+		if (g_ascii_strcasecmp(item, target) == 0)
 		{
-			return gtk_source_language_get_id(language);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+SnippetTranslation *find_snippet_translation(const char *tag, const char *language)
+{
+	return g_hash_table_lookup(get_snippet_language_index(language)->triggers,tag);
+}
+
+/**
+	The language language inherits snippets from, NULL if it only gets the global ones.
+*/
+const char *get_snippet_language_parent(const char *language)
+{
+	for(size_t i=0;i<G_N_ELEMENTS(SNIPPET_LANGUAGE_PARENTS);i++)
+	{
+		if(g_ascii_strcasecmp(language,SNIPPET_LANGUAGE_PARENTS[i][0])==0)
+		{
+			return SNIPPET_LANGUAGE_PARENTS[i][1];
 		}
 	}
 	
 	return NULL;
 }
 
-SnippetBlock *get_or_create_block(size_t str_len)
+static guint get_snippet_layer(SnippetTranslation *sntran)
+{
+	//the compiled snippets are under every file
+	return sntran->fileinf?sntran->fileinf->layer:G_MAXUINT;
+}
+
+//the first language of the chain sntran has, G_MAXUINT when it has none of them
+static guint get_chain_position(SnippetLanguageIndex *self, SnippetTranslation *sntran)
+{
+	for(guint c=0;c<self->chain_len;c++)
+	{
+		if(language_exists_in_obj(sntran,self->chain[c]))
+		{
+			return c;
+		}
+	}
+	
+	return G_MAXUINT;
+}
+
+//the nearest language wins, then the earliest layer, then the one that was there first
+static gboolean is_better_snippet(SnippetLanguageIndex *self, SnippetTranslation *candidate, SnippetTranslation *current)
+{
+	const guint candidate_position=get_chain_position(self,candidate);
+	
+	if(candidate_position==G_MAXUINT)
+	{
+		return FALSE;
+	}
+	else if(!current)
+	{
+		return TRUE;
+	}
+	
+	const guint current_position=get_chain_position(self,current);
+	
+	if(candidate_position!=current_position)
+	{
+		return candidate_position<current_position;
+	}
+	
+	return get_snippet_layer(candidate)<get_snippet_layer(current);
+}
+
+static void add_trigger_len(SnippetLanguageIndex *self, guint len)
+{
+	guint i=0;
+	
+	//longest first, there are only a few lengths
+	while(i<self->trigger_lens->len && g_array_index(self->trigger_lens,guint,i)>len)
+	{
+		i++;
+	}
+	
+	if(i<self->trigger_lens->len && g_array_index(self->trigger_lens,guint,i)==len)
+	{
+		g_array_index(self->trigger_len_counts,guint,i)++;
+		return;
+	}
+	
+	const guint count=1;
+	g_array_insert_val(self->trigger_lens,i,len);
+	g_array_insert_val(self->trigger_len_counts,i,count);
+}
+
+static void remove_trigger_len(SnippetLanguageIndex *self, guint len)
+{
+	for(guint i=0;i<self->trigger_lens->len;i++)
+	{
+		if(g_array_index(self->trigger_lens,guint,i)==len)
+		{
+			if(--g_array_index(self->trigger_len_counts,guint,i)==0)
+			{
+				g_array_remove_index(self->trigger_lens,i);
+				g_array_remove_index(self->trigger_len_counts,i);
+			}
+			return;
+		}
+	}
+}
+
+/**
+	Puts the best snippet for trigger into the index, or takes the trigger out when no snippet of
+	the chain has it. Returns TRUE when the language could not expand trigger before.
+*/
+static gboolean refresh_index_trigger(SnippetLanguageIndex *self, const char *trigger)
+{
+	SnippetTranslation *best=NULL;
+	GPtrArray *candidates=g_hash_table_lookup(GLOBAL_SNIPPETS_BY_TRIGGER,trigger);
+	
+	for(guint i=0;candidates && i<candidates->len;i++)
+	{
+		SnippetTranslation *candidate=g_ptr_array_index(candidates,i);
+		
+		if(is_better_snippet(self,candidate,best))
+		{
+			best=candidate;
+		}
+	}
+	
+	for(guint c=0;c<self->chain_len;c++)
+	{
+		SnippetTranslation *builtin=snippet_builtin_lookup(self->chain[c],trigger);
+		
+		if(builtin && is_better_snippet(self,builtin,best))
+		{
+			best=builtin;
+		}
+	}
+	
+	SnippetTranslation *current=g_hash_table_lookup(self->triggers,trigger);
+	
+	if(current==best)
+	{
+		return FALSE;
+	}
+	else if(!best)
+	{
+		g_hash_table_remove(self->triggers,trigger);
+		remove_trigger_len(self,g_utf8_strlen(trigger,-1));
+		
+		return FALSE;
+	}
+	
+	//the key is the string of the snippet, it lives as long as the snippet
+	g_hash_table_replace(self->triggers,(gpointer)best->from,best);
+	
+	if(current)
+	{
+		return FALSE;
+	}
+	
+	add_trigger_len(self,g_utf8_strlen(trigger,-1));
+	
+	return TRUE;
+}
+
+static void build_snippet_language_index(SnippetLanguageIndex *self, const char *language)
+{
+	self->generation=GLOBAL_SNIPPETS_GENERATION;
+	g_hash_table_remove_all(self->triggers);
+	g_array_set_size(self->trigger_lens,0);
+	g_array_set_size(self->trigger_len_counts,0);
+	
+	//the language, its parents, then the global snippets. Cut off so a cycle in the map can not hang
+	self->chain_len=0;
+	
+	for(const char *link=language;link && self->chain_len<SNIPPET_LANGUAGE_CHAIN_MAX;link=get_snippet_language_parent(link))
+	{
+		self->chain[self->chain_len++]=link;
+	}
+	
+	if(g_strcmp0(language,SNIPPET_GLOBAL_LANGUAGE)!=0)
+	{
+		self->chain[self->chain_len++]=SNIPPET_GLOBAL_LANGUAGE;
+	}
+	
+	GHashTableIter iter;
+	gpointer trigger;
+	
+	g_hash_table_iter_init(&iter,GLOBAL_SNIPPETS_BY_TRIGGER);
+	
+	while(g_hash_table_iter_next(&iter,&trigger,NULL))
+	{
+		refresh_index_trigger(self,trigger);
+	}
+	
+	const SnippetBuiltinTable *builtin=GLOBAL_SNIPPET_BUILTIN_TABLE;
+	
+	//the compiled triggers no file has
+	for(guint i=0;builtin && i<builtin->keys_len;i++)
+	{
+		const char *builtin_trigger=builtin->keys[i].trigger;
+		
+		if(builtin_trigger && !g_hash_table_contains(self->triggers,builtin_trigger))
+		{
+			refresh_index_trigger(self,builtin_trigger);
+		}
+	}
+}
+
+static void snippet_language_index_free(SnippetLanguageIndex *self)
+{
+	g_hash_table_destroy(self->triggers);
+	g_array_free(self->trigger_lens,TRUE);
+	g_array_free(self->trigger_len_counts,TRUE);
+	g_free(self);
+}
+
+/**
+	The flattened snippets of language, NULL for a buffer without one gets the global snippets.
+	Stays valid until the snippets are reloaded.
+*/
+SnippetLanguageIndex *get_snippet_language_index(const char *language)
+{
+	g_autofree char *key=g_ascii_strdown(language?language:"",-1);
+	SnippetLanguageIndex *index=g_hash_table_lookup(GLOBAL_SNIPPET_LANGUAGE_INDEXES,key);
+	
+	if(!index)
+	{
+		index=g_new0(SnippetLanguageIndex,1);
+		//the triggers live in GLOBAL_SNIPPET_ARENA or the builtin table
+		index->triggers=g_hash_table_new(g_str_hash,g_str_equal);
+		index->trigger_lens=g_array_new(FALSE,FALSE,sizeof(guint));
+		index->trigger_len_counts=g_array_new(FALSE,FALSE,sizeof(guint));
+		
+		//the chain points at the key
+		char *language_key=g_steal_pointer(&key);
+		g_hash_table_insert(GLOBAL_SNIPPET_LANGUAGE_INDEXES,language_key,index);
+		build_snippet_language_index(index,language_key);
+	}
+	else if(index->generation!=GLOBAL_SNIPPETS_GENERATION)
+	{
+		build_snippet_language_index(index,index->chain[0]);
+	}
+	
+	return index;
+}
+
+//brings the built language indexes up to date for one trigger, the others are built when used
+static void refresh_language_indexes(const char *trigger)
+{
+	GHashTableIter iter;
+	gpointer value;
+	
+	g_hash_table_iter_init(&iter,GLOBAL_SNIPPET_LANGUAGE_INDEXES);
+	
+	while(g_hash_table_iter_next(&iter,NULL,&value))
+	{
+		SnippetLanguageIndex *index=value;
+		
+		if(index->generation==GLOBAL_SNIPPETS_GENERATION && refresh_index_trigger(index,trigger) && GLOBAL_SNIPPET_TRIGGER_FUNC)
+		{
+			GLOBAL_SNIPPET_TRIGGER_FUNC(index->chain[0],trigger,GLOBAL_SNIPPET_TRIGGER_DATA);
+		}
+	}
+}
+
+/**
+	func gets every trigger that a built language index gains between two reloads.
+*/
+int snippet_index_set_trigger_func(SnippetTriggerFunc func, gpointer user_data)
+{
+	GLOBAL_SNIPPET_TRIGGER_FUNC=func;
+	GLOBAL_SNIPPET_TRIGGER_DATA=user_data;
+	
+	return 0;
+}
+
+/**
+	func gets the text of every snippet that is loaded, imported or added in the manager, for
+	example to compile its transformations while loading instead of on its first expansion.
+	The snippets compiled into the build are there from the start, func gets them right away.
+*/
+int snippet_index_set_added_func(SnippetAddedFunc func, gpointer user_data)
+{
+	GLOBAL_SNIPPET_ADDED_FUNC=func;
+	GLOBAL_SNIPPET_ADDED_DATA=user_data;
+	
+	const SnippetBuiltinTable *builtin=GLOBAL_SNIPPET_BUILTIN_TABLE;
+	
+	for(guint i=0;func && builtin && i<builtin->snippets_len;i++)
+	{
+		if(builtin->snippets[i].to)
+		{
+			func(builtin->snippets[i].to,user_data);
+		}
+	}
+	
+	return 0;
+}
+
+static SnippetHandle allocate_snippet_slot(SnippetTranslation *sntran)
+{
+	guint32 slot_index;
+	
+	if(GLOBAL_SNIPPET_FREE_SLOT)
+	{
+		slot_index=GLOBAL_SNIPPET_FREE_SLOT-1;
+		GLOBAL_SNIPPET_FREE_SLOT=g_array_index(GLOBAL_SNIPPET_SLOTS,SnippetSlot,slot_index).next_free;
+	}
+	else
+	{
+		const SnippetSlot new_slot={.generation=1};
+		g_array_append_val(GLOBAL_SNIPPET_SLOTS,new_slot);
+		slot_index=GLOBAL_SNIPPET_SLOTS->len-1;
+	}
+	
+	SnippetSlot *slot=&g_array_index(GLOBAL_SNIPPET_SLOTS,SnippetSlot,slot_index);
+	slot->sntran=sntran;
+	slot->next_free=0;
+	
+	return ((SnippetHandle)slot->generation<<32)|slot_index;
+}
+
+static void release_snippet_slot(SnippetHandle handle)
+{
+	const guint32 slot_index=handle&G_MAXUINT32;
+	SnippetSlot *slot=&g_array_index(GLOBAL_SNIPPET_SLOTS,SnippetSlot,slot_index);
+	
+	slot->sntran->handle=0;
+	slot->sntran=NULL;
+	
+	//0 would make a handle that is no snippet look like one
+	if(++slot->generation==0)
+	{
+		slot->generation=1;
+	}
+	
+	slot->next_free=GLOBAL_SNIPPET_FREE_SLOT;
+	GLOBAL_SNIPPET_FREE_SLOT=slot_index+1;
+}
+
+/**
+	The snippet handle was given for, NULL when it has been removed or the snippets were
+	reloaded since.
+*/
+SnippetTranslation *snippet_handle_get(SnippetHandle handle)
+{
+	const guint32 slot_index=handle&G_MAXUINT32;
+	const guint32 generation=handle>>32;
+	
+	if(!GLOBAL_SNIPPET_SLOTS || slot_index>=GLOBAL_SNIPPET_SLOTS->len)
+	{
+		return NULL;
+	}
+	
+	SnippetSlot *slot=&g_array_index(GLOBAL_SNIPPET_SLOTS,SnippetSlot,slot_index);
+	
+	return slot->generation==generation?slot->sntran:NULL;
+}
+
+static void add_block_snippet(SnippetTranslation *sntran)
+{
+	SnippetBlock *block=get_or_create_block(strlen(sntran->from));
+	sntran->node_index=block->nodes->len;
+	g_ptr_array_add(block->nodes,sntran);
+}
+
+static void remove_block_snippet(SnippetTranslation *sntran)
+{
+	SnippetBlock *block=get_or_create_block(strlen(sntran->from));
+	
+	//the last one takes its place
+	g_ptr_array_remove_index_fast(block->nodes,sntran->node_index);
+	
+	if(sntran->node_index<block->nodes->len)
+	{
+		((SnippetTranslation *)g_ptr_array_index(block->nodes,sntran->node_index))->node_index=sntran->node_index;
+	}
+}
+
+//FALSE for the snippets in GLOBAL_SHADOWED_SNIPPETS
+static gboolean is_snippet_in_block(SnippetTranslation *sntran)
+{
+	SnippetBlock *block=get_or_create_block(strlen(sntran->from));
+	
+	return sntran->node_index<block->nodes->len && g_ptr_array_index(block->nodes,sntran->node_index)==sntran;
+}
+
+//an earlier snippet has the trigger for every language of sntran
+static gboolean is_snippet_shadowed(SnippetTranslation *sntran)
+{
+	return sntran->shadowed_languages && !sntran->programming_languages[g_strv_length((GStrv)sntran->shadowed_languages)];
+}
+
+//an earlier layer wins, and within a layer the one that came first, like in resolve_snippet_layers
+static gboolean is_shadowing_candidate(SnippetTranslation *candidate, SnippetTranslation *sntran)
+{
+	const guint candidate_layer=get_snippet_layer(candidate);
+	const guint layer=get_snippet_layer(sntran);
+	
+	if(candidate_layer!=layer)
+	{
+		return candidate_layer<layer;
+	}
+	
+	return candidate->sequence<sntran->sequence;
+}
+
+//sets shadowed_languages and shadowed_by again after the snippets of its trigger changed
+static void find_snippet_shadows(SnippetTranslation *sntran)
+{
+	GPtrArray *candidates=g_hash_table_lookup(GLOBAL_SNIPPETS_BY_TRIGGER,sntran->from);
+	g_autoptr(GPtrArray) shadowed_languages=g_ptr_array_new();
+	
+	sntran->shadowed_by=NULL;
+	sntran->shadowed_languages=NULL;
+	
+	for(guint k=0;sntran->programming_languages[k];k++)
+	{
+		for(guint i=0;candidates && i<candidates->len;i++)
+		{
+			SnippetTranslation *candidate=g_ptr_array_index(candidates,i);
+			
+			if(candidate!=sntran && language_exists_in_obj(candidate,sntran->programming_languages[k]) && is_shadowing_candidate(candidate,sntran))
+			{
+				sntran->shadowed_by=sntran->shadowed_by?sntran->shadowed_by:candidate;
+				g_ptr_array_add(shadowed_languages,(gpointer)sntran->programming_languages[k]);
+				break;
+			}
+		}
+	}
+	
+	if(shadowed_languages->len>0)
+	{
+		sntran->shadowed_languages=snippet_arena_new0(GLOBAL_SNIPPET_ARENA,const char *,shadowed_languages->len+1);
+		memcpy(sntran->shadowed_languages,shadowed_languages->pdata,shadowed_languages->len*sizeof(const char *));
+	}
+}
+
+/**
+	Finds what shadows the snippets of trigger again after one of them changed, and moves the
+	ones that lost all their languages from their block to GLOBAL_SHADOWED_SNIPPETS or back.
+	Only for the edits made while running, a load leaves it all to resolve_snippet_layers.
+*/
+static void refresh_snippet_shadows(const char *trigger)
+{
+	GPtrArray *candidates=g_hash_table_lookup(GLOBAL_SNIPPETS_BY_TRIGGER,trigger);
+	
+	for(guint i=0;candidates && i<candidates->len;i++)
+	{
+		SnippetTranslation *candidate=g_ptr_array_index(candidates,i);
+		
+		find_snippet_shadows(candidate);
+		
+		const gboolean shadowed=is_snippet_shadowed(candidate);
+		const gboolean in_block=is_snippet_in_block(candidate);
+		
+		if(shadowed && in_block)
+		{
+			remove_block_snippet(candidate);
+			g_ptr_array_add(GLOBAL_SHADOWED_SNIPPETS,candidate);
+		}
+		else if(!shadowed && !in_block)
+		{
+			g_ptr_array_remove(GLOBAL_SHADOWED_SNIPPETS,candidate);
+			add_block_snippet(candidate);
+		}
+	}
+}
+
+//into its block and the trigger lookup, not the language indexes
+static void link_snippet(SnippetTranslation *sntran)
+{
+	add_block_snippet(sntran);
+	
+	GPtrArray *candidates=g_hash_table_lookup(GLOBAL_SNIPPETS_BY_TRIGGER,sntran->from);
+	
+	if(!candidates)
+	{
+		candidates=g_ptr_array_new();
+		g_hash_table_insert(GLOBAL_SNIPPETS_BY_TRIGGER,(gpointer)sntran->from,candidates);
+	}
+	
+	g_ptr_array_add(candidates,sntran);
+}
+
+static void unlink_snippet(SnippetTranslation *sntran)
+{
+	if(is_snippet_in_block(sntran))
+	{
+		remove_block_snippet(sntran);
+	}
+	else
+	{
+		g_ptr_array_remove(GLOBAL_SHADOWED_SNIPPETS,sntran);
+	}
+	
+	GPtrArray *candidates=g_hash_table_lookup(GLOBAL_SNIPPETS_BY_TRIGGER,sntran->from);
+	
+	//in load order, which decides between equals
+	if(candidates && g_ptr_array_remove(candidates,sntran) && candidates->len==0)
+	{
+		g_hash_table_remove(GLOBAL_SNIPPETS_BY_TRIGGER,sntran->from);
+	}
+}
+
+//into the blocks and the trigger lookup with a handle, what shadows it and the language indexes are left as they are
+static void add_index_snippet(SnippetTranslation *sntran)
+{
+	link_snippet(sntran);
+	sntran->handle=allocate_snippet_slot(sntran);
+	sntran->sequence=++GLOBAL_SNIPPET_SEQUENCE;
+	
+	if(GLOBAL_SNIPPET_ADDED_FUNC && sntran->to)
+	{
+		GLOBAL_SNIPPET_ADDED_FUNC(sntran->to,GLOBAL_SNIPPET_ADDED_DATA);
+	}
+}
+
+/**
+	Makes sntran expandable and returns its handle. The blocks, the trigger lookup and the built
+	language indexes are updated in place, nothing is rebuilt.
+*/
+SnippetHandle snippet_index_insert(SnippetTranslation *sntran)
+{
+	add_index_snippet(sntran);
+	refresh_snippet_shadows(sntran->from);
+	refresh_language_indexes(sntran->from);
+	
+	return sntran->handle;
+}
+
+/**
+	Takes the snippet out of the index, the snippet it shadowed takes over if there is one. The
+	snippet itself stays valid until the next reload.
+*/
+int snippet_index_remove(SnippetHandle handle)
+{
+	SnippetTranslation *sntran=snippet_handle_get(handle);
+	
+	if(!sntran)
+	{
+		return -1;
+	}
+	
+	unlink_snippet(sntran);
+	release_snippet_slot(handle);
+	refresh_snippet_shadows(sntran->from);
+	refresh_language_indexes(sntran->from);
+	
+	return 0;
+}
+
+int snippet_index_rename(SnippetHandle handle, const char *tag)
+{
+	SnippetTranslation *sntran=snippet_handle_get(handle);
+	
+	if(!sntran)
+	{
+		return -1;
+	}
+	
+	const char *old_tag=sntran->from;
+	
+	unlink_snippet(sntran);
+	sntran->from=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,tag);
+	link_snippet(sntran);
+	
+	refresh_snippet_shadows(old_tag);
+	refresh_snippet_shadows(sntran->from);
+	refresh_language_indexes(old_tag);
+	refresh_language_indexes(sntran->from);
+	
+	return 0;
+}
+
+int snippet_index_set_languages(SnippetHandle handle, GStrv programming_languages)
+{
+	SnippetTranslation *sntran=snippet_handle_get(handle);
+	
+	if(!sntran)
+	{
+		return -1;
+	}
+	
+	sntran->programming_languages=snippet_languages_new(programming_languages);
+	refresh_snippet_shadows(sntran->from);
+	refresh_language_indexes(sntran->from);
+	
+	return 0;
+}
+
+/**
+	Call after changing the snippets other than through the snippet_index_ functions, everything
+	built from them is built again when it is next used.
+*/
+void mark_snippets_changed()
+{
+	GLOBAL_SNIPPETS_GENERATION++;
+}
+
+SnippetTranslation *snippet_translation_new()
+{
+	SnippetTranslation *self = snippet_arena_new0(GLOBAL_SNIPPET_ARENA,SnippetTranslation,1);
+	return self;
+}
+
+const char **snippet_languages_new(GStrv programming_languages)
+{
+	const guint languages_len=g_strv_length(programming_languages);
+	const char **languages=snippet_arena_new0(GLOBAL_SNIPPET_ARENA,const char *,languages_len+1);
+	
+	for (guint i = 0; i < languages_len; i++)
+	{
+		languages[i]=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,programming_languages[i]);
+	}
+	
+	return languages;
+}
+
+/**
+	Only reads the node, so it is safe to call from the parser threads.
+*/
+static void read_snippet_fields(xmlNode *node, char **tag, char **text, char **description)
+{
+	for (xmlNode *child = node->children; child; child = child->next)
+	{
+		if (child->type == XML_ELEMENT_NODE)
+		{
+			if (g_strcmp0((const char *)child->name, "tag") == 0)
+			{
+				g_free(*tag);
+				*tag = (char *)xmlNodeGetContent(child);
+			}
+			else if (g_strcmp0((const char *)child->name, "text") == 0)
+			{
+				g_free(*text);
+				*text = (char *)xmlNodeGetContent(child);
+			}
+			else if (g_strcmp0((const char *)child->name, "description") == 0)
+			{
+				g_free(*description);
+				*description = (char *)xmlNodeGetContent(child);
+			}
+		}
+	}
+}
+
+//loading leaves the shadows to resolve_snippet_layers and the language indexes to their rebuild, once all are there
+static void add_snippet_translation(xmlNode *node, const char *tag, const char *text, const char *description, XmlFileInformation *fileinf, const char **programming_languages, gboolean loading)
+{
+	SnippetTranslation *entry = snippet_translation_new();
+	entry->from = snippet_arena_intern(GLOBAL_SNIPPET_ARENA,tag);
+	entry->to = snippet_arena_intern(GLOBAL_SNIPPET_ARENA,text);
+	entry->variables = get_snippet_variable_mask(text);
+	entry->description = snippet_arena_intern(GLOBAL_SNIPPET_ARENA,description);
+	entry->programming_languages = programming_languages;
+	entry->fileinf=fileinf;
+	entry->child=node;
+	//printf("FROM: %s %s\n",entry->from,entry->to);
+	
+	if(loading)
+	{
+		add_index_snippet(entry);
+	}
+	else
+	{
+		snippet_index_insert(entry);
+	}
+}
+
+static void process_snippet(xmlNode *node, XmlFileInformation *fileinf, GStrv programming_languages)
+{
+	g_autofree char *tag = NULL;
+	g_autofree char *text = NULL;
+	g_autofree char *description = NULL;
+	
+	read_snippet_fields(node,&tag,&text,&description);
+
+	if (tag && text)
+	{
+		add_snippet_translation(node,tag,text,description,fileinf,snippet_languages_new(programming_languages),FALSE);
+	}
+}
+
+int load_snippet_node(xmlNode *node, XmlFileInformation *fileinf, GStrv programming_languages)
+{
+	if (node->type != XML_ELEMENT_NODE || g_strcmp0((const char *)node->name, "snippet") != 0)
+	{
+		return -1;
+	}
+	
+	process_snippet(node,fileinf,programming_languages);
+	
+	return 0;
+}
+
+typedef struct ParsedSnippet
+{
+	xmlNode *node;
+	char *tag;
+	char *text;
+	char *description;
+}ParsedSnippet;
+
+/**
+	One snippet file. The parser threads only fill doc and snippets, everything
+	shared (the arena, the blocks, GLOBAL_XML_FILE_INFO) is touched when merging.
+*/
+typedef struct SnippetFileJob
+{
+	char *filepath;
+	GStrv programming_languages;
+	guint layer;
+	xmlDoc *doc;
+	GArray *snippets; ///< ParsedSnippet
+}SnippetFileJob;
+
+static void parsed_snippet_clear(ParsedSnippet *self)
+{
+	g_free(self->tag);
+	g_free(self->text);
+	g_free(self->description);
+}
+
+static void snippet_file_job_free(SnippetFileJob *self)
 {
-	for (guint i = 0; i < GLOBAL_SNIPPETS->len; i++)
+	g_free(self->filepath);
+	g_strfreev(self->programming_languages);
+	
+	//only set if the file was not merged
+	if(self->doc)
 	{
-		SnippetBlock *block = g_ptr_array_index(GLOBAL_SNIPPETS, i);
-		if (block->str_len == str_len)
-			return block;
+		xmlFreeDoc(self->doc);
 	}
-
-	SnippetBlock *new_block = g_malloc(sizeof(SnippetBlock));
-	new_block->str_len = str_len;
-	new_block->nodes = g_ptr_array_new_with_free_func((GDestroyNotify)snippet_translation_free);
-	g_ptr_array_add(GLOBAL_SNIPPETS, new_block);
-
-	return new_block;
+	
+	g_array_free(self->snippets,TRUE);
+	g_free(self);
 }
 
-SnippetTranslation *snippet_translation_new()
+static SnippetFileJob *snippet_file_job_new(const char *filepath, GStrv programming_languages, guint layer)
 {
-	SnippetTranslation *self = g_new0(SnippetTranslation,1);
-	self->programming_languages=g_ptr_array_new_with_free_func(g_free);
+	SnippetFileJob *self=g_new0(SnippetFileJob,1);
+	self->filepath=g_strdup(filepath);
+	self->programming_languages=g_strdupv(programming_languages);
+	self->layer=layer;
+	self->snippets=g_array_new(FALSE,TRUE,sizeof(ParsedSnippet));
+	g_array_set_clear_func(self->snippets,(GDestroyNotify)parsed_snippet_clear);
+	
 	return self;
 }
 
-static void process_snippet(xmlNode *node, XmlFileInformation *fileinf, GStrv programming_languages)
+static void parse_snippet_file(gpointer data, gpointer user_data)
 {
-	g_autofree char *tag = NULL;
-	g_autofree char *text = NULL;
-	g_autofree char *description = NULL;
+	SnippetFileJob *job=data;
+
+	//snippet files never need the network, an external entity should not reach out
+	job->doc = xmlReadFile(job->filepath, NULL, XML_PARSE_NONET);
+	if (!job->doc)
+	{
+		return;
+	}
+
+	xmlNode *root = xmlDocGetRootElement(job->doc);
+	if (!root)
+	{
+		return;
+	}
 	
-	for (xmlNode *child = node->children; child; child = child->next)
+	for (xmlNode *node = root->children; node; node = node->next)
 	{
-		if (child->type == XML_ELEMENT_NODE)
+		if (node->type == XML_ELEMENT_NODE && g_strcmp0((const char *)node->name, "snippet") == 0)
 		{
-			if (g_strcmp0((const char *)child->name, "tag") == 0)
-			{
-				tag = (char *)xmlNodeGetContent(child);
-			}
-			else if (g_strcmp0((const char *)child->name, "text") == 0)
+			ParsedSnippet parsed={.node=node};
+			read_snippet_fields(node,&parsed.tag,&parsed.text,&parsed.description);
+			
+			//the expansion walks the text as UTF-8
+			if (parsed.tag && parsed.text && g_utf8_validate(parsed.tag,-1,NULL) && g_utf8_validate(parsed.text,-1,NULL)
+				&& (!parsed.description || g_utf8_validate(parsed.description,-1,NULL)))
 			{
-				text = (char *)xmlNodeGetContent(child);
+				g_array_append_val(job->snippets,parsed);
 			}
-			else if (g_strcmp0((const char *)child->name, "description") == 0)
+			else
 			{
-				description = (char *)xmlNodeGetContent(child);
+				parsed_snippet_clear(&parsed);
 			}
 		}
 	}
-
-	if (tag && text)
-	{
-		const size_t tag_len = strlen(tag);
-		SnippetBlock *block = get_or_create_block(tag_len);
-		
-		SnippetTranslation *entry = snippet_translation_new();
-		entry->from = g_steal_pointer(&tag);
-		entry->to = g_steal_pointer(&text);
-		entry->description = g_steal_pointer(&description);
-		for (gint i = 0; programming_languages[i] != NULL; i++)
-		{
-			g_ptr_array_add(entry->programming_languages,g_strdup(programming_languages[i]));
-		}
-		entry->fileinf=fileinf;
-		entry->child=node;
-		//printf("FROM: %s %s\n",entry->from,entry->to);
-		g_ptr_array_add(block->nodes, entry);
-	}
 }
 
-static void parse_snippet_file(const char *filepath, GStrv programming_languages)
+static void merge_snippet_file(SnippetFileJob *job)
 {
-	XmlFileInformation *fileinf=NULL;
-
-	xmlDoc *doc = xmlReadFile(filepath, NULL, 0);
-	if (!doc)
+	if (!job->doc)
 	{
 		return;
 	}
 	
-	if(!g_hash_table_contains(GLOBAL_XML_FILE_INFO,filepath))
-	{
-		fileinf = g_new0(XmlFileInformation,1);
-		fileinf->doc=doc;
-		fileinf->filename=g_strdup(filepath);
-	
-		g_hash_table_insert(GLOBAL_XML_FILE_INFO,g_strdup(filepath),fileinf);
-	}
-	else
+	//the same path twice keeps the first one, like before
+	if(g_hash_table_contains(GLOBAL_XML_FILE_INFO,job->filepath))
 	{
-		fileinf = g_hash_table_lookup(GLOBAL_XML_FILE_INFO,filepath);
+		return;
 	}
-
-	xmlNode *root = xmlDocGetRootElement(doc);
-	for (xmlNode *node = root->children; node; node = node->next)
+	
+	XmlFileInformation *fileinf = g_new0(XmlFileInformation,1);
+	fileinf->doc=g_steal_pointer(&job->doc);
+	fileinf->filename=g_strdup(job->filepath);
+	fileinf->layer=job->layer;
+	
+	g_hash_table_insert(GLOBAL_XML_FILE_INFO,g_strdup(job->filepath),fileinf);
+	
+	//every snippet of the file shares the language list, edits replace it rather than change it
+	const char **programming_languages=snippet_languages_new(job->programming_languages);
+	
+	for (guint i = 0; i < job->snippets->len; i++)
 	{
-		if (node->type == XML_ELEMENT_NODE && g_strcmp0((const char *)node->name, "snippet") == 0)
-		{
-			process_snippet(node,fileinf,programming_languages);
-		}
+		ParsedSnippet *parsed=&g_array_index(job->snippets,ParsedSnippet,i);
+		add_snippet_translation(parsed->node,parsed->tag,parsed->text,parsed->description,fileinf,programming_languages,TRUE);
 	}
 }
 
+/**
+	Puts a new snippet into the user file of its first language, which gets created if there is
+	none. Returns 1 when it is in that file already, -1 when the file can not be used.
+*/
 int fix_xml_file_from_snippet_translation(SnippetTranslation *self)
 {
 	const char *langauage="c";
 
-	if(self->programming_languages->len>0)
+	if(self->programming_languages[0])
 	{
-		langauage=g_ptr_array_index(self->programming_languages,0);
+		langauage=self->programming_languages[0];
 	}
 
-	g_autofree char *preferred_file=g_build_filename(g_get_home_dir(), ".config/gedit/snippets/", langauage, ".xml", NULL);
+	g_autofree char *preferred_file=get_user_snippet_file(langauage);
 	
 	if(self->fileinf && g_strcmp0(self->fileinf->filename,preferred_file)==0)
 	{
@@ -186,61 +973,16 @@ int fix_xml_file_from_snippet_translation(SnippetTranslation *self)
 		return 1;
 	}
 	
-	GHashTableIter hiter;
-	gpointer key, value;
-
-	g_hash_table_iter_init(&hiter, GLOBAL_XML_FILE_INFO);
-	while (g_hash_table_iter_next(&hiter, &key, &value))
-	{
-		XmlFileInformation *fileinf=value;
-		
-		if(g_strcmp0(fileinf->filename,preferred_file)==0)
-		{
-			self->fileinf=fileinf;
-			break;
-		}
-	}
+	XmlFileInformation *fileinf=get_or_create_user_snippet_file(langauage);
 	
-	//did not find the file
-	if(!self->fileinf)
+	if(!fileinf)
 	{
-		XmlFileInformation *new_fileinf=g_new0(XmlFileInformation,1);
-		
-		new_fileinf->filename=g_steal_pointer(&preferred_file);
-		
-		xmlDocPtr doc = xmlNewDoc((const xmlChar*)"1.0");
-		xmlNodePtr root = xmlNewNode(NULL, (const xmlChar*)"snippets");
-		xmlNewProp(root, (const xmlChar*)"language", (const xmlChar*)langauage);
-		xmlDocSetRootElement(doc, root);
-
-		// <snippet>
-		xmlNodePtr snippet = xmlNewChild(root, NULL, (const xmlChar*)"snippet", NULL);
-
-		// <tag>if_cpp</tag>
-		xmlNewChild(snippet, NULL, (const xmlChar*)"tag", (const xmlChar*)self->from);
-
-		// <text><![CDATA[ ... ]]></text>
-		const char *cdata_content = self->to;
-
-		xmlNodePtr text_node = xmlNewChild(snippet, NULL, (const xmlChar*)"text", NULL);
-		xmlNodePtr cdata = xmlNewCDataBlock(doc, (const xmlChar*)cdata_content, strlen(cdata_content));
-		xmlAddChild(text_node, cdata);
-
-		// <description>if_cpp</description>
-		xmlNewChild(snippet, NULL, (const xmlChar*)"description", (const xmlChar*)self->description);
-
-		// Save the document to stdout
-		g_autofree xmlChar *xmlbuff;
-		int buffersize;
-		xmlDocDumpFormatMemoryEnc(doc, &xmlbuff, &buffersize, "utf-8", 1);
-		g_print("%s", (char *)xmlbuff);
-
-		new_fileinf->doc=doc;
-
-		self->child=snippet;
-		self->fileinf=new_fileinf;
+		return -1;
 	}
 	
+	self->fileinf=fileinf;
+	self->child=append_snippet_node(fileinf,self->from,self->to,self->description);
+	
 	return 0;
 }
 
@@ -325,6 +1067,111 @@ int save_snippet_translation(SnippetTranslation *self, int options)
 	return 0;
 }
 
+char *get_user_snippet_file(const char *language)
+{
+	g_autofree char *filename=g_strconcat(language, ".xml", NULL);
+	
+	return g_build_filename(g_get_home_dir(), ".config/gedit/snippets", filename, NULL);
+}
+
+XmlFileInformation *get_or_create_user_snippet_file(const char *language)
+{
+	g_autofree char *filepath=get_user_snippet_file(language);
+	
+	XmlFileInformation *fileinf=g_hash_table_lookup(GLOBAL_XML_FILE_INFO,filepath);
+	
+	if(fileinf)
+	{
+		return fileinf;
+	}
+	
+	//there but not loaded, most likely it did not parse, and an empty doc would be saved over it
+	if(g_file_test(filepath,G_FILE_TEST_EXISTS))
+	{
+		fprintf(stderr,"%s:%d %s exists but is not loaded, fix or move it first\n",__FILE__,__LINE__,filepath);
+		return NULL;
+	}
+	
+	xmlDocPtr doc = xmlNewDoc((const xmlChar*)"1.0");
+	xmlNodePtr root = xmlNewNode(NULL, (const xmlChar*)"snippets");
+	xmlNewProp(root, (const xmlChar*)"language", (const xmlChar*)language);
+	xmlDocSetRootElement(doc, root);
+	
+	fileinf = g_new0(XmlFileInformation,1);
+	fileinf->doc=doc;
+	fileinf->filename=g_strdup(filepath);
+	
+	g_hash_table_insert(GLOBAL_XML_FILE_INFO,g_steal_pointer(&filepath),fileinf);
+	
+	return fileinf;
+}
+
+/**
+	Returns the <snippet> of fileinf with tag, or NULL when it has none.
+*/
+xmlNode *find_snippet_node(XmlFileInformation *fileinf, const char *tag)
+{
+	xmlNode *root = xmlDocGetRootElement(fileinf->doc);
+	
+	for (xmlNode *node = root?root->children:NULL; node; node = node->next)
+	{
+		if (node->type != XML_ELEMENT_NODE || g_strcmp0((const char *)node->name, "snippet") != 0)
+		{
+			continue;
+		}
+		
+		g_autofree char *node_tag = NULL;
+		g_autofree char *text = NULL;
+		g_autofree char *description = NULL;
+		
+		read_snippet_fields(node,&node_tag,&text,&description);
+		
+		if (g_strcmp0(node_tag,tag) == 0)
+		{
+			return node;
+		}
+	}
+	
+	return NULL;
+}
+
+xmlNode *append_snippet_node(XmlFileInformation *fileinf, const char *tag, const char *text, const char *description)
+{
+	xmlNode *root = xmlDocGetRootElement(fileinf->doc);
+	
+	xmlNodePtr snippet = xmlNewChild(root, NULL, (const xmlChar*)"snippet", NULL);
+	xmlNewTextChild(snippet, NULL, (const xmlChar*)"tag", (const xmlChar*)tag);
+	
+	xmlNodePtr text_node = xmlNewChild(snippet, NULL, (const xmlChar*)"text", NULL);
+	xmlAddChild(text_node, xmlNewCDataBlock(fileinf->doc, (const xmlChar*)text, strlen(text)));
+	
+	if(description)
+	{
+		xmlNewTextChild(snippet, NULL, (const xmlChar*)"description", (const xmlChar*)description);
+	}
+	
+	return snippet;
+}
+
+int save_xml_file_information(XmlFileInformation *fileinf)
+{
+	g_autofree char *dirname=g_path_get_dirname(fileinf->filename);
+	
+	if(g_mkdir_with_parents(dirname,0755)!=0)
+	{
+		fprintf(stderr,"%s:%d Could not create the directory %s\n",__FILE__,__LINE__,dirname);
+		return -1;
+	}
+	
+	if(xmlSaveFormatFileEnc(fileinf->filename, fileinf->doc, "utf-8", 1)<0)
+	{
+		fprintf(stderr,"%s:%d Could not save %s\n",__FILE__,__LINE__,fileinf->filename);
+		return -1;
+	}
+	
+	return 0;
+}
+
 static void _xml_file_information_free(XmlFileInformation *self)
 {
 	xmlFreeDoc(self->doc);
@@ -335,8 +1182,16 @@ static void _xml_file_information_free(XmlFileInformation *self)
 
 int configuration_init()
 {
-	GLOBAL_SNIPPETS = g_ptr_array_new_with_free_func((GDestroyNotify)g_free);
+	GLOBAL_SNIPPETS = g_ptr_array_new_with_free_func((GDestroyNotify)snippet_block_free);
 	GLOBAL_XML_FILE_INFO = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)_xml_file_information_free);
+	GLOBAL_SNIPPET_ARENA = snippet_arena_new(SNIPPET_ARENA_CHUNK_SIZE);
+	//the snippets are in the arena
+	GLOBAL_SHADOWED_SNIPPETS = g_ptr_array_new();
+	GLOBAL_SNIPPET_LANGUAGE_INDEXES = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)snippet_language_index_free);
+	//the triggers are the strings of the snippets
+	GLOBAL_SNIPPETS_BY_TRIGGER = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_ptr_array_unref);
+	GLOBAL_SNIPPET_SLOTS = g_array_new(FALSE, FALSE, sizeof(SnippetSlot));
+	GLOBAL_SNIPPET_FREE_SLOT = 0;
 	
 	return 0;
 }
@@ -344,28 +1199,248 @@ int configuration_init()
 int configuration_finalize()
 {
 	g_ptr_array_free(GLOBAL_SNIPPETS,TRUE);
+	g_ptr_array_free(GLOBAL_SHADOWED_SNIPPETS,TRUE);
+	g_clear_pointer(&GLOBAL_SNIPPET_LANGUAGE_INDEXES,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_SNIPPETS_BY_TRIGGER,g_hash_table_destroy);
+	g_array_free(GLOBAL_SNIPPET_SLOTS,TRUE);
+	GLOBAL_SNIPPET_SLOTS = NULL;
+	g_clear_pointer(&GLOBAL_SNIPPET_LAYERS,g_strfreev);
 	g_hash_table_destroy(GLOBAL_XML_FILE_INFO);
+	snippet_arena_free(GLOBAL_SNIPPET_ARENA);
+	GLOBAL_SNIPPET_ARENA = NULL;
 	
 	return 0;
 }
 
-int load_configuration()
+static gint sort_filename(gconstpointer a, gconstpointer b)
+{
+	return strcmp(*(const char **)a,*(const char **)b);
+}
+
+/**
+	How many threads parse the snippet files, 0 for one per core. With 1 no thread is started
+	and they are parsed on the calling thread, for a process that forks after loading.
+*/
+int configuration_set_parser_threads(guint threads_len)
+{
+	GLOBAL_SNIPPET_PARSER_THREADS=threads_len;
+	
+	return 0;
+}
+
+/**
+	Parses the files on a thread pool with one thread per core and returns when
+	all of them are done. Falls back to this thread if no pool can be made.
+*/
+static void parse_snippet_files(GPtrArray *jobs)
+{
+	const guint threads_len=MIN(GLOBAL_SNIPPET_PARSER_THREADS?GLOBAL_SNIPPET_PARSER_THREADS:g_get_num_processors(),jobs->len);
+	
+	if(threads_len<=1)
+	{
+		for (guint i = 0; i < jobs->len; i++)
+		{
+			parse_snippet_file(g_ptr_array_index(jobs,i),NULL);
+		}
+		return;
+	}
+	
+	//libxml2 has to be set up once before it is used from several threads
+	xmlInitParser();
+	
+	g_autoptr(GError) error=NULL;
+	GThreadPool *pool=g_thread_pool_new(parse_snippet_file,NULL,threads_len,FALSE,&error);
+	
+	if(!pool)
+	{
+		fprintf(stderr,"%s:%d Could not create the parser threads: %s\n",__FILE__,__LINE__,error->message);
+		
+		for (guint i = 0; i < jobs->len; i++)
+		{
+			parse_snippet_file(g_ptr_array_index(jobs,i),NULL);
+		}
+		return;
+	}
+	
+	for (guint i = 0; i < jobs->len; i++)
+	{
+		g_thread_pool_push(pool,g_ptr_array_index(jobs,i),NULL);
+	}
+	
+	//waits for the queued files
+	g_thread_pool_free(pool,FALSE,TRUE);
+}
+
+static void add_snippet_directory(GPtrArray *dirs, char *dir)
+{
+	for(guint i=0;i<dirs->len;i++)
+	{
+		if(g_strcmp0(g_ptr_array_index(dirs,i),dir)==0)
+		{
+			g_free(dir);
+			return;
+		}
+	}
+	
+	g_ptr_array_add(dirs,dir);
+}
+
+/**
+	The directories the snippets are read from, one layer each and the first wins: the user's,
+	then gedit/plugins/snippets in every $XDG_DATA_DIRS entry. /usr/share and /usr/local/share
+	are always searched, last if XDG_DATA_DIRS leaves them out. Free with g_strfreev.
+*/
+GStrv get_snippet_directories()
+{
+	GPtrArray *dirs=g_ptr_array_new();
+	
+	g_ptr_array_add(dirs,g_build_filename(g_get_home_dir(), ".config/gedit/snippets", NULL));
+	
+	const char *const *data_dirs=g_get_system_data_dirs();
+	
+	for(size_t i=0;data_dirs[i];i++)
+	{
+		add_snippet_directory(dirs,g_build_filename(data_dirs[i], "gedit/plugins/snippets", NULL));
+	}
+	
+	add_snippet_directory(dirs,g_strdup("/usr/share/gedit/plugins/snippets"));
+	add_snippet_directory(dirs,g_strdup("/usr/local/share/gedit/plugins/snippets"));
+	g_ptr_array_add(dirs,NULL);
+	
+	return (GStrv)g_ptr_array_free(dirs,FALSE);
+}
+
+/**
+	The directory of a layer for showing to the user, with the home directory as "~".
+*/
+char *get_snippet_layer_name(guint layer)
+{
+	if(!GLOBAL_SNIPPET_LAYERS || layer>=g_strv_length(GLOBAL_SNIPPET_LAYERS))
+	{
+		return g_strdup("?");
+	}
+	
+	const char *dir=GLOBAL_SNIPPET_LAYERS[layer];
+	const char *home=g_get_home_dir();
+	const size_t home_len=strlen(home);
+	
+	if(home_len>1 && strncmp(dir,home,home_len)==0 && dir[home_len]=='/')
+	{
+		return g_strconcat("~",dir+home_len,NULL);
+	}
+	
+	return g_strdup(dir);
+}
+
+/**
+	Finds the snippet of the earliest layer and within a layer of the first file for every trigger
+	and language. The lookups rank them the same way, this is for the manager: a snippet that
+	loses keeps its languages and lists the ones it lost in shadowed_languages, one that loses all
+	moves from its block to GLOBAL_SHADOWED_SNIPPETS. Either way it stays a candidate of its
+	trigger with its handle, so it takes over when the winner is removed, and shadowed_by
+	points at the first winner. This is the only resolution of a load, the snippets are
+	merged without it and refresh_snippet_shadows takes over for the edits after it.
+*/
+static void resolve_snippet_layers()
+{
+	//"language\ntag" -> the SnippetTranslation that has it
+	g_autoptr(GHashTable) owners=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	g_autoptr(GPtrArray) shadowed_languages=g_ptr_array_new();
+	
+	for (guint i = 0; i < GLOBAL_SNIPPETS->len; i++)
+	{
+		SnippetBlock *block = g_ptr_array_index(GLOBAL_SNIPPETS, i);
+		guint kept=0;
+		
+		for (guint j = 0; j < block->nodes->len; j++)
+		{
+			SnippetTranslation *sntran = g_ptr_array_index(block->nodes, j);
+			const char **languages=sntran->programming_languages;
+			
+			g_ptr_array_set_size(shadowed_languages,0);
+			
+			for (guint k = 0; languages[k]; k++)
+			{
+				g_autofree char *lower=g_ascii_strdown(languages[k],-1);
+				char *key=g_strconcat(lower,"\n",sntran->from,NULL);
+				SnippetTranslation *owner=g_hash_table_lookup(owners,key);
+				
+				if(owner==sntran)
+				{
+					//the file names the language twice
+					g_free(key);
+				}
+				else if(owner)
+				{
+					sntran->shadowed_by=sntran->shadowed_by?sntran->shadowed_by:owner;
+					g_ptr_array_add(shadowed_languages,(gpointer)languages[k]);
+					g_free(key);
+				}
+				else
+				{
+					g_hash_table_insert(owners,key,sntran);
+				}
+			}
+			
+			if(shadowed_languages->len>0)
+			{
+				//the strings are interned already
+				sntran->shadowed_languages=snippet_arena_new0(GLOBAL_SNIPPET_ARENA,const char *,shadowed_languages->len+1);
+				memcpy(sntran->shadowed_languages,shadowed_languages->pdata,shadowed_languages->len*sizeof(const char *));
+			}
+			
+			if(is_snippet_shadowed(sntran))
+			{
+				g_ptr_array_add(GLOBAL_SHADOWED_SNIPPETS,sntran);
+			}
+			else
+			{
+				block->nodes->pdata[kept++]=sntran;
+			}
+		}
+		
+		g_ptr_array_set_size(block->nodes,kept);
+		renumber_snippet_block(block,0);
+	}
+}
+
+/**
+	Drops the loaded snippets and loads the ones in dirs, a NULL terminated list.
+*/
+int load_snippet_directories(const char *const *dirs)
 {
+	//the handles of the previous load stop working
+	for (guint i = 0; i < GLOBAL_SNIPPET_SLOTS->len; i++)
+	{
+		SnippetSlot *slot = &g_array_index(GLOBAL_SNIPPET_SLOTS, SnippetSlot, i);
+		
+		if (slot->sntran)
+		{
+			release_snippet_slot(((SnippetHandle)slot->generation<<32)|i);
+		}
+	}
+	
+	g_hash_table_remove_all(GLOBAL_SNIPPETS_BY_TRIGGER);
+	GLOBAL_SNIPPET_SEQUENCE=0;
 	g_ptr_array_set_size(GLOBAL_SNIPPETS,0);
+	g_ptr_array_set_size(GLOBAL_SHADOWED_SNIPPETS,0);
 	g_hash_table_remove_all(GLOBAL_XML_FILE_INFO);
-
-	g_autofree char *home_config_dir=g_build_filename(g_get_home_dir(), ".config/gedit/snippets/", NULL);
+	mark_snippets_changed();
+	
+	g_strfreev(GLOBAL_SNIPPET_LAYERS);
+	GLOBAL_SNIPPET_LAYERS=g_strdupv((GStrv)dirs);
 	
-	char *dirs[] = {
-		home_config_dir,
-		"/usr/share/gedit/plugins/snippets/",
-		"/usr/local/share/gedit/plugins/snippets/"
-	};
+	//drop the previous generation in one go
+	snippet_arena_free(GLOBAL_SNIPPET_ARENA);
+	GLOBAL_SNIPPET_ARENA = snippet_arena_new(SNIPPET_ARENA_CHUNK_SIZE);
 	
 	const char *const file_suffix=".xml";
 	const size_t file_suffix_len=strlen(file_suffix);
 	
-	for (size_t i = 0; i < G_N_ELEMENTS(dirs); i++)
+	//in the order they are merged: the directories in order, then the files sorted by name
+	g_autoptr(GPtrArray) jobs=g_ptr_array_new_with_free_func((GDestroyNotify)snippet_file_job_free);
+	
+	for (size_t i = 0; dirs[i]; i++)
 	{
 		g_autoptr(GError) error=NULL;
 		g_autoptr(GDir) dir = g_dir_open(dirs[i], 0, &error);
@@ -375,24 +1450,50 @@ int load_configuration()
 			continue;
 		}
 
+		g_autoptr(GPtrArray) filenames=g_ptr_array_new_with_free_func(g_free);
+		
 		const gchar *filename;
 		while ((filename = g_dir_read_name(dir)))
 		{
 			//printf("READ: %s\n",filename);
 			if (g_str_has_suffix(filename, file_suffix))
 			{
-				gsize len = strlen(filename) - file_suffix_len;
-				g_autofree char *file_language_name=g_strndup(filename, len);
-				
-				g_auto(GStrv) possible_languages=g_strsplit(file_language_name,"_",-1);
-				g_autofree char *filepath = g_build_filename(dirs[i], filename, NULL);
-				parse_snippet_file(filepath,possible_languages);
+				g_ptr_array_add(filenames,g_strdup(filename));
 			}
 		}
+		
+		g_ptr_array_sort(filenames,sort_filename);
+		
+		for (guint j = 0; j < filenames->len; j++)
+		{
+			filename = g_ptr_array_index(filenames,j);
+			
+			gsize len = strlen(filename) - file_suffix_len;
+			g_autofree char *file_language_name=g_strndup(filename, len);
+			
+			g_auto(GStrv) possible_languages=g_strsplit(file_language_name,"_",-1);
+			g_autofree char *filepath = g_build_filename(dirs[i], filename, NULL);
+			g_ptr_array_add(jobs,snippet_file_job_new(filepath,possible_languages,i));
+		}
+	}
+	
+	parse_snippet_files(jobs);
+	
+	for (guint i = 0; i < jobs->len; i++)
+	{
+		merge_snippet_file(g_ptr_array_index(jobs,i));
 	}
+	
+	resolve_snippet_layers();
 
 	g_ptr_array_sort(GLOBAL_SNIPPETS,sort_snippet_block);
 
 	return 0;
 }
 
+int load_configuration()
+{
+	g_auto(GStrv) dirs=get_snippet_directories();
+	
+	return load_snippet_directories((const char *const *)dirs);
+}
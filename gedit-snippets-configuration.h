@@ -20,28 +20,68 @@ freely, subject to the following restrictions:
 #pragma once
 
 #include <glib.h>
-#include <gedit/gedit-window.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 
+#include "gedit-snippets-arena.h"
+
 G_BEGIN_DECLS
 
 typedef struct XmlFileInformation
 {
 	xmlDoc *doc;
 	char *filename;
+	guint layer; ///< index of its directory in GLOBAL_SNIPPET_LAYERS, 0 is the user's
 }XmlFileInformation;
 
+typedef guint64 SnippetHandle; ///< slot in the low 32 bits, the generation of the slot above, 0 is no snippet
+
 typedef struct SnippetTranslation
 {
-	char *from; ///< tag in the xml files
-	char *to; ///< text in the xml files
-	char *description; ///< optional description
-	GPtrArray *programming_languages;
+	const char *from; ///< tag in the xml files
+	const char *to; ///< text in the xml files
+	const char *description; ///< optional description
+	const char **programming_languages; ///< NULL terminated
+	guint32 variables; ///< SNIPPET_VARIABLE_BIT of every variable in to
+	guint expansions; ///< from the usage file, the most used come first in their block
 	XmlFileInformation *fileinf;
 	xmlNode *child;
+	struct SnippetTranslation *shadowed_by; ///< the snippet of an earlier layer that has the trigger for some or all of the languages
+	const char **shadowed_languages; ///< NULL terminated, the languages of programming_languages an earlier snippet has the trigger for, NULL when none
+	SnippetHandle handle; ///< 0 while it is not in the index, like the compiled snippets
+	guint node_index; ///< position in the nodes of its block
+	guint sequence; ///< when it came into the index, of two in one layer the earlier one wins
 }SnippetTranslation;
 
+#define SNIPPET_LANGUAGE_CHAIN_MAX 8
+
+/**
+	Every snippet one language can expand: its own, then the ones of the languages it inherits
+	from and the global ones, flattened so a trigger is one probe. Built on first use and again
+	after a reload, the snippet_index_ functions keep it up to date in between.
+*/
+typedef struct SnippetLanguageIndex
+{
+	guint generation; ///< GLOBAL_SNIPPETS_GENERATION it was built from
+	const char *chain[SNIPPET_LANGUAGE_CHAIN_MAX+1]; ///< the language, its parents, then SNIPPET_GLOBAL_LANGUAGE
+	guint chain_len;
+	GHashTable *triggers; ///< trigger -> SnippetTranslation, the nearest language wins
+	GArray *trigger_lens; ///< guint, in characters, the longest first
+	GArray *trigger_len_counts; ///< guint, the number of triggers with the length at the same position
+}SnippetLanguageIndex;
+
+/**
+	Gets a trigger that a language can expand from now on, see snippet_index_set_trigger_func.
+*/
+typedef void (*SnippetTriggerFunc)(const char *language, const char *trigger, gpointer user_data);
+
+/**
+	Gets the text of every snippet added to the index, see snippet_index_set_added_func.
+*/
+typedef void (*SnippetAddedFunc)(const char *text, gpointer user_data);
+
+#define SNIPPET_GLOBAL_LANGUAGE "global" ///< global.xml has snippets for every language
+
 typedef struct SnippetBlock
 {
 	size_t str_len;
@@ -49,19 +89,47 @@ typedef struct SnippetBlock
 }SnippetBlock;
 
 SnippetTranslation *snippet_translation_new();
+const char **snippet_languages_new(GStrv programming_languages);
+gboolean language_exists_in_obj(SnippetTranslation *self, const gchar *target);
+SnippetTranslation *find_snippet_translation(const char *tag, const char *language);
+SnippetLanguageIndex *get_snippet_language_index(const char *language);
+SnippetHandle snippet_index_insert(SnippetTranslation *sntran);
+int snippet_index_remove(SnippetHandle handle);
+int snippet_index_rename(SnippetHandle handle, const char *tag);
+int snippet_index_set_languages(SnippetHandle handle, GStrv programming_languages);
+int snippet_index_set_trigger_func(SnippetTriggerFunc func, gpointer user_data);
+int snippet_index_set_added_func(SnippetAddedFunc func, gpointer user_data);
+SnippetTranslation *snippet_handle_get(SnippetHandle handle);
+const char *get_snippet_language_parent(const char *language);
 
 int configuration_init();
 int configuration_finalize();
+int configuration_set_parser_threads(guint threads_len);
 int load_configuration();
-const char *get_programming_language(GeditWindow *window);
+int load_snippet_directories(const char *const *dirs);
+GStrv get_snippet_directories();
+char *get_snippet_layer_name(guint layer);
 
 int fix_xml_file_from_snippet_translation(SnippetTranslation *self);
 int save_snippet_translation(SnippetTranslation *self, int options);
 
+int load_snippet_node(xmlNode *node, XmlFileInformation *fileinf, GStrv programming_languages);
+char *get_user_snippet_file(const char *language);
+XmlFileInformation *get_or_create_user_snippet_file(const char *language);
+xmlNode *find_snippet_node(XmlFileInformation *fileinf, const char *tag);
+xmlNode *append_snippet_node(XmlFileInformation *fileinf, const char *tag, const char *text, const char *description);
+int save_xml_file_information(XmlFileInformation *fileinf);
+
 extern GPtrArray *GLOBAL_SNIPPETS;
 extern GHashTable *GLOBAL_XML_FILE_INFO;
+extern SnippetArena *GLOBAL_SNIPPET_ARENA; ///< owns all SnippetTranslation and their strings
+extern guint GLOBAL_SNIPPETS_GENERATION; ///< bumped whenever a trigger or its languages change
+extern GStrv GLOBAL_SNIPPET_LAYERS; ///< the directories loaded, the first wins
+extern GPtrArray *GLOBAL_SHADOWED_SNIPPETS; ///< SnippetTranslation that earlier layers hide for all its languages, kept out of the blocks but still in the index
 
 SnippetBlock *get_or_create_block(size_t str_len);
+void renumber_snippet_block(SnippetBlock *self, guint from);
+void mark_snippets_changed();
 
 //static SnippetBlock GLOBAL_SNIPPETS[]={
 //	{3,(SnippetTranslation[]){{"prl","fprintf(stdout,\"%s:%d \\n\",__FILE__,__LINE__,);"},{"err","fprintf(stderr,\"%s:%d \\n\",__FILE__,__LINE__,);"},{NULL,NULL}}},
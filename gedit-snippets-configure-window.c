@@ -19,14 +19,19 @@ freely, subject to the following restrictions:
 */
 #include "gedit-snippets-configure-window.h"
 #include "gedit-snippets-configuration.h"
+#include "gedit-snippets-import.h"
+#include "gedit-snippets-variables.h"
+#include "gedit-snippets-memory.h"
+#include "gedit-snippets-usage.h"
+#include "gedit-snippets-template.h"
 
 char *create_snippet_label(SnippetTranslation *snippet_translation)
 {
 	GString *label_string=g_string_sized_new(10);
 				
-	for(guint k=0;k<snippet_translation->programming_languages->len;k++)
+	for(guint k=0;snippet_translation->programming_languages[k];k++)
 	{
-		const char *langauage=g_ptr_array_index(snippet_translation->programming_languages,k);
+		const char *langauage=snippet_translation->programming_languages[k];
 		
 		g_string_append_printf(label_string,"%s%s",k==0?"":",",langauage);
 	}
@@ -36,6 +41,328 @@ char *create_snippet_label(SnippetTranslation *snippet_translation)
 	return g_string_free(label_string,FALSE);
 }
 
+//the snippet of the row, NULL when it was removed or the snippets were reloaded under the dialog
+static SnippetTranslation *get_row_snippet(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	SnippetHandle handle=0;
+	gtk_tree_model_get(model, iter, 1, &handle, -1);
+	
+	return snippet_handle_get(handle);
+}
+
+//remembers in overrides (winner -> layer names) that the layer of shadowed lost to its shadowed_by
+static void add_snippet_override(GHashTable *overrides, SnippetTranslation *shadowed)
+{
+	if(!shadowed->shadowed_by || !shadowed->fileinf)
+	{
+		return;
+	}
+	
+	g_autofree char *name=get_snippet_layer_name(shadowed->fileinf->layer);
+	const char *layers=g_hash_table_lookup(overrides,shadowed->shadowed_by);
+	
+	if(!layers)
+	{
+		g_hash_table_insert(overrides,shadowed->shadowed_by,g_steal_pointer(&name));
+	}
+	else if(!strstr(layers,name))
+	{
+		g_hash_table_insert(overrides,shadowed->shadowed_by,g_strdup_printf("%s, %s",layers,name));
+	}
+}
+
+//the layer the snippet comes from and what it conflicts with
+static char *create_snippet_source_label(SnippetTranslation *snippet_translation, GHashTable *overrides)
+{
+	if(!snippet_translation->fileinf)
+	{
+		return g_strdup("");
+	}
+	
+	GString *label_string=g_string_new(NULL);
+	g_autofree char *name=get_snippet_layer_name(snippet_translation->fileinf->layer);
+	g_string_append(label_string,name);
+	
+	const char *overridden=g_hash_table_lookup(overrides,snippet_translation);
+	
+	if(overridden)
+	{
+		g_string_append_printf(label_string,", overrides %s",overridden);
+	}
+	
+	if(snippet_translation->shadowed_by && snippet_translation->shadowed_by->fileinf && snippet_translation->shadowed_languages)
+	{
+		g_autofree char *winner=get_snippet_layer_name(snippet_translation->shadowed_by->fileinf->layer);
+		g_autofree char *languages=g_strjoinv(",",(GStrv)snippet_translation->shadowed_languages);
+		g_string_append_printf(label_string,", shadowed by %s for %s",winner,languages);
+	}
+	
+	return g_string_free(label_string,FALSE);
+}
+
+//the value of a tab stop in the preview: its default, or [N] when it has none
+static const char *get_preview_value(long long id, gpointer user_data)
+{
+	GHashTable *defaults=user_data;
+	const char *value=g_hash_table_lookup(defaults,&id);
+	
+	if(!value)
+	{
+		gint64 *key=g_new(gint64,1);
+		*key=id;
+		
+		value=g_strdup_printf("[%lld]",id);
+		g_hash_table_insert(defaults,key,(char *)value);
+	}
+	
+	return value;
+}
+
+static const char *get_preview_variable(int variable, gpointer user_data)
+{
+	char **variables=user_data;
+	
+	return variables[variable];
+}
+
+static const char *get_preview_command(const char *command, gpointer user_data)
+{
+	//commands are not run while editing, they show as themselves
+	GPtrArray *commands=user_data;
+	char *shown=g_strdup_printf("$(%s)",command);
+	g_ptr_array_add(commands,shown);
+	
+	return shown;
+}
+
+static void on_preview_error(const char *message, gpointer user_data)
+{
+	GString *errors=user_data;
+	
+	g_string_append_printf(errors,"%s%s",errors->len>0?"\n":"",message);
+}
+
+/**
+	Fills defaults with id -> the rendered default of the first ${N:default}, like the first
+	placeholder sets the mirrors. The placeholders in a default are collected before it.
+*/
+static void collect_preview_defaults(GHashTable *defaults, const char *text)
+{
+	g_autoptr(GMatchInfo) match_info=NULL;
+	
+	g_regex_match(GLOBAL_REGEX_FIND_VARIABLES, text, 0, &match_info);
+	
+	while (g_match_info_matches(match_info))
+	{
+		g_autofree char *match = g_match_info_fetch(match_info, 0);
+		
+		if(match[1]=='{' && g_ascii_isdigit(match[2]))
+		{
+			char *id_end=NULL;
+			gint64 id=g_ascii_strtoll(match+2,&id_end,10);
+			const char *body=NULL;
+			const gssize body_len=*id_end==':'?get_match_body(match,id_end-match+1,'}',&body):-1;
+			
+			if(body_len>=0)
+			{
+				g_autofree char *default_text=g_strndup(body,body_len);
+				collect_preview_defaults(defaults,default_text);
+				
+				if(!g_hash_table_contains(defaults,&id))
+				{
+					GString *rendered=g_string_sized_new(body_len);
+					render_snippet_template(rendered,default_text,get_preview_value,defaults);
+					
+					gint64 *key=g_new(gint64,1);
+					*key=id;
+					g_hash_table_insert(defaults,key,g_string_free(rendered,FALSE));
+				}
+			}
+		}
+		
+		g_match_info_next(match_info, NULL);
+	}
+}
+
+//what a preview render on a worker gets and gives back
+typedef struct SnippetPreviewJob
+{
+	char *text;
+	char *variables[SNIPPET_VARIABLE_COUNT];
+	GString *result;
+	GString *errors;
+}SnippetPreviewJob;
+
+static void snippet_preview_job_free(SnippetPreviewJob *self)
+{
+	g_free(self->text);
+	
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		g_free(self->variables[i]);
+	}
+	
+	g_string_free(self->result,TRUE);
+	g_string_free(self->errors,TRUE);
+	g_free(self);
+}
+
+/**
+	Runs on a worker, so a slow python block does not block the dialog. The hooks it sets are
+	only those of its thread.
+*/
+static void render_snippet_preview_thread(GTask *task, gpointer source_object, gpointer task_data, GCancellable *cancellable)
+{
+	SnippetPreviewJob *job=task_data;
+	g_autoptr(GHashTable) defaults=g_hash_table_new_full(g_int64_hash,g_int64_equal,g_free,g_free);
+	g_autoptr(GPtrArray) commands=g_ptr_array_new_with_free_func(g_free);
+	
+	template_set_command_func(get_preview_command,commands);
+	template_set_variable_func(get_preview_variable,job->variables);
+	template_set_error_func(on_preview_error,job->errors);
+	
+	//every edit is a new body, caching them would only grow the caches
+	template_begin_uncached();
+	collect_preview_defaults(defaults,job->text);
+	render_snippet_template(job->result,job->text,get_preview_value,defaults);
+	template_end_uncached();
+	
+	//the worker goes back to the pool
+	template_set_error_func(NULL,NULL);
+	template_set_variable_func(NULL,NULL);
+	template_set_command_func(NULL,NULL);
+	
+	g_task_return_boolean(task,TRUE);
+}
+
+static void on_snippet_preview_done(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	
+	//a newer render or the closed dialog cancelled it, then data is not ours to touch
+	if(!g_task_propagate_boolean(G_TASK(res),NULL))
+	{
+		return;
+	}
+	
+	SnippetPreviewJob *job=g_task_get_task_data(G_TASK(res));
+	
+	gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(data->preview_view)), job->result->str, job->result->len);
+	gtk_label_set_text(GTK_LABEL(data->preview_errors), job->errors->str);
+	gtk_widget_set_visible(data->preview_errors, job->errors->len>0);
+	
+	g_clear_object(&data->preview_cancellable);
+}
+
+/**
+	Renders text through the same engine as Tab, with sample values for the tab stops
+	and the variables, and shows it once it is done. The python blocks run, $(command)
+	only shows the command.
+*/
+static void render_snippet_preview(SnippetDialogData *data, const char *text, const char *language)
+{
+	SnippetPreviewJob *job=g_new0(SnippetPreviewJob,1);
+	g_autofree char *sample_path=g_build_filename(g_get_home_dir(),"example.txt",NULL);
+	
+	job->text=g_strdup(text);
+	job->result=g_string_sized_new(strlen(text));
+	job->errors=g_string_new(NULL);
+	
+	set_snippet_file_variables(job->variables,sample_path);
+	job->variables[SNIPPET_VARIABLE_LANGUAGE]=g_strdup(language);
+	job->variables[SNIPPET_VARIABLE_SELECTED_TEXT]=g_strdup("selected text");
+	job->variables[SNIPPET_VARIABLE_CLIPBOARD]=g_strdup("clipboard text");
+	job->variables[SNIPPET_VARIABLE_LINE_NUMBER]=g_strdup("1");
+	job->variables[SNIPPET_VARIABLE_DATE]=get_snippet_time_variable(SNIPPET_VARIABLE_DATE);
+	job->variables[SNIPPET_VARIABLE_TIME]=get_snippet_time_variable(SNIPPET_VARIABLE_TIME);
+	job->variables[SNIPPET_VARIABLE_YEAR]=get_snippet_time_variable(SNIPPET_VARIABLE_YEAR);
+	
+	//only the newest body is shown
+	if(data->preview_cancellable)
+	{
+		g_cancellable_cancel(data->preview_cancellable);
+		g_clear_object(&data->preview_cancellable);
+	}
+	
+	data->preview_cancellable=g_cancellable_new();
+	
+	g_autoptr(GTask) task=g_task_new(NULL,data->preview_cancellable,on_snippet_preview_done,data);
+	g_task_set_task_data(task,job,(GDestroyNotify)snippet_preview_job_free);
+	g_task_run_in_thread(task,render_snippet_preview_thread);
+}
+
+static gboolean on_preview_timeout(gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	data->preview_source=0;
+	
+	GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(data->textview));
+	GtkTextIter start, end;
+	
+	gtk_text_buffer_get_bounds(buffer, &start, &end);
+	g_autofree gchar *text = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+	
+	//moving the cursor or undoing back to the same body does not render again
+	if(g_strcmp0(text,data->preview_text)==0)
+	{
+		return G_SOURCE_REMOVE;
+	}
+	
+	const char *language=NULL;
+	GtkTreeSelection *selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(data->treeview));
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	
+	if (gtk_tree_selection_get_selected(selection, &model, &iter))
+	{
+		SnippetTranslation *current_snippet_translation=get_row_snippet(model, &iter);
+		
+		if(current_snippet_translation)
+		{
+			language=current_snippet_translation->programming_languages[0];
+		}
+	}
+	
+	render_snippet_preview(data, text, language);
+	
+	g_free(data->preview_text);
+	data->preview_text=g_steal_pointer(&text);
+	
+	return G_SOURCE_REMOVE;
+}
+
+static void on_text_changed(GtkTextBuffer *buffer, gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	
+	//renders once typing pauses
+	if(data->preview_source)
+	{
+		g_source_remove(data->preview_source);
+	}
+	
+	data->preview_source=g_timeout_add(SNIPPET_PREVIEW_DELAY_MS, on_preview_timeout, data);
+}
+
+static void on_snippet_dialog_destroy(GtkWidget *widget, gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	
+	if(data->preview_source)
+	{
+		g_source_remove(data->preview_source);
+		data->preview_source=0;
+	}
+	
+	if(data->preview_cancellable)
+	{
+		g_cancellable_cancel(data->preview_cancellable);
+		g_clear_object(&data->preview_cancellable);
+	}
+	
+	g_clear_pointer(&data->preview_text,g_free);
+}
+
 static void on_snippet_selected(GtkTreeSelection *selection, gpointer user_data)
 {
 	SnippetDialogData *data = user_data;
@@ -45,8 +372,13 @@ static void on_snippet_selected(GtkTreeSelection *selection, gpointer user_data)
 
 	if (gtk_tree_selection_get_selected(selection, &model, &iter))
 	{
-		SnippetTranslation *current_snippet_translation;
-		gtk_tree_model_get(model, &iter, 1, &current_snippet_translation, -1);
+		SnippetTranslation *current_snippet_translation=get_row_snippet(model, &iter);
+		
+		if(!current_snippet_translation)
+		{
+			return;
+		}
+		
 		fprintf(stdout,"%s:%d SET: [%s]\n",__FILE__,__LINE__,current_snippet_translation->to);
 		gtk_text_buffer_set_text(buffer, current_snippet_translation->to, -1);
 	}
@@ -56,31 +388,162 @@ static void on_add_snippet(GtkButton *button, gpointer user_data)
 {
 	SnippetDialogData *data = user_data;
 	GtkTreeIter iter;
-	gtk_list_store_append(data->store, &iter);
 	
 	const char *new_snippet_text="NewSnippet";
-	const size_t new_snippet_text_len=strlen(new_snippet_text);
 	
 	const char *add_language="c";
 	
 	SnippetTranslation *new_snippet_translation=snippet_translation_new();
-	new_snippet_translation->from=g_strndup(new_snippet_text,new_snippet_text_len);
-	new_snippet_translation->to=g_strdup("//Your code here");
+	new_snippet_translation->from=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,new_snippet_text);
+	new_snippet_translation->to=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,"//Your code here");
 	
 	//.config/gedit/snippets/c.xml
-	g_ptr_array_add(new_snippet_translation->programming_languages,g_strdup(add_language));
-	new_snippet_translation->description = g_strdup("Your description");
+	char *add_languages[]={(char *)add_language,NULL};
+	new_snippet_translation->programming_languages=snippet_languages_new(add_languages);
+	new_snippet_translation->description = snippet_arena_intern(GLOBAL_SNIPPET_ARENA,"Your description");
 	
-	SnippetBlock *block = get_or_create_block(new_snippet_text_len);
-	g_ptr_array_add(block->nodes,new_snippet_translation);
+	//the index ranks it by the layer of its file, so the file comes first
+	if(fix_xml_file_from_snippet_translation(new_snippet_translation)<0)
+	{
+		return;
+	}
 	
-	fix_xml_file_from_snippet_translation(new_snippet_translation);
+	SnippetHandle handle=snippet_index_insert(new_snippet_translation);
 	
 	save_snippet_translation(new_snippet_translation,1);
 	
+	gtk_list_store_append(data->store, &iter);
+	
 	g_autofree char *full_new_label=create_snippet_label(new_snippet_translation);
 	
-	gtk_list_store_set(data->store, &iter, 0, full_new_label, 1, new_snippet_translation, -1);
+	g_autofree char *source_label=get_snippet_layer_name(new_snippet_translation->fileinf->layer);
+	gtk_list_store_set(data->store, &iter, 0, full_new_label, 1, handle, 2, source_label, -1);
+}
+
+static void update_memory_label(SnippetDialogData *data)
+{
+	SnippetMemoryReport *report=snippet_memory_report_new();
+	g_autofree char *summary=snippet_memory_report_to_string(report);
+	g_autofree char *label=g_strdup_printf("Memory %s",summary);
+	
+	gtk_label_set_text(GTK_LABEL(data->memory_label), label);
+	
+	snippet_memory_report_free(report);
+}
+
+static void fill_snippet_store(SnippetDialogData *data)
+{
+	gtk_list_store_clear(data->store);
+
+	if(GLOBAL_SNIPPETS)
+	{
+		g_autoptr(GPtrArray) snippets=g_ptr_array_new();
+		
+		for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+		{
+			SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+			
+			for(guint j=0;j<sblk->nodes->len;j++)
+			{
+				g_ptr_array_add(snippets,g_ptr_array_index(sblk->nodes,j));
+			}
+		}
+		
+		//the most used first, the rest in load order
+		g_ptr_array_sort(snippets,compare_snippet_usage);
+		
+		//the shadowed snippets are not listed, the ones hiding them say so
+		g_autoptr(GHashTable) overrides=g_hash_table_new_full(NULL,NULL,NULL,g_free);
+		
+		for(guint i=0;i<GLOBAL_SHADOWED_SNIPPETS->len;i++)
+		{
+			add_snippet_override(overrides,g_ptr_array_index(GLOBAL_SHADOWED_SNIPPETS,i));
+		}
+		
+		for(guint i=0;i<snippets->len;i++)
+		{
+			add_snippet_override(overrides,g_ptr_array_index(snippets,i));
+		}
+		
+		for(guint i=0;i<snippets->len;i++)
+		{
+			SnippetTranslation *snippet_translation=g_ptr_array_index(snippets,i);
+			
+			g_autofree char *label_string=create_snippet_label(snippet_translation);
+			g_autofree char *source_label=create_snippet_source_label(snippet_translation,overrides);
+			
+			GtkTreeIter iter;
+			gtk_list_store_append(data->store, &iter);
+			gtk_list_store_set(data->store, &iter, 0, label_string, 1, snippet_translation->handle, 2, source_label, -1);
+		}
+	}
+	
+	update_memory_label(data);
+}
+
+static void on_import_snippets(GtkButton *button, gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	
+	GtkWidget *chooser = gtk_file_chooser_dialog_new("Import Snippets",
+		GTK_WINDOW(gtk_widget_get_toplevel(GTK_WIDGET(data->treeview))),
+		GTK_FILE_CHOOSER_ACTION_OPEN,
+		"_Cancel", GTK_RESPONSE_CANCEL,
+		"_Import", GTK_RESPONSE_ACCEPT,
+		NULL);
+	gtk_file_chooser_set_select_multiple(GTK_FILE_CHOOSER(chooser), TRUE);
+	
+	if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT)
+	{
+		GSList *filenames = gtk_file_chooser_get_filenames(GTK_FILE_CHOOSER(chooser));
+		
+		for (GSList *l = filenames; l != NULL; l = l->next)
+		{
+			int imported=import_snippets(l->data, NULL);
+			
+			g_message("Imported %d snippets from %s", imported, (const char *)l->data);
+		}
+		
+		g_slist_free_full(filenames, g_free);
+		
+		fill_snippet_store(data);
+	}
+	
+	gtk_widget_destroy(chooser);
+}
+
+static void on_save_memory_report(GtkButton *button, gpointer user_data)
+{
+	SnippetDialogData *data = user_data;
+	
+	GtkWidget *chooser = gtk_file_chooser_dialog_new("Save Memory Report",
+		GTK_WINDOW(gtk_widget_get_toplevel(GTK_WIDGET(data->treeview))),
+		GTK_FILE_CHOOSER_ACTION_SAVE,
+		"_Cancel", GTK_RESPONSE_CANCEL,
+		"_Save", GTK_RESPONSE_ACCEPT,
+		NULL);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(chooser), "snippets-memory.json");
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(chooser), TRUE);
+	
+	if (gtk_dialog_run(GTK_DIALOG(chooser)) == GTK_RESPONSE_ACCEPT)
+	{
+		g_autofree char *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(chooser));
+		
+		SnippetMemoryReport *report=snippet_memory_report_new();
+		g_autofree char *json=snippet_memory_report_to_json(report);
+		snippet_memory_report_free(report);
+		
+		g_autoptr(GError) error=NULL;
+		
+		if(!g_file_set_contents(filename, json, -1, &error))
+		{
+			fprintf(stderr,"%s:%d Could not save %s: %s\n",__FILE__,__LINE__,filename,error->message);
+		}
+		
+		update_memory_label(data);
+	}
+	
+	gtk_widget_destroy(chooser);
 }
 
 static void on_remove_snippet(GtkButton *button, gpointer user_data)
@@ -92,10 +555,50 @@ static void on_remove_snippet(GtkButton *button, gpointer user_data)
 
 	if (gtk_tree_selection_get_selected(selection, &model, &iter))
 	{
-		SnippetTranslation *current_snippet_translation;
-		gtk_tree_model_get(model, &iter, 1, &current_snippet_translation, -1);
-	
+		SnippetHandle handle=0;
+		gtk_tree_model_get(model, &iter, 1, &handle, -1);
+		SnippetTranslation *current_snippet_translation=snippet_handle_get(handle);
+		
+		if(current_snippet_translation)
+		{
+			XmlFileInformation *fileinf=current_snippet_translation->fileinf;
+			xmlNode *child=current_snippet_translation->child;
+			
+			//only the user's files are written, the other directories are usually not ours
+			if(!fileinf || fileinf->layer!=0 || !child)
+			{
+				fprintf(stderr,"%s:%d %s is not in a user snippet file and can not be removed\n",__FILE__,__LINE__,current_snippet_translation->from);
+				return;
+			}
+			
+			xmlNode *parent=child->parent;
+			xmlNode *next=child->next;
+			
+			xmlUnlinkNode(child);
+			
+			//the index only changes once the file did, so they can not disagree
+			if(save_xml_file_information(fileinf)!=0)
+			{
+				if(next)
+				{
+					xmlAddPrevSibling(next,child);
+				}
+				else
+				{
+					xmlAddChild(parent,child);
+				}
+				return;
+			}
+			
+			xmlFreeNode(child);
+			current_snippet_translation->child=NULL;
+			
+			//the snippet it shadowed takes over right away
+			snippet_index_remove(handle);
+		}
+		
 		gtk_list_store_remove(data->store, &iter);
+		update_memory_label(data);
 	}
 }
 
@@ -130,8 +633,12 @@ static void on_rename_snippet(GtkMenuItem *menuitem, gpointer user_data)
 
 	if (gtk_tree_selection_get_selected(selection, &model, &iter))
 	{
-		SnippetTranslation *current_snippet_translation;
-		gtk_tree_model_get(model, &iter, 1, &current_snippet_translation, -1);
+		SnippetTranslation *current_snippet_translation=get_row_snippet(model, &iter);
+		
+		if(!current_snippet_translation)
+		{
+			return;
+		}
 
 		GtkWidget *dialog = gtk_dialog_new_with_buttons(
 			"Rename Snippet",
@@ -153,9 +660,9 @@ static void on_rename_snippet(GtkMenuItem *menuitem, gpointer user_data)
 		
 		g_autoptr(GString) lang_label_string=g_string_sized_new(10);
 				
-		for(guint k=0;k<current_snippet_translation->programming_languages->len;k++)
+		for(guint k=0;current_snippet_translation->programming_languages[k];k++)
 		{
-			const char *langauage=g_ptr_array_index(current_snippet_translation->programming_languages,k);
+			const char *langauage=current_snippet_translation->programming_languages[k];
 			
 			g_string_append_printf(lang_label_string,"%s%s",k==0?"":",",langauage);
 		}
@@ -181,44 +688,18 @@ static void on_rename_snippet(GtkMenuItem *menuitem, gpointer user_data)
 			
 			if(g_strcmp0(new_name,current_snippet_translation->from)!=0)
 			{
-				const size_t new_name_len=strlen(new_name);
-				const size_t from_len=strlen(current_snippet_translation->from);
-			
-				free(current_snippet_translation->from);
-				current_snippet_translation->from=g_strdup(new_name);
-				
-				if(from_len!=new_name_len)
-				{
-					SnippetBlock *old_block = get_or_create_block(from_len);
-					
-					guint cur_index;
-					if(g_ptr_array_find(old_block->nodes,current_snippet_translation,&cur_index))
-					{
-						g_ptr_array_steal_index(old_block->nodes,cur_index);
-						
-						SnippetBlock *new_block = get_or_create_block(new_name_len);
-						
-						g_ptr_array_add(new_block->nodes,current_snippet_translation);
-					}
-				}
+				snippet_index_rename(current_snippet_translation->handle,new_name);
 			}
 			
 			if(g_strcmp0(new_language,lang_label_string->str)!=0)
 			{
-//				free(current_snippet_translation->from);
-				g_autofree gchar **tokens = g_strsplit(new_language, ",", -1);
-				g_ptr_array_set_size(current_snippet_translation->programming_languages,0);
-				
-				for (gchar **p = tokens; *p != NULL; p++)
-				{
-					g_ptr_array_add(current_snippet_translation->programming_languages, *p);
-				}
+				g_auto(GStrv) tokens = g_strsplit(new_language, ",", -1);
+				snippet_index_set_languages(current_snippet_translation->handle,tokens);
 			}
 			
 			if(g_strcmp0(new_description,current_snippet_translation->description)!=0)
 			{
-				free(current_snippet_translation->description);
-				current_snippet_translation->description=g_strdup(new_description);
+				current_snippet_translation->description=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,new_description);
 			}
 			
 			g_autofree char *label_string=create_snippet_label(current_snippet_translation);
@@ -311,9 +792,14 @@ static void on_snippet_dialog_response(GtkDialog *dialog, gint response_id, gpoi
 
 			if (gtk_tree_selection_get_selected(selection, &model, &iter))
 			{
-				SnippetTranslation *current_snippet_translation;
-				gchar *name;
-				gtk_tree_model_get(model, &iter, 0, &name, 1, &current_snippet_translation, -1);
+				SnippetTranslation *current_snippet_translation=get_row_snippet(model, &iter);
+				g_autofree gchar *name=NULL;
+				gtk_tree_model_get(model, &iter, 0, &name, -1);
+				
+				if(!current_snippet_translation)
+				{
+					break;
+				}
 			
 				GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(data->textview));
 				GtkTextIter start, end;
@@ -323,8 +809,9 @@ static void on_snippet_dialog_response(GtkDialog *dialog, gint response_id, gpoi
 				
 				g_message("Saving snippet '%s' with content:\n%s\n%s", name, current_snippet_translation->to,new_text);
 				
-				free(current_snippet_translation->to);
-				current_snippet_translation->to=g_steal_pointer(&new_text);
+				template_forget_placeholders(current_snippet_translation->to);
+				current_snippet_translation->to=snippet_arena_intern(GLOBAL_SNIPPET_ARENA,new_text);
+				current_snippet_translation->variables=get_snippet_variable_mask(new_text);
 				
 				save_snippet_translation(current_snippet_translation,1);
 			}
@@ -343,7 +830,8 @@ static void on_snippet_dialog_response(GtkDialog *dialog, gint response_id, gpoi
 
 void create_snippet_dialog(GtkWidget *parent)
 {
-	GtkWidget *dialog, *content_area, *treeview, *textview, *scrolled_window, *hbox, *vbox, *button_add, *button_remove;
+	GtkWidget *dialog, *content_area, *treeview, *textview, *scrolled_window, *hbox, *vbox, *button_add, *button_remove, *button_import, *button_memory, *memory_label;
+	GtkWidget *editor_box, *preview_label, *preview_window, *preview_view, *preview_errors;
 	GtkListStore *store;
 	GtkCellRenderer *renderer;
 	GtkTreeViewColumn *column;
@@ -363,7 +851,7 @@ void create_snippet_dialog(GtkWidget *parent)
 	gtk_box_pack_start(GTK_BOX(hbox), vbox, FALSE, FALSE, 5);
 
 	// Snippet list store
-	store = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_POINTER);
+	store = gtk_list_store_new(3, G_TYPE_STRING, G_TYPE_UINT64, G_TYPE_STRING);
 	data->store = store;
 
 	// TreeView
@@ -375,50 +863,121 @@ void create_snippet_dialog(GtkWidget *parent)
 	column = gtk_tree_view_column_new_with_attributes("Snippet", renderer, "text", 0, NULL);
 	gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
 
+	renderer = gtk_cell_renderer_text_new();
+	column = gtk_tree_view_column_new_with_attributes("Source", renderer, "text", 2, NULL);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+
 	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview));
 	gtk_box_pack_start(GTK_BOX(vbox), treeview, TRUE, TRUE, 5);
 
 	// Buttons
 	button_add = gtk_button_new_with_label("Add");
 	button_remove = gtk_button_new_with_label("Remove");
+	button_import = gtk_button_new_with_label("Import");
 	gtk_box_pack_start(GTK_BOX(vbox), button_add, FALSE, FALSE, 2);
 	gtk_box_pack_start(GTK_BOX(vbox), button_remove, FALSE, FALSE, 2);
+	gtk_box_pack_start(GTK_BOX(vbox), button_import, FALSE, FALSE, 2);
+
+	// Memory used by the snippets, and a button to save the full report as JSON
+	memory_label = gtk_label_new(NULL);
+	gtk_label_set_line_wrap(GTK_LABEL(memory_label), TRUE);
+	gtk_label_set_max_width_chars(GTK_LABEL(memory_label), 30);
+	data->memory_label = memory_label;
+	button_memory = gtk_button_new_with_label("Memory Report");
+	gtk_box_pack_start(GTK_BOX(vbox), memory_label, FALSE, FALSE, 2);
+	gtk_box_pack_start(GTK_BOX(vbox), button_memory, FALSE, FALSE, 2);
+
+	// Right side - Text editor, with the preview below it
+	editor_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
+	gtk_box_pack_start(GTK_BOX(hbox), editor_box, TRUE, TRUE, 5);
 
-	// Right side - Text editor
 	scrolled_window = gtk_scrolled_window_new(NULL, NULL);
 	gtk_widget_set_size_request(scrolled_window, 300, 200);
-	gtk_box_pack_start(GTK_BOX(hbox), scrolled_window, TRUE, TRUE, 5);
+	gtk_box_pack_start(GTK_BOX(editor_box), scrolled_window, TRUE, TRUE, 0);
 
 	textview = gtk_text_view_new();
 	data->textview = textview;
 	gtk_container_add(GTK_CONTAINER(scrolled_window), textview);
 
-	if(GLOBAL_SNIPPETS)
-	{
-		for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
-		{
-			SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
-			
-			for(guint j=0;j<sblk->nodes->len;j++)
-			{
-				SnippetTranslation *snippet_translation=g_ptr_array_index(sblk->nodes,j);
-				
-				g_autofree char *label_string=create_snippet_label(snippet_translation);
-				
-				GtkTreeIter iter;
-				gtk_list_store_append(data->store, &iter);
-				gtk_list_store_set(data->store, &iter, 0, label_string, 1, snippet_translation, -1);
-			}
-		}
-	}
+	preview_label = gtk_label_new("Preview");
+	gtk_widget_set_halign(preview_label, GTK_ALIGN_START);
+	gtk_box_pack_start(GTK_BOX(editor_box), preview_label, FALSE, FALSE, 0);
+
+	preview_window = gtk_scrolled_window_new(NULL, NULL);
+	gtk_widget_set_size_request(preview_window, 300, 120);
+	gtk_box_pack_start(GTK_BOX(editor_box), preview_window, TRUE, TRUE, 0);
+
+	preview_view = gtk_text_view_new();
+	gtk_text_view_set_editable(GTK_TEXT_VIEW(preview_view), FALSE);
+	gtk_text_view_set_cursor_visible(GTK_TEXT_VIEW(preview_view), FALSE);
+	data->preview_view = preview_view;
+	gtk_container_add(GTK_CONTAINER(preview_window), preview_view);
+
+	preview_errors = gtk_label_new(NULL);
+	gtk_label_set_line_wrap(GTK_LABEL(preview_errors), TRUE);
+	gtk_label_set_selectable(GTK_LABEL(preview_errors), TRUE);
+	gtk_widget_set_halign(preview_errors, GTK_ALIGN_START);
+	gtk_widget_set_no_show_all(preview_errors, TRUE);
+	data->preview_errors = preview_errors;
+	gtk_box_pack_start(GTK_BOX(editor_box), preview_errors, FALSE, FALSE, 0);
+
+	fill_snippet_store(data);
 
 	// Connect signals
 	g_signal_connect(selection, "changed", G_CALLBACK(on_snippet_selected), data);
 	g_signal_connect(button_add, "clicked", G_CALLBACK(on_add_snippet), data);
 	g_signal_connect(button_remove, "clicked", G_CALLBACK(on_remove_snippet), data);
-//	g_signal_connect(gtk_text_view_get_buffer(GTK_TEXT_VIEW(textview)), "changed", G_CALLBACK(on_text_changed), data);
+	g_signal_connect(button_import, "clicked", G_CALLBACK(on_import_snippets), data);
+	g_signal_connect(button_memory, "clicked", G_CALLBACK(on_save_memory_report), data);
+	g_signal_connect(gtk_text_view_get_buffer(GTK_TEXT_VIEW(textview)), "changed", G_CALLBACK(on_text_changed), data);
+	g_signal_connect(dialog, "destroy", G_CALLBACK(on_snippet_dialog_destroy), data);
 
 	gtk_widget_show_all(dialog);
 	g_signal_connect(dialog, "response", G_CALLBACK(on_snippet_dialog_response), data);
 }
 
+
+gboolean run_expand_selection_dialog(GtkWidget *parent, char **tag, char **pattern)
+{
+	GtkWidget *dialog = gtk_dialog_new_with_buttons(
+		"Expand Snippet over Selection",
+		GTK_WINDOW(parent),
+		GTK_DIALOG_MODAL,
+		"_OK", GTK_RESPONSE_OK,
+		"_Cancel", GTK_RESPONSE_CANCEL,
+		NULL);
+	
+	GtkWidget *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+	
+	GtkWidget *tag_label = gtk_label_new("snippet");
+	gtk_container_add(GTK_CONTAINER(content_area), tag_label);
+	
+	GtkWidget *tag_entry = gtk_entry_new();
+	gtk_container_add(GTK_CONTAINER(content_area), tag_entry);
+	
+	GtkWidget *pattern_label = gtk_label_new("regex (optional, groups become $1..$N, otherwise the line is $1)");
+	gtk_container_add(GTK_CONTAINER(content_area), pattern_label);
+	
+	GtkWidget *pattern_entry = gtk_entry_new();
+	gtk_container_add(GTK_CONTAINER(content_area), pattern_entry);
+	
+	gtk_widget_show_all(dialog);
+	
+	gboolean accepted = FALSE;
+	
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK)
+	{
+		const gchar *new_tag = gtk_entry_get_text(GTK_ENTRY(tag_entry));
+		
+		if(new_tag[0]!='\0')
+		{
+			*tag = g_strdup(new_tag);
+			*pattern = g_strdup(gtk_entry_get_text(GTK_ENTRY(pattern_entry)));
+			accepted = TRUE;
+		}
+	}
+	
+	gtk_widget_destroy(dialog);
+	
+	return accepted;
+}
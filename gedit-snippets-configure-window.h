@@ -27,8 +27,17 @@ typedef struct {
 	GtkWidget *treeview;
 	GtkWidget *textview;
 	GtkListStore *store;
+	GtkWidget *memory_label;
+	GtkWidget *preview_view; ///< the edited body rendered with sample values
+	GtkWidget *preview_errors; ///< python and transformation errors of the preview
+	guint preview_source; ///< pending render, 0 when there is none
+	GCancellable *preview_cancellable; ///< of the render running on a worker, NULL when there is none
+	char *preview_text; ///< the body the preview was rendered from
 } SnippetDialogData;
 
+#define SNIPPET_PREVIEW_DELAY_MS 200
+
 void create_snippet_dialog(GtkWidget *parent);
+gboolean run_expand_selection_dialog(GtkWidget *parent, char **tag, char **pattern);
 
 G_END_DECLS
@@ -0,0 +1,118 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+
+#include "gedit-snippets-corpus.h"
+
+#define SNIPPET_CORPUS_DIR ".config/gedit/snippets"
+
+/**
+	Writes snippets over files of SNIPPET_CORPUS_SNIPPETS_PER_FILE, one language per file.
+*/
+static int write_snippet_corpus(const char *snippets_dir, guint snippets)
+{
+	g_autoptr(GString) xml=g_string_sized_new(SNIPPET_CORPUS_SNIPPETS_PER_FILE*256);
+	
+	for(guint file=0;file*SNIPPET_CORPUS_SNIPPETS_PER_FILE<snippets;file++)
+	{
+		g_string_assign(xml,"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<snippets>\n");
+		
+		for(guint i=file*SNIPPET_CORPUS_SNIPPETS_PER_FILE;i<MIN(snippets,(file+1)*SNIPPET_CORPUS_SNIPPETS_PER_FILE);i++)
+		{
+			g_string_append_printf(xml,
+				"<snippet><tag>snippet%u</tag><description>synthetic snippet %u</description>"
+				"<text><![CDATA[for(size_t ${1:i}=0;$1<${2:len};$1++)\n{\n\t${3:body_%u}($1);\n}\n$0]]></text></snippet>\n",
+				i,i,i);
+		}
+		
+		g_string_append(xml,"</snippets>\n");
+		
+		g_autofree char *filename=g_strdup_printf("lang%u.xml",file);
+		g_autofree char *filepath=g_build_filename(snippets_dir,filename,NULL);
+		g_autoptr(GError) error=NULL;
+		
+		if(!g_file_set_contents(filepath,xml->str,xml->len,&error))
+		{
+			fprintf(stderr,"%s:%d Could not write %s: %s\n",__FILE__,__LINE__,filepath,error->message);
+			return -1;
+		}
+	}
+	
+	return 0;
+}
+
+/**
+	Makes a temporary home with a synthetic corpus of snippets in its snippet directory,
+	for the benchmarks. Load it with $HOME set to the returned directory.
+*/
+char *snippet_corpus_new(guint snippets)
+{
+	g_autoptr(GError) error=NULL;
+	char *home=g_dir_make_tmp("snippets-corpus-XXXXXX",&error);
+	
+	if(!home)
+	{
+		fprintf(stderr,"%s:%d Could not create a directory: %s\n",__FILE__,__LINE__,error->message);
+		return NULL;
+	}
+	
+	g_autofree char *snippets_dir=g_build_filename(home,SNIPPET_CORPUS_DIR,NULL);
+	
+	if(g_mkdir_with_parents(snippets_dir,0700)!=0 || write_snippet_corpus(snippets_dir,snippets)!=0)
+	{
+		snippet_corpus_free(home);
+		return NULL;
+	}
+	
+	return home;
+}
+
+/**
+	Removes the corpus and the temporary home.
+*/
+void snippet_corpus_free(char *home)
+{
+	if(!home)
+	{
+		return;
+	}
+	
+	g_autofree char *snippets_dir=g_build_filename(home,SNIPPET_CORPUS_DIR,NULL);
+	g_autoptr(GDir) dir=g_dir_open(snippets_dir,0,NULL);
+	const char *filename;
+	
+	while(dir && (filename=g_dir_read_name(dir)))
+	{
+		g_autofree char *filepath=g_build_filename(snippets_dir,filename,NULL);
+		g_unlink(filepath);
+	}
+	
+	const char *const parents[]={SNIPPET_CORPUS_DIR,".config/gedit",".config",""};
+	
+	for(size_t i=0;i<G_N_ELEMENTS(parents);i++)
+	{
+		g_autofree char *path=g_build_filename(home,parents[i],NULL);
+		g_rmdir(path);
+	}
+	
+	g_free(home);
+}
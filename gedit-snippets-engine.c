@@ -0,0 +1,1336 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	The expansion state machine: what Tab does while a snippet is expanded, and how a
+	snippet gets into the buffer. It only needs a GtkTextBuffer, so gedit and snippets-replay
+	drive the same code.
+*/
+#include <string.h>
+#include <gtk/gtk.h>
+
+#include "gedit-snippets-engine.h"
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-shell.h"
+#include "gedit-snippets-filter.h"
+#include "gedit-snippets-stops.h"
+
+size_t GLOBAL_SNIPPET_START_POS=0;
+SnippetStops *GLOBAL_SNIPPET_STOPS=NULL; ///< set while a snippet is expanded
+GArray *GLOBAL_SNIPPET_STOP_ORDER=NULL; ///< guint, the stops in the order Tab visits them
+GtkTextBuffer *GLOBAL_SNIPPET_BUFFER=NULL; ///< set once all of the snippet is in, its edits move the stops
+SnippetTranslation *GLOBAL_CURRENT_SNIPPET_TRANSLATION=NULL;
+int GLOBAL_POSITION_STATE=0; ///< index into GLOBAL_SNIPPET_STOP_ORDER of the stop being edited
+int GLOBAL_EXPAND_INTERNAL_CODE=0;
+
+//bodies bigger than this are inserted a chunk at a time from an idle source
+#define SNIPPET_CHUNKED_INSERTION_THRESHOLD (64*1024)
+#define SNIPPET_INSERTION_CHUNK_SIZE (8*1024)
+#define SNIPPET_INSERTION_SLICE_USEC 5000
+
+typedef struct ChunkedInsertion
+{
+	GtkTextBuffer *buffer;
+	GtkTextMark *start_mark; ///< stays before the snippet
+	GtkTextMark *end_mark; ///< follows the inserted text
+	char *text;
+	size_t text_len;
+	size_t inserted; ///< bytes of text already in the buffer
+	guint source_id;
+	char *trigger; ///< deleted for the snippet, put back when the insertion is cancelled
+}ChunkedInsertion;
+
+ChunkedInsertion *GLOBAL_CHUNKED_INSERTION=NULL;
+
+//shown for a $(command) until its output is there, compared by address
+static const char SHELL_COMMAND_PLACEHOLDER[]="...";
+
+typedef struct PendingShellCommand
+{
+	char *command; ///< or the name of the variable for GEDIT_CLIPBOARD
+	guint generation; ///< the expansion it belongs to
+	size_t offset; ///< characters from the start of the snippet
+	GtkTextMark *start_mark; ///< set once the snippet is in the buffer
+	GtkTextMark *end_mark;
+	char *output; ///< set once the command is done
+}PendingShellCommand;
+
+GPtrArray *GLOBAL_PENDING_SHELL_COMMANDS=NULL;
+char *GLOBAL_SHELL_COMMAND_CWD=NULL;
+guint GLOBAL_SHELL_COMMAND_GENERATION=0;
+
+//values of the variables the current snippet refers to, indexed by SnippetVariable
+char *GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_COUNT]={NULL};
+
+static SnippetDocumentFunc GLOBAL_DOCUMENT_FUNC=NULL;
+static gpointer GLOBAL_DOCUMENT_FUNC_DATA=NULL;
+
+//above zero while the engine itself edits a buffer
+static int GLOBAL_ENGINE_EDITING=0;
+
+//by id, with $0 last
+static gint compare_stop_order(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const long long ia=snippet_stops_get(user_data,*(const guint *)a)->id;
+	const long long ib=snippet_stops_get(user_data,*(const guint *)b)->id;
+	
+	if(ia==ib)
+	{
+		return 0;
+	}
+	else if(ia==0)
+	{
+		return 1;
+	}
+	else if(ib==0)
+	{
+		return -1;
+	}
+	
+	return ia<ib?-1:1;
+}
+
+static void on_snippet_insert_text(GtkTextBuffer *buffer, GtkTextIter *location, gchar *text, gint len, gpointer user_data)
+{
+	snippet_stops_insert(GLOBAL_SNIPPET_STOPS, gtk_text_iter_get_offset(location), g_utf8_strlen(text, len));
+}
+
+static void on_snippet_delete_range(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, gpointer user_data)
+{
+	SnippetStops *stops=GLOBAL_SNIPPET_STOPS;
+	const guint active=stops->active;
+	
+	//only what the user deletes drops the placeholders in it, not a $(command) getting its output
+	if(snippet_engine_is_editing())
+	{
+		stops->active=SNIPPET_STOP_NONE;
+	}
+	
+	snippet_stops_delete(stops, gtk_text_iter_get_offset(start), gtk_text_iter_get_offset(end));
+	stops->active=active;
+}
+
+static void stop_tracking_edits()
+{
+	if(GLOBAL_SNIPPET_BUFFER)
+	{
+		g_signal_handlers_disconnect_by_func(GLOBAL_SNIPPET_BUFFER, on_snippet_insert_text, NULL);
+		g_signal_handlers_disconnect_by_func(GLOBAL_SNIPPET_BUFFER, on_snippet_delete_range, NULL);
+		g_clear_object(&GLOBAL_SNIPPET_BUFFER);
+	}
+}
+
+int reset_globals()
+{
+	//dont free every time
+	if(GLOBAL_SNIPPET_STOPS)
+	{
+		stop_tracking_edits();
+		g_clear_pointer(&GLOBAL_SNIPPET_STOPS,snippet_stops_free);
+		g_array_set_size(GLOBAL_SNIPPET_STOP_ORDER,0);
+		
+		GLOBAL_SNIPPET_START_POS=0;
+		GLOBAL_POSITION_STATE=0;
+		GLOBAL_EXPAND_INTERNAL_CODE=0;
+		GLOBAL_CURRENT_SNIPPET_TRANSLATION=NULL;
+		//commands still running patch their text, but no longer take part in the expansion
+		GLOBAL_SHELL_COMMAND_GENERATION++;
+	}
+	
+	return 0;
+}
+
+static void _pending_shell_command_free(PendingShellCommand *self)
+{
+	if(self->start_mark)
+	{
+		GtkTextBuffer *buffer=gtk_text_mark_get_buffer(self->start_mark);
+		
+		if(buffer)
+		{
+			gtk_text_buffer_delete_mark(buffer,self->start_mark);
+			gtk_text_buffer_delete_mark(buffer,self->end_mark);
+		}
+		
+		g_object_unref(self->start_mark);
+		g_object_unref(self->end_mark);
+	}
+	
+	g_free(self->command);
+	g_free(self->output);
+	g_free(self);
+}
+
+/**
+	Replaces the placeholder with the output. The output goes in between the dots, which are
+	deleted after, so the stops right before and after the placeholder keep their ranges.
+*/
+static void patch_shell_command(PendingShellCommand *pending)
+{
+	GtkTextBuffer *buffer=gtk_text_mark_get_buffer(pending->start_mark);
+	
+	if(!buffer)
+	{
+		return;
+	}
+	
+	GtkTextIter start, end;
+	gtk_text_buffer_get_iter_at_mark(buffer, &start, pending->start_mark);
+	gtk_text_buffer_get_iter_at_mark(buffer, &end, pending->end_mark);
+	
+	const gint start_offset=gtk_text_iter_get_offset(&start);
+	
+	GLOBAL_ENGINE_EDITING++;
+	gtk_text_buffer_begin_user_action(buffer);
+	
+	//the user may have typed over some of the dots
+	if(gtk_text_iter_get_offset(&end)-start_offset>=2)
+	{
+		GtkTextIter inside;
+		gtk_text_buffer_get_iter_at_offset(buffer, &inside, start_offset+1);
+		gtk_text_buffer_insert(buffer, &inside, pending->output, -1);
+		
+		const gint output_len=g_utf8_strlen(pending->output,-1);
+		
+		gtk_text_buffer_get_iter_at_offset(buffer, &start, start_offset);
+		gtk_text_buffer_get_iter_at_offset(buffer, &end, start_offset+1);
+		gtk_text_buffer_delete(buffer, &start, &end);
+		
+		gtk_text_buffer_get_iter_at_offset(buffer, &start, start_offset+output_len);
+		gtk_text_buffer_get_iter_at_mark(buffer, &end, pending->end_mark);
+		gtk_text_buffer_delete(buffer, &start, &end);
+	}
+	else
+	{
+		gtk_text_buffer_delete(buffer, &start, &end);
+		gtk_text_buffer_insert(buffer, &start, pending->output, -1);
+	}
+	
+	gtk_text_buffer_end_user_action(buffer);
+	GLOBAL_ENGINE_EDITING--;
+}
+
+static void on_shell_command_output(const char *command, const char *output, gpointer user_data)
+{
+	const guint generation=GPOINTER_TO_UINT(user_data);
+	
+	for(guint i=0;i<GLOBAL_PENDING_SHELL_COMMANDS->len;)
+	{
+		PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+		
+		if(pending->generation!=generation || pending->output || g_strcmp0(pending->command,command)!=0)
+		{
+			i++;
+			continue;
+		}
+		
+		pending->output=g_strdup(output);
+		
+		//not in the buffer yet, track_shell_commands patches it
+		if(!pending->start_mark)
+		{
+			i++;
+			continue;
+		}
+		
+		patch_shell_command(pending);
+		g_ptr_array_remove_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+	}
+}
+
+/**
+	Marks where the placeholders of the current snippet are, once all of it is in the buffer.
+*/
+static void track_shell_commands(GtkTextBuffer *buffer)
+{
+	const glong placeholder_len=g_utf8_strlen(SHELL_COMMAND_PLACEHOLDER,-1);
+	
+	for(guint i=0;i<GLOBAL_PENDING_SHELL_COMMANDS->len;)
+	{
+		PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+		
+		if(pending->generation!=GLOBAL_SHELL_COMMAND_GENERATION || pending->start_mark)
+		{
+			i++;
+			continue;
+		}
+		
+		GtkTextIter start, end;
+		gtk_text_buffer_get_iter_at_offset(buffer, &start, GLOBAL_SNIPPET_START_POS+pending->offset);
+		gtk_text_buffer_get_iter_at_offset(buffer, &end, GLOBAL_SNIPPET_START_POS+pending->offset+placeholder_len);
+		
+		//text typed right before or after the placeholder stays outside of it
+		pending->start_mark=g_object_ref(gtk_text_buffer_create_mark(buffer, NULL, &start, FALSE));
+		pending->end_mark=g_object_ref(gtk_text_buffer_create_mark(buffer, NULL, &end, TRUE));
+		
+		if(pending->output)
+		{
+			patch_shell_command(pending);
+			g_ptr_array_remove_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+//drops the commands of a snippet that never made it into the buffer
+static void forget_untracked_shell_commands()
+{
+	for(guint i=GLOBAL_PENDING_SHELL_COMMANDS->len;i>0;i--)
+	{
+		PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i-1);
+		
+		if(!pending->start_mark)
+		{
+			g_ptr_array_remove_index(GLOBAL_PENDING_SHELL_COMMANDS,i-1);
+		}
+	}
+}
+
+static const char *get_document_value(GtkTextBuffer *buffer, SnippetVariable variable)
+{
+	return GLOBAL_DOCUMENT_FUNC?GLOBAL_DOCUMENT_FUNC(buffer,variable,GLOBAL_DOCUMENT_FUNC_DATA):NULL;
+}
+
+/**
+	Resolves the variables in mask, the rest stays NULL. GEDIT_CLIPBOARD is requested
+	when the snippet is inserted, so a slow clipboard owner does not block.
+*/
+static void resolve_snippet_variables(GtkTextBuffer *buffer, guint32 mask)
+{
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		g_clear_pointer(&GLOBAL_SNIPPET_VARIABLES[i],g_free);
+	}
+	
+	if(mask==0)
+	{
+		return;
+	}
+	
+	if(mask&SNIPPET_VARIABLES_DOCUMENT)
+	{
+		for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+		{
+			if(mask&SNIPPET_VARIABLES_DOCUMENT&SNIPPET_VARIABLE_BIT(i))
+			{
+				GLOBAL_SNIPPET_VARIABLES[i]=g_strdup(get_document_value(buffer,i));
+			}
+		}
+	}
+	
+	if(mask&SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_SELECTED_TEXT))
+	{
+		GtkTextIter start, end;
+		gtk_text_buffer_get_selection_bounds(buffer, &start, &end);
+		GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_SELECTED_TEXT]=gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+	}
+	
+	if(mask&SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_LINE_NUMBER))
+	{
+		GtkTextIter cursor;
+		gtk_text_buffer_get_iter_at_mark(buffer, &cursor, gtk_text_buffer_get_insert(buffer));
+		GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_LINE_NUMBER]=g_strdup_printf("%d",gtk_text_iter_get_line(&cursor)+1);
+	}
+	
+	const SnippetVariable time_variables[]={SNIPPET_VARIABLE_DATE,SNIPPET_VARIABLE_TIME,SNIPPET_VARIABLE_YEAR};
+	
+	for(size_t i=0;i<G_N_ELEMENTS(time_variables);i++)
+	{
+		if(mask&SNIPPET_VARIABLE_BIT(time_variables[i]))
+		{
+			GLOBAL_SNIPPET_VARIABLES[time_variables[i]]=get_snippet_time_variable(time_variables[i]);
+		}
+	}
+}
+
+static const char *get_snippet_variable_value(int variable, gpointer user_data)
+{
+	return GLOBAL_SNIPPET_VARIABLES[variable];
+}
+
+static void on_clipboard_text(GtkClipboard *clipboard, const gchar *text, gpointer user_data)
+{
+	const guint generation=GPOINTER_TO_UINT(user_data);
+	
+	if(generation==GLOBAL_SHELL_COMMAND_GENERATION && !GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_CLIPBOARD])
+	{
+		GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_CLIPBOARD]=g_strdup(text?text:"");
+	}
+	
+	on_shell_command_output(get_snippet_variable_name(SNIPPET_VARIABLE_CLIPBOARD),text?text:"",user_data);
+}
+
+/**
+	The output for the final render. Commands still running render as nothing.
+*/
+static const char *get_shell_command_output(const char *command, gpointer user_data)
+{
+	for(guint i=0;i<GLOBAL_PENDING_SHELL_COMMANDS->len;i++)
+	{
+		PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+		
+		if(pending->generation==GLOBAL_SHELL_COMMAND_GENERATION && pending->output && g_strcmp0(pending->command,command)==0)
+		{
+			return pending->output;
+		}
+	}
+	
+	const char *output=lookup_shell_command(command,GLOBAL_SHELL_COMMAND_CWD);
+	
+	return output?output:"";
+}
+
+static const char *get_tab_position_content(long long id, gpointer user_data)
+{
+	GHashTable *contents=user_data;
+	
+	return g_hash_table_lookup(contents, GINT_TO_POINTER(id));
+}
+
+static char *get_stop_text(GtkTextBuffer *buffer, guint stop)
+{
+	gint64 start, end;
+	snippet_stops_get_range(GLOBAL_SNIPPET_STOPS,stop,&start,&end);
+	
+	GtkTextIter start_iter, end_iter;
+	gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start);
+	gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end);
+	
+	return gtk_text_buffer_get_text(buffer, &start_iter, &end_iter, FALSE);
+}
+
+/**
+	Renders the snippet again with what the stops hold now, for the mirrors and python blocks.
+	A stop whose default got typed over has no content, and renders its own default.
+*/
+int finalize_fancy_snippet(GtkTextBuffer *buffer)
+{
+	const char *const insertion=GLOBAL_CURRENT_SNIPPET_TRANSLATION->to;
+	
+	g_autoptr(GHashTable) contents=g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,g_free);
+	
+	for(guint i=0;i<GLOBAL_SNIPPET_STOP_ORDER->len;i++)
+	{
+		const guint stop=g_array_index(GLOBAL_SNIPPET_STOP_ORDER,guint,i);
+		SnippetStop *snippet_stop=snippet_stops_get(GLOBAL_SNIPPET_STOPS,stop);
+		
+		if(!snippet_stop->removed)
+		{
+			g_hash_table_insert(contents,GINT_TO_POINTER(snippet_stop->id),get_stop_text(buffer,stop));
+		}
+	}
+	
+	g_autoptr(GString) result=g_string_sized_new(100);
+	render_snippet_template(result,insertion,get_tab_position_content,contents);
+	
+	//the first stop is the whole snippet
+	gint64 start, end;
+	snippet_stops_get_range(GLOBAL_SNIPPET_STOPS,0,&start,&end);
+	
+	stop_tracking_edits();
+	
+	gtk_text_buffer_begin_user_action(buffer);
+	
+	GtkTextIter start_iter, end_iter;
+	gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start);
+	gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end);
+	
+	gtk_text_buffer_delete(buffer, &start_iter, &end_iter);
+	gtk_text_buffer_insert(buffer, &start_iter, result->str, result->len);
+	
+	//the placeholders were replaced with the rest of the snippet
+	for(guint i=GLOBAL_PENDING_SHELL_COMMANDS->len;i>0;i--)
+	{
+		PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i-1);
+		
+		if(pending->generation==GLOBAL_SHELL_COMMAND_GENERATION)
+		{
+			g_ptr_array_remove_index(GLOBAL_PENDING_SHELL_COMMANDS,i-1);
+		}
+	}
+	
+	gtk_text_buffer_end_user_action(buffer);
+	
+	return 0;
+}
+
+/**
+	The expansion in progress and the caches it fills, for the memory report.
+*/
+size_t get_snippet_engine_memory(gpointer user_data)
+{
+	size_t bytes=get_shell_command_cache_memory();
+	
+	bytes+=snippet_stops_get_memory(GLOBAL_SNIPPET_STOPS);
+	
+	if(GLOBAL_SNIPPET_STOP_ORDER)
+	{
+		bytes+=GLOBAL_SNIPPET_STOP_ORDER->len*sizeof(guint);
+	}
+	
+	if(GLOBAL_PENDING_SHELL_COMMANDS)
+	{
+		for(guint i=0;i<GLOBAL_PENDING_SHELL_COMMANDS->len;i++)
+		{
+			PendingShellCommand *pending=g_ptr_array_index(GLOBAL_PENDING_SHELL_COMMANDS,i);
+			bytes+=sizeof(PendingShellCommand)+strlen(pending->command)+1+(pending->output?strlen(pending->output)+1:0);
+		}
+	}
+	
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		bytes+=GLOBAL_SNIPPET_VARIABLES[i]?strlen(GLOBAL_SNIPPET_VARIABLES[i])+1:0;
+	}
+	
+	if(GLOBAL_CHUNKED_INSERTION)
+	{
+		bytes+=sizeof(ChunkedInsertion)+GLOBAL_CHUNKED_INSERTION->text_len+1;
+	}
+	
+	return bytes;
+}
+
+int init_globals()
+{
+	if(GLOBAL_SNIPPET_STOP_ORDER==NULL)
+	{
+		GLOBAL_SNIPPET_STOP_ORDER=g_array_new(FALSE,FALSE,sizeof(guint));
+		GLOBAL_PENDING_SHELL_COMMANDS=g_ptr_array_new_with_free_func((GDestroyNotify)_pending_shell_command_free);
+		
+		shell_commands_init();
+		
+		if(template_init()!=0)
+		{
+			return -1;
+		}
+		
+		template_set_variable_func(get_snippet_variable_value,NULL);
+		
+		return template_set_command_func(get_shell_command_output,NULL);
+	}
+	else
+	{
+		return reset_globals();
+	}
+	
+	return 0;
+}
+
+size_t get_position_relative_start(GtkTextBuffer *buffer)
+{
+	GtkTextIter iter;
+	gtk_text_buffer_get_iter_at_mark(buffer,
+		                             &iter,
+		                             gtk_text_buffer_get_insert(buffer));
+
+	return gtk_text_iter_get_offset(&iter);
+}
+
+//the first stop from index on in the order of Tab whose default was not typed over
+static guint get_next_live_position(guint index)
+{
+	while(index<GLOBAL_SNIPPET_STOP_ORDER->len && snippet_stops_get(GLOBAL_SNIPPET_STOPS,g_array_index(GLOBAL_SNIPPET_STOP_ORDER,guint,index))->removed)
+	{
+		index++;
+	}
+	
+	return index;
+}
+
+/**
+	Selects the next stop from index on, so typing replaces its default. On the last one the
+	next Tab fills in the rest of the snippet, or there is nothing left to do.
+	Returns FALSE when there are no stops left.
+*/
+static gboolean enter_tab_position(GtkTextBuffer *buffer, guint index)
+{
+	index=get_next_live_position(index);
+	
+	if(index>=GLOBAL_SNIPPET_STOP_ORDER->len)
+	{
+		return FALSE;
+	}
+	
+	GLOBAL_POSITION_STATE=index;
+	GLOBAL_SNIPPET_STOPS->active=g_array_index(GLOBAL_SNIPPET_STOP_ORDER,guint,index);
+	
+	gint64 start, end;
+	snippet_stops_get_range(GLOBAL_SNIPPET_STOPS,GLOBAL_SNIPPET_STOPS->active,&start,&end);
+	
+	GtkTextIter start_iter, end_iter;
+	gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, start);
+	gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, end);
+	gtk_text_buffer_select_range(buffer, &end_iter, &start_iter);
+	
+	if(get_next_live_position(index+1)>=GLOBAL_SNIPPET_STOP_ORDER->len)
+	{
+		if(GLOBAL_EXPAND_INTERNAL_CODE)
+		{
+			GLOBAL_EXPAND_INTERNAL_CODE=2;
+		}
+		else
+		{
+			reset_globals();
+		}
+	}
+	
+	return TRUE;
+}
+
+/**
+	Starts editing the stops, once all of the snippet is in the buffer.
+*/
+static void place_first_tab_position(GtkTextBuffer *buffer)
+{
+	snippet_stops_build(GLOBAL_SNIPPET_STOPS,GLOBAL_SNIPPET_START_POS);
+	
+	GLOBAL_SNIPPET_BUFFER=g_object_ref(buffer);
+	g_signal_connect(buffer, "insert-text", G_CALLBACK(on_snippet_insert_text), NULL);
+	g_signal_connect(buffer, "delete-range", G_CALLBACK(on_snippet_delete_range), NULL);
+	
+	track_shell_commands(buffer);
+	
+	for(guint i=0;i<GLOBAL_SNIPPET_STOPS->stops->len;i++)
+	{
+		if(snippet_stops_get(GLOBAL_SNIPPET_STOPS,i)->id>=0)
+		{
+			g_array_append_val(GLOBAL_SNIPPET_STOP_ORDER,i);
+		}
+	}
+	
+	g_array_sort_with_data(GLOBAL_SNIPPET_STOP_ORDER,compare_stop_order,GLOBAL_SNIPPET_STOPS);
+	
+	if(!enter_tab_position(buffer,0))
+	{
+		//nothing to type, only python blocks to fill in
+		if(GLOBAL_EXPAND_INTERNAL_CODE)
+		{
+			finalize_fancy_snippet(buffer);
+		}
+		
+		reset_globals();
+	}
+}
+
+static void on_chunked_insert_text(GtkTextBuffer *buffer, GtkTextIter *location, gchar *text, gint len, gpointer user_data);
+static void on_chunked_delete_range(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, gpointer user_data);
+
+static void chunked_insertion_free(ChunkedInsertion *self)
+{
+	if(self->source_id)
+	{
+		g_source_remove(self->source_id);
+	}
+	
+	g_signal_handlers_disconnect_by_func(self->buffer, on_chunked_insert_text, self);
+	g_signal_handlers_disconnect_by_func(self->buffer, on_chunked_delete_range, self);
+	
+	gtk_text_buffer_delete_mark(self->buffer,self->start_mark);
+	gtk_text_buffer_delete_mark(self->buffer,self->end_mark);
+	
+	//closes the user action opened in start_chunked_insertion, so the snippet is undone in one step
+	gtk_text_buffer_end_user_action(self->buffer);
+	
+	g_object_unref(self->buffer);
+	g_free(self->text);
+	g_free(self->trigger);
+	g_free(self);
+}
+
+static gboolean insert_next_chunk(gpointer user_data)
+{
+	ChunkedInsertion *self=user_data;
+	
+	const gint64 deadline=g_get_monotonic_time()+SNIPPET_INSERTION_SLICE_USEC;
+	
+	GLOBAL_ENGINE_EDITING++;
+	
+	do
+	{
+		const char *chunk=self->text+self->inserted;
+		size_t chunk_len=MIN(SNIPPET_INSERTION_CHUNK_SIZE,self->text_len-self->inserted);
+		
+		//do not split a character
+		while(self->inserted+chunk_len<self->text_len && chunk_len>1 && (chunk[chunk_len]&0xC0)==0x80)
+		{
+			chunk_len--;
+		}
+		
+		GtkTextIter iter;
+		gtk_text_buffer_get_iter_at_mark(self->buffer, &iter, self->end_mark);
+		gtk_text_buffer_insert(self->buffer, &iter, chunk, chunk_len);
+		
+		self->inserted+=chunk_len;
+	}
+	while(self->inserted<self->text_len && g_get_monotonic_time()<deadline);
+	
+	GLOBAL_ENGINE_EDITING--;
+	
+	if(self->inserted<self->text_len)
+	{
+		return G_SOURCE_CONTINUE;
+	}
+	
+	self->source_id=0;
+	GLOBAL_CHUNKED_INSERTION=NULL;
+	
+	GtkTextIter end;
+	gtk_text_buffer_get_iter_at_mark(self->buffer, &end, self->end_mark);
+	gtk_text_buffer_place_cursor(self->buffer, &end);
+	
+	place_first_tab_position(self->buffer);
+	
+	chunked_insertion_free(self);
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Stops a running chunked insertion, removes what it inserted so far and puts the trigger back.
+*/
+int cancel_chunked_insertion()
+{
+	ChunkedInsertion *self=GLOBAL_CHUNKED_INSERTION;
+	
+	if(!self)
+	{
+		return 0;
+	}
+	
+	GLOBAL_CHUNKED_INSERTION=NULL;
+	
+	GtkTextIter start, end;
+	gtk_text_buffer_get_iter_at_mark(self->buffer, &start, self->start_mark);
+	gtk_text_buffer_get_iter_at_mark(self->buffer, &end, self->end_mark);
+	GLOBAL_ENGINE_EDITING++;
+	gtk_text_buffer_delete(self->buffer, &start, &end);
+	
+	if(self->trigger)
+	{
+		gtk_text_buffer_insert(self->buffer, &start, self->trigger, -1);
+		gtk_text_buffer_place_cursor(self->buffer, &start);
+	}
+	
+	GLOBAL_ENGINE_EDITING--;
+	
+	chunked_insertion_free(self);
+	forget_untracked_shell_commands();
+	
+	return reset_globals();
+}
+
+/**
+	Like cancel_chunked_insertion, but only when the running insertion goes into buffer, so a
+	window that closes leaves the insertion of another window alone.
+*/
+int cancel_buffer_chunked_insertion(GtkTextBuffer *buffer)
+{
+	if(!GLOBAL_CHUNKED_INSERTION || GLOBAL_CHUNKED_INSERTION->buffer!=buffer)
+	{
+		return 0;
+	}
+	
+	return cancel_chunked_insertion();
+}
+
+/**
+	Any edit that does not come from the engine, like a paste, a drop or another plugin, cancels
+	the insertion before it happens, so it is not merged into the undo step of the snippet.
+	The iters of the edit are revalidated, as the handlers run before the default one.
+*/
+static void on_chunked_insert_text(GtkTextBuffer *buffer, GtkTextIter *location, gchar *text, gint len, gpointer user_data)
+{
+	if(snippet_engine_is_editing())
+	{
+		return;
+	}
+	
+	GtkTextMark *mark=gtk_text_buffer_create_mark(buffer, NULL, location, FALSE);
+	cancel_chunked_insertion();
+	gtk_text_buffer_get_iter_at_mark(buffer, location, mark);
+	gtk_text_buffer_delete_mark(buffer, mark);
+}
+
+static void on_chunked_delete_range(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, gpointer user_data)
+{
+	if(snippet_engine_is_editing())
+	{
+		return;
+	}
+	
+	GtkTextMark *start_mark=gtk_text_buffer_create_mark(buffer, NULL, start, TRUE);
+	GtkTextMark *end_mark=gtk_text_buffer_create_mark(buffer, NULL, end, FALSE);
+	cancel_chunked_insertion();
+	gtk_text_buffer_get_iter_at_mark(buffer, start, start_mark);
+	gtk_text_buffer_get_iter_at_mark(buffer, end, end_mark);
+	gtk_text_buffer_delete_mark(buffer, start_mark);
+	gtk_text_buffer_delete_mark(buffer, end_mark);
+}
+
+/**
+	Takes text. The cursor and the tab positions are set up once all of it is in. trigger is
+	what was deleted for the snippet, or NULL.
+*/
+static int start_chunked_insertion(GtkTextBuffer *buffer, GtkTextIter *start, char *text, const char *trigger)
+{
+	ChunkedInsertion *self=g_new0(ChunkedInsertion,1);
+	self->buffer=g_object_ref(buffer);
+	self->start_mark=gtk_text_buffer_create_mark(buffer, NULL, start, TRUE);
+	self->end_mark=gtk_text_buffer_create_mark(buffer, NULL, start, FALSE);
+	self->text=text;
+	self->text_len=strlen(text);
+	self->trigger=g_strdup(trigger);
+	
+	gtk_text_buffer_begin_user_action(buffer);
+	
+	g_signal_connect(buffer, "insert-text", G_CALLBACK(on_chunked_insert_text), self);
+	g_signal_connect(buffer, "delete-range", G_CALLBACK(on_chunked_delete_range), self);
+	
+	self->source_id=g_idle_add(insert_next_chunk, self);
+	
+	GLOBAL_CHUNKED_INSERTION=self;
+	
+	return 0;
+}
+
+typedef struct SnippetLayout
+{
+	GString *text; ///< what the first insertion shows
+	glong text_len; ///< in characters, where the stops begin and end
+	GHashTable *ids; ///< the ids that already have a stop
+	gboolean clipboard_requested;
+}SnippetLayout;
+
+static void append_layout_text(SnippetLayout *layout, const char *text, gssize len)
+{
+	g_string_append_len(layout->text,text,len);
+	layout->text_len+=g_utf8_strlen(text,len);
+}
+
+//a $(command) or GEDIT_CLIPBOARD that is not there yet, shown as the placeholder until it is
+static void add_pending_shell_command(SnippetLayout *layout, const char *match)
+{
+	char *command=get_match_command(match);
+	const gboolean is_command=command!=NULL;
+	
+	PendingShellCommand *pending=g_new0(PendingShellCommand,1);
+	pending->command=is_command?command:g_strdup(get_snippet_variable_name(SNIPPET_VARIABLE_CLIPBOARD));
+	pending->generation=GLOBAL_SHELL_COMMAND_GENERATION;
+	pending->offset=layout->text_len;
+	g_ptr_array_add(GLOBAL_PENDING_SHELL_COMMANDS,pending);
+	
+	if(is_command)
+	{
+		run_shell_command_async(pending->command,GLOBAL_SHELL_COMMAND_CWD,on_shell_command_output,GUINT_TO_POINTER(GLOBAL_SHELL_COMMAND_GENERATION));
+	}
+	else if(!layout->clipboard_requested)
+	{
+		layout->clipboard_requested=TRUE;
+		
+		//without a display, like in snippets-replay, the clipboard is empty
+		if(gdk_display_get_default())
+		{
+			gtk_clipboard_request_text(gtk_clipboard_get(GDK_SELECTION_CLIPBOARD),on_clipboard_text,GUINT_TO_POINTER(GLOBAL_SHELL_COMMAND_GENERATION));
+		}
+		else
+		{
+			on_clipboard_text(NULL,NULL,GUINT_TO_POINTER(GLOBAL_SHELL_COMMAND_GENERATION));
+		}
+	}
+	
+	append_layout_text(layout,SHELL_COMMAND_PLACEHOLDER,-1);
+}
+
+static void layout_snippet_text(SnippetLayout *layout, const char *insertion, GPtrArray *placeholders);
+
+//$N, ${N}, ${N:default}, $<[N]:...> and the rest of the python blocks and transformations
+static void layout_placeholder(SnippetLayout *layout, SnippetPlaceholder *placeholder)
+{
+	const char *match=placeholder->match;
+	long long id_num=-1;
+	char *id_end=NULL;
+	
+	if(g_ascii_isdigit(match[1]))
+	{
+		id_num=g_ascii_strtoll(match+1,&id_end,10);
+	}
+	else if(match[1]=='<' && match[2]=='[' && g_ascii_isdigit(match[3]))
+	{
+		id_num=g_ascii_strtoll(match+3,&id_end,10);
+	}
+	else if(match[1]=='{' && g_ascii_isdigit(match[2]))
+	{
+		id_num=g_ascii_strtoll(match+2,&id_end,10);
+	}
+	
+	if(match[1]=='<' || match[1]=='{')
+	{
+		GLOBAL_EXPAND_INTERNAL_CODE=1;
+	}
+	
+	//${N/regex/format/flags} only mirrors $N, it is not a tab stop of its own
+	if(id_num<0 || (match[1]=='{' && *id_end=='/'))
+	{
+		return;
+	}
+	
+	if(!g_hash_table_add(layout->ids,GINT_TO_POINTER(id_num)))
+	{
+		//more than one variable exists, need to expand
+		GLOBAL_EXPAND_INTERNAL_CODE=1;
+		return;
+	}
+	
+	const guint stop=snippet_stops_begin(GLOBAL_SNIPPET_STOPS,id_num,layout->text_len);
+	
+	//the default is shown, with the placeholders in it as stops of their own
+	if(placeholder->children)
+	{
+		layout_snippet_text(layout,placeholder->default_text,placeholder->children);
+	}
+	else if(placeholder->default_text)
+	{
+		append_layout_text(layout,placeholder->default_text,-1);
+	}
+	
+	snippet_stops_end(GLOBAL_SNIPPET_STOPS,stop,layout->text_len);
+}
+
+/**
+	Lays out what the first insertion shows: the values of the variables and commands, or the
+	placeholder until they are there, and the defaults of the tab stops. The first $N or
+	${N:...} of every id becomes a stop, mirrors and python blocks show nothing until the end.
+	placeholders is the tree of insertion from get_snippet_placeholders.
+*/
+static void layout_snippet_text(SnippetLayout *layout, const char *insertion, GPtrArray *placeholders)
+{
+	const char *cursor=insertion;
+	
+	for(guint i=0;i<placeholders->len;i++)
+	{
+		SnippetPlaceholder *placeholder=g_ptr_array_index(placeholders,i);
+		const char *match=placeholder->match;
+		
+		append_layout_text(layout, cursor, insertion+placeholder->start-cursor);
+		cursor=insertion+placeholder->end;
+		
+		const int variable=get_match_variable(match);
+		g_autofree char *command=get_match_command(match);
+		
+		if(command || variable==SNIPPET_VARIABLE_CLIPBOARD)
+		{
+			const char *output=command?lookup_shell_command(command,GLOBAL_SHELL_COMMAND_CWD):NULL;
+			
+			if(output)
+			{
+				append_layout_text(layout, output, -1);
+			}
+			else
+			{
+				add_pending_shell_command(layout, match);
+			}
+		}
+		else if(variable>=0)
+		{
+			append_layout_text(layout, GLOBAL_SNIPPET_VARIABLES[variable]?GLOBAL_SNIPPET_VARIABLES[variable]:"", -1);
+		}
+		else if(match[1]=='G')
+		{
+			//an unknown $GEDIT_NAME stays as it is
+			append_layout_text(layout, match, -1);
+		}
+		else
+		{
+			layout_placeholder(layout, placeholder);
+		}
+	}
+	
+	append_layout_text(layout, cursor, -1);
+}
+
+/**
+	1. Add the snippet with the defaults of the tab stops, and remember the range of each stop.
+	2. Select the first stop. Its range follows the edits to the buffer, typing in it grows it,
+	   typing over a default drops the stops that were in it. Clicking somewhere cancels everything.
+	3. Tab selects the next stop. After the last one, if the snippet has mirrors or python blocks,
+	   it is rendered again with what the stops hold and replaces what was inserted.
+	trigger is the text the snippet replaced, a big snippet that gets cancelled while it is
+	inserted puts it back.
+*/
+static int handle_first_insertion(GtkTextBuffer *buffer, GtkTextIter *start, SnippetTranslation *sntran, const char *trigger)
+{
+	init_globals();
+	GLOBAL_CURRENT_SNIPPET_TRANSLATION=sntran;
+	
+	g_free(GLOBAL_SHELL_COMMAND_CWD);
+	GLOBAL_SHELL_COMMAND_CWD=g_strdup(get_document_value(buffer,SNIPPET_VARIABLE_DIR));
+	
+	resolve_snippet_variables(buffer, sntran->variables);
+	
+	g_autoptr(GHashTable) ids=g_hash_table_new(g_direct_hash,g_direct_equal);
+	SnippetLayout layout={g_string_sized_new(strlen(sntran->to)),0,ids,FALSE};
+	
+	//the whole snippet is a stop too, what finalize_fancy_snippet replaces
+	GLOBAL_SNIPPET_STOPS=snippet_stops_new();
+	const guint root=snippet_stops_begin(GLOBAL_SNIPPET_STOPS,-1,0);
+	layout_snippet_text(&layout, sntran->to, get_snippet_placeholders(sntran->to));
+	snippet_stops_end(GLOBAL_SNIPPET_STOPS,root,layout.text_len);
+	
+	GLOBAL_SNIPPET_START_POS=get_position_relative_start(buffer);
+	
+	if(layout.text->len>SNIPPET_CHUNKED_INSERTION_THRESHOLD)
+	{
+		return start_chunked_insertion(buffer, start, g_string_free(layout.text,FALSE), trigger);
+	}
+	
+	gtk_text_buffer_insert(buffer, start, layout.text->str, layout.text->len);
+	g_string_free(layout.text,TRUE);
+	
+	place_first_tab_position(buffer);
+	
+	return 0;
+}
+
+typedef struct SelectionInstance
+{
+	const char *line;
+	GPtrArray *captures; ///< $N is group N of the regex, NULL when there is no regex
+}SelectionInstance;
+
+static const char *get_selection_value(long long id, gpointer user_data)
+{
+	SelectionInstance *instance=user_data;
+	
+	if(instance->captures)
+	{
+		if(id>=0 && (guint)id<instance->captures->len)
+		{
+			return g_ptr_array_index(instance->captures,id);
+		}
+		
+		return NULL;
+	}
+	
+	return id==1?instance->line:NULL;
+}
+
+/**
+	Renders the snippet once per selected line, with the line as $1, or with the groups of regex as $1..$N.
+	The python blocks and commands that do not read $N run once for all lines.
+	Lines the regex does not match are kept as they are. Everything is rendered into one buffer and
+	inserted at once, so it is a single undo step.
+*/
+int expand_snippet_over_selection(GtkTextBuffer *buffer, SnippetTranslation *sntran, GRegex *regex)
+{
+	GtkTextIter start, end;
+	
+	if(!gtk_text_buffer_get_selection_bounds(buffer, &start, &end))
+	{
+		return -1;
+	}
+	
+	if(template_init()!=0)
+	{
+		return -1;
+	}
+	
+	//the whole selection is replaced, so nothing waits on the clipboard
+	resolve_snippet_variables(buffer, sntran->variables);
+	
+	if(sntran->variables&SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_CLIPBOARD))
+	{
+		GLOBAL_SNIPPET_VARIABLES[SNIPPET_VARIABLE_CLIPBOARD]=g_strdup("");
+	}
+	
+	template_set_variable_func(get_snippet_variable_value,NULL);
+	
+	//work on whole lines, but not the newline after the last one
+	gtk_text_iter_set_line_offset(&start, 0);
+	
+	if(gtk_text_iter_starts_line(&end) && gtk_text_iter_compare(&start, &end)<0)
+	{
+		gtk_text_iter_backward_char(&end);
+	}
+	else if(!gtk_text_iter_ends_line(&end))
+	{
+		gtk_text_iter_forward_to_line_end(&end);
+	}
+	
+	g_autofree char *selected=gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+	const size_t selected_len=strlen(selected);
+	
+	g_auto(GStrv) lines=g_strsplit(selected, "\n", -1);
+	const guint lines_len=g_strv_length(lines);
+	
+	g_autoptr(GString) result=g_string_sized_new(lines_len*(strlen(sntran->to)+1)+selected_len);
+	g_autoptr(GPtrArray) captures=regex?g_ptr_array_new_with_free_func(g_free):NULL;
+	g_autoptr(GString) rendered=g_string_sized_new(strlen(sntran->to)+64);
+	//the blocks that do not read the line run for the first instance only
+	g_autoptr(GHashTable) block_outputs=g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,g_free);
+	
+	for(guint i=0;i<lines_len;i++)
+	{
+		if(i>0)
+		{
+			g_string_append_c(result,'\n');
+		}
+		
+		//the indentation stays in front of the instance, $1 is the rest without trailing space or \r
+		const char *content=lines[i];
+		
+		while(*content==' ' || *content=='\t')
+		{
+			content++;
+		}
+		
+		g_autofree char *line=g_strchomp(g_strdup(content));
+		
+		if(line[0]=='\0')
+		{
+			g_string_append(result,lines[i]);
+			continue;
+		}
+		
+		SelectionInstance instance={line,NULL};
+		
+		if(regex)
+		{
+			g_autoptr(GMatchInfo) match_info=NULL;
+			
+			if(!g_regex_match(regex, line, 0, &match_info))
+			{
+				g_string_append(result,lines[i]);
+				continue;
+			}
+			
+			g_ptr_array_set_size(captures,0);
+			
+			const gint match_count=g_match_info_get_match_count(match_info);
+			for(gint j=0;j<match_count;j++)
+			{
+				g_ptr_array_add(captures,g_match_info_fetch(match_info,j));
+			}
+			
+			instance.captures=captures;
+		}
+		
+		g_string_truncate(rendered,0);
+		render_snippet_template_reusing(rendered,sntran->to,get_selection_value,&instance,block_outputs);
+		
+		//multi line snippets already end their instance
+		if(rendered->len>0 && rendered->str[rendered->len-1]=='\n')
+		{
+			g_string_truncate(rendered,rendered->len-1);
+		}
+		
+		//every line of the instance gets the indentation of the selected line
+		const size_t indent_len=content-lines[i];
+		const char *p=rendered->str;
+		const char *newline;
+		
+		g_string_append_len(result,lines[i],indent_len);
+		
+		while((newline=strchr(p,'\n')))
+		{
+			g_string_append_len(result,p,newline-p+1);
+			g_string_append_len(result,lines[i],indent_len);
+			p=newline+1;
+		}
+		
+		g_string_append(result,p);
+	}
+	
+	gtk_text_buffer_begin_user_action(buffer);
+	
+	gtk_text_buffer_delete(buffer, &start, &end);
+	gtk_text_buffer_insert(buffer, &start, result->str, result->len);
+	
+	gtk_text_buffer_end_user_action(buffer);
+	
+	return 0;
+}
+
+//replaces the trigger between start and end with the snippet
+static void expand_trigger(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, SnippetTranslation *sntran, SnippetTranslation **expanded)
+{
+	gtk_text_buffer_begin_user_action(buffer);
+	
+	g_autofree char *trigger=gtk_text_buffer_get_text(buffer, start, end, FALSE);
+	gtk_text_buffer_delete(buffer, start, end);
+	int ret_result=handle_first_insertion(buffer, start, sntran, trigger);
+	
+	if(ret_result!=0)
+	{
+		fprintf(stderr,"%s:%d Something went wrong to handle the first insertion.\n",__FILE__,__LINE__);
+	}
+	else
+	{
+		*expanded=sntran;
+	}
+	
+	gtk_text_buffer_end_user_action(buffer);
+}
+
+static gboolean handle_tab(GtkTextBuffer *buffer, const char *language, SnippetTranslation **expanded)
+{
+	GtkTextIter iter, start;
+	
+	/* Get the current cursor position */
+	gtk_text_buffer_get_iter_at_mark(buffer, &iter, gtk_text_buffer_get_insert(buffer));
+	
+	//Tab moves to the next stop while a snippet is expanded in this buffer
+	if(GLOBAL_SNIPPET_BUFFER==buffer)
+	{
+		gtk_text_buffer_begin_user_action(buffer);
+		
+		if(GLOBAL_EXPAND_INTERNAL_CODE==2 || !enter_tab_position(buffer,GLOBAL_POSITION_STATE+1))
+		{
+			//the rest of the stops may have been in a default that got typed over
+			if(GLOBAL_EXPAND_INTERNAL_CODE)
+			{
+				finalize_fancy_snippet(buffer);
+			}
+			
+			reset_globals();
+		}
+		
+		gtk_text_buffer_end_user_action(buffer);
+		
+		return TRUE;  // Stop event propagation
+	}
+	
+	//a snippet still expanded in another buffer is left as it is, expanding one here ends it in handle_first_insertion
+	if(GLOBAL_SNIPPETS)
+	{
+		//Tab over a selection indents it, at the start of a line it indents the line
+		if(gtk_text_buffer_get_has_selection(buffer) || gtk_text_iter_starts_line(&iter))
+		{
+			return FALSE;
+		}
+		
+		gtk_text_iter_assign(&start, &iter);
+		gtk_text_iter_backward_char(&start);
+		const gunichar last=gtk_text_iter_get_char(&start);
+		gunichar before_last=0;
+		
+		if(!gtk_text_iter_starts_line(&start) && gtk_text_iter_backward_char(&start))
+		{
+			before_last=gtk_text_iter_get_char(&start);
+		}
+		
+		if(!snippet_filter_may_match(language,before_last,last))
+		{
+			return FALSE;
+		}
+		
+		//one probe per trigger length, the index already has the inherited and compiled snippets
+		SnippetLanguageIndex *index=get_snippet_language_index(language);
+		
+		for(guint i=0;i<index->trigger_lens->len;i++)
+		{
+			gtk_text_iter_assign(&start, &iter);
+			gtk_text_iter_backward_chars(&start,g_array_index(index->trigger_lens,guint,i));
+			
+			g_autofree gchar *word = gtk_text_buffer_get_text(buffer, &start, &iter, FALSE);
+			SnippetTranslation *tmp=g_hash_table_lookup(index->triggers,word);
+			
+			if(tmp)
+			{
+				expand_trigger(buffer, &start, &iter, tmp, expanded);
+				return TRUE;  // Stop event propagation
+			}
+		}
+	}
+	return FALSE;
+}
+
+/**
+	Handles a key pressed in buffer. Returns TRUE when the engine used the key, expanded is
+	set to the snippet when it was the Tab that expanded one.
+*/
+gboolean snippet_engine_key_press(GtkTextBuffer *buffer, const char *language, guint keyval, gboolean is_modifier, SnippetTranslation **expanded)
+{
+	*expanded=NULL;
+	
+	GLOBAL_ENGINE_EDITING++;
+	
+	//typing while a big snippet is still being inserted drops it
+	if(GLOBAL_CHUNKED_INSERTION && !is_modifier)
+	{
+		cancel_chunked_insertion();
+	}
+	
+	const gboolean handled=keyval==GDK_KEY_Tab && handle_tab(buffer, language, expanded);
+	
+	GLOBAL_ENGINE_EDITING--;
+	
+	return handled;
+}
+
+int snippet_engine_button_press(guint button)
+{
+	if(button==1) // left click
+	{
+		GLOBAL_ENGINE_EDITING++;
+		cancel_chunked_insertion();
+		GLOBAL_ENGINE_EDITING--;
+		
+		reset_globals();
+	}
+	
+	return 0;
+}
+
+/**
+	TRUE while the edits to a buffer come from the engine, and not from the user.
+*/
+gboolean snippet_engine_is_editing()
+{
+	return GLOBAL_ENGINE_EDITING>0;
+}
+
+int snippet_engine_set_document_func(SnippetDocumentFunc func, gpointer user_data)
+{
+	GLOBAL_DOCUMENT_FUNC=func;
+	GLOBAL_DOCUMENT_FUNC_DATA=user_data;
+	
+	return 0;
+}
+
+int snippet_engine_finalize()
+{
+	cancel_chunked_insertion();
+	reset_globals();
+	
+	g_clear_pointer(&GLOBAL_SNIPPET_STOP_ORDER,g_array_unref);
+	g_clear_pointer(&GLOBAL_PENDING_SHELL_COMMANDS,g_ptr_array_unref);
+	g_clear_pointer(&GLOBAL_SHELL_COMMAND_CWD,g_free);
+	
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		g_clear_pointer(&GLOBAL_SNIPPET_VARIABLES[i],g_free);
+	}
+	
+	return shell_commands_finalize();
+}
@@ -0,0 +1,50 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-variables.h"
+
+G_BEGIN_DECLS
+
+/**
+	Returns the value of one of the SNIPPET_VARIABLES_DOCUMENT for buffer, or NULL.
+*/
+typedef const char *(*SnippetDocumentFunc)(GtkTextBuffer *buffer, SnippetVariable variable, gpointer user_data);
+
+int snippet_engine_set_document_func(SnippetDocumentFunc func, gpointer user_data);
+int snippet_engine_finalize();
+
+gboolean snippet_engine_key_press(GtkTextBuffer *buffer, const char *language, guint keyval, gboolean is_modifier, SnippetTranslation **expanded);
+int snippet_engine_button_press(guint button);
+gboolean snippet_engine_is_editing();
+
+int init_globals();
+int reset_globals();
+int cancel_chunked_insertion();
+int cancel_buffer_chunked_insertion(GtkTextBuffer *buffer);
+int finalize_fancy_snippet(GtkTextBuffer *buffer);
+size_t get_position_relative_start(GtkTextBuffer *buffer);
+int expand_snippet_over_selection(GtkTextBuffer *buffer, SnippetTranslation *sntran, GRegex *regex);
+size_t get_snippet_engine_memory(gpointer user_data);
+
+G_END_DECLS
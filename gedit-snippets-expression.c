@@ -0,0 +1,2150 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Evaluates the common $<[N]: return ...> blocks without python. The block is compiled to a
+	small stack bytecode once, and every expansion only runs that. The language is the subset
+	of python expressions the snippets use: string, number and list values, $N for the text of
+	a tab stop, + - * // %, comparisons, in, and, or, not, x if c else y, [i] and [a:b],
+	str methods like upper, strip, split, join, ljust and replace, and the functions len, str,
+	int, camelcase, pascalcase, snakecase and kebabcase. Everything else, like names of the
+	includes or of the helper modules, makes the compile fail, and the block runs in python.
+	A block calling a function that the includes or helpers define runs in python too.
+*/
+#include <errno.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-expression.h"
+
+//so that '-' * 1000000000 fails instead of taking the editor down
+#define SNIPPET_EXPRESSION_STRING_MAX (1<<20)
+
+typedef enum SnippetExpressionBinary
+{
+	SNIPPET_EXPRESSION_BINARY_ADD=0,
+	SNIPPET_EXPRESSION_BINARY_SUBTRACT,
+	SNIPPET_EXPRESSION_BINARY_MULTIPLY,
+	SNIPPET_EXPRESSION_BINARY_FLOOR_DIVIDE,
+	SNIPPET_EXPRESSION_BINARY_MODULO,
+	SNIPPET_EXPRESSION_BINARY_EQUAL,
+	SNIPPET_EXPRESSION_BINARY_NOT_EQUAL,
+	SNIPPET_EXPRESSION_BINARY_LESS,
+	SNIPPET_EXPRESSION_BINARY_LESS_EQUAL,
+	SNIPPET_EXPRESSION_BINARY_GREATER,
+	SNIPPET_EXPRESSION_BINARY_GREATER_EQUAL,
+	SNIPPET_EXPRESSION_BINARY_IN,
+	SNIPPET_EXPRESSION_BINARY_NOT_IN
+}SnippetExpressionBinary;
+
+typedef gboolean (*ExpressionFunc)(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error);
+
+typedef struct ExpressionFunction
+{
+	const char *name;
+	gboolean method; ///< called as value.name(...), the value is the first argument
+	guint8 min_args; ///< with the value of a method
+	guint8 max_args;
+	ExpressionFunc func;
+}ExpressionFunction;
+
+typedef enum ExpressionToken
+{
+	EXPRESSION_TOKEN_END=0,
+	EXPRESSION_TOKEN_INT,
+	EXPRESSION_TOKEN_STRING,
+	EXPRESSION_TOKEN_STOP,
+	EXPRESSION_TOKEN_NAME,
+	EXPRESSION_TOKEN_OP,
+	EXPRESSION_TOKEN_ERROR
+}ExpressionToken;
+
+typedef struct ExpressionCompiler
+{
+	const char *p;
+	int brackets; ///< open ( and [, a line break inside them is only space
+	ExpressionToken token;
+	long long number; ///< of INT and STOP
+	GString *text; ///< of STRING, NAME and OP
+	SnippetExpression *expression;
+	int depth; ///< of the stack after the code emitted so far
+}ExpressionCompiler;
+
+/////////////////////////////////////////////////////////////////////// values
+
+static void expression_value_clear(SnippetExpressionValue *self)
+{
+	g_clear_pointer(&self->text,g_free);
+	g_clear_pointer(&self->list,g_ptr_array_unref);
+	self->number=0;
+	self->type=SNIPPET_EXPRESSION_VALUE_STRING;
+}
+
+static void expression_value_set_string(SnippetExpressionValue *self, char *text)
+{
+	expression_value_clear(self);
+	self->type=SNIPPET_EXPRESSION_VALUE_STRING;
+	self->text=text;
+}
+
+static void expression_value_set_int(SnippetExpressionValue *self, long long number)
+{
+	expression_value_clear(self);
+	self->type=SNIPPET_EXPRESSION_VALUE_INT;
+	self->number=number;
+}
+
+static void expression_value_set_bool(SnippetExpressionValue *self, gboolean value)
+{
+	expression_value_clear(self);
+	self->type=SNIPPET_EXPRESSION_VALUE_BOOL;
+	self->number=value?1:0;
+}
+
+static void expression_value_set_list(SnippetExpressionValue *self, GPtrArray *list)
+{
+	expression_value_clear(self);
+	self->type=SNIPPET_EXPRESSION_VALUE_LIST;
+	self->list=list;
+}
+
+static GPtrArray *expression_list_new()
+{
+	return g_ptr_array_new_with_free_func(g_free);
+}
+
+static void expression_value_copy(SnippetExpressionValue *self, const SnippetExpressionValue *source)
+{
+	expression_value_clear(self);
+	self->type=source->type;
+	self->number=source->number;
+	self->text=g_strdup(source->text);
+
+	if(source->list)
+	{
+		self->list=expression_list_new();
+
+		for(guint i=0;i<source->list->len;i++)
+		{
+			g_ptr_array_add(self->list,g_strdup(g_ptr_array_index(source->list,i)));
+		}
+	}
+}
+
+static const char *get_expression_type_name(const SnippetExpressionValue *self)
+{
+	switch(self->type)
+	{
+		case SNIPPET_EXPRESSION_VALUE_INT:
+			return "int";
+		case SNIPPET_EXPRESSION_VALUE_BOOL:
+			return "bool";
+		case SNIPPET_EXPRESSION_VALUE_LIST:
+			return "list";
+		default:
+			return "str";
+	}
+}
+
+static gboolean is_expression_number(const SnippetExpressionValue *self)
+{
+	return self->type==SNIPPET_EXPRESSION_VALUE_INT || self->type==SNIPPET_EXPRESSION_VALUE_BOOL;
+}
+
+static gboolean is_expression_true(const SnippetExpressionValue *self)
+{
+	switch(self->type)
+	{
+		case SNIPPET_EXPRESSION_VALUE_STRING:
+			return self->text[0]!='\0';
+		case SNIPPET_EXPRESSION_VALUE_LIST:
+			return self->list->len>0;
+		default:
+			return self->number!=0;
+	}
+}
+
+//what str() gives
+static char *expression_value_to_string(const SnippetExpressionValue *self)
+{
+	switch(self->type)
+	{
+		case SNIPPET_EXPRESSION_VALUE_INT:
+			return g_strdup_printf("%lld",self->number);
+		case SNIPPET_EXPRESSION_VALUE_BOOL:
+			return g_strdup(self->number?"True":"False");
+		case SNIPPET_EXPRESSION_VALUE_LIST:
+		{
+			GString *repr=g_string_new("[");
+
+			for(guint i=0;i<self->list->len;i++)
+			{
+				g_string_append_printf(repr,"%s'%s'",i==0?"":", ",(const char *)g_ptr_array_index(self->list,i));
+			}
+
+			g_string_append_c(repr,']');
+
+			return g_string_free(repr,FALSE);
+		}
+		default:
+			return g_strdup(self->text);
+	}
+}
+
+static gboolean set_expression_error(char **error, const char *format, ...) G_GNUC_PRINTF(2,3);
+
+//always FALSE, so a failing function can return it
+static gboolean set_expression_error(char **error, const char *format, ...)
+{
+	va_list args;
+	va_start(args,format);
+
+	g_free(*error);
+	*error=g_strdup_vprintf(format,args);
+
+	va_end(args);
+
+	return FALSE;
+}
+
+static gboolean require_expression_string(const SnippetExpressionValue *value, const char *function, char **error)
+{
+	if(value->type!=SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		return set_expression_error(error,"TypeError: %s() needs a str, not %s",function,get_expression_type_name(value));
+	}
+
+	return TRUE;
+}
+
+static gboolean require_expression_number(const SnippetExpressionValue *value, const char *function, char **error)
+{
+	if(!is_expression_number(value))
+	{
+		return set_expression_error(error,"TypeError: %s() needs an int, not %s",function,get_expression_type_name(value));
+	}
+
+	return TRUE;
+}
+
+//a fill character of ljust, rjust and center
+static gboolean get_expression_fill(SnippetExpressionValue *args, guint argc, guint index, const char *function, gunichar *fill, char **error)
+{
+	*fill=' ';
+
+	if(argc<=index)
+	{
+		return TRUE;
+	}
+
+	if(!require_expression_string(&args[index],function,error))
+	{
+		return FALSE;
+	}
+
+	if(g_utf8_strlen(args[index].text,-1)!=1)
+	{
+		return set_expression_error(error,"TypeError: The fill character must be exactly one character long");
+	}
+
+	*fill=g_utf8_get_char(args[index].text);
+
+	return TRUE;
+}
+
+static gboolean check_expression_length(long long len, char **error)
+{
+	if(len>SNIPPET_EXPRESSION_STRING_MAX)
+	{
+		return set_expression_error(error,"MemoryError: the result would be longer than %d bytes",SNIPPET_EXPRESSION_STRING_MAX);
+	}
+
+	return TRUE;
+}
+
+/////////////////////////////////////////////////////////////////////// functions
+
+static gboolean expression_upper(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_string(result,g_utf8_strup(args[0].text,-1));
+	return TRUE;
+}
+
+static gboolean expression_lower(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_string(result,g_utf8_strdown(args[0].text,-1));
+	return TRUE;
+}
+
+static gboolean is_cased(gunichar c)
+{
+	return g_unichar_isupper(c) || g_unichar_islower(c) || g_unichar_istitle(c);
+}
+
+static gboolean expression_title(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	GString *out=g_string_sized_new(strlen(args[0].text));
+	gboolean previous_cased=FALSE;
+
+	for(const char *p=args[0].text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+
+		g_string_append_unichar(out,previous_cased?g_unichar_tolower(c):g_unichar_totitle(c));
+		previous_cased=is_cased(c);
+	}
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_capitalize(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	GString *out=g_string_sized_new(strlen(args[0].text));
+
+	for(const char *p=args[0].text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+		g_string_append_unichar(out,p==args[0].text?g_unichar_totitle(c):g_unichar_tolower(c));
+	}
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_swapcase(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	GString *out=g_string_sized_new(strlen(args[0].text));
+
+	for(const char *p=args[0].text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+		g_string_append_unichar(out,g_unichar_isupper(c)?g_unichar_tolower(c):g_unichar_islower(c)?g_unichar_toupper(c):c);
+	}
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean is_stripped_char(gunichar c, const char *chars)
+{
+	return chars?g_utf8_strchr(chars,-1,c)!=NULL:g_unichar_isspace(c);
+}
+
+static gboolean strip_expression_string(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, gboolean left, gboolean right, const char *function, char **error)
+{
+	if(argc>1 && !require_expression_string(&args[1],function,error))
+	{
+		return FALSE;
+	}
+
+	const char *chars=argc>1?args[1].text:NULL;
+	const char *start=args[0].text;
+	const char *end=start+strlen(start);
+
+	while(left && start<end && is_stripped_char(g_utf8_get_char(start),chars))
+	{
+		start=g_utf8_next_char(start);
+	}
+
+	while(right && end>start)
+	{
+		const char *last=g_utf8_prev_char(end);
+
+		if(!is_stripped_char(g_utf8_get_char(last),chars))
+		{
+			break;
+		}
+
+		end=last;
+	}
+
+	expression_value_set_string(result,g_strndup(start,end-start));
+	return TRUE;
+}
+
+static gboolean expression_strip(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return strip_expression_string(args,argc,result,TRUE,TRUE,"strip",error);
+}
+
+static gboolean expression_lstrip(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return strip_expression_string(args,argc,result,TRUE,FALSE,"lstrip",error);
+}
+
+static gboolean expression_rstrip(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return strip_expression_string(args,argc,result,FALSE,TRUE,"rstrip",error);
+}
+
+static gboolean expression_replace(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[1],"replace",error) || !require_expression_string(&args[2],"replace",error))
+	{
+		return FALSE;
+	}
+
+	const char *old=args[1].text;
+	const char *new=args[2].text;
+	GString *out=g_string_sized_new(strlen(args[0].text));
+
+	if(old[0]=='\0')
+	{
+		//like python, around every character
+		for(const char *p=args[0].text;*p;p=g_utf8_next_char(p))
+		{
+			g_string_append(out,new);
+			g_string_append_len(out,p,g_utf8_next_char(p)-p);
+		}
+
+		g_string_append(out,new);
+	}
+	else
+	{
+		const size_t old_len=strlen(old);
+		const char *p=args[0].text;
+		const char *found;
+
+		while((found=strstr(p,old)))
+		{
+			g_string_append_len(out,p,found-p);
+			g_string_append(out,new);
+			p=found+old_len;
+		}
+
+		g_string_append(out,p);
+	}
+
+	if(!check_expression_length(out->len,error))
+	{
+		g_string_free(out,TRUE);
+		return FALSE;
+	}
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_startswith(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[1],"startswith",error))
+	{
+		return FALSE;
+	}
+
+	expression_value_set_bool(result,g_str_has_prefix(args[0].text,args[1].text));
+	return TRUE;
+}
+
+static gboolean expression_endswith(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[1],"endswith",error))
+	{
+		return FALSE;
+	}
+
+	expression_value_set_bool(result,g_str_has_suffix(args[0].text,args[1].text));
+	return TRUE;
+}
+
+static void append_expression_fill(GString *out, gunichar fill, long long count)
+{
+	for(long long i=0;i<count;i++)
+	{
+		g_string_append_unichar(out,fill);
+	}
+}
+
+//left_share of the padding goes before the text, the rest after it
+static gboolean pad_expression_string(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, const char *function, int alignment, char **error)
+{
+	gunichar fill;
+
+	if(!require_expression_number(&args[1],function,error) || !get_expression_fill(args,argc,2,function,&fill,error))
+	{
+		return FALSE;
+	}
+
+	const long long width=args[1].number;
+	const long long len=g_utf8_strlen(args[0].text,-1);
+
+	if(width<=len)
+	{
+		expression_value_set_string(result,g_strdup(args[0].text));
+		return TRUE;
+	}
+
+	if(!check_expression_length(width*6,error))
+	{
+		return FALSE;
+	}
+
+	const long long padding=width-len;
+	long long before;
+
+	if(alignment<0)
+	{
+		before=0;
+	}
+	else if(alignment>0)
+	{
+		before=padding;
+	}
+	else
+	{
+		//what python's center does with odd padding
+		before=padding/2+(padding&width&1);
+	}
+
+	GString *out=g_string_sized_new(strlen(args[0].text)+padding);
+	append_expression_fill(out,fill,before);
+	g_string_append(out,args[0].text);
+	append_expression_fill(out,fill,padding-before);
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_ljust(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return pad_expression_string(args,argc,result,"ljust",-1,error);
+}
+
+static gboolean expression_rjust(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return pad_expression_string(args,argc,result,"rjust",1,error);
+}
+
+static gboolean expression_center(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	return pad_expression_string(args,argc,result,"center",0,error);
+}
+
+static gboolean expression_zfill(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_number(&args[1],"zfill",error))
+	{
+		return FALSE;
+	}
+
+	const char *text=args[0].text;
+	const long long len=g_utf8_strlen(text,-1);
+	const long long padding=args[1].number-len;
+
+	if(padding<=0)
+	{
+		expression_value_set_string(result,g_strdup(text));
+		return TRUE;
+	}
+
+	if(!check_expression_length(padding,error))
+	{
+		return FALSE;
+	}
+
+	GString *out=g_string_sized_new(strlen(text)+padding);
+
+	//the zeros go after the sign
+	if(text[0]=='+' || text[0]=='-')
+	{
+		g_string_append_c(out,*text++);
+	}
+
+	append_expression_fill(out,'0',padding);
+	g_string_append(out,text);
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_count(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[1],"count",error))
+	{
+		return FALSE;
+	}
+
+	const char *sub=args[1].text;
+	long long count=0;
+
+	if(sub[0]=='\0')
+	{
+		count=g_utf8_strlen(args[0].text,-1)+1;
+	}
+	else
+	{
+		const size_t sub_len=strlen(sub);
+
+		for(const char *p=strstr(args[0].text,sub);p;p=strstr(p+sub_len,sub))
+		{
+			count++;
+		}
+	}
+
+	expression_value_set_int(result,count);
+	return TRUE;
+}
+
+static gboolean expression_find(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[1],"find",error))
+	{
+		return FALSE;
+	}
+
+	const char *found=strstr(args[0].text,args[1].text);
+
+	expression_value_set_int(result,found?g_utf8_pointer_to_offset(args[0].text,found):-1);
+	return TRUE;
+}
+
+static gboolean expression_split(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	GPtrArray *list=expression_list_new();
+	const char *p=args[0].text;
+
+	if(argc<2)
+	{
+		//runs of space, without empty parts
+		while(*p)
+		{
+			while(*p && g_unichar_isspace(g_utf8_get_char(p)))
+			{
+				p=g_utf8_next_char(p);
+			}
+
+			const char *start=p;
+
+			while(*p && !g_unichar_isspace(g_utf8_get_char(p)))
+			{
+				p=g_utf8_next_char(p);
+			}
+
+			if(p>start)
+			{
+				g_ptr_array_add(list,g_strndup(start,p-start));
+			}
+		}
+	}
+	else
+	{
+		if(!require_expression_string(&args[1],"split",error) || (args[1].text[0]=='\0' && !set_expression_error(error,"ValueError: empty separator")))
+		{
+			g_ptr_array_unref(list);
+			return FALSE;
+		}
+
+		const char *separator=args[1].text;
+		const size_t separator_len=strlen(separator);
+		const char *found;
+
+		while((found=strstr(p,separator)))
+		{
+			g_ptr_array_add(list,g_strndup(p,found-p));
+			p=found+separator_len;
+		}
+
+		g_ptr_array_add(list,g_strdup(p));
+	}
+
+	expression_value_set_list(result,list);
+	return TRUE;
+}
+
+static gboolean expression_join(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	GString *out=g_string_new(NULL);
+
+	if(args[1].type==SNIPPET_EXPRESSION_VALUE_LIST)
+	{
+		for(guint i=0;i<args[1].list->len;i++)
+		{
+			g_string_append(out,i==0?"":args[0].text);
+			g_string_append(out,g_ptr_array_index(args[1].list,i));
+		}
+	}
+	else if(args[1].type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		//a string joins its characters
+		for(const char *p=args[1].text;*p;p=g_utf8_next_char(p))
+		{
+			g_string_append(out,p==args[1].text?"":args[0].text);
+			g_string_append_len(out,p,g_utf8_next_char(p)-p);
+		}
+	}
+	else
+	{
+		g_string_free(out,TRUE);
+		return set_expression_error(error,"TypeError: can only join an iterable, not %s",get_expression_type_name(&args[1]));
+	}
+
+	if(!check_expression_length(out->len,error))
+	{
+		g_string_free(out,TRUE);
+		return FALSE;
+	}
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+//is_wanted for every character, and at least one
+static gboolean test_expression_chars(const char *text, gboolean (*is_wanted)(gunichar c))
+{
+	if(text[0]=='\0')
+	{
+		return FALSE;
+	}
+
+	for(const char *p=text;*p;p=g_utf8_next_char(p))
+	{
+		if(!is_wanted(g_utf8_get_char(p)))
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean expression_isdigit(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_bool(result,test_expression_chars(args[0].text,g_unichar_isdigit));
+	return TRUE;
+}
+
+static gboolean expression_isalpha(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_bool(result,test_expression_chars(args[0].text,g_unichar_isalpha));
+	return TRUE;
+}
+
+//cased characters all upper (or all lower), and at least one of them
+static gboolean test_expression_case(const char *text, gboolean upper)
+{
+	gboolean any_cased=FALSE;
+
+	for(const char *p=text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+
+		if(upper?g_unichar_islower(c) || g_unichar_istitle(c):g_unichar_isupper(c) || g_unichar_istitle(c))
+		{
+			return FALSE;
+		}
+
+		any_cased|=is_cased(c);
+	}
+
+	return any_cased;
+}
+
+static gboolean expression_isupper(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_bool(result,test_expression_case(args[0].text,TRUE));
+	return TRUE;
+}
+
+static gboolean expression_islower(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_bool(result,test_expression_case(args[0].text,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_len(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(args[0].type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		expression_value_set_int(result,g_utf8_strlen(args[0].text,-1));
+	}
+	else if(args[0].type==SNIPPET_EXPRESSION_VALUE_LIST)
+	{
+		expression_value_set_int(result,args[0].list->len);
+	}
+	else
+	{
+		return set_expression_error(error,"TypeError: object of type '%s' has no len()",get_expression_type_name(&args[0]));
+	}
+
+	return TRUE;
+}
+
+static gboolean expression_str(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	expression_value_set_string(result,expression_value_to_string(&args[0]));
+	return TRUE;
+}
+
+static gboolean expression_int(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(is_expression_number(&args[0]))
+	{
+		expression_value_set_int(result,args[0].number);
+		return TRUE;
+	}
+	else if(args[0].type!=SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		return set_expression_error(error,"TypeError: int() can not convert %s",get_expression_type_name(&args[0]));
+	}
+
+	g_autofree char *stripped=g_strstrip(g_strdup(args[0].text));
+	char *end=NULL;
+	errno=0;
+	const long long number=g_ascii_strtoll(stripped,&end,10);
+
+	if(stripped[0]=='\0' || *end!='\0' || errno!=0)
+	{
+		return set_expression_error(error,"ValueError: invalid literal for int() with base 10: '%s'",args[0].text);
+	}
+
+	expression_value_set_int(result,number);
+	return TRUE;
+}
+
+static gboolean expression_camelcase(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[0],"camelcase",error))
+	{
+		return FALSE;
+	}
+
+	GString *out=g_string_sized_new(strlen(args[0].text));
+	append_joined_words(out,args[0].text,FALSE);
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_pascalcase(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[0],"pascalcase",error))
+	{
+		return FALSE;
+	}
+
+	GString *out=g_string_sized_new(strlen(args[0].text));
+	append_joined_words(out,args[0].text,TRUE);
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+/**
+	Lower case words joined by separator. A word also ends where a lower case letter or digit
+	is followed by an upper case one, and before the last capital of a run like HTTPServer.
+*/
+static void append_separated_words(GString *out, const char *text, char separator)
+{
+	gunichar previous=0;
+	gboolean word_done=FALSE;
+
+	for(const char *p=text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+
+		if(!g_unichar_isalnum(c))
+		{
+			word_done=out->len>0;
+			previous=0;
+			continue;
+		}
+
+		const char *next_p=g_utf8_next_char(p);
+		const gunichar next=*next_p?g_utf8_get_char(next_p):0;
+
+		if(g_unichar_isupper(c) && previous && ((g_unichar_islower(previous) || g_unichar_isdigit(previous)) || (g_unichar_isupper(previous) && g_unichar_islower(next))))
+		{
+			word_done=TRUE;
+		}
+
+		if(word_done)
+		{
+			g_string_append_c(out,separator);
+			word_done=FALSE;
+		}
+
+		g_string_append_unichar(out,g_unichar_tolower(c));
+		previous=c;
+	}
+}
+
+static gboolean expression_snakecase(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[0],"snakecase",error))
+	{
+		return FALSE;
+	}
+
+	GString *out=g_string_sized_new(strlen(args[0].text)+4);
+	append_separated_words(out,args[0].text,'_');
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+static gboolean expression_kebabcase(SnippetExpressionValue *args, guint argc, SnippetExpressionValue *result, char **error)
+{
+	if(!require_expression_string(&args[0],"kebabcase",error))
+	{
+		return FALSE;
+	}
+
+	GString *out=g_string_sized_new(strlen(args[0].text)+4);
+	append_separated_words(out,args[0].text,'-');
+
+	expression_value_set_string(result,g_string_free(out,FALSE));
+	return TRUE;
+}
+
+//the methods are of str, their value is checked before the call
+static const ExpressionFunction GLOBAL_EXPRESSION_FUNCTIONS[]={
+	{"upper",TRUE,1,1,expression_upper},
+	{"lower",TRUE,1,1,expression_lower},
+	{"title",TRUE,1,1,expression_title},
+	{"capitalize",TRUE,1,1,expression_capitalize},
+	{"swapcase",TRUE,1,1,expression_swapcase},
+	{"strip",TRUE,1,2,expression_strip},
+	{"lstrip",TRUE,1,2,expression_lstrip},
+	{"rstrip",TRUE,1,2,expression_rstrip},
+	{"replace",TRUE,3,3,expression_replace},
+	{"startswith",TRUE,2,2,expression_startswith},
+	{"endswith",TRUE,2,2,expression_endswith},
+	{"ljust",TRUE,2,3,expression_ljust},
+	{"rjust",TRUE,2,3,expression_rjust},
+	{"center",TRUE,2,3,expression_center},
+	{"zfill",TRUE,2,2,expression_zfill},
+	{"count",TRUE,2,2,expression_count},
+	{"find",TRUE,2,2,expression_find},
+	{"split",TRUE,1,2,expression_split},
+	{"join",TRUE,2,2,expression_join},
+	{"isdigit",TRUE,1,1,expression_isdigit},
+	{"isalpha",TRUE,1,1,expression_isalpha},
+	{"isupper",TRUE,1,1,expression_isupper},
+	{"islower",TRUE,1,1,expression_islower},
+	{"len",FALSE,1,1,expression_len},
+	{"str",FALSE,1,1,expression_str},
+	{"int",FALSE,1,1,expression_int},
+	{"camelcase",FALSE,1,1,expression_camelcase},
+	{"pascalcase",FALSE,1,1,expression_pascalcase},
+	{"snakecase",FALSE,1,1,expression_snakecase},
+	{"kebabcase",FALSE,1,1,expression_kebabcase}
+};
+
+static int find_expression_function(const char *name, gboolean method)
+{
+	for(size_t i=0;i<G_N_ELEMENTS(GLOBAL_EXPRESSION_FUNCTIONS);i++)
+	{
+		if(GLOBAL_EXPRESSION_FUNCTIONS[i].method==method && strcmp(GLOBAL_EXPRESSION_FUNCTIONS[i].name,name)==0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/////////////////////////////////////////////////////////////////////// operators
+
+//-1, 0 or 1, or -2 when the two can not be ordered
+static int compare_expression_values(const SnippetExpressionValue *a, const SnippetExpressionValue *b)
+{
+	if(is_expression_number(a) && is_expression_number(b))
+	{
+		return (a->number>b->number)-(a->number<b->number);
+	}
+	else if(a->type==SNIPPET_EXPRESSION_VALUE_STRING && b->type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		//byte order of utf-8 is code point order, like python
+		const int order=strcmp(a->text,b->text);
+		return (order>0)-(order<0);
+	}
+	else if(a->type==SNIPPET_EXPRESSION_VALUE_LIST && b->type==SNIPPET_EXPRESSION_VALUE_LIST)
+	{
+		for(guint i=0;i<a->list->len && i<b->list->len;i++)
+		{
+			const int order=strcmp(g_ptr_array_index(a->list,i),g_ptr_array_index(b->list,i));
+
+			if(order!=0)
+			{
+				return (order>0)-(order<0);
+			}
+		}
+
+		return (a->list->len>b->list->len)-(a->list->len<b->list->len);
+	}
+
+	return -2;
+}
+
+static gboolean repeat_expression_value(const SnippetExpressionValue *value, long long times, SnippetExpressionValue *result, char **error)
+{
+	times=MAX(times,0);
+
+	if(value->type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		const size_t len=strlen(value->text);
+
+		if(len>0 && !check_expression_length(times>SNIPPET_EXPRESSION_STRING_MAX?times:(long long)len*times,error))
+		{
+			return FALSE;
+		}
+
+		GString *out=g_string_sized_new(len*times);
+
+		for(long long i=0;i<times && len>0;i++)
+		{
+			g_string_append_len(out,value->text,len);
+		}
+
+		expression_value_set_string(result,g_string_free(out,FALSE));
+	}
+	else
+	{
+		if(value->list->len>0 && !check_expression_length(times>SNIPPET_EXPRESSION_STRING_MAX?times:(long long)value->list->len*times,error))
+		{
+			return FALSE;
+		}
+
+		GPtrArray *list=expression_list_new();
+
+		for(long long i=0;i<times;i++)
+		{
+			for(guint j=0;j<value->list->len;j++)
+			{
+				g_ptr_array_add(list,g_strdup(g_ptr_array_index(value->list,j)));
+			}
+		}
+
+		expression_value_set_list(result,list);
+	}
+
+	return TRUE;
+}
+
+static gboolean contains_expression_value(const SnippetExpressionValue *item, const SnippetExpressionValue *container, gboolean *contains, char **error)
+{
+	if(container->type==SNIPPET_EXPRESSION_VALUE_STRING && item->type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		*contains=strstr(container->text,item->text)!=NULL;
+		return TRUE;
+	}
+	else if(container->type==SNIPPET_EXPRESSION_VALUE_LIST)
+	{
+		*contains=FALSE;
+
+		for(guint i=0;item->type==SNIPPET_EXPRESSION_VALUE_STRING && i<container->list->len;i++)
+		{
+			*contains|=strcmp(g_ptr_array_index(container->list,i),item->text)==0;
+		}
+
+		return TRUE;
+	}
+
+	return set_expression_error(error,"TypeError: 'in <%s>' requires a str as left operand, not %s",get_expression_type_name(container),get_expression_type_name(item));
+}
+
+//a=a op b
+static gboolean apply_expression_binary(SnippetExpressionBinary op, SnippetExpressionValue *a, const SnippetExpressionValue *b, char **error)
+{
+	static const char *const symbols[]={"+","-","*","//","%","==","!=","<","<=",">",">=","in","not in"};
+	const gboolean numbers=is_expression_number(a) && is_expression_number(b);
+
+	switch(op)
+	{
+		case SNIPPET_EXPRESSION_BINARY_ADD:
+			if(numbers)
+			{
+				expression_value_set_int(a,a->number+b->number);
+				return TRUE;
+			}
+			else if(a->type==SNIPPET_EXPRESSION_VALUE_STRING && b->type==SNIPPET_EXPRESSION_VALUE_STRING)
+			{
+				if(!check_expression_length(strlen(a->text)+strlen(b->text),error))
+				{
+					return FALSE;
+				}
+
+				expression_value_set_string(a,g_strconcat(a->text,b->text,NULL));
+				return TRUE;
+			}
+			else if(a->type==SNIPPET_EXPRESSION_VALUE_LIST && b->type==SNIPPET_EXPRESSION_VALUE_LIST)
+			{
+				for(guint i=0;i<b->list->len;i++)
+				{
+					g_ptr_array_add(a->list,g_strdup(g_ptr_array_index(b->list,i)));
+				}
+				return TRUE;
+			}
+			break;
+		case SNIPPET_EXPRESSION_BINARY_SUBTRACT:
+			if(numbers)
+			{
+				expression_value_set_int(a,a->number-b->number);
+				return TRUE;
+			}
+			break;
+		case SNIPPET_EXPRESSION_BINARY_MULTIPLY:
+			if(numbers)
+			{
+				expression_value_set_int(a,a->number*b->number);
+				return TRUE;
+			}
+			else if(is_expression_number(b) && (a->type==SNIPPET_EXPRESSION_VALUE_STRING || a->type==SNIPPET_EXPRESSION_VALUE_LIST))
+			{
+				SnippetExpressionValue repeated={0};
+
+				if(!repeat_expression_value(a,b->number,&repeated,error))
+				{
+					return FALSE;
+				}
+
+				expression_value_clear(a);
+				*a=repeated;
+				return TRUE;
+			}
+			else if(is_expression_number(a) && (b->type==SNIPPET_EXPRESSION_VALUE_STRING || b->type==SNIPPET_EXPRESSION_VALUE_LIST))
+			{
+				return repeat_expression_value(b,a->number,a,error);
+			}
+			break;
+		case SNIPPET_EXPRESSION_BINARY_FLOOR_DIVIDE:
+		case SNIPPET_EXPRESSION_BINARY_MODULO:
+			if(numbers)
+			{
+				if(b->number==0)
+				{
+					return set_expression_error(error,"ZeroDivisionError: integer division or modulo by zero");
+				}
+
+				//rounded towards minus infinity, like python
+				long long quotient=a->number/b->number;
+				long long remainder=a->number%b->number;
+
+				if(remainder!=0 && (remainder<0)!=(b->number<0))
+				{
+					quotient--;
+					remainder+=b->number;
+				}
+
+				expression_value_set_int(a,op==SNIPPET_EXPRESSION_BINARY_FLOOR_DIVIDE?quotient:remainder);
+				return TRUE;
+			}
+			break;
+		case SNIPPET_EXPRESSION_BINARY_EQUAL:
+		case SNIPPET_EXPRESSION_BINARY_NOT_EQUAL:
+		{
+			const gboolean equal=compare_expression_values(a,b)==0;
+			expression_value_set_bool(a,equal==(op==SNIPPET_EXPRESSION_BINARY_EQUAL));
+			return TRUE;
+		}
+		case SNIPPET_EXPRESSION_BINARY_LESS:
+		case SNIPPET_EXPRESSION_BINARY_LESS_EQUAL:
+		case SNIPPET_EXPRESSION_BINARY_GREATER:
+		case SNIPPET_EXPRESSION_BINARY_GREATER_EQUAL:
+		{
+			const int order=compare_expression_values(a,b);
+
+			if(order==-2)
+			{
+				break;
+			}
+
+			const gboolean truth=op==SNIPPET_EXPRESSION_BINARY_LESS?order<0:op==SNIPPET_EXPRESSION_BINARY_LESS_EQUAL?order<=0:op==SNIPPET_EXPRESSION_BINARY_GREATER?order>0:order>=0;
+			expression_value_set_bool(a,truth);
+			return TRUE;
+		}
+		case SNIPPET_EXPRESSION_BINARY_IN:
+		case SNIPPET_EXPRESSION_BINARY_NOT_IN:
+		{
+			gboolean contains;
+
+			if(!contains_expression_value(a,b,&contains,error))
+			{
+				return FALSE;
+			}
+
+			expression_value_set_bool(a,contains==(op==SNIPPET_EXPRESSION_BINARY_IN));
+			return TRUE;
+		}
+	}
+
+	return set_expression_error(error,"TypeError: unsupported operand types for %s: '%s' and '%s'",symbols[op],get_expression_type_name(a),get_expression_type_name(b));
+}
+
+//python's handling of negative and out of range indexes of a slice
+static long long clamp_expression_index(long long index, long long len)
+{
+	if(index<0)
+	{
+		index+=len;
+	}
+
+	return CLAMP(index,0,len);
+}
+
+static gboolean slice_expression_value(SnippetExpressionValue *value, gboolean has_start, long long start, gboolean has_end, long long end, char **error)
+{
+	const gboolean is_list=value->type==SNIPPET_EXPRESSION_VALUE_LIST;
+
+	if(!is_list && value->type!=SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		return set_expression_error(error,"TypeError: '%s' object is not subscriptable",get_expression_type_name(value));
+	}
+
+	const long long len=is_list?value->list->len:g_utf8_strlen(value->text,-1);
+	start=has_start?clamp_expression_index(start,len):0;
+	end=has_end?clamp_expression_index(end,len):len;
+	end=MAX(start,end);
+
+	if(is_list)
+	{
+		GPtrArray *list=expression_list_new();
+
+		for(long long i=start;i<end;i++)
+		{
+			g_ptr_array_add(list,g_strdup(g_ptr_array_index(value->list,i)));
+		}
+
+		expression_value_set_list(value,list);
+	}
+	else
+	{
+		const char *start_p=g_utf8_offset_to_pointer(value->text,start);
+		const char *end_p=g_utf8_offset_to_pointer(start_p,end-start);
+
+		expression_value_set_string(value,g_strndup(start_p,end_p-start_p));
+	}
+
+	return TRUE;
+}
+
+static gboolean index_expression_value(SnippetExpressionValue *value, const SnippetExpressionValue *index, char **error)
+{
+	const gboolean is_list=value->type==SNIPPET_EXPRESSION_VALUE_LIST;
+
+	if(!is_list && value->type!=SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		return set_expression_error(error,"TypeError: '%s' object is not subscriptable",get_expression_type_name(value));
+	}
+	else if(!is_expression_number(index))
+	{
+		return set_expression_error(error,"TypeError: indices must be integers, not %s",get_expression_type_name(index));
+	}
+
+	const long long len=is_list?value->list->len:g_utf8_strlen(value->text,-1);
+	const long long position=index->number<0?index->number+len:index->number;
+
+	if(position<0 || position>=len)
+	{
+		return set_expression_error(error,"IndexError: %s index out of range",is_list?"list":"string");
+	}
+
+	if(is_list)
+	{
+		expression_value_set_string(value,g_strdup(g_ptr_array_index(value->list,position)));
+		return TRUE;
+	}
+
+	return slice_expression_value(value,TRUE,position,TRUE,position+1,error);
+}
+
+/////////////////////////////////////////////////////////////////////// compiler
+
+static ExpressionToken next_expression_token(ExpressionCompiler *self)
+{
+	const char *p=self->p;
+
+	g_string_truncate(self->text,0);
+
+	for(;;)
+	{
+		if(*p==' ' || *p=='\t' || *p=='\r' || (*p=='\n' && self->brackets>0))
+		{
+			p++;
+		}
+		else if(*p=='\n' || *p=='\0')
+		{
+			//one statement, the rest can only be space
+			while(g_ascii_isspace(*p))
+			{
+				p++;
+			}
+
+			self->p=p;
+			return self->token=*p=='\0'?EXPRESSION_TOKEN_END:EXPRESSION_TOKEN_ERROR;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if(g_ascii_isdigit(*p))
+	{
+		char *end=NULL;
+		errno=0;
+		self->number=g_ascii_strtoll(p,&end,10);
+		self->p=end;
+
+		return self->token=errno==0 && !g_ascii_isalpha(*end) && *end!='.' && *end!='_'?EXPRESSION_TOKEN_INT:EXPRESSION_TOKEN_ERROR;
+	}
+	else if(*p=='$' && g_ascii_isdigit(p[1]))
+	{
+		char *end=NULL;
+		self->number=g_ascii_strtoll(p+1,&end,10);
+		self->p=end;
+
+		return self->token=EXPRESSION_TOKEN_STOP;
+	}
+	else if(g_ascii_isalpha(*p) || *p=='_')
+	{
+		while(g_ascii_isalnum(*p) || *p=='_')
+		{
+			g_string_append_c(self->text,*p++);
+		}
+
+		self->p=p;
+
+		//prefixed strings like f'' and r'' are python's
+		return self->token=*p=='\'' || *p=='"'?EXPRESSION_TOKEN_ERROR:EXPRESSION_TOKEN_NAME;
+	}
+	else if(*p=='\'' || *p=='"')
+	{
+		const char quote=*p++;
+
+		//''' and """ are python's
+		if(p[0]==quote && p[1]==quote)
+		{
+			return self->token=EXPRESSION_TOKEN_ERROR;
+		}
+
+		while(*p && *p!=quote && *p!='\n')
+		{
+			if(*p=='\\' && p[1]!='\0')
+			{
+				switch(p[1])
+				{
+					case 'n':
+						g_string_append_c(self->text,'\n');
+						break;
+					case 't':
+						g_string_append_c(self->text,'\t');
+						break;
+					case 'r':
+						g_string_append_c(self->text,'\r');
+						break;
+					case '\\':
+					case '\'':
+					case '"':
+						g_string_append_c(self->text,p[1]);
+						break;
+					case 'x':
+					case 'u':
+					case 'U':
+					case 'N':
+					case '0':
+					case '\n':
+						//rare enough for python
+						return self->token=EXPRESSION_TOKEN_ERROR;
+					default:
+						g_string_append_c(self->text,'\\');
+						g_string_append_c(self->text,p[1]);
+						break;
+				}
+				p+=2;
+			}
+			else
+			{
+				g_string_append_c(self->text,*p++);
+			}
+		}
+
+		if(*p!=quote || !g_utf8_validate(self->text->str,self->text->len,NULL))
+		{
+			return self->token=EXPRESSION_TOKEN_ERROR;
+		}
+
+		self->p=p+1;
+		return self->token=EXPRESSION_TOKEN_STRING;
+	}
+
+	static const char *const operators[]={"==","!=","<=",">=","//","+","-","*","%","<",">","(",")","[","]",".",",",":"};
+
+	for(size_t i=0;i<G_N_ELEMENTS(operators);i++)
+	{
+		const size_t len=strlen(operators[i]);
+
+		if(strncmp(p,operators[i],len)==0)
+		{
+			g_string_append(self->text,operators[i]);
+			self->p=p+len;
+
+			if(*p=='(' || *p=='[')
+			{
+				self->brackets++;
+			}
+			else if(*p==')' || *p==']')
+			{
+				self->brackets--;
+			}
+
+			return self->token=EXPRESSION_TOKEN_OP;
+		}
+	}
+
+	return self->token=EXPRESSION_TOKEN_ERROR;
+}
+
+static gboolean is_expression_op(ExpressionCompiler *self, const char *op)
+{
+	return self->token==EXPRESSION_TOKEN_OP && strcmp(self->text->str,op)==0;
+}
+
+static gboolean is_expression_keyword(ExpressionCompiler *self, const char *keyword)
+{
+	return self->token==EXPRESSION_TOKEN_NAME && strcmp(self->text->str,keyword)==0;
+}
+
+//consumes op, FALSE when the current token is something else
+static gboolean expect_expression_op(ExpressionCompiler *self, const char *op)
+{
+	if(!is_expression_op(self,op))
+	{
+		return FALSE;
+	}
+
+	next_expression_token(self);
+	return TRUE;
+}
+
+static gboolean emit_expression_code(ExpressionCompiler *self, SnippetExpressionOp op, guint8 argc, gint32 arg, int stack_effect)
+{
+	const SnippetExpressionInstruction instruction={.op=op,.argc=argc,.arg=arg};
+	g_array_append_val(self->expression->code,instruction);
+
+	self->depth+=stack_effect;
+
+	//deeper than that is no longer a common block
+	return self->depth<=SNIPPET_EXPRESSION_STACK_MAX;
+}
+
+static gboolean emit_expression_constant(ExpressionCompiler *self, SnippetExpressionValue *constant)
+{
+	g_array_append_val(self->expression->constants,*constant);
+
+	return emit_expression_code(self,SNIPPET_EXPRESSION_OP_CONST,0,self->expression->constants->len-1,1);
+}
+
+//returns the position of the jump, for patch_expression_jump
+static guint emit_expression_jump(ExpressionCompiler *self, SnippetExpressionOp op, int stack_effect)
+{
+	emit_expression_code(self,op,0,0,stack_effect);
+
+	return self->expression->code->len-1;
+}
+
+//makes the jump at position go to the end of the code so far
+static void patch_expression_jump(ExpressionCompiler *self, guint position)
+{
+	g_array_index(self->expression->code,SnippetExpressionInstruction,position).arg=self->expression->code->len-(position+1);
+}
+
+static gboolean compile_expression(ExpressionCompiler *self);
+
+//the arguments of a call, up to and with the ')'
+static gboolean compile_expression_arguments(ExpressionCompiler *self, guint *argc)
+{
+	*argc=0;
+
+	if(expect_expression_op(self,")"))
+	{
+		return TRUE;
+	}
+
+	for(;;)
+	{
+		if(!compile_expression(self))
+		{
+			return FALSE;
+		}
+
+		(*argc)++;
+
+		if(expect_expression_op(self,")"))
+		{
+			return TRUE;
+		}
+		else if(!expect_expression_op(self,","))
+		{
+			return FALSE;
+		}
+	}
+}
+
+static gboolean emit_expression_call(ExpressionCompiler *self, const char *name, gboolean method, guint argc)
+{
+	const int function=find_expression_function(name,method);
+
+	if(function<0 || argc<GLOBAL_EXPRESSION_FUNCTIONS[function].min_args || argc>GLOBAL_EXPRESSION_FUNCTIONS[function].max_args)
+	{
+		return FALSE;
+	}
+
+	return emit_expression_code(self,SNIPPET_EXPRESSION_OP_CALL,argc,function,1-(int)argc);
+}
+
+static gboolean compile_expression_primary(ExpressionCompiler *self)
+{
+	SnippetExpressionValue constant={0};
+
+	switch(self->token)
+	{
+		case EXPRESSION_TOKEN_INT:
+			constant.type=SNIPPET_EXPRESSION_VALUE_INT;
+			constant.number=self->number;
+			next_expression_token(self);
+			return emit_expression_constant(self,&constant);
+		case EXPRESSION_TOKEN_STRING:
+			constant.text=g_strndup(self->text->str,self->text->len);
+			next_expression_token(self);
+
+			//'a' 'b' is 'ab'
+			while(self->token==EXPRESSION_TOKEN_STRING)
+			{
+				char *joined=g_strconcat(constant.text,self->text->str,NULL);
+				g_free(constant.text);
+				constant.text=joined;
+				next_expression_token(self);
+			}
+
+			return emit_expression_constant(self,&constant);
+		case EXPRESSION_TOKEN_STOP:
+		{
+			const long long id=self->number;
+			next_expression_token(self);
+			return id<=G_MAXINT32 && emit_expression_code(self,SNIPPET_EXPRESSION_OP_STOP,0,id,1);
+		}
+		case EXPRESSION_TOKEN_NAME:
+		{
+			if(is_expression_keyword(self,"True") || is_expression_keyword(self,"False"))
+			{
+				constant.type=SNIPPET_EXPRESSION_VALUE_BOOL;
+				constant.number=is_expression_keyword(self,"True");
+				next_expression_token(self);
+				return emit_expression_constant(self,&constant);
+			}
+
+			g_autofree char *name=g_strdup(self->text->str);
+			guint argc;
+
+			//any other name is python's
+			next_expression_token(self);
+			return expect_expression_op(self,"(") && compile_expression_arguments(self,&argc) && emit_expression_call(self,name,FALSE,argc);
+		}
+		case EXPRESSION_TOKEN_OP:
+			if(expect_expression_op(self,"("))
+			{
+				return compile_expression(self) && expect_expression_op(self,")");
+			}
+			return FALSE;
+		default:
+			return FALSE;
+	}
+}
+
+static gboolean compile_expression_postfix(ExpressionCompiler *self)
+{
+	if(!compile_expression_primary(self))
+	{
+		return FALSE;
+	}
+
+	for(;;)
+	{
+		if(expect_expression_op(self,"."))
+		{
+			if(self->token!=EXPRESSION_TOKEN_NAME)
+			{
+				return FALSE;
+			}
+
+			g_autofree char *name=g_strdup(self->text->str);
+			guint argc;
+			next_expression_token(self);
+
+			if(!expect_expression_op(self,"(") || !compile_expression_arguments(self,&argc) || !emit_expression_call(self,name,TRUE,argc+1))
+			{
+				return FALSE;
+			}
+		}
+		else if(expect_expression_op(self,"["))
+		{
+			int bounds=0;
+
+			if(!is_expression_op(self,":"))
+			{
+				if(!compile_expression(self))
+				{
+					return FALSE;
+				}
+
+				if(expect_expression_op(self,"]"))
+				{
+					if(!emit_expression_code(self,SNIPPET_EXPRESSION_OP_SUBSCRIPT,0,0,-1))
+					{
+						return FALSE;
+					}
+					continue;
+				}
+
+				bounds|=1;
+			}
+
+			if(!expect_expression_op(self,":"))
+			{
+				return FALSE;
+			}
+
+			if(!is_expression_op(self,"]"))
+			{
+				if(!compile_expression(self))
+				{
+					return FALSE;
+				}
+
+				bounds|=2;
+			}
+
+			if(!expect_expression_op(self,"]") || !emit_expression_code(self,SNIPPET_EXPRESSION_OP_SLICE,0,bounds,-((bounds&1)+(bounds>>1))))
+			{
+				return FALSE;
+			}
+		}
+		else
+		{
+			return TRUE;
+		}
+	}
+}
+
+static gboolean compile_expression_unary(ExpressionCompiler *self)
+{
+	if(expect_expression_op(self,"-"))
+	{
+		return compile_expression_unary(self) && emit_expression_code(self,SNIPPET_EXPRESSION_OP_NEGATE,0,0,0);
+	}
+	else if(expect_expression_op(self,"+"))
+	{
+		return compile_expression_unary(self);
+	}
+
+	return compile_expression_postfix(self);
+}
+
+static gboolean compile_expression_term(ExpressionCompiler *self)
+{
+	if(!compile_expression_unary(self))
+	{
+		return FALSE;
+	}
+
+	for(;;)
+	{
+		SnippetExpressionBinary op;
+
+		if(is_expression_op(self,"*"))
+		{
+			op=SNIPPET_EXPRESSION_BINARY_MULTIPLY;
+		}
+		else if(is_expression_op(self,"//"))
+		{
+			op=SNIPPET_EXPRESSION_BINARY_FLOOR_DIVIDE;
+		}
+		else if(is_expression_op(self,"%"))
+		{
+			op=SNIPPET_EXPRESSION_BINARY_MODULO;
+		}
+		else
+		{
+			return TRUE;
+		}
+
+		next_expression_token(self);
+
+		if(!compile_expression_unary(self) || !emit_expression_code(self,SNIPPET_EXPRESSION_OP_BINARY,0,op,-1))
+		{
+			return FALSE;
+		}
+	}
+}
+
+static gboolean compile_expression_sum(ExpressionCompiler *self)
+{
+	if(!compile_expression_term(self))
+	{
+		return FALSE;
+	}
+
+	for(;;)
+	{
+		SnippetExpressionBinary op;
+
+		if(is_expression_op(self,"+"))
+		{
+			op=SNIPPET_EXPRESSION_BINARY_ADD;
+		}
+		else if(is_expression_op(self,"-"))
+		{
+			op=SNIPPET_EXPRESSION_BINARY_SUBTRACT;
+		}
+		else
+		{
+			return TRUE;
+		}
+
+		next_expression_token(self);
+
+		if(!compile_expression_term(self) || !emit_expression_code(self,SNIPPET_EXPRESSION_OP_BINARY,0,op,-1))
+		{
+			return FALSE;
+		}
+	}
+}
+
+//one comparison, python's chains like a<b<c are left to python
+static gboolean compile_expression_comparison(ExpressionCompiler *self)
+{
+	static const char *const operators[]={"==","!=","<","<=",">",">="};
+	static const SnippetExpressionBinary binaries[]={
+		SNIPPET_EXPRESSION_BINARY_EQUAL,
+		SNIPPET_EXPRESSION_BINARY_NOT_EQUAL,
+		SNIPPET_EXPRESSION_BINARY_LESS,
+		SNIPPET_EXPRESSION_BINARY_LESS_EQUAL,
+		SNIPPET_EXPRESSION_BINARY_GREATER,
+		SNIPPET_EXPRESSION_BINARY_GREATER_EQUAL
+	};
+
+	if(!compile_expression_sum(self))
+	{
+		return FALSE;
+	}
+
+	int op=-1;
+
+	for(size_t i=0;i<G_N_ELEMENTS(operators);i++)
+	{
+		if(is_expression_op(self,operators[i]))
+		{
+			op=binaries[i];
+		}
+	}
+
+	if(is_expression_keyword(self,"in"))
+	{
+		op=SNIPPET_EXPRESSION_BINARY_IN;
+	}
+	else if(is_expression_keyword(self,"not"))
+	{
+		next_expression_token(self);
+
+		if(!is_expression_keyword(self,"in"))
+		{
+			return FALSE;
+		}
+
+		op=SNIPPET_EXPRESSION_BINARY_NOT_IN;
+	}
+
+	if(op<0)
+	{
+		return TRUE;
+	}
+
+	next_expression_token(self);
+
+	if(!compile_expression_sum(self) || !emit_expression_code(self,SNIPPET_EXPRESSION_OP_BINARY,0,op,-1))
+	{
+		return FALSE;
+	}
+
+	//a chain
+	for(size_t i=0;i<G_N_ELEMENTS(operators);i++)
+	{
+		if(is_expression_op(self,operators[i]))
+		{
+			return FALSE;
+		}
+	}
+
+	return !is_expression_keyword(self,"in") && !is_expression_keyword(self,"not");
+}
+
+static gboolean compile_expression_not(ExpressionCompiler *self)
+{
+	if(is_expression_keyword(self,"not"))
+	{
+		next_expression_token(self);
+		return compile_expression_not(self) && emit_expression_code(self,SNIPPET_EXPRESSION_OP_NOT,0,0,0);
+	}
+
+	return compile_expression_comparison(self);
+}
+
+static gboolean compile_expression_and(ExpressionCompiler *self)
+{
+	if(!compile_expression_not(self))
+	{
+		return FALSE;
+	}
+
+	while(is_expression_keyword(self,"and"))
+	{
+		next_expression_token(self);
+
+		//the value stays when it is false
+		const guint jump=emit_expression_jump(self,SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE_OR_POP,-1);
+
+		if(!compile_expression_not(self))
+		{
+			return FALSE;
+		}
+
+		patch_expression_jump(self,jump);
+	}
+
+	return TRUE;
+}
+
+static gboolean compile_expression_or(ExpressionCompiler *self)
+{
+	if(!compile_expression_and(self))
+	{
+		return FALSE;
+	}
+
+	while(is_expression_keyword(self,"or"))
+	{
+		next_expression_token(self);
+
+		const guint jump=emit_expression_jump(self,SNIPPET_EXPRESSION_OP_JUMP_IF_TRUE_OR_POP,-1);
+
+		if(!compile_expression_and(self))
+		{
+			return FALSE;
+		}
+
+		patch_expression_jump(self,jump);
+	}
+
+	return TRUE;
+}
+
+/**
+	value if condition else other. The condition runs first, so the code of value, compiled
+	before the if was seen, is moved behind it. The jumps are relative, so it stays valid.
+*/
+static gboolean compile_expression(ExpressionCompiler *self)
+{
+	const guint value_start=self->expression->code->len;
+	const int depth=self->depth;
+
+	if(!compile_expression_or(self))
+	{
+		return FALSE;
+	}
+
+	if(!is_expression_keyword(self,"if"))
+	{
+		return TRUE;
+	}
+
+	next_expression_token(self);
+
+	const guint value_len=self->expression->code->len-value_start;
+	g_autoptr(GArray) value_code=g_array_sized_new(FALSE,FALSE,sizeof(SnippetExpressionInstruction),value_len);
+	g_array_append_vals(value_code,&g_array_index(self->expression->code,SnippetExpressionInstruction,value_start),value_len);
+	g_array_set_size(self->expression->code,value_start);
+	self->depth=depth;
+
+	if(!compile_expression_or(self))
+	{
+		return FALSE;
+	}
+
+	const guint to_other=emit_expression_jump(self,SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE,-1);
+
+	g_array_append_vals(self->expression->code,value_code->data,value_len);
+
+	const guint to_end=emit_expression_jump(self,SNIPPET_EXPRESSION_OP_JUMP,0);
+	patch_expression_jump(self,to_other);
+	self->depth=depth;
+
+	if(!is_expression_keyword(self,"else"))
+	{
+		return FALSE;
+	}
+
+	next_expression_token(self);
+
+	if(!compile_expression(self))
+	{
+		return FALSE;
+	}
+
+	patch_expression_jump(self,to_end);
+
+	return TRUE;
+}
+
+static void snippet_expression_constant_clear(SnippetExpressionValue *self)
+{
+	expression_value_clear(self);
+}
+
+/**
+	Compiles code, the part of $<[N]: code> after the ':', when it is one return of an
+	expression the native evaluator understands. NULL means it is for python.
+*/
+SnippetExpression *snippet_expression_compile(const char *code)
+{
+	SnippetExpression *expression=g_new0(SnippetExpression,1);
+	expression->code=g_array_new(FALSE,FALSE,sizeof(SnippetExpressionInstruction));
+	expression->constants=g_array_new(FALSE,TRUE,sizeof(SnippetExpressionValue));
+	g_array_set_clear_func(expression->constants,(GDestroyNotify)snippet_expression_constant_clear);
+
+	g_autoptr(GString) text=g_string_new(NULL);
+	ExpressionCompiler compiler={.p=code,.text=text,.expression=expression};
+
+	next_expression_token(&compiler);
+
+	if(is_expression_keyword(&compiler,"return"))
+	{
+		next_expression_token(&compiler);
+
+		if(compile_expression(&compiler) && compiler.token==EXPRESSION_TOKEN_END && compiler.depth==1)
+		{
+			return expression;
+		}
+	}
+
+	snippet_expression_free(expression);
+
+	return NULL;
+}
+
+void snippet_expression_free(SnippetExpression *self)
+{
+	if(!self)
+	{
+		return;
+	}
+
+	g_array_free(self->code,TRUE);
+	g_array_free(self->constants,TRUE);
+	g_free(self);
+}
+
+/**
+	Calls func with the id of every $N the expression reads.
+*/
+int snippet_expression_foreach_stop(SnippetExpression *self, void (*func)(long long id, gpointer user_data), gpointer user_data)
+{
+	for(guint i=0;i<self->code->len;i++)
+	{
+		const SnippetExpressionInstruction *instruction=&g_array_index(self->code,SnippetExpressionInstruction,i);
+
+		if(instruction->op==SNIPPET_EXPRESSION_OP_STOP)
+		{
+			func(instruction->arg,user_data);
+		}
+	}
+
+	return 0;
+}
+
+/**
+	Calls func with the name of every function the expression calls, like len or camelcase,
+	but not the methods. In python the includes and helpers could define these names.
+*/
+int snippet_expression_foreach_function(SnippetExpression *self, void (*func)(const char *name, gpointer user_data), gpointer user_data)
+{
+	for(guint i=0;i<self->code->len;i++)
+	{
+		const SnippetExpressionInstruction *instruction=&g_array_index(self->code,SnippetExpressionInstruction,i);
+
+		if(instruction->op==SNIPPET_EXPRESSION_OP_CALL && !GLOBAL_EXPRESSION_FUNCTIONS[instruction->arg].method)
+		{
+			func(GLOBAL_EXPRESSION_FUNCTIONS[instruction->arg].name,user_data);
+		}
+	}
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////// vm
+
+static gboolean call_expression_function(const SnippetExpressionInstruction *instruction, SnippetExpressionValue *args, SnippetExpressionValue *result, char **error)
+{
+	const ExpressionFunction *function=&GLOBAL_EXPRESSION_FUNCTIONS[instruction->arg];
+
+	if(function->method && !require_expression_string(&args[0],function->name,error))
+	{
+		return FALSE;
+	}
+
+	return function->func(args,instruction->argc,result,error);
+}
+
+/**
+	Runs the expression with the texts of the tab stops from get_value. Returns what it gives,
+	which has to be a str like for python, or NULL with the reason in error. Free with g_free.
+*/
+char *snippet_expression_eval(SnippetExpression *self, SnippetValueFunc get_value, gpointer user_data, char **error)
+{
+	SnippetExpressionValue stack[SNIPPET_EXPRESSION_STACK_MAX+1]={0};
+	const SnippetExpressionInstruction *code=(const SnippetExpressionInstruction *)self->code->data;
+	guint sp=0;
+	gboolean ok=TRUE;
+
+	*error=NULL;
+
+	for(guint pc=0;ok && pc<self->code->len;)
+	{
+		const SnippetExpressionInstruction *instruction=&code[pc++];
+
+		switch(instruction->op)
+		{
+			case SNIPPET_EXPRESSION_OP_CONST:
+				expression_value_copy(&stack[sp++],&g_array_index(self->constants,SnippetExpressionValue,instruction->arg));
+				break;
+			case SNIPPET_EXPRESSION_OP_STOP:
+			{
+				const char *value=get_value(instruction->arg,user_data);
+				expression_value_set_string(&stack[sp++],g_strdup(value?value:""));
+				break;
+			}
+			case SNIPPET_EXPRESSION_OP_CALL:
+			{
+				SnippetExpressionValue result={0};
+				SnippetExpressionValue *args=&stack[sp-instruction->argc];
+
+				ok=call_expression_function(instruction,args,&result,error);
+
+				for(guint i=0;i<instruction->argc;i++)
+				{
+					expression_value_clear(&args[i]);
+				}
+
+				sp-=instruction->argc;
+				stack[sp++]=result;
+				break;
+			}
+			case SNIPPET_EXPRESSION_OP_BINARY:
+				sp--;
+				ok=apply_expression_binary(instruction->arg,&stack[sp-1],&stack[sp],error);
+				expression_value_clear(&stack[sp]);
+				break;
+			case SNIPPET_EXPRESSION_OP_NOT:
+				expression_value_set_bool(&stack[sp-1],!is_expression_true(&stack[sp-1]));
+				break;
+			case SNIPPET_EXPRESSION_OP_NEGATE:
+				ok=require_expression_number(&stack[sp-1],"-",error);
+
+				if(ok)
+				{
+					expression_value_set_int(&stack[sp-1],-stack[sp-1].number);
+				}
+				break;
+			case SNIPPET_EXPRESSION_OP_SUBSCRIPT:
+				sp--;
+				ok=index_expression_value(&stack[sp-1],&stack[sp],error);
+				expression_value_clear(&stack[sp]);
+				break;
+			case SNIPPET_EXPRESSION_OP_SLICE:
+			{
+				const gboolean has_start=instruction->arg&1;
+				const gboolean has_end=(instruction->arg&2)!=0;
+				SnippetExpressionValue *end=has_end?&stack[--sp]:NULL;
+				SnippetExpressionValue *start=has_start?&stack[--sp]:NULL;
+
+				if((start && !require_expression_number(start,"slice",error)) || (end && !require_expression_number(end,"slice",error)))
+				{
+					ok=FALSE;
+				}
+				else
+				{
+					ok=slice_expression_value(&stack[sp-1],has_start,start?start->number:0,has_end,end?end->number:0,error);
+				}
+
+				if(start)
+				{
+					expression_value_clear(start);
+				}
+
+				if(end)
+				{
+					expression_value_clear(end);
+				}
+				break;
+			}
+			case SNIPPET_EXPRESSION_OP_JUMP:
+				pc+=instruction->arg;
+				break;
+			case SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE:
+				if(!is_expression_true(&stack[--sp]))
+				{
+					pc+=instruction->arg;
+				}
+				expression_value_clear(&stack[sp]);
+				break;
+			case SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE_OR_POP:
+			case SNIPPET_EXPRESSION_OP_JUMP_IF_TRUE_OR_POP:
+				if(is_expression_true(&stack[sp-1])==(instruction->op==SNIPPET_EXPRESSION_OP_JUMP_IF_TRUE_OR_POP))
+				{
+					pc+=instruction->arg;
+				}
+				else
+				{
+					expression_value_clear(&stack[--sp]);
+				}
+				break;
+		}
+	}
+
+	char *result=NULL;
+
+	if(ok && stack[0].type==SNIPPET_EXPRESSION_VALUE_STRING)
+	{
+		result=g_steal_pointer(&stack[0].text);
+	}
+	else if(ok)
+	{
+		set_expression_error(error,"TypeError: the block returned %s, not str",get_expression_type_name(&stack[0]));
+	}
+
+	for(guint i=0;i<=SNIPPET_EXPRESSION_STACK_MAX;i++)
+	{
+		expression_value_clear(&stack[i]);
+	}
+
+	return result;
+}
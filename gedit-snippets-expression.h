@@ -0,0 +1,84 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+#include "gedit-snippets-template.h"
+
+G_BEGIN_DECLS
+
+#define SNIPPET_EXPRESSION_STACK_MAX 32
+
+typedef enum SnippetExpressionOp
+{
+	SNIPPET_EXPRESSION_OP_CONST=0, ///< pushes the constant arg
+	SNIPPET_EXPRESSION_OP_STOP, ///< pushes the text of tab stop arg
+	SNIPPET_EXPRESSION_OP_CALL, ///< pops argc values, a method gets its object first, and pushes function arg of them
+	SNIPPET_EXPRESSION_OP_BINARY, ///< pops two values and pushes SnippetExpressionBinary arg of them
+	SNIPPET_EXPRESSION_OP_NOT,
+	SNIPPET_EXPRESSION_OP_NEGATE,
+	SNIPPET_EXPRESSION_OP_SUBSCRIPT, ///< value[index]
+	SNIPPET_EXPRESSION_OP_SLICE, ///< value[start:end], bit 0 of arg when there is a start, bit 1 when there is an end
+	SNIPPET_EXPRESSION_OP_JUMP, ///< the jumps are relative to the next instruction
+	SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE, ///< pops the condition
+	SNIPPET_EXPRESSION_OP_JUMP_IF_FALSE_OR_POP, ///< and, keeps the value when it jumps
+	SNIPPET_EXPRESSION_OP_JUMP_IF_TRUE_OR_POP ///< or, keeps the value when it jumps
+}SnippetExpressionOp;
+
+typedef enum SnippetExpressionValueType
+{
+	SNIPPET_EXPRESSION_VALUE_STRING=0,
+	SNIPPET_EXPRESSION_VALUE_INT,
+	SNIPPET_EXPRESSION_VALUE_BOOL,
+	SNIPPET_EXPRESSION_VALUE_LIST
+}SnippetExpressionValueType;
+
+typedef struct SnippetExpressionValue
+{
+	SnippetExpressionValueType type;
+	long long number; ///< INT and BOOL
+	char *text; ///< STRING
+	GPtrArray *list; ///< LIST of strings
+}SnippetExpressionValue;
+
+typedef struct SnippetExpressionInstruction
+{
+	guint8 op; ///< SnippetExpressionOp
+	guint8 argc; ///< CALL only
+	gint32 arg;
+}SnippetExpressionInstruction;
+
+/**
+	A $<[N]: return ...> block compiled for the native evaluator, see snippet_expression_compile.
+*/
+typedef struct SnippetExpression
+{
+	GArray *code; ///< SnippetExpressionInstruction
+	GArray *constants; ///< SnippetExpressionValue, strings and numbers only
+}SnippetExpression;
+
+SnippetExpression *snippet_expression_compile(const char *code);
+void snippet_expression_free(SnippetExpression *self);
+char *snippet_expression_eval(SnippetExpression *self, SnippetValueFunc get_value, gpointer user_data, char **error);
+int snippet_expression_foreach_stop(SnippetExpression *self, void (*func)(long long id, gpointer user_data), gpointer user_data);
+int snippet_expression_foreach_function(SnippetExpression *self, void (*func)(const char *name, gpointer user_data), gpointer user_data);
+
+G_END_DECLS
@@ -0,0 +1,164 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <string.h>
+
+#include "gedit-snippets-filter.h"
+#include "gedit-snippets-configuration.h"
+
+static GHashTable *GLOBAL_SNIPPET_FILTERS = NULL; ///< lowercase language -> SnippetFilter
+
+#define SNIPPET_FILTER_SET(bits,n) ((bits)[(n)/64]|=G_GUINT64_CONSTANT(1)<<((n)%64))
+#define SNIPPET_FILTER_TEST(bits,n) (((bits)[(n)/64]>>((n)%64))&1)
+
+static inline guint get_char_bit(gunichar c)
+{
+	return (c^(c>>8))%SNIPPET_FILTER_CHAR_BITS;
+}
+
+static inline guint32 get_suffix_hash(gunichar before_last, gunichar last)
+{
+	//fnv-1a over the two code points
+	guint32 hash=2166136261u;
+	hash=(hash^before_last)*16777619u;
+	hash=(hash^last)*16777619u;
+
+	return hash;
+}
+
+static void add_filter_trigger(SnippetFilter *self, const char *from)
+{
+	const char *end=from+strlen(from);
+
+	if(end==from)
+	{
+		return;
+	}
+
+	const char *last_p=g_utf8_prev_char(end);
+	gunichar last=g_utf8_get_char(last_p);
+
+	SNIPPET_FILTER_SET(self->last_chars,get_char_bit(last));
+
+	if(last_p==from)
+	{
+		SNIPPET_FILTER_SET(self->single_chars,get_char_bit(last));
+		return;
+	}
+
+	gunichar before_last=g_utf8_get_char(g_utf8_prev_char(last_p));
+	guint32 hash=get_suffix_hash(before_last,last);
+
+	SNIPPET_FILTER_SET(self->suffixes,hash%SNIPPET_FILTER_BLOOM_BITS);
+	SNIPPET_FILTER_SET(self->suffixes,(hash>>16)%SNIPPET_FILTER_BLOOM_BITS);
+}
+
+static void build_snippet_filter(SnippetFilter *self, const char *language)
+{
+	memset(self,0,sizeof(*self));
+	self->generation=GLOBAL_SNIPPETS_GENERATION;
+
+	//the inherited and compiled snippets are in the index already
+	SnippetLanguageIndex *index=get_snippet_language_index(language);
+
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init(&iter,index->triggers);
+
+	while(g_hash_table_iter_next(&iter,&key,NULL))
+	{
+		add_filter_trigger(self,key);
+	}
+}
+
+//a snippet was added or renamed, the bits of triggers that went away stay until the next reload
+static void on_snippet_trigger_added(const char *language, const char *trigger, gpointer user_data)
+{
+	SnippetFilter *filter=g_hash_table_lookup(GLOBAL_SNIPPET_FILTERS,language);
+
+	if(filter && filter->generation==GLOBAL_SNIPPETS_GENERATION)
+	{
+		add_filter_trigger(filter,trigger);
+	}
+}
+
+int snippet_filter_init()
+{
+	GLOBAL_SNIPPET_FILTERS=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,g_free);
+	snippet_index_set_trigger_func(on_snippet_trigger_added,NULL);
+
+	return 0;
+}
+
+int snippet_filter_finalize()
+{
+	snippet_index_set_trigger_func(NULL,NULL);
+	g_clear_pointer(&GLOBAL_SNIPPET_FILTERS,g_hash_table_destroy);
+
+	return 0;
+}
+
+/**
+	FALSE when no snippet of language can end with before_last and last, pass 0 as
+	before_last at the start of a line. Filters are rebuilt lazily after the snippets changed.
+*/
+gboolean snippet_filter_may_match(const char *language, gunichar before_last, gunichar last)
+{
+	if(!language || !GLOBAL_SNIPPET_FILTERS || !GLOBAL_SNIPPETS)
+	{
+		return TRUE;
+	}
+
+	g_autofree char *key=g_ascii_strdown(language,-1);
+	SnippetFilter *filter=g_hash_table_lookup(GLOBAL_SNIPPET_FILTERS,key);
+
+	if(!filter)
+	{
+		filter=g_new(SnippetFilter,1);
+		build_snippet_filter(filter,key);
+		g_hash_table_insert(GLOBAL_SNIPPET_FILTERS,g_steal_pointer(&key),filter);
+	}
+	else if(filter->generation!=GLOBAL_SNIPPETS_GENERATION)
+	{
+		build_snippet_filter(filter,key);
+	}
+
+	const guint last_bit=get_char_bit(last);
+
+	if(!SNIPPET_FILTER_TEST(filter->last_chars,last_bit))
+	{
+		return FALSE;
+	}
+
+	if(SNIPPET_FILTER_TEST(filter->single_chars,last_bit))
+	{
+		return TRUE;
+	}
+	else if(before_last==0)
+	{
+		return FALSE;
+	}
+
+	guint32 hash=get_suffix_hash(before_last,last);
+
+	return SNIPPET_FILTER_TEST(filter->suffixes,hash%SNIPPET_FILTER_BLOOM_BITS)
+		&& SNIPPET_FILTER_TEST(filter->suffixes,(hash>>16)%SNIPPET_FILTER_BLOOM_BITS);
+}
@@ -0,0 +1,47 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define SNIPPET_FILTER_CHAR_BITS 256
+#define SNIPPET_FILTER_BLOOM_BITS 4096
+
+/**
+	Cheap test of the characters before the cursor that says when no trigger of a
+	language can end there, so a Tab used for indentation never walks the blocks.
+	False positives only cost the normal lookup, there are no false negatives.
+*/
+typedef struct SnippetFilter
+{
+	guint generation; ///< GLOBAL_SNIPPETS_GENERATION it was built from
+	guint64 last_chars[SNIPPET_FILTER_CHAR_BITS/64]; ///< last character of every trigger
+	guint64 single_chars[SNIPPET_FILTER_CHAR_BITS/64]; ///< triggers that are one character long
+	guint64 suffixes[SNIPPET_FILTER_BLOOM_BITS/64]; ///< bloom filter over the last two characters
+}SnippetFilter;
+
+int snippet_filter_init();
+int snippet_filter_finalize();
+
+gboolean snippet_filter_may_match(const char *language, gunichar before_last, gunichar last);
+
+G_END_DECLS
@@ -0,0 +1,823 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <gio/gio.h>
+#include <json-glib/json-glib.h>
+#include <libxml/xmlreader.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-import.h"
+#include "gedit-snippets-configuration.h"
+
+typedef struct SnippetImportContext
+{
+	const char *language; ///< forced language, NULL to take it from the file
+	GHashTable *touched_files; ///< XmlFileInformation that got new snippets
+	GHashTable *refused_languages; ///< whose user file exists but did not load, so it is left alone
+	int imported;
+	int skipped; ///< whose trigger the users file of the language already had
+}SnippetImportContext;
+
+//other editors language ids -> gtksourceview language ids
+static const char *const IMPORT_LANGUAGE_MAP[][2]={
+	{"c++","cpp"},
+	{"javascript","js"},
+	{"shellscript","sh"},
+	{"shell","sh"},
+	{"bash","sh"},
+	{"csharp","c-sharp"},
+	{"cs","c-sharp"},
+	{"objective-c","objc"},
+	{"python","python3"},
+	{"tex","latex"}
+};
+
+SnippetImportFormat get_snippet_import_format(const char *filepath)
+{
+	if(g_str_has_suffix(filepath,".code-snippets") || g_str_has_suffix(filepath,".json"))
+	{
+		return SNIPPET_IMPORT_FORMAT_VSCODE;
+	}
+	else if(g_str_has_suffix(filepath,".tmSnippet") || g_str_has_suffix(filepath,".sublime-snippet"))
+	{
+		return SNIPPET_IMPORT_FORMAT_TEXTMATE;
+	}
+	else if(g_str_has_suffix(filepath,".snippets"))
+	{
+		return SNIPPET_IMPORT_FORMAT_ULTISNIPS;
+	}
+
+	return SNIPPET_IMPORT_FORMAT_UNKNOWN;
+}
+
+static char *map_import_language(const char *language)
+{
+	g_autofree char *lower=g_ascii_strdown(language,-1);
+
+	//textmate scopes: source.c, source.c++, text.tex.latex
+	if(g_str_has_prefix(lower,"source.") || g_str_has_prefix(lower,"text."))
+	{
+		const char *id=strchr(lower,'.')+1;
+		const char *id_end=strchr(id,'.');
+
+		char *stripped=g_strndup(id,id_end?(size_t)(id_end-id):strlen(id));
+		g_free(lower);
+		lower=stripped;
+	}
+
+	for(size_t i=0;i<G_N_ELEMENTS(IMPORT_LANGUAGE_MAP);i++)
+	{
+		if(g_strcmp0(lower,IMPORT_LANGUAGE_MAP[i][0])==0)
+		{
+			return g_strdup(IMPORT_LANGUAGE_MAP[i][1]);
+		}
+	}
+
+	return g_steal_pointer(&lower);
+}
+
+//c.json, c_mine.snippets -> c
+static char *get_language_from_filename(const char *filepath)
+{
+	g_autofree char *basename=g_path_get_basename(filepath);
+
+	const size_t name_len=strcspn(basename,"._");
+
+	if(name_len==0)
+	{
+		return NULL;
+	}
+
+	basename[name_len]='\0';
+
+	return map_import_language(basename);
+}
+
+static const char *translate_segment(GString *out, const char *p, SnippetImportFormat format, int depth);
+
+//VS Code and TextMate variables that have a built-in variable of their own
+static const char *const GLOBAL_IMPORT_VARIABLES[][2]=
+{
+	{"TM_FILENAME","GEDIT_FILENAME"},
+	{"TM_FILENAME_BASE","GEDIT_BASENAME"},
+	{"TM_FILEPATH","GEDIT_CURRENT_DOCUMENT_PATH"},
+	{"TM_DIRECTORY","GEDIT_CURRENT_DOCUMENT_DIR"},
+	{"TM_SELECTED_TEXT","GEDIT_SELECTED_TEXT"},
+	{"CLIPBOARD","GEDIT_CLIPBOARD"},
+	{"TM_LINE_NUMBER","GEDIT_CURRENT_LINE_NUMBER"},
+	{"CURRENT_YEAR","GEDIT_CURRENT_YEAR"},
+};
+
+static const char *get_gedit_variable(const char *name, size_t name_len)
+{
+	for(size_t i=0;i<G_N_ELEMENTS(GLOBAL_IMPORT_VARIABLES);i++)
+	{
+		if(strlen(GLOBAL_IMPORT_VARIABLES[i][0])==name_len && strncmp(GLOBAL_IMPORT_VARIABLES[i][0],name,name_len)==0)
+		{
+			return GLOBAL_IMPORT_VARIABLES[i][1];
+		}
+	}
+
+	return NULL;
+}
+
+//skips ${N/regex/format/options}, p points at the first '/'. Returns a pointer to the closing '}'
+static const char *skip_transformation(const char *p)
+{
+	int braces=0;
+
+	while(*p)
+	{
+		if(*p=='\\' && p[1]!='\0')
+		{
+			p+=2;
+			continue;
+		}
+		else if(*p=='{')
+		{
+			braces++;
+		}
+		else if(*p=='}')
+		{
+			if(braces==0)
+			{
+				break;
+			}
+			braces--;
+		}
+		p++;
+	}
+
+	return p;
+}
+
+//p points right after "${"
+static const char *translate_braced_placeholder(GString *out, const char *p, SnippetImportFormat format, int depth)
+{
+	if(g_ascii_isdigit(*p))
+	{
+		char *end=NULL;
+		guint64 id_num=g_ascii_strtoull(p,&end,10);
+		p=end;
+
+		if(*p==':')
+		{
+			g_autoptr(GString) default_text=g_string_sized_new(16);
+			p=translate_segment(default_text,p+1,format,depth+1);
+
+			g_string_append_printf(out,"${%" G_GUINT64_FORMAT ":%s}",id_num,default_text->str);
+		}
+		else if(*p=='|')
+		{
+			//choice, the first option becomes the default
+			const char *option=p+1;
+			size_t option_len=strcspn(option,",|");
+
+			g_string_append_printf(out,"${%" G_GUINT64_FORMAT ":%.*s}",id_num,(int)option_len,option);
+
+			const char *choice_end=strstr(option,"|}");
+			p=choice_end?choice_end+1:option+strlen(option);
+		}
+		else
+		{
+			if(*p=='/')
+			{
+				//transformations are kept as is
+				const char *transformation=p;
+				p=skip_transformation(p);
+
+				g_string_append_printf(out,"${%" G_GUINT64_FORMAT "%.*s}",id_num,(int)(p-transformation),transformation);
+			}
+			else
+			{
+				g_string_append_printf(out,"$%" G_GUINT64_FORMAT,id_num);
+			}
+		}
+	}
+	else
+	{
+		//variables like ${TM_FILENAME:default}, the default is kept when there is no counterpart
+		const char *name=p;
+
+		while(g_ascii_isalnum(*p) || *p=='_')
+		{
+			p++;
+		}
+
+		const char *variable=get_gedit_variable(name,p-name);
+
+		if(variable)
+		{
+			g_string_append_printf(out,"${%s}",variable);
+
+			if(*p==':')
+			{
+				g_autoptr(GString) ignored=g_string_sized_new(16);
+				p=translate_segment(ignored,p+1,format,depth+1);
+			}
+		}
+		else if(*p==':')
+		{
+			p=translate_segment(out,p+1,format,depth+1);
+		}
+		else if(*p=='/')
+		{
+			p=skip_transformation(p);
+		}
+	}
+
+	while(*p && *p!='}')
+	{
+		p++;
+	}
+
+	if(*p=='}')
+	{
+		p++;
+	}
+
+	return p;
+}
+
+//whether a '$' right before p starts a placeholder, a variable or a block in the gedit syntax
+static gboolean starts_gedit_placeholder(const char *p)
+{
+	return g_ascii_isdigit(*p) || (*p!='\0' && strchr("{(<",*p)) || g_str_has_prefix(p,"GEDIT_");
+}
+
+/**
+	Translates one TextMate style body (shared by VS Code and UltiSnips) into $N and ${N:default}.
+	Placeholders, variables and transformations nested in a default are kept, only a '\}' in it is
+	dropped since ${N:...} has no escape for it. The gedit syntax has no escape for '$' either, so
+	an escaped '$' that would start a placeholder there, like \$1, is dropped with a warning.
+	When depth>0 it stops at the closing '}' of the placeholder.
+*/
+static const char *translate_segment(GString *out, const char *p, SnippetImportFormat format, int depth)
+{
+	while(*p)
+	{
+		if(*p=='\\' && p[1]!='\0' && strchr("$}\\`,|",p[1]))
+		{
+			if(p[1]=='$' && starts_gedit_placeholder(p+2))
+			{
+				fprintf(stderr,"%s:%d Dropping the escaped '$' of \\$%.8s, it would start a placeholder\n",__FILE__,__LINE__,p+2);
+			}
+			//a '}' would end the ${N:...} early
+			else if(depth==0 || p[1]!='}')
+			{
+				g_string_append_c(out,p[1]);
+			}
+			p+=2;
+		}
+		else if(*p=='}' && depth>0)
+		{
+			return p;
+		}
+		else if(*p=='`' && format==SNIPPET_IMPORT_FORMAT_ULTISNIPS)
+		{
+			//shell interpolation becomes $(command), python and vim interpolation has no counterpart
+			const char *end=strchr(p+1,'`');
+
+			if(end && p[1]!='!')
+			{
+				g_string_append(out,"$(");
+				g_string_append_len(out,p+1,end-p-1);
+				g_string_append(out,")");
+			}
+
+			p=end?end+1:p+strlen(p);
+		}
+		else if(*p=='$' && g_ascii_isdigit(p[1]))
+		{
+			char *end=NULL;
+			guint64 id_num=g_ascii_strtoull(p+1,&end,10);
+
+			g_string_append_printf(out,"$%" G_GUINT64_FORMAT,id_num);
+			p=end;
+		}
+		else if(*p=='$' && p[1]=='{')
+		{
+			p=translate_braced_placeholder(out,p+2,format,depth);
+		}
+		else if(*p=='$' && (g_ascii_isalpha(p[1]) || p[1]=='_'))
+		{
+			//variables like $TM_FILENAME
+			const char *name=++p;
+			while(g_ascii_isalnum(*p) || *p=='_')
+			{
+				p++;
+			}
+
+			const char *variable=get_gedit_variable(name,p-name);
+
+			if(variable)
+			{
+				g_string_append_printf(out,"${%s}",variable);
+			}
+		}
+		else
+		{
+			g_string_append_c(out,*p);
+			p++;
+		}
+	}
+
+	return p;
+}
+
+int translate_snippet_placeholders(GString *out, const char *body, SnippetImportFormat format)
+{
+	translate_segment(out,body,format,0);
+
+	return 0;
+}
+
+static int import_add_snippet(SnippetImportContext *ctx, const char *language, const char *tag, const char *body, const char *description, SnippetImportFormat format)
+{
+	if(!language || !tag || tag[0]=='\0' || !body)
+	{
+		return -1;
+	}
+
+	if(g_hash_table_contains(ctx->refused_languages,language))
+	{
+		return -1;
+	}
+
+	XmlFileInformation *fileinf=get_or_create_user_snippet_file(language);
+
+	if(!fileinf)
+	{
+		g_hash_table_add(ctx->refused_languages,g_strdup(language));
+		return -1;
+	}
+
+	//importing the same file again, or a trigger the user already made, leaves the users snippet
+	if(find_snippet_node(fileinf,tag))
+	{
+		fprintf(stderr,"%s:%d The %s snippets already have %s, skipping\n",__FILE__,__LINE__,language,tag);
+		ctx->skipped++;
+		return -1;
+	}
+
+	g_autoptr(GString) translated=g_string_sized_new(strlen(body)+16);
+	translate_snippet_placeholders(translated,body,format);
+
+	xmlNode *node=append_snippet_node(fileinf,tag,translated->str,description);
+
+	char *programming_languages[]={(char *)language,NULL};
+	load_snippet_node(node,fileinf,programming_languages);
+
+	g_hash_table_add(ctx->touched_files,fileinf);
+	ctx->imported++;
+
+	return 0;
+}
+
+//"prefix" and "body" can be either a string or an array of strings
+static char *get_json_string_or_lines(JsonObject *object, const char *member, const char *separator)
+{
+	JsonNode *node=json_object_get_member(object,member);
+
+	if(!node)
+	{
+		return NULL;
+	}
+
+	if(JSON_NODE_HOLDS_VALUE(node) && json_node_get_value_type(node)==G_TYPE_STRING)
+	{
+		return g_strdup(json_node_get_string(node));
+	}
+
+	if(JSON_NODE_HOLDS_ARRAY(node))
+	{
+		JsonArray *array=json_node_get_array(node);
+		const guint array_len=json_array_get_length(array);
+		g_autoptr(GString) lines=g_string_sized_new(64);
+
+		for(guint i=0;i<array_len;i++)
+		{
+			JsonNode *element=json_array_get_element(array,i);
+
+			if(JSON_NODE_HOLDS_VALUE(element) && json_node_get_value_type(element)==G_TYPE_STRING)
+			{
+				g_string_append_printf(lines,"%s%s",i==0?"":separator,json_node_get_string(element));
+			}
+		}
+
+		return g_string_free(g_steal_pointer(&lines),FALSE);
+	}
+
+	return NULL;
+}
+
+static void import_vscode_snippet(JsonObject *object, const gchar *member_name, JsonNode *member_node, gpointer user_data)
+{
+	SnippetImportContext *ctx=user_data;
+
+	if(!JSON_NODE_HOLDS_OBJECT(member_node))
+	{
+		return;
+	}
+
+	JsonObject *snippet=json_node_get_object(member_node);
+
+	//several prefixes give one snippet each
+	g_autofree char *prefixes=get_json_string_or_lines(snippet,"prefix","\n");
+	g_autofree char *body=get_json_string_or_lines(snippet,"body","\n");
+	const char *description=json_object_get_string_member_with_default(snippet,"description",member_name);
+	const char *scope=json_object_get_string_member_with_default(snippet,"scope",NULL);
+
+	if(!prefixes || !body)
+	{
+		return;
+	}
+
+	g_auto(GStrv) tags=g_strsplit(prefixes,"\n",-1);
+	g_auto(GStrv) scopes=NULL;
+
+	if(ctx->language)
+	{
+		scopes=g_strsplit(ctx->language,",",-1);
+	}
+	else if(scope)
+	{
+		scopes=g_strsplit(scope,",",-1);
+	}
+	else
+	{
+		fprintf(stderr,"%s:%d Snippet %s has no language, skipping\n",__FILE__,__LINE__,member_name);
+		return;
+	}
+
+	for(gint i=0;scopes[i]!=NULL;i++)
+	{
+		g_autofree char *language=map_import_language(g_strstrip(scopes[i]));
+
+		for(gint j=0;tags[j]!=NULL;j++)
+		{
+			import_add_snippet(ctx,language,tags[j],body,description,SNIPPET_IMPORT_FORMAT_VSCODE);
+		}
+	}
+}
+
+static int import_vscode_file(SnippetImportContext *ctx, const char *filepath)
+{
+	g_autoptr(GError) error=NULL;
+	g_autoptr(JsonParser) parser=json_parser_new_immutable();
+
+	//json-glib has no event parser, but only one file is held at a time
+	if(!json_parser_load_from_file(parser,filepath,&error))
+	{
+		fprintf(stderr,"%s:%d Could not parse %s: %s\n",__FILE__,__LINE__,filepath,error->message);
+		return -1;
+	}
+
+	JsonNode *root=json_parser_get_root(parser);
+
+	if(!root || !JSON_NODE_HOLDS_OBJECT(root))
+	{
+		fprintf(stderr,"%s:%d %s is not a snippet object\n",__FILE__,__LINE__,filepath);
+		return -1;
+	}
+
+	//c.json holds snippets for c, while *.code-snippets name the languages in "scope"
+	g_autofree char *file_language=NULL;
+	SnippetImportContext file_ctx=*ctx;
+
+	if(!file_ctx.language && g_str_has_suffix(filepath,".json"))
+	{
+		file_language=get_language_from_filename(filepath);
+		file_ctx.language=file_language;
+	}
+
+	json_object_foreach_member(json_node_get_object(root),import_vscode_snippet,&file_ctx);
+
+	ctx->imported=file_ctx.imported;
+	ctx->skipped=file_ctx.skipped;
+
+	return 0;
+}
+
+static int import_textmate_file(SnippetImportContext *ctx, const char *filepath)
+{
+	xmlTextReaderPtr reader=xmlReaderForFile(filepath,NULL,XML_PARSE_NONET);
+
+	if(!reader)
+	{
+		fprintf(stderr,"%s:%d Could not open %s\n",__FILE__,__LINE__,filepath);
+		return -1;
+	}
+
+	g_autofree char *key=NULL;
+	g_autofree char *content=NULL;
+	g_autofree char *trigger=NULL;
+	g_autofree char *name=NULL;
+	g_autofree char *scope=NULL;
+
+	int ret;
+
+	//<plist><dict><key>tabTrigger</key><string>for</string>...</dict></plist>
+	while((ret=xmlTextReaderRead(reader))==1)
+	{
+		if(xmlTextReaderNodeType(reader)!=XML_READER_TYPE_ELEMENT || xmlTextReaderDepth(reader)!=2)
+		{
+			continue;
+		}
+
+		const char *element=(const char *)xmlTextReaderConstName(reader);
+
+		if(g_strcmp0(element,"key")==0)
+		{
+			g_free(key);
+			key=(char *)xmlTextReaderReadString(reader);
+			continue;
+		}
+
+		if(key && g_strcmp0(element,"string")==0)
+		{
+			char *value=(char *)xmlTextReaderReadString(reader);
+
+			if(g_strcmp0(key,"content")==0)
+			{
+				g_free(content);
+				content=value;
+			}
+			else if(g_strcmp0(key,"tabTrigger")==0)
+			{
+				g_free(trigger);
+				trigger=value;
+			}
+			else if(g_strcmp0(key,"name")==0)
+			{
+				g_free(name);
+				name=value;
+			}
+			else if(g_strcmp0(key,"scope")==0)
+			{
+				g_free(scope);
+				scope=value;
+			}
+			else
+			{
+				g_free(value);
+			}
+		}
+
+		g_clear_pointer(&key,g_free);
+	}
+
+	xmlFreeTextReader(reader);
+
+	if(ret!=0)
+	{
+		fprintf(stderr,"%s:%d Could not parse %s\n",__FILE__,__LINE__,filepath);
+		return -1;
+	}
+
+	//scope can be a selector like "source.c, source.objc"
+	g_autofree char *language=NULL;
+
+	if(ctx->language)
+	{
+		language=g_strdup(ctx->language);
+	}
+	else if(scope)
+	{
+		scope[strcspn(scope,", ")]='\0';
+		language=map_import_language(scope);
+	}
+
+	if(!language)
+	{
+		fprintf(stderr,"%s:%d %s has no scope, skipping\n",__FILE__,__LINE__,filepath);
+		return -1;
+	}
+
+	return import_add_snippet(ctx,language,trigger,content,name,SNIPPET_IMPORT_FORMAT_TEXTMATE);
+}
+
+//snippet trigger "description" options
+static int parse_ultisnips_header(const char *line, char **trigger, char **description)
+{
+	const char *p=line+strlen("snippet");
+
+	while(g_ascii_isspace(*p))
+	{
+		p++;
+	}
+
+	const char *trigger_start=p;
+	const char *trigger_end=NULL;
+
+	if(*p=='"' && (trigger_end=strchr(p+1,'"')))
+	{
+		trigger_start=p+1;
+		p=trigger_end+1;
+	}
+	else
+	{
+		while(*p && !g_ascii_isspace(*p))
+		{
+			p++;
+		}
+		trigger_end=p;
+	}
+
+	while(g_ascii_isspace(*p))
+	{
+		p++;
+	}
+
+	const char *options=p;
+
+	if(*p=='"')
+	{
+		const char *description_end=strrchr(p+1,'"');
+
+		if(description_end)
+		{
+			*description=g_strndup(p+1,description_end-(p+1));
+			options=description_end+1;
+		}
+	}
+
+	//regular expression triggers can not be matched by the tab lookup
+	if(strchr(options,'r'))
+	{
+		return -1;
+	}
+
+	*trigger=g_strndup(trigger_start,trigger_end-trigger_start);
+
+	return 0;
+}
+
+static int import_ultisnips_file(SnippetImportContext *ctx, const char *filepath)
+{
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GFile) file=g_file_new_for_path(filepath);
+	g_autoptr(GFileInputStream) file_stream=g_file_read(file,NULL,&error);
+
+	if(!file_stream)
+	{
+		fprintf(stderr,"%s:%d Could not open %s: %s\n",__FILE__,__LINE__,filepath,error->message);
+		return -1;
+	}
+
+	g_autoptr(GDataInputStream) data_stream=g_data_input_stream_new(G_INPUT_STREAM(file_stream));
+
+	g_autofree char *language=ctx->language?g_strdup(ctx->language):get_language_from_filename(filepath);
+
+	g_autoptr(GString) body=g_string_sized_new(256);
+	g_autofree char *trigger=NULL;
+	g_autofree char *description=NULL;
+	gboolean in_snippet=FALSE;
+	gboolean skip_snippet=FALSE;
+	gboolean in_global=FALSE;
+
+	char *line;
+
+	//only the snippet being read is kept in memory
+	while((line=g_data_input_stream_read_line_utf8(data_stream,NULL,NULL,&error)))
+	{
+		if(in_snippet)
+		{
+			if(g_str_has_prefix(line,"endsnippet"))
+			{
+				if(!skip_snippet)
+				{
+					import_add_snippet(ctx,language,trigger,body->str,description,SNIPPET_IMPORT_FORMAT_ULTISNIPS);
+				}
+
+				g_clear_pointer(&trigger,g_free);
+				g_clear_pointer(&description,g_free);
+				g_string_truncate(body,0);
+				in_snippet=FALSE;
+			}
+			else
+			{
+				g_string_append_printf(body,"%s%s",body->len==0?"":"\n",line);
+			}
+		}
+		else if(in_global)
+		{
+			in_global=!g_str_has_prefix(line,"endglobal");
+		}
+		else if(g_str_has_prefix(line,"snippet ") || g_str_has_prefix(line,"snippet\t"))
+		{
+			skip_snippet=parse_ultisnips_header(line,&trigger,&description)!=0;
+			in_snippet=TRUE;
+		}
+		else if(g_str_has_prefix(line,"global "))
+		{
+			in_global=TRUE;
+		}
+
+		g_free(line);
+	}
+
+	if(error)
+	{
+		fprintf(stderr,"%s:%d Could not read %s: %s\n",__FILE__,__LINE__,filepath,error->message);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int import_snippet_path(SnippetImportContext *ctx, const char *path)
+{
+	if(g_file_test(path,G_FILE_TEST_IS_DIR))
+	{
+		g_autoptr(GError) error=NULL;
+		g_autoptr(GDir) dir=g_dir_open(path,0,&error);
+
+		if(!dir)
+		{
+			fprintf(stderr,"%s:%d Could not open %s: %s\n",__FILE__,__LINE__,path,error->message);
+			return -1;
+		}
+
+		const gchar *filename;
+		while((filename=g_dir_read_name(dir)))
+		{
+			g_autofree char *filepath=g_build_filename(path,filename,NULL);
+			import_snippet_path(ctx,filepath);
+		}
+
+		return 0;
+	}
+
+	switch(get_snippet_import_format(path))
+	{
+		case SNIPPET_IMPORT_FORMAT_VSCODE:
+			return import_vscode_file(ctx,path);
+		case SNIPPET_IMPORT_FORMAT_TEXTMATE:
+			return import_textmate_file(ctx,path);
+		case SNIPPET_IMPORT_FORMAT_ULTISNIPS:
+			return import_ultisnips_file(ctx,path);
+		default:
+			return -1;
+	}
+}
+
+/**
+	Imports a file, or a directory of files, from VS Code, TextMate or UltiSnips.
+	The snippets are added to the loaded index and to the users snippet file
+	of each language, which is then saved. A snippet whose trigger that file
+	already has is skipped and reported, so importing again adds no duplicates.
+	
+	Returns the number of imported snippets, or -1 on failure.
+*/
+int import_snippets(const char *path, const char *language)
+{
+	SnippetImportContext ctx={0};
+	ctx.language=language;
+	ctx.touched_files=g_hash_table_new(g_direct_hash,g_direct_equal);
+	ctx.refused_languages=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+
+	int ret=import_snippet_path(&ctx,path);
+
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init(&iter,ctx.touched_files);
+	while(g_hash_table_iter_next(&iter,&key,NULL))
+	{
+		save_xml_file_information(key);
+	}
+
+	g_hash_table_destroy(ctx.touched_files);
+	g_hash_table_destroy(ctx.refused_languages);
+
+	if(ctx.skipped>0)
+	{
+		fprintf(stderr,"%s:%d Skipped %d snippets of %s whose trigger was already there\n",__FILE__,__LINE__,ctx.skipped,path);
+	}
+
+	if(ret!=0 && ctx.imported==0)
+	{
+		return -1;
+	}
+
+	return ctx.imported;
+}
@@ -0,0 +1,38 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum SnippetImportFormat
+{
+	SNIPPET_IMPORT_FORMAT_UNKNOWN=0,
+	SNIPPET_IMPORT_FORMAT_VSCODE, ///< .code-snippets or .json
+	SNIPPET_IMPORT_FORMAT_TEXTMATE, ///< .tmSnippet plist, one snippet per file
+	SNIPPET_IMPORT_FORMAT_ULTISNIPS ///< .snippets
+}SnippetImportFormat;
+
+SnippetImportFormat get_snippet_import_format(const char *filepath);
+int translate_snippet_placeholders(GString *out, const char *body, SnippetImportFormat format);
+int import_snippets(const char *path, const char *language);
+
+G_END_DECLS
@@ -0,0 +1,305 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <string.h>
+
+#include "gedit-snippets-memory.h"
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-python-handling.h"
+
+static const char *const GLOBAL_SNIPPET_MEMORY_NAMES[SNIPPET_MEMORY_COUNT]={"index","xml","python","session"};
+
+SnippetMemoryFunc GLOBAL_SNIPPET_MEMORY_SESSION_FUNC=NULL;
+gpointer GLOBAL_SNIPPET_MEMORY_SESSION_DATA=NULL;
+
+//a GHashTable keeps a key, a value and a hash per slot
+#define HASH_TABLE_MEMORY(table) (g_hash_table_size(table)*(2*sizeof(gpointer)+sizeof(guint)))
+
+/**
+	Sets who counts the session, the plugin has the expansion state the other tools do not.
+*/
+int snippet_memory_set_session_func(SnippetMemoryFunc func, gpointer user_data)
+{
+	GLOBAL_SNIPPET_MEMORY_SESSION_FUNC=func;
+	GLOBAL_SNIPPET_MEMORY_SESSION_DATA=user_data;
+	
+	return 0;
+}
+
+static size_t get_string_memory(const char *str)
+{
+	return str?strlen(str)+1:0;
+}
+
+static size_t get_xml_node_memory(xmlNode *node)
+{
+	size_t bytes=0;
+	
+	for(;node;node=node->next)
+	{
+		bytes+=sizeof(xmlNode)+get_string_memory((const char *)node->content);
+		
+		if(node->type==XML_ELEMENT_NODE)
+		{
+			for(xmlAttr *attr=node->properties;attr;attr=attr->next)
+			{
+				bytes+=sizeof(xmlAttr)+get_xml_node_memory(attr->children);
+			}
+		}
+		
+		bytes+=get_xml_node_memory(node->children);
+	}
+	
+	return bytes;
+}
+
+/**
+	Nodes, attributes and their text. Element names live in the dictionary of the parser
+	and are not counted.
+*/
+size_t get_xml_doc_memory(xmlDoc *doc)
+{
+	if(!doc)
+	{
+		return 0;
+	}
+	
+	return sizeof(xmlDoc)+get_xml_node_memory(doc->children);
+}
+
+static SnippetFileMemory *get_file_memory(SnippetMemoryReport *self, const char *filename)
+{
+	SnippetFileMemory *file=g_hash_table_lookup(self->files,filename);
+	
+	if(!file)
+	{
+		file=g_new0(SnippetFileMemory,1);
+		file->filename=filename;
+		g_hash_table_insert(self->files,(gpointer)filename,file);
+	}
+	
+	return file;
+}
+
+static size_t get_snippet_translation_memory(SnippetTranslation *sntran)
+{
+	size_t bytes=sizeof(SnippetTranslation)+get_string_memory(sntran->from)+get_string_memory(sntran->to)+get_string_memory(sntran->description);
+	
+	for(const char **language=sntran->programming_languages;language && *language;language++)
+	{
+		bytes+=sizeof(char *)+get_string_memory(*language);
+	}
+	
+	return bytes;
+}
+
+static void count_index_memory(SnippetMemoryReport *self)
+{
+	if(GLOBAL_SNIPPET_ARENA)
+	{
+		self->bytes[SNIPPET_MEMORY_INDEX]+=sizeof(SnippetArena)+GLOBAL_SNIPPET_ARENA->reserved_bytes+HASH_TABLE_MEMORY(GLOBAL_SNIPPET_ARENA->strings);
+	}
+	
+	if(!GLOBAL_SNIPPETS)
+	{
+		return;
+	}
+	
+	self->bytes[SNIPPET_MEMORY_INDEX]+=sizeof(GPtrArray)+GLOBAL_SNIPPETS->len*sizeof(gpointer);
+	
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		self->bytes[SNIPPET_MEMORY_INDEX]+=sizeof(SnippetBlock)+sizeof(GPtrArray)+sblk->nodes->len*sizeof(gpointer);
+		
+		for(guint j=0;j<sblk->nodes->len;j++)
+		{
+			SnippetTranslation *sntran=g_ptr_array_index(sblk->nodes,j);
+			
+			if(!sntran->fileinf)
+			{
+				continue;
+			}
+			
+			SnippetFileMemory *file=get_file_memory(self,sntran->fileinf->filename);
+			file->snippets++;
+			file->index_bytes+=get_snippet_translation_memory(sntran);
+		}
+	}
+}
+
+static void count_xml_memory(SnippetMemoryReport *self)
+{
+	if(!GLOBAL_XML_FILE_INFO)
+	{
+		return;
+	}
+	
+	self->bytes[SNIPPET_MEMORY_XML]+=HASH_TABLE_MEMORY(GLOBAL_XML_FILE_INFO);
+	
+	GHashTableIter iter;
+	gpointer value;
+	g_hash_table_iter_init(&iter,GLOBAL_XML_FILE_INFO);
+	
+	while(g_hash_table_iter_next(&iter,NULL,&value))
+	{
+		XmlFileInformation *fileinf=value;
+		SnippetFileMemory *file=get_file_memory(self,fileinf->filename);
+		
+		//the key is a copy of the filename
+		file->xml_bytes=sizeof(XmlFileInformation)+2*get_string_memory(fileinf->filename)+get_xml_doc_memory(fileinf->doc);
+		self->bytes[SNIPPET_MEMORY_XML]+=file->xml_bytes;
+	}
+}
+
+SnippetMemoryReport *snippet_memory_report_new()
+{
+	SnippetMemoryReport *self=g_new0(SnippetMemoryReport,1);
+	self->files=g_hash_table_new_full(g_str_hash,g_str_equal,NULL,g_free);
+	
+	count_index_memory(self);
+	count_xml_memory(self);
+	
+	get_python_memory_usage(&self->bytes[SNIPPET_MEMORY_PYTHON],&self->python_blocks);
+	
+	if(GLOBAL_SNIPPET_MEMORY_SESSION_FUNC)
+	{
+		self->bytes[SNIPPET_MEMORY_SESSION]=GLOBAL_SNIPPET_MEMORY_SESSION_FUNC(GLOBAL_SNIPPET_MEMORY_SESSION_DATA);
+	}
+	
+	return self;
+}
+
+void snippet_memory_report_free(SnippetMemoryReport *self)
+{
+	if(!self)
+	{
+		return;
+	}
+	
+	g_hash_table_destroy(self->files);
+	g_free(self);
+}
+
+size_t snippet_memory_report_total(SnippetMemoryReport *self)
+{
+	size_t total=0;
+	
+	for(int i=0;i<SNIPPET_MEMORY_COUNT;i++)
+	{
+		total+=self->bytes[i];
+	}
+	
+	return total;
+}
+
+/**
+	One line for the snippet manager, like "1.2 MB: index 800.0 kB, xml 400.0 kB, ..."
+*/
+char *snippet_memory_report_to_string(SnippetMemoryReport *self)
+{
+	g_autofree char *total=g_format_size(snippet_memory_report_total(self));
+	GString *result=g_string_new(total);
+	
+	for(int i=0;i<SNIPPET_MEMORY_COUNT;i++)
+	{
+		g_autofree char *size=g_format_size(self->bytes[i]);
+		g_string_append_printf(result,"%s %s %s",i==0?":":",",GLOBAL_SNIPPET_MEMORY_NAMES[i],size);
+	}
+	
+	return g_string_free(result,FALSE);
+}
+
+static gint sort_file_memory(gconstpointer a, gconstpointer b)
+{
+	const SnippetFileMemory *file_a=*(SnippetFileMemory *const *)a;
+	const SnippetFileMemory *file_b=*(SnippetFileMemory *const *)b;
+	
+	return strcmp(file_a->filename,file_b->filename);
+}
+
+/**
+	{"total":..,"subsystems":{"index":..,..},"python_blocks":..,"files":[{"filename":..,..}]}
+*/
+char *snippet_memory_report_to_json(SnippetMemoryReport *self)
+{
+	g_autoptr(JsonBuilder) builder=json_builder_new();
+	
+	json_builder_begin_object(builder);
+	
+	json_builder_set_member_name(builder,"total");
+	json_builder_add_int_value(builder,snippet_memory_report_total(self));
+	
+	json_builder_set_member_name(builder,"subsystems");
+	json_builder_begin_object(builder);
+	for(int i=0;i<SNIPPET_MEMORY_COUNT;i++)
+	{
+		json_builder_set_member_name(builder,GLOBAL_SNIPPET_MEMORY_NAMES[i]);
+		json_builder_add_int_value(builder,self->bytes[i]);
+	}
+	json_builder_end_object(builder);
+	
+	json_builder_set_member_name(builder,"python_blocks");
+	json_builder_add_int_value(builder,self->python_blocks);
+	
+	//sorted, so two dumps can be compared with diff
+	g_autoptr(GPtrArray) files=g_ptr_array_sized_new(g_hash_table_size(self->files));
+	
+	GHashTableIter iter;
+	gpointer value;
+	g_hash_table_iter_init(&iter,self->files);
+	
+	while(g_hash_table_iter_next(&iter,NULL,&value))
+	{
+		g_ptr_array_add(files,value);
+	}
+	
+	g_ptr_array_sort(files,sort_file_memory);
+	
+	json_builder_set_member_name(builder,"files");
+	json_builder_begin_array(builder);
+	for(guint i=0;i<files->len;i++)
+	{
+		SnippetFileMemory *file=g_ptr_array_index(files,i);
+		
+		json_builder_begin_object(builder);
+		json_builder_set_member_name(builder,"filename");
+		json_builder_add_string_value(builder,file->filename);
+		json_builder_set_member_name(builder,"snippets");
+		json_builder_add_int_value(builder,file->snippets);
+		json_builder_set_member_name(builder,"index");
+		json_builder_add_int_value(builder,file->index_bytes);
+		json_builder_set_member_name(builder,"xml");
+		json_builder_add_int_value(builder,file->xml_bytes);
+		json_builder_end_object(builder);
+	}
+	json_builder_end_array(builder);
+	
+	json_builder_end_object(builder);
+	
+	g_autoptr(JsonGenerator) generator=json_generator_new();
+	g_autoptr(JsonNode) root=json_builder_get_root(builder);
+	json_generator_set_root(generator,root);
+	json_generator_set_pretty(generator,TRUE);
+	
+	return json_generator_to_data(generator,NULL);
+}
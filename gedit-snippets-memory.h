@@ -0,0 +1,66 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+#include <libxml/tree.h>
+
+G_BEGIN_DECLS
+
+typedef enum SnippetMemorySubsystem
+{
+	SNIPPET_MEMORY_INDEX=0, ///< GLOBAL_SNIPPETS and the arena behind it
+	SNIPPET_MEMORY_XML, ///< the xmlDoc of every file in GLOBAL_XML_FILE_INFO
+	SNIPPET_MEMORY_PYTHON, ///< only known while tracemalloc is tracing
+	SNIPPET_MEMORY_SESSION, ///< the snippet being expanded, caches of the editor
+	SNIPPET_MEMORY_COUNT
+}SnippetMemorySubsystem;
+
+typedef struct SnippetFileMemory
+{
+	const char *filename;
+	guint snippets;
+	size_t index_bytes; ///< its snippets, strings shared with other files are counted for each
+	size_t xml_bytes;
+}SnippetFileMemory;
+
+/**
+	Estimated bytes per subsystem, counted from the structures when it is made.
+*/
+typedef struct SnippetMemoryReport
+{
+	size_t bytes[SNIPPET_MEMORY_COUNT];
+	size_t python_blocks; ///< sys.getallocatedblocks()
+	GHashTable *files; ///< filename -> SnippetFileMemory
+}SnippetMemoryReport;
+
+typedef size_t (*SnippetMemoryFunc)(gpointer user_data);
+
+int snippet_memory_set_session_func(SnippetMemoryFunc func, gpointer user_data);
+
+SnippetMemoryReport *snippet_memory_report_new();
+void snippet_memory_report_free(SnippetMemoryReport *self);
+size_t snippet_memory_report_total(SnippetMemoryReport *self);
+char *snippet_memory_report_to_string(SnippetMemoryReport *self);
+char *snippet_memory_report_to_json(SnippetMemoryReport *self);
+
+size_t get_xml_doc_memory(xmlDoc *doc);
+
+G_END_DECLS
@@ -18,46 +18,672 @@ freely, subject to the following restrictions:
 3. This notice may not be removed or altered from any source distribution.
 */
 
-#include <gtk/gtk.h>
-#include "gedit-snippets.h"
 #include "gedit-snippets-python-handling.h"
+#include "gedit-snippets-configuration.h"
 
-char *translate_python_block(const char *globals_code, const char *return_code)
+//the interpreter Py_Initialize created, used when no window has set its own
+static SnippetPython GLOBAL_MAIN_PYTHON={0};
+
+static SnippetPython *GLOBAL_CURRENT_PYTHON=&GLOBAL_MAIN_PYTHON;
+
+//return code -> compiled code, what a thread compiles between snippet_python_begin_uncached and snippet_python_end_uncached
+static _Thread_local GHashTable *GLOBAL_UNCACHED_PYTHON_CODE=NULL;
+//lowercase language -> helper module, what those renders import, kept out of the helpers of the main interpreter
+static _Thread_local GHashTable *GLOBAL_UNCACHED_PYTHON_HELPERS=NULL;
+
+//"Type: message" of the last exception a block of this thread raised, until take_python_error
+static _Thread_local char *GLOBAL_PYTHON_ERROR=NULL;
+
+//the thread state snippet_python_init gave up the GIL with, NULL when another plugin set python up
+static PyThreadState *GLOBAL_OWNED_PYTHON_STATE=NULL;
+
+//of the main interpreter on the thread that set python up, what the subinterpreters are created from and left to
+static PyThreadState *GLOBAL_MAIN_THREAD_STATE=NULL;
+
+/**
+	Sets python up unless someone in the process did already, like the python plugin loader
+	of gedit. Either way the GIL is free afterwards and every function here takes it when it
+	needs it, so the same interpreter serves this plugin and the python ones.
+*/
+int snippet_python_init()
+{
+	if(GLOBAL_MAIN_THREAD_STATE)
+	{
+		return 0;
+	}
+	
+	if(Py_IsInitialized())
+	{
+		//the thread state of whoever set python up is theirs to use
+		GLOBAL_MAIN_THREAD_STATE=PyThreadState_New(PyInterpreterState_Main());
+		return 0;
+	}
+	
+	//the signals are gedit's
+	Py_InitializeEx(0);
+	GLOBAL_OWNED_PYTHON_STATE=PyEval_SaveThread();
+	GLOBAL_MAIN_THREAD_STATE=GLOBAL_OWNED_PYTHON_STATE;
+	
+	return 0;
+}
+
+/**
+	Drops what the snippets compiled and imported, and shuts python down only if
+	snippet_python_init started it.
+*/
+int snippet_python_finalize()
+{
+	if(!Py_IsInitialized() || !GLOBAL_MAIN_THREAD_STATE)
+	{
+		return -1;
+	}
+	
+	clear_python_blocks();
+	
+	PyEval_RestoreThread(g_steal_pointer(&GLOBAL_MAIN_THREAD_STATE));
+	
+	if(GLOBAL_OWNED_PYTHON_STATE)
+	{
+		GLOBAL_OWNED_PYTHON_STATE=NULL;
+		Py_FinalizeEx();
+	}
+	else
+	{
+		PyThreadState_Clear(PyThreadState_Get());
+		PyThreadState_DeleteCurrent();
+	}
+	
+	return 0;
+}
+
+static void release_python_code(PyObject *code)
+{
+	Py_XDECREF(code);
+}
+
+/**
+	PyErr_Print, after keeping the exception as the one take_python_error returns.
+*/
+static void print_python_error()
+{
+	PyObject *type, *value, *traceback;
+	PyErr_Fetch(&type,&value,&traceback);
+	PyErr_NormalizeException(&type,&value,&traceback);
+	
+	PyObject *message=value?PyObject_Str(value):NULL;
+	const char *message_utf8=message?PyUnicode_AsUTF8(message):NULL;
+	
+	g_free(GLOBAL_PYTHON_ERROR);
+	GLOBAL_PYTHON_ERROR=g_strdup_printf("%s: %s",type?((PyTypeObject *)type)->tp_name:"Error",message_utf8?message_utf8:"");
+	
+	Py_XDECREF(message);
+	PyErr_Clear();
+	
+	PyErr_Restore(type,value,traceback);
+	PyErr_Print();
+}
+
+/**
+	The last python error, NULL when there was none since the previous call. Free with g_free.
+*/
+char *take_python_error()
+{
+	return g_steal_pointer(&GLOBAL_PYTHON_ERROR);
+}
+
+/**
+	Takes the GIL to run in self. A subinterpreter is entered with its own thread state and
+	without PyGILState, which does not support them. The main interpreter can be entered from
+	any thread, like the worker of the preview. Give the result to leave_snippet_python.
+*/
+static PyGILState_STATE enter_snippet_python(SnippetPython *self)
+{
+	if(self->thread_state)
+	{
+		PyEval_RestoreThread(self->thread_state);
+		return PyGILState_UNLOCKED;
+	}
+	
+	return PyGILState_Ensure();
+}
+
+static void leave_snippet_python(SnippetPython *self, PyGILState_STATE gil)
+{
+	if(self->thread_state)
+	{
+		PyEval_SaveThread();
+		return;
+	}
+	
+	PyGILState_Release(gil);
+}
+
+/**
+	Creates the subinterpreter, only with python 3.12 and later. Otherwise and on failure self
+	keeps using the main interpreter. It shares the GIL and the allocator of the main one: the
+	blocks run one at a time on the main thread anyway, and so every extension module can be
+	imported.
+*/
+static void init_snippet_python(SnippetPython *self)
+{
+	self->thread_state=NULL;
+	
+#if PY_VERSION_HEX >= 0x030C0000
+	const PyInterpreterConfig config={
+		.use_main_obmalloc=1,
+		.allow_fork=0,
+		.allow_exec=0,
+		.allow_threads=1,
+		.allow_daemon_threads=0,
+		.check_multi_interp_extensions=0,
+		.gil=PyInterpreterConfig_SHARED_GIL,
+	};
+	
+	PyEval_RestoreThread(GLOBAL_MAIN_THREAD_STATE);
+	
+	PyThreadState *thread_state=NULL;
+	PyStatus status=Py_NewInterpreterFromConfig(&thread_state,&config);
+	
+	if(PyStatus_Exception(status))
+	{
+		fprintf(stderr,"%s:%d Could not create a python subinterpreter: %s\n",__FILE__,__LINE__,status.err_msg?status.err_msg:"");
+	}
+	else
+	{
+		self->thread_state=thread_state;
+	}
+	
+	//back to the main interpreter, the new one is entered for every block
+	PyThreadState_Swap(GLOBAL_MAIN_THREAD_STATE);
+	PyEval_SaveThread();
+#endif
+}
+
+static void clear_snippet_python(SnippetPython *self)
+{
+	PyGILState_STATE gil=enter_snippet_python(self);
+	
+	g_clear_pointer(&self->code_cache,g_hash_table_destroy);
+	g_clear_pointer(&self->helpers,g_hash_table_destroy);
+	
+	//the helpers are imported again, maybe changed
+	g_clear_pointer(&self->helper_sources,g_hash_table_destroy);
+	
+	if(!self->thread_state)
+	{
+		leave_snippet_python(self,gil);
+		return;
+	}
+	
+	//leaves no thread state and no GIL
+	Py_EndInterpreter(g_steal_pointer(&self->thread_state));
+}
+
+SnippetPython *snippet_python_new()
+{
+	SnippetPython *self=g_new0(SnippetPython,1);
+	
+	init_snippet_python(self);
+	
+	return self;
+}
+
+/**
+	Tears down the interpreter with everything the snippets left in it.
+*/
+void snippet_python_free(SnippetPython *self)
+{
+	if(!self)
+	{
+		return;
+	}
+	
+	if(GLOBAL_CURRENT_PYTHON==self)
+	{
+		GLOBAL_CURRENT_PYTHON=&GLOBAL_MAIN_PYTHON;
+	}
+	
+	clear_snippet_python(self);
+	
+	g_free(self);
+}
+
+/**
+	Whether self has a subinterpreter of its own that snippet_python_reset can replace. The
+	main interpreter, which is all there is before python 3.12, is shared by every window and
+	can not be restarted while the process runs.
+*/
+gboolean snippet_python_can_reset(SnippetPython *self)
+{
+	return self && self->thread_state;
+}
+
+/**
+	Replaces the subinterpreter with a fresh one, for when a snippet left it broken.
+	Returns -1 and does nothing when snippet_python_can_reset says it can not.
+*/
+int snippet_python_reset(SnippetPython *self)
+{
+	if(!snippet_python_can_reset(self))
+	{
+		return -1;
+	}
+	
+	clear_snippet_python(self);
+	init_snippet_python(self);
+	
+	return 0;
+}
+
+/**
+	The interpreter the following python blocks run in, NULL for the main one.
+*/
+void snippet_python_set_current(SnippetPython *self)
 {
+	GLOBAL_CURRENT_PYTHON=self?self:&GLOBAL_MAIN_PYTHON;
+}
+
+//windows without a subinterpreter share what the main interpreter compiled
+static SnippetPython *get_current_python()
+{
+	//the uncached code is released with the GIL of the main interpreter
+	if(GLOBAL_UNCACHED_PYTHON_CODE)
+	{
+		return &GLOBAL_MAIN_PYTHON;
+	}
+	
+	return GLOBAL_CURRENT_PYTHON->thread_state?GLOBAL_CURRENT_PYTHON:&GLOBAL_MAIN_PYTHON;
+}
+
+static PyObject *get_python_function_code(SnippetPython *self, const char *return_code)
+{
+	if(!self->code_cache)
+	{
+		self->code_cache=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,(GDestroyNotify)release_python_code);
+	}
+	
+	GHashTable *cache=GLOBAL_UNCACHED_PYTHON_CODE?GLOBAL_UNCACHED_PYTHON_CODE:self->code_cache;
+	PyObject *code=g_hash_table_lookup(cache,return_code);
+	
+	if(code)
+	{
+		return code;
+	}
+	
 	// Wrap the return_code into a Python function
-	g_autofree char *wrapped_code=NULL;
-	size_t wrapped_code_len=asprintf(&wrapped_code, "def __tempfunc(): %s\n", return_code);
+	g_autofree char *wrapped_code=g_strdup_printf("def __tempfunc(): %s\n", return_code);
+	
+	code=Py_CompileString(wrapped_code,"<snippet>",Py_file_input);
+	
+	if(!code)
+	{
+		print_python_error();
+		return NULL;
+	}
+	
+	g_hash_table_insert(cache,g_strdup(return_code),code);
+	
+	return code;
+}
+
+/**
+	Until snippet_python_end_uncached, the blocks of the calling thread run in the main
+	interpreter and what they compile and the helpers they import are dropped at the end
+	instead of kept.
+*/
+int snippet_python_begin_uncached()
+{
+	if(!GLOBAL_UNCACHED_PYTHON_CODE)
+	{
+		GLOBAL_UNCACHED_PYTHON_CODE=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,(GDestroyNotify)release_python_code);
+		GLOBAL_UNCACHED_PYTHON_HELPERS=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,(GDestroyNotify)release_python_code);
+	}
+	
+	return 0;
+}
+
+int snippet_python_end_uncached()
+{
+	if(!GLOBAL_UNCACHED_PYTHON_CODE)
+	{
+		return 0;
+	}
+	
+	//only compiled code and imported helpers need python, which is up then
+	if(g_hash_table_size(GLOBAL_UNCACHED_PYTHON_CODE)>0 || g_hash_table_size(GLOBAL_UNCACHED_PYTHON_HELPERS)>0)
+	{
+		PyGILState_STATE gil=PyGILState_Ensure();
+		g_clear_pointer(&GLOBAL_UNCACHED_PYTHON_CODE,g_hash_table_destroy);
+		g_clear_pointer(&GLOBAL_UNCACHED_PYTHON_HELPERS,g_hash_table_destroy);
+		PyGILState_Release(gil);
+	}
+	else
+	{
+		g_clear_pointer(&GLOBAL_UNCACHED_PYTHON_CODE,g_hash_table_destroy);
+		g_clear_pointer(&GLOBAL_UNCACHED_PYTHON_HELPERS,g_hash_table_destroy);
+	}
+	
+	return 0;
+}
+
+/**
+	Compiles the return code ahead of the first expansion that needs it.
+*/
+int prepare_python_block(const char *return_code)
+{
+	SnippetPython *self=get_current_python();
+	PyGILState_STATE gil=enter_snippet_python(self);
+	
+	PyObject *code=get_python_function_code(self,return_code);
+	
+	leave_snippet_python(self,gil);
+	
+	return code?0:-1;
+}
+
+/**
+	Compiles code as the file filename without running or keeping it, for checking snippets.
+	Returns NULL when it compiles, else "Type: message" with the line of a syntax error in line,
+	0 when it has none. Takes the GIL of the main interpreter, so any thread can call it once
+	that is initialized. Free with g_free.
+*/
+char *check_python_code(const char *code, const char *filename, long *line)
+{
+	*line=0;
+	
+	PyGILState_STATE gil=PyGILState_Ensure();
+	
+	PyObject *compiled=Py_CompileString(code,filename,Py_file_input);
+	char *error=NULL;
+	
+	if(!compiled)
+	{
+		PyObject *type, *value, *traceback;
+		PyErr_Fetch(&type,&value,&traceback);
+		PyErr_NormalizeException(&type,&value,&traceback);
+		
+		PyObject *message=value?PyObject_Str(value):NULL;
+		const char *message_utf8=message?PyUnicode_AsUTF8(message):NULL;
+		
+		error=g_strdup_printf("%s: %s",type?((PyTypeObject *)type)->tp_name:"Error",message_utf8?message_utf8:"");
+		
+		PyObject *lineno=value && PyObject_HasAttrString(value,"lineno")?PyObject_GetAttrString(value,"lineno"):NULL;
+		
+		if(lineno && PyLong_Check(lineno))
+		{
+			*line=PyLong_AsLong(lineno);
+		}
+		
+		Py_XDECREF(lineno);
+		Py_XDECREF(message);
+		Py_XDECREF(type);
+		Py_XDECREF(value);
+		Py_XDECREF(traceback);
+		PyErr_Clear();
+	}
+	
+	Py_XDECREF(compiled);
+	PyGILState_Release(gil);
+	
+	return error;
+}
+
+//the source of <language>.py from the first snippet directory that has one, NULL when none has
+static char *read_python_helpers(const char *language, char **filepath)
+{
+	g_auto(GStrv) dirs=get_snippet_directories();
+	g_autofree char *basename=g_strconcat(language,".py",NULL);
+	
+	for(size_t i=0;dirs[i];i++)
+	{
+		g_autofree char *path=g_build_filename(dirs[i],basename,NULL);
+		char *source=NULL;
+		
+		if(g_file_get_contents(path,&source,NULL,NULL))
+		{
+			if(filepath)
+			{
+				*filepath=g_steal_pointer(&path);
+			}
+			
+			return source;
+		}
+	}
+	
+	return NULL;
+}
+
+/**
+	Runs <language>.py from the first snippet directory that has one in a module of its own,
+	gedit_snippets.<language>. It is kept out of sys.modules, so the python plugins sharing the
+	interpreter neither see nor clash with it. Compiled and run once per interpreter.
+*/
+static PyObject *import_python_helpers(const char *language)
+{
+	g_autofree char *filepath=NULL;
+	g_autofree char *source=read_python_helpers(language,&filepath);
+	
+	if(!source)
+	{
+		return NULL;
+	}
+	
+	g_autofree char *module_name=g_strconcat("gedit_snippets.",language,NULL);
+	g_strcanon(module_name+strlen("gedit_snippets."),G_CSET_a_2_z G_CSET_A_2_Z G_CSET_DIGITS "_",'_');
+	
+	PyObject *code=Py_CompileString(source,filepath,Py_file_input);
+	PyObject *module=code?PyModule_New(module_name):NULL;
+	
+	if(module)
+	{
+		PyObject *module_dict=PyModule_GetDict(module);
+		PyObject *file=PyUnicode_DecodeFSDefault(filepath);
+		
+		PyDict_SetItemString(module_dict,"__file__",file);
+		PyDict_SetItemString(module_dict,"__builtins__",PyEval_GetBuiltins());
+		Py_XDECREF(file);
+		
+		PyObject *result=PyEval_EvalCode(code,module_dict,module_dict);
+		
+		if(result)
+		{
+			Py_DECREF(result);
+		}
+		else
+		{
+			Py_CLEAR(module);
+		}
+	}
+	
+	Py_XDECREF(code);
+	
+	if(!module)
+	{
+		fprintf(stderr,"%s:%d Could not import the python helpers %s\n",__FILE__,__LINE__,filepath);
+		print_python_error();
+	}
+	
+	return module;
+}
+
+static PyObject *get_python_helpers(SnippetPython *self, const char *language)
+{
+	if(!language)
+	{
+		return NULL;
+	}
+	
+	if(!self->helpers)
+	{
+		self->helpers=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,(GDestroyNotify)release_python_code);
+	}
+	
+	//the renders of another thread, like the preview, import their own and drop them at the end
+	GHashTable *helpers=GLOBAL_UNCACHED_PYTHON_HELPERS?GLOBAL_UNCACHED_PYTHON_HELPERS:self->helpers;
+	g_autofree char *key=g_ascii_strdown(language,-1);
+	PyObject *module=g_hash_table_lookup(helpers,key);
+	
+	if(!module)
+	{
+		//a missing or broken file is not looked for again
+		module=import_python_helpers(key);
+		
+		if(!module)
+		{
+			Py_INCREF(Py_None);
+			module=Py_None;
+		}
+		
+		g_hash_table_insert(helpers,g_steal_pointer(&key),module);
+	}
+	
+	return module==Py_None?NULL:module;
+}
 
-	if(wrapped_code_len==0)
+//whether name is in code as a whole word, code may define it then
+static gboolean has_python_name(const char *code, const char *name)
+{
+	const size_t name_len=strlen(name);
+	
+	for(const char *p=strstr(code,name);p;p=strstr(p+1,name))
+	{
+		const gboolean starts=p==code || !(g_ascii_isalnum(p[-1]) || p[-1]=='_');
+		const gboolean ends=!(g_ascii_isalnum(p[name_len]) || p[name_len]=='_');
+		
+		if(starts && ends)
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+/**
+	Whether the includes globals_code or the <language>.py helpers may define name, which they
+	do for python when it is there at all. A block that calls such a name runs in python and
+	not as an expression. Only reads the helpers, once per language, python is not needed.
+	language can be NULL.
+*/
+gboolean python_may_define_name(const char *language, const char *globals_code, const char *name)
+{
+	if(globals_code && has_python_name(globals_code,name))
+	{
+		return TRUE;
+	}
+	
+	if(!language)
+	{
+		return FALSE;
+	}
+	
+	g_autofree char *key=g_ascii_strdown(language,-1);
+	
+	//the renders of another thread, like the preview, read the file every time
+	if(GLOBAL_UNCACHED_PYTHON_CODE)
+	{
+		g_autofree char *source=read_python_helpers(key,NULL);
+		
+		return source && has_python_name(source,name);
+	}
+	
+	SnippetPython *self=get_current_python();
+	
+	if(!self->helper_sources)
+	{
+		self->helper_sources=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,g_free);
+	}
+	
+	gpointer source=NULL;
+	
+	if(!g_hash_table_lookup_extended(self->helper_sources,key,NULL,&source))
+	{
+		source=read_python_helpers(key,NULL);
+		g_hash_table_insert(self->helper_sources,g_steal_pointer(&key),source);
+	}
+	
+	return source && has_python_name(source,name);
+}
+
+/**
+	Puts the public names of the language's helper module into globals.
+*/
+static int add_python_helpers(SnippetPython *self, PyObject *globals, const char *language)
+{
+	PyObject *module=get_python_helpers(self,language);
+	
+	if(!module)
+	{
+		return 0;
+	}
+	
+	PyObject *module_dict=PyModule_GetDict(module);
+	PyObject *key, *value;
+	Py_ssize_t pos=0;
+	
+	while(PyDict_Next(module_dict,&pos,&key,&value))
+	{
+		const char *name=PyUnicode_Check(key)?PyUnicode_AsUTF8(key):NULL;
+		
+		if(name && name[0]!='_')
+		{
+			PyDict_SetItem(globals,key,value);
+		}
+	}
+	
+	return 0;
+}
+
+/**
+	Drops the compiled blocks and the helper modules of the main interpreter.
+*/
+void clear_python_blocks()
+{
+	clear_snippet_python(&GLOBAL_MAIN_PYTHON);
+	
+	GLOBAL_CURRENT_PYTHON=&GLOBAL_MAIN_PYTHON;
+}
+
+static char *run_python_block(SnippetPython *self, const char *language, const char *globals_code, const char *return_code)
+{
+	PyObject *code=get_python_function_code(self,return_code);
+	
+	if(!code)
 	{
-		fprintf(stdout,"%s:%d Could not allocate memory\n",__FILE__,__LINE__);
 		return NULL;
 	}
 
 	PyObject *globals = PyDict_New();
 	PyDict_SetItemString(globals, "__builtins__", PyEval_GetBuiltins());
+	add_python_helpers(self, globals, language);
 
 	// Run global setup code
-	if (PyRun_String(globals_code, Py_file_input, globals, globals) == NULL)
+	PyObject *globals_result=PyRun_String(globals_code, Py_file_input, globals, globals);
+	if (globals_result == NULL)
 	{
-		PyErr_Print();
+		print_python_error();
 		Py_DECREF(globals);
 		return NULL;
 	}
+	Py_DECREF(globals_result);
 
 	// Run the wrapped function definition
-	if (PyRun_String(wrapped_code, Py_file_input, globals, globals) == NULL)
+	PyObject *definition_result=PyEval_EvalCode(code, globals, globals);
+	if (definition_result == NULL)
 	{
-		PyErr_Print();
+		print_python_error();
 		Py_DECREF(globals);
 		return NULL;
 	}
+	Py_DECREF(definition_result);
 
 	// Call the function
 	PyObject *func = PyDict_GetItemString(globals, "__tempfunc");
 	if (!func || !PyCallable_Check(func))
 	{
 		fprintf(stderr, "Function not found or not callable.\n");
+		g_free(GLOBAL_PYTHON_ERROR);
+		GLOBAL_PYTHON_ERROR=g_strdup("Function not found or not callable");
 		Py_DECREF(globals);
 		return NULL;
 	}
@@ -65,7 +691,7 @@ char *translate_python_block(const char *globals_code, const char *return_code)
 	PyObject *result = PyObject_CallObject(func, NULL);
 	if (!result)
 	{
-		PyErr_Print();
+		print_python_error();
 		Py_DECREF(globals);
 		return NULL;
 	}
@@ -82,3 +708,67 @@ char *translate_python_block(const char *globals_code, const char *return_code)
 	Py_DECREF(globals);
 	return output_str;
 }
+
+/**
+	Runs globals_code, the $<...> includes, and then return_code as the body of a function,
+	in the current interpreter. The helpers of language are there as globals, language can be NULL.
+*/
+char *translate_python_block(const char *language, const char *globals_code, const char *return_code)
+{
+	SnippetPython *self=get_current_python();
+	PyGILState_STATE gil=enter_snippet_python(self);
+	
+	char *output_str=run_python_block(self,language,globals_code,return_code);
+	
+	leave_snippet_python(self,gil);
+	
+	return output_str;
+}
+
+/**
+	bytes is what tracemalloc traces, 0 unless it was started (PYTHONTRACEMALLOC=1).
+	blocks is the number of objects python has allocated.
+*/
+int get_python_memory_usage(size_t *bytes, size_t *blocks)
+{
+	*bytes=0;
+	*blocks=0;
+	
+	if(!Py_IsInitialized())
+	{
+		return -1;
+	}
+	
+	PyGILState_STATE gil=PyGILState_Ensure();
+	
+	PyObject *sys_module=PyImport_ImportModule("sys");
+	PyObject *allocated=sys_module?PyObject_CallMethod(sys_module,"getallocatedblocks",NULL):NULL;
+	
+	if(allocated)
+	{
+		*blocks=PyLong_AsSize_t(allocated);
+	}
+	
+	PyObject *tracemalloc=PyImport_ImportModule("tracemalloc");
+	PyObject *traced=tracemalloc?PyObject_CallMethod(tracemalloc,"get_traced_memory",NULL):NULL;
+	
+	//(current, peak), both 0 while it does not trace
+	if(traced && PyTuple_Check(traced))
+	{
+		*bytes=PyLong_AsSize_t(PyTuple_GetItem(traced,0));
+	}
+	
+	if(PyErr_Occurred())
+	{
+		PyErr_Clear();
+	}
+	
+	Py_XDECREF(traced);
+	Py_XDECREF(tracemalloc);
+	Py_XDECREF(allocated);
+	Py_XDECREF(sys_module);
+	
+	PyGILState_Release(gil);
+	
+	return 0;
+}
@@ -19,11 +19,41 @@ freely, subject to the following restrictions:
 */
 #pragma once
 
-#include <gtk/gtk.h>
 #include <Python.h>
+#include <glib.h>
 
 G_BEGIN_DECLS
 
-char *translate_python_block(const char *globals_code, const char *return_code);
+/**
+	The interpreter the python blocks of one window run in, with what was compiled and
+	imported for it. With python 3.12 and later it is a subinterpreter sharing the GIL of the
+	main one, before that it is the main interpreter.
+*/
+typedef struct SnippetPython
+{
+	PyThreadState *thread_state; ///< NULL for the main interpreter
+	GHashTable *code_cache; ///< return code -> compiled "def __tempfunc(): ..."
+	GHashTable *helpers; ///< lowercase language -> module from <language>.py, Py_None when there is none
+	GHashTable *helper_sources; ///< lowercase language -> source of <language>.py or NULL, for python_may_define_name
+}SnippetPython;
+
+int snippet_python_init();
+int snippet_python_finalize();
+
+SnippetPython *snippet_python_new();
+void snippet_python_free(SnippetPython *self);
+gboolean snippet_python_can_reset(SnippetPython *self);
+int snippet_python_reset(SnippetPython *self);
+void snippet_python_set_current(SnippetPython *self);
+
+char *translate_python_block(const char *language, const char *globals_code, const char *return_code);
+gboolean python_may_define_name(const char *language, const char *globals_code, const char *name);
+int prepare_python_block(const char *return_code);
+char *check_python_code(const char *code, const char *filename, long *line);
+void clear_python_blocks();
+int snippet_python_begin_uncached();
+int snippet_python_end_uncached();
+char *take_python_error();
+int get_python_memory_usage(size_t *bytes, size_t *blocks);
 
 G_END_DECLS
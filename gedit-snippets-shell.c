@@ -0,0 +1,346 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <gio/gio.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-shell.h"
+
+typedef struct ShellCommandResult
+{
+	char *output;
+	gint64 expires; ///< monotonic time
+}ShellCommandResult;
+
+typedef struct ShellCommandWaiter
+{
+	ShellCommandFunc callback;
+	gpointer user_data;
+}ShellCommandWaiter;
+
+typedef struct ShellCommandRun
+{
+	char *key;
+	char *command;
+	GSubprocess *process;
+	GCancellable *cancellable;
+	guint timeout_id;
+	GArray *waiters; ///< ShellCommandWaiter, everyone asking while it runs
+}ShellCommandRun;
+
+//cwd and command -> ShellCommandResult
+GHashTable *GLOBAL_SHELL_COMMAND_CACHE=NULL;
+//cwd and command -> ShellCommandRun, the runs free themselves when they are done
+GHashTable *GLOBAL_SHELL_COMMAND_RUNNING=NULL;
+//the output of the last run_shell_command_sync that was not cached
+char *GLOBAL_SHELL_COMMAND_SYNC_OUTPUT=NULL;
+
+static void shell_command_result_free(ShellCommandResult *self)
+{
+	g_free(self->output);
+	g_free(self);
+}
+
+static void shell_command_run_free(ShellCommandRun *self)
+{
+	if(self->timeout_id)
+	{
+		g_source_remove(self->timeout_id);
+	}
+	
+	g_free(self->key);
+	g_free(self->command);
+	g_clear_object(&self->process);
+	g_clear_object(&self->cancellable);
+	g_array_free(self->waiters,TRUE);
+	g_free(self);
+}
+
+static char *get_shell_command_key(const char *command, const char *cwd)
+{
+	return g_strconcat(cwd?cwd:"","\n",command,NULL);
+}
+
+int shell_commands_init()
+{
+	if(GLOBAL_SHELL_COMMAND_CACHE)
+	{
+		return 0;
+	}
+	
+	GLOBAL_SHELL_COMMAND_CACHE=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,(GDestroyNotify)shell_command_result_free);
+	GLOBAL_SHELL_COMMAND_RUNNING=g_hash_table_new(g_str_hash,g_str_equal);
+	
+	return 0;
+}
+
+int shell_commands_finalize()
+{
+	if(!GLOBAL_SHELL_COMMAND_CACHE)
+	{
+		return 0;
+	}
+	
+	GHashTableIter iter;
+	gpointer value;
+	
+	//the runs still get their completion callback, but nobody is told
+	g_hash_table_iter_init(&iter,GLOBAL_SHELL_COMMAND_RUNNING);
+	while(g_hash_table_iter_next(&iter,NULL,&value))
+	{
+		ShellCommandRun *run=value;
+		
+		g_array_set_size(run->waiters,0);
+		g_cancellable_cancel(run->cancellable);
+		g_subprocess_force_exit(run->process);
+	}
+	
+	//the callbacks are code of this module, which may be unloaded after this returns, so they run now
+	while(g_hash_table_size(GLOBAL_SHELL_COMMAND_RUNNING)>0)
+	{
+		g_main_context_iteration(NULL,TRUE);
+	}
+	
+	g_clear_pointer(&GLOBAL_SHELL_COMMAND_RUNNING,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_SHELL_COMMAND_CACHE,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_SHELL_COMMAND_SYNC_OUTPUT,g_free);
+	
+	return 0;
+}
+
+/**
+	Returns the output of the command if it ran in cwd within the cache lifetime, else NULL.
+*/
+const char *lookup_shell_command(const char *command, const char *cwd)
+{
+	g_autofree char *key=get_shell_command_key(command,cwd);
+	ShellCommandResult *result=g_hash_table_lookup(GLOBAL_SHELL_COMMAND_CACHE,key);
+	
+	if(!result)
+	{
+		return NULL;
+	}
+	
+	if(result->expires<g_get_monotonic_time())
+	{
+		g_hash_table_remove(GLOBAL_SHELL_COMMAND_CACHE,key);
+		return NULL;
+	}
+	
+	return result->output;
+}
+
+/**
+	Gives output to everyone waiting for the run. Only a successful run is cached, a failed or timed
+	out one is started again the next time, and does not blank the placeholder for the whole TTL.
+*/
+static void finish_shell_command(ShellCommandRun *run, char *output, gboolean successful)
+{
+	//like the original plugin, only the last line break is removed
+	if(output)
+	{
+		size_t output_len=strlen(output);
+		
+		if(output_len>0 && output[output_len-1]=='\n')
+		{
+			output[output_len-1]='\0';
+		}
+	}
+	else
+	{
+		output=g_strdup("");
+	}
+	
+	g_hash_table_remove(GLOBAL_SHELL_COMMAND_RUNNING,run->key);
+	
+	for(guint i=0;i<run->waiters->len;i++)
+	{
+		ShellCommandWaiter *waiter=&g_array_index(run->waiters,ShellCommandWaiter,i);
+		waiter->callback(run->command,output,waiter->user_data);
+	}
+	
+	if(successful)
+	{
+		ShellCommandResult *result=g_new0(ShellCommandResult,1);
+		result->output=output;
+		result->expires=g_get_monotonic_time()+SHELL_COMMAND_CACHE_TTL_USEC;
+		
+		g_hash_table_replace(GLOBAL_SHELL_COMMAND_CACHE,g_strdup(run->key),result);
+	}
+	else
+	{
+		g_free(output);
+	}
+	
+	shell_command_run_free(run);
+}
+
+static void on_shell_command_done(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	ShellCommandRun *run=user_data;
+	g_autoptr(GError) error=NULL;
+	char *output=NULL;
+	
+	gboolean successful=g_subprocess_communicate_utf8_finish(G_SUBPROCESS(source),res,&output,NULL,&error);
+	
+	if(!successful)
+	{
+		fprintf(stderr,"%s:%d Command [%s] failed: %s\n",__FILE__,__LINE__,run->command,error->message);
+		g_clear_pointer(&output,g_free);
+	}
+	else if(!g_subprocess_get_successful(G_SUBPROCESS(source)))
+	{
+		//what it printed is still shown, but it runs again next time
+		successful=FALSE;
+	}
+	
+	finish_shell_command(run,output,successful);
+}
+
+static gboolean on_shell_command_timeout(gpointer user_data)
+{
+	ShellCommandRun *run=user_data;
+	
+	run->timeout_id=0;
+	
+	g_cancellable_cancel(run->cancellable);
+	g_subprocess_force_exit(run->process);
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Runs command with /bin/sh in cwd without blocking. Commands that are cached or
+	already running are not started again. callback is called from the main loop, or before
+	this returns if the command could not be started.
+*/
+int run_shell_command_async(const char *command, const char *cwd, ShellCommandFunc callback, gpointer user_data)
+{
+	g_autofree char *key=get_shell_command_key(command,cwd);
+	ShellCommandWaiter waiter={callback,user_data};
+	
+	ShellCommandRun *run=g_hash_table_lookup(GLOBAL_SHELL_COMMAND_RUNNING,key);
+	
+	if(run)
+	{
+		if(callback)
+		{
+			g_array_append_val(run->waiters,waiter);
+		}
+		return 0;
+	}
+	
+	run=g_new0(ShellCommandRun,1);
+	run->key=g_steal_pointer(&key);
+	run->command=g_strdup(command);
+	run->cancellable=g_cancellable_new();
+	run->waiters=g_array_new(FALSE,FALSE,sizeof(ShellCommandWaiter));
+	
+	if(callback)
+	{
+		g_array_append_val(run->waiters,waiter);
+	}
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GSubprocessLauncher) launcher=g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_STDOUT_PIPE|G_SUBPROCESS_FLAGS_STDERR_SILENCE);
+	
+	if(cwd)
+	{
+		g_subprocess_launcher_set_cwd(launcher,cwd);
+	}
+	
+	const char *argv[]={"/bin/sh","-c",command,NULL};
+	run->process=g_subprocess_launcher_spawnv(launcher,argv,&error);
+	
+	g_hash_table_insert(GLOBAL_SHELL_COMMAND_RUNNING,run->key,run);
+	
+	if(!run->process)
+	{
+		fprintf(stderr,"%s:%d Could not run [%s]: %s\n",__FILE__,__LINE__,command,error->message);
+		finish_shell_command(run,NULL,FALSE);
+		return -1;
+	}
+	
+	run->timeout_id=g_timeout_add(SHELL_COMMAND_TIMEOUT_MS,on_shell_command_timeout,run);
+	g_subprocess_communicate_utf8_async(run->process,NULL,run->cancellable,on_shell_command_done,run);
+	
+	return 0;
+}
+
+static void on_shell_command_sync_done(const char *command, const char *output, gpointer user_data)
+{
+	gboolean *done=user_data;
+	
+	g_free(GLOBAL_SHELL_COMMAND_SYNC_OUTPUT);
+	GLOBAL_SHELL_COMMAND_SYNC_OUTPUT=g_strdup(output);
+	*done=TRUE;
+}
+
+/**
+	Runs the command and waits for it, for tools without an editor to keep responsive.
+	The output of a failed run is only valid until the next call.
+*/
+const char *run_shell_command_sync(const char *command, const char *cwd)
+{
+	const char *output=lookup_shell_command(command,cwd);
+	
+	if(output)
+	{
+		return output;
+	}
+	
+	gboolean done=FALSE;
+	
+	run_shell_command_async(command,cwd,on_shell_command_sync_done,&done);
+	
+	while(!done)
+	{
+		g_main_context_iteration(NULL,TRUE);
+	}
+	
+	output=lookup_shell_command(command,cwd);
+	
+	return output?output:GLOBAL_SHELL_COMMAND_SYNC_OUTPUT;
+}
+
+/**
+	Bytes held by the cached outputs, for the memory report.
+*/
+size_t get_shell_command_cache_memory()
+{
+	if(!GLOBAL_SHELL_COMMAND_CACHE)
+	{
+		return 0;
+	}
+	
+	size_t bytes=0;
+	
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init(&iter,GLOBAL_SHELL_COMMAND_CACHE);
+	
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		ShellCommandResult *result=value;
+		bytes+=strlen(key)+1+sizeof(ShellCommandResult)+strlen(result->output)+1;
+	}
+	
+	return bytes;
+}
@@ -0,0 +1,42 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_COMMAND_TIMEOUT_MS 2000
+#define SHELL_COMMAND_CACHE_TTL_USEC (30*G_USEC_PER_SEC)
+
+/**
+	Called once the command is done. output is empty if it could not run or timed out, a non-zero exit keeps what it printed.
+*/
+typedef void (*ShellCommandFunc)(const char *command, const char *output, gpointer user_data);
+
+int shell_commands_init();
+int shell_commands_finalize();
+
+const char *lookup_shell_command(const char *command, const char *cwd);
+int run_shell_command_async(const char *command, const char *cwd, ShellCommandFunc callback, gpointer user_data);
+const char *run_shell_command_sync(const char *command, const char *cwd);
+size_t get_shell_command_cache_memory();
+
+G_END_DECLS
@@ -0,0 +1,368 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <string.h>
+
+#include "gedit-snippets-stops.h"
+
+SnippetStops *snippet_stops_new()
+{
+	SnippetStops *self=g_new0(SnippetStops,1);
+	self->stops=g_array_new(FALSE,FALSE,sizeof(SnippetStop));
+	self->endpoint_stops=g_array_new(FALSE,FALSE,sizeof(guint));
+	self->positions=g_array_new(FALSE,FALSE,sizeof(gint64));
+	self->active=SNIPPET_STOP_NONE;
+	self->open=SNIPPET_STOP_NONE;
+	
+	return self;
+}
+
+void snippet_stops_free(SnippetStops *self)
+{
+	if(!self)
+	{
+		return;
+	}
+	
+	g_array_unref(self->stops);
+	g_array_unref(self->endpoint_stops);
+	
+	if(self->positions)
+	{
+		g_array_unref(self->positions);
+	}
+	
+	g_free(self->max);
+	g_free(self->add);
+	g_free(self->assign);
+	g_free(self);
+}
+
+static void add_endpoint(SnippetStops *self, guint stop, gint64 position)
+{
+	g_array_append_val(self->endpoint_stops,stop);
+	g_array_append_val(self->positions,position);
+}
+
+/**
+	Starts a stop at position, inside the stop begun last that is not ended yet.
+	Stops have to be begun in the order they appear in the text.
+*/
+guint snippet_stops_begin(SnippetStops *self, long long id, gint64 position)
+{
+	SnippetStop stop={id,self->open,self->endpoint_stops->len,0,FALSE};
+	const guint index=self->stops->len;
+	
+	g_array_append_val(self->stops,stop);
+	add_endpoint(self,index,position);
+	
+	self->open=index;
+	
+	return index;
+}
+
+int snippet_stops_end(SnippetStops *self, guint stop, gint64 position)
+{
+	SnippetStop *ended=&g_array_index(self->stops,SnippetStop,stop);
+	ended->end_endpoint=self->endpoint_stops->len;
+	
+	add_endpoint(self,stop,position);
+	
+	self->open=ended->parent;
+	
+	return 0;
+}
+
+static void apply_tag(SnippetStops *self, guint node, gint64 assign, gint64 add)
+{
+	if(assign>=0)
+	{
+		self->max[node]=assign+add;
+		self->assign[node]=assign;
+		self->add[node]=add;
+	}
+	else
+	{
+		self->max[node]+=add;
+		self->add[node]+=add;
+	}
+}
+
+static void push_tag(SnippetStops *self, guint node)
+{
+	if(self->assign[node]>=0 || self->add[node]!=0)
+	{
+		apply_tag(self,node*2,self->assign[node],self->add[node]);
+		apply_tag(self,node*2+1,self->assign[node],self->add[node]);
+		
+		self->assign[node]=-1;
+		self->add[node]=0;
+	}
+}
+
+static void build_node(SnippetStops *self, guint node, guint low, guint high)
+{
+	self->assign[node]=-1;
+	self->add[node]=0;
+	
+	if(low==high)
+	{
+		self->max[node]=g_array_index(self->positions,gint64,low);
+		return;
+	}
+	
+	const guint middle=(low+high)/2;
+	build_node(self,node*2,low,middle);
+	build_node(self,node*2+1,middle+1,high);
+	
+	self->max[node]=self->max[node*2+1];
+}
+
+/**
+	Builds the tree once all stops are ended, offset is added to every position.
+*/
+int snippet_stops_build(SnippetStops *self, gint64 offset)
+{
+	self->size=self->endpoint_stops->len;
+	
+	if(self->size==0)
+	{
+		return -1;
+	}
+	
+	for(guint i=0;i<self->size;i++)
+	{
+		g_array_index(self->positions,gint64,i)+=offset;
+	}
+	
+	self->max=g_new(gint64,self->size*4);
+	self->add=g_new(gint64,self->size*4);
+	self->assign=g_new(gint64,self->size*4);
+	
+	build_node(self,1,0,self->size-1);
+	
+	g_clear_pointer(&self->positions,g_array_unref);
+	
+	return 0;
+}
+
+static void update_range(SnippetStops *self, guint node, guint low, guint high, guint from, guint to, gint64 assign, gint64 add)
+{
+	if(to<low || high<from)
+	{
+		return;
+	}
+	
+	if(from<=low && high<=to)
+	{
+		apply_tag(self,node,assign,add);
+		return;
+	}
+	
+	push_tag(self,node);
+	
+	const guint middle=(low+high)/2;
+	update_range(self,node*2,low,middle,from,to,assign,add);
+	update_range(self,node*2+1,middle+1,high,from,to,assign,add);
+	
+	self->max[node]=self->max[node*2+1];
+}
+
+static gint64 get_endpoint_position(SnippetStops *self, guint endpoint)
+{
+	guint node=1, low=0, high=self->size-1;
+	
+	while(low<high)
+	{
+		push_tag(self,node);
+		
+		const guint middle=(low+high)/2;
+		
+		if(endpoint<=middle)
+		{
+			node=node*2;
+			high=middle;
+		}
+		else
+		{
+			node=node*2+1;
+			low=middle+1;
+		}
+	}
+	
+	return self->max[node];
+}
+
+//first endpoint at position or behind it, or size. strictly behind when after is set
+static guint find_endpoint(SnippetStops *self, gint64 position, gboolean after)
+{
+	if(after?self->max[1]<=position:self->max[1]<position)
+	{
+		return self->size;
+	}
+	
+	guint node=1, low=0, high=self->size-1;
+	
+	while(low<high)
+	{
+		push_tag(self,node);
+		
+		const guint middle=(low+high)/2;
+		const gint64 left_max=self->max[node*2];
+		
+		if(after?left_max>position:left_max>=position)
+		{
+			node=node*2;
+			high=middle;
+		}
+		else
+		{
+			node=node*2+1;
+			low=middle+1;
+		}
+	}
+	
+	return low;
+}
+
+static gboolean is_end_endpoint(SnippetStops *self, guint endpoint)
+{
+	const guint stop=g_array_index(self->endpoint_stops,guint,endpoint);
+	
+	return g_array_index(self->stops,SnippetStop,stop).end_endpoint==endpoint;
+}
+
+/**
+	Moves the ranges for len characters inserted at position. Text typed where ranges meet
+	goes into the active stop, at its start or at its end. Elsewhere it extends the ranges
+	that end there, and the ones that start there move.
+*/
+int snippet_stops_insert(SnippetStops *self, gint64 position, gint64 len)
+{
+	if(self->size==0 || len<=0)
+	{
+		return 0;
+	}
+	
+	const guint first=find_endpoint(self,position,FALSE);
+	const guint last=find_endpoint(self,position,TRUE);
+	guint split=last;
+	
+	const SnippetStop *active=self->active!=SNIPPET_STOP_NONE?snippet_stops_get(self,self->active):NULL;
+	
+	if(active && active->start_endpoint>=first && active->start_endpoint<last)
+	{
+		split=active->start_endpoint+1;
+	}
+	else if(active && active->end_endpoint>=first && active->end_endpoint<last)
+	{
+		split=active->end_endpoint;
+	}
+	else
+	{
+		for(guint i=first;i<last;i++)
+		{
+			if(is_end_endpoint(self,i))
+			{
+				split=i;
+				break;
+			}
+		}
+	}
+	
+	if(split<self->size)
+	{
+		update_range(self,1,0,self->size-1,split,self->size-1,-1,len);
+	}
+	
+	return 0;
+}
+
+/**
+	Moves the ranges for the characters from start to end being deleted. The stops inside
+	the active one that were entirely in the deleted text are removed, so replacing a
+	default also drops the placeholders it held.
+*/
+int snippet_stops_delete(SnippetStops *self, gint64 start, gint64 end)
+{
+	if(self->size==0 || end<=start)
+	{
+		return 0;
+	}
+	
+	const guint inside=find_endpoint(self,start,TRUE);
+	const guint behind=find_endpoint(self,end,FALSE);
+	
+	if(self->active!=SNIPPET_STOP_NONE)
+	{
+		const SnippetStop *active=snippet_stops_get(self,self->active);
+		const guint last=find_endpoint(self,end,TRUE);
+		
+		for(guint i=find_endpoint(self,start,FALSE);i<last;i++)
+		{
+			SnippetStop *stop=snippet_stops_get(self,g_array_index(self->endpoint_stops,guint,i));
+			
+			//descendants of the active stop lie between its endpoints
+			if(stop->start_endpoint==i && i>active->start_endpoint && stop->end_endpoint<active->end_endpoint &&
+				get_endpoint_position(self,stop->end_endpoint)<=end)
+			{
+				stop->removed=TRUE;
+			}
+		}
+	}
+	
+	if(inside<behind)
+	{
+		update_range(self,1,0,self->size-1,inside,behind-1,start,0);
+	}
+	
+	if(behind<self->size)
+	{
+		update_range(self,1,0,self->size-1,behind,self->size-1,-1,start-end);
+	}
+	
+	return 0;
+}
+
+SnippetStop *snippet_stops_get(SnippetStops *self, guint stop)
+{
+	return &g_array_index(self->stops,SnippetStop,stop);
+}
+
+int snippet_stops_get_range(SnippetStops *self, guint stop, gint64 *start, gint64 *end)
+{
+	const SnippetStop *found=snippet_stops_get(self,stop);
+	
+	*start=get_endpoint_position(self,found->start_endpoint);
+	*end=get_endpoint_position(self,found->end_endpoint);
+	
+	return 0;
+}
+
+size_t snippet_stops_get_memory(SnippetStops *self)
+{
+	if(!self)
+	{
+		return 0;
+	}
+	
+	return sizeof(SnippetStops)+self->stops->len*sizeof(SnippetStop)+self->endpoint_stops->len*sizeof(guint)+
+		(self->positions?self->positions->len*sizeof(gint64):0)+(size_t)self->size*4*3*sizeof(gint64);
+}
@@ -0,0 +1,73 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#define SNIPPET_STOP_NONE G_MAXUINT
+
+/**
+	One placeholder of an expanded snippet, $N or ${N:default}. The placeholders in its
+	default are its children, and come right after it.
+*/
+typedef struct SnippetStop
+{
+	long long id; ///< N, negative for the whole snippet
+	guint parent; ///< the stop whose default holds it, or SNIPPET_STOP_NONE
+	guint start_endpoint; ///< index into the endpoints
+	guint end_endpoint; ///< after the end endpoints of its children
+	gboolean removed; ///< the default it was in got replaced
+}SnippetStop;
+
+/**
+	The ranges of the stops in the buffer while a snippet is edited. The endpoints are kept in
+	text order in a segment tree, which stays sorted under edits, so an insertion or deletion
+	moves all ranges behind it in O(log n) and a range is looked up in O(log n).
+*/
+typedef struct SnippetStops
+{
+	GArray *stops; ///< SnippetStop, in the order they start
+	GArray *endpoint_stops; ///< guint, the stop each endpoint belongs to
+	GArray *positions; ///< gint64 per endpoint, only until snippet_stops_build
+	gint64 *max; ///< per tree node, the position of its last endpoint
+	gint64 *add; ///< pending shift of the node
+	gint64 *assign; ///< pending position of the whole node, -1 when there is none
+	guint size; ///< number of endpoints
+	guint active; ///< the stop being edited, its edits stay inside of it
+	guint open; ///< innermost stop begun and not ended yet, while building
+}SnippetStops;
+
+SnippetStops *snippet_stops_new();
+void snippet_stops_free(SnippetStops *self);
+
+guint snippet_stops_begin(SnippetStops *self, long long id, gint64 position);
+int snippet_stops_end(SnippetStops *self, guint stop, gint64 position);
+int snippet_stops_build(SnippetStops *self, gint64 offset);
+
+int snippet_stops_insert(SnippetStops *self, gint64 position, gint64 len);
+int snippet_stops_delete(SnippetStops *self, gint64 start, gint64 end);
+
+SnippetStop *snippet_stops_get(SnippetStops *self, guint stop);
+int snippet_stops_get_range(SnippetStops *self, guint stop, gint64 *start, gint64 *end);
+size_t snippet_stops_get_memory(SnippetStops *self);
+
+G_END_DECLS
@@ -0,0 +1,1292 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-expression.h"
+#include "gedit-snippets-python-handling.h"
+#include "gedit-snippets-variables.h"
+
+//define once
+GRegex *GLOBAL_REGEX_FIND_VARIABLES=NULL;
+GRegex *GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES=NULL;
+GHashTable *GLOBAL_TRANSFORM_CACHE=NULL;
+GHashTable *GLOBAL_EXPRESSION_CACHE=NULL;
+GHashTable *GLOBAL_PLACEHOLDER_CACHE=NULL;
+static guint GLOBAL_PLACEHOLDER_GENERATION=0; ///< the GLOBAL_SNIPPETS_GENERATION GLOBAL_PLACEHOLDER_CACHE was filled in
+
+//per thread, so the preview renders on a worker with its own hooks while the editor keeps using its own on the main thread
+static _Thread_local SnippetCommandFunc GLOBAL_TEMPLATE_COMMAND_FUNC=NULL;
+static _Thread_local gpointer GLOBAL_TEMPLATE_COMMAND_DATA=NULL;
+static _Thread_local SnippetVariableFunc GLOBAL_TEMPLATE_VARIABLE_FUNC=NULL;
+static _Thread_local gpointer GLOBAL_TEMPLATE_VARIABLE_DATA=NULL;
+static _Thread_local SnippetErrorFunc GLOBAL_TEMPLATE_ERROR_FUNC=NULL;
+static _Thread_local gpointer GLOBAL_TEMPLATE_ERROR_DATA=NULL;
+
+//what the renders of a thread compile between template_begin_uncached and template_end_uncached
+static _Thread_local GHashTable *GLOBAL_UNCACHED_TRANSFORMS=NULL;
+static _Thread_local GHashTable *GLOBAL_UNCACHED_EXPRESSIONS=NULL;
+static _Thread_local GHashTable *GLOBAL_UNCACHED_PLACEHOLDERS=NULL;
+
+typedef struct SnippetTransform
+{
+	GRegex *regex;
+	char *format;
+	gboolean global; ///< the g flag, replace every match and not only the first
+}SnippetTransform;
+
+typedef enum TransformCase
+{
+	TRANSFORM_CASE_NONE=0,
+	TRANSFORM_CASE_UPPER,
+	TRANSFORM_CASE_LOWER
+}TransformCase;
+
+typedef struct TransformCaseState
+{
+	TransformCase next; ///< \u and \l, only the next character
+	TransformCase mode; ///< \U and \L, until \E
+}TransformCaseState;
+
+static void snippet_transform_free(SnippetTransform *self)
+{
+	if(!self)
+	{
+		return;
+	}
+	
+	g_regex_unref(self->regex);
+	g_free(self->format);
+	g_free(self);
+}
+
+static void snippet_placeholder_free(SnippetPlaceholder *self)
+{
+	g_free(self->match);
+	g_free(self->default_text);
+	
+	if(self->children)
+	{
+		g_ptr_array_unref(self->children);
+	}
+	
+	g_free(self);
+}
+
+int template_init()
+{
+	if(GLOBAL_REGEX_FIND_VARIABLES)
+	{
+		return 0;
+	}
+	
+	GError *error = NULL;
+	
+	//${...} may hold any balanced braces, for nested placeholders and the ${N:/upcase} of transformations, and $(...) one level of parentheses
+	const char *pattern = "\\$([0-9]+|<[^>]*>|(\\{(?:[^{}]|(?2))*\\})|{[^}]*}|\\((?:[^()]|\\([^()]*\\))*\\)|GEDIT_[A-Z_]+)";
+	
+	GLOBAL_REGEX_FIND_VARIABLES = g_regex_new(pattern, G_REGEX_EXTENDED, 0, &error);
+	
+	if (!GLOBAL_REGEX_FIND_VARIABLES)
+	{
+		fprintf(stderr, "Regex compilation failed: %s\n", error->message);
+		g_error_free(error);
+		return -1;
+	}
+	
+	GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES = g_regex_new("\\$([0-9]+)", G_REGEX_EXTENDED, 0, &error);
+	
+	if (!GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES)
+	{
+		fprintf(stderr, "Regex compilation failed: %s\n", error->message);
+		g_error_free(error);
+		return -1;
+	}
+	
+	GLOBAL_TRANSFORM_CACHE = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)snippet_transform_free);
+	GLOBAL_EXPRESSION_CACHE = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)snippet_expression_free);
+	GLOBAL_PLACEHOLDER_CACHE = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+	
+	return 0;
+}
+
+int template_finalize()
+{
+	g_clear_pointer(&GLOBAL_REGEX_FIND_VARIABLES,g_regex_unref);
+	g_clear_pointer(&GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES,g_regex_unref);
+	g_clear_pointer(&GLOBAL_TRANSFORM_CACHE,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_EXPRESSION_CACHE,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_PLACEHOLDER_CACHE,g_hash_table_destroy);
+	
+	return 0;
+}
+
+/**
+	Until template_end_uncached, what the renders of the calling thread compile is kept apart and
+	dropped at the end, for one-off renders like the preview that should not grow the caches.
+*/
+int template_begin_uncached()
+{
+	if(GLOBAL_UNCACHED_TRANSFORMS)
+	{
+		return 0;
+	}
+	
+	GLOBAL_UNCACHED_TRANSFORMS = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)snippet_transform_free);
+	GLOBAL_UNCACHED_EXPRESSIONS = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)snippet_expression_free);
+	GLOBAL_UNCACHED_PLACEHOLDERS = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+	
+	return snippet_python_begin_uncached();
+}
+
+int template_end_uncached()
+{
+	g_clear_pointer(&GLOBAL_UNCACHED_TRANSFORMS,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_UNCACHED_EXPRESSIONS,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_UNCACHED_PLACEHOLDERS,g_hash_table_destroy);
+	
+	return snippet_python_end_uncached();
+}
+
+/**
+	Sets where the output of $(command) comes from for the renders of the calling thread.
+	Without one, the commands render as nothing.
+*/
+int template_set_command_func(SnippetCommandFunc func, gpointer user_data)
+{
+	GLOBAL_TEMPLATE_COMMAND_FUNC=func;
+	GLOBAL_TEMPLATE_COMMAND_DATA=user_data;
+	
+	return 0;
+}
+
+/**
+	Sets where the values of $GEDIT_NAME come from for the renders of the calling thread.
+	Without one, they render as nothing.
+*/
+int template_set_variable_func(SnippetVariableFunc func, gpointer user_data)
+{
+	GLOBAL_TEMPLATE_VARIABLE_FUNC=func;
+	GLOBAL_TEMPLATE_VARIABLE_DATA=user_data;
+	
+	return 0;
+}
+
+SnippetCommandFunc template_get_command_func(gpointer *user_data)
+{
+	*user_data=GLOBAL_TEMPLATE_COMMAND_DATA;
+	
+	return GLOBAL_TEMPLATE_COMMAND_FUNC;
+}
+
+SnippetVariableFunc template_get_variable_func(gpointer *user_data)
+{
+	*user_data=GLOBAL_TEMPLATE_VARIABLE_DATA;
+	
+	return GLOBAL_TEMPLATE_VARIABLE_FUNC;
+}
+
+/**
+	Sets who hears about the problems of the renders of the calling thread, besides stderr.
+*/
+int template_set_error_func(SnippetErrorFunc func, gpointer user_data)
+{
+	GLOBAL_TEMPLATE_ERROR_FUNC=func;
+	GLOBAL_TEMPLATE_ERROR_DATA=user_data;
+	
+	return 0;
+}
+
+static void report_template_error(const char *format, ...) G_GNUC_PRINTF(1,2);
+
+static void report_template_error(const char *format, ...)
+{
+	va_list args;
+	va_start(args,format);
+	g_autofree char *message=g_strdup_vprintf(format,args);
+	va_end(args);
+	
+	fprintf(stderr,"%s:%d %s\n",__FILE__,__LINE__,message);
+	
+	if(GLOBAL_TEMPLATE_ERROR_FUNC)
+	{
+		GLOBAL_TEMPLATE_ERROR_FUNC(message,GLOBAL_TEMPLATE_ERROR_DATA);
+	}
+}
+
+/**
+	Returns the SnippetVariable of a $GEDIT_NAME or ${GEDIT_NAME} match, or -1.
+*/
+int get_match_variable(const char *match)
+{
+	const char *name=match[1]=='{'?match+2:match+1;
+	const size_t name_len=strspn(name,"ABCDEFGHIJKLMNOPQRSTUVWXYZ_");
+	
+	//${GEDIT_NAME} has nothing after the name
+	if(match[1]=='{' && name[name_len]!='}')
+	{
+		return -1;
+	}
+	
+	return get_snippet_variable(name,name_len);
+}
+
+/**
+	Points body at the text of match between its prefix_len first bytes and the closing
+	character, like "i" in "${1:i}" with prefix "${1:" and '}'. Returns the length of the
+	body, or -1 when match is too short or does not end with closer.
+*/
+gssize get_match_body(const char *match, size_t prefix_len, char closer, const char **body)
+{
+	const size_t match_len=strlen(match);
+	
+	if(match_len<prefix_len+1 || match[match_len-1]!=closer)
+	{
+		return -1;
+	}
+	
+	*body=match+prefix_len;
+	
+	return match_len-prefix_len-1;
+}
+
+/**
+	Returns the command of a $(command) match, NULL for any other match.
+*/
+char *get_match_command(const char *match)
+{
+	const char *command=NULL;
+	const gssize command_len=match[0]=='$' && match[1]=='('?get_match_body(match,2,')',&command):-1;
+	
+	return command_len>=0?g_strndup(command,command_len):NULL;
+}
+
+//the placeholders of text, and of the defaults in it, found with GLOBAL_REGEX_FIND_VARIABLES
+static GPtrArray *parse_snippet_placeholders(const char *text)
+{
+	g_autoptr(GMatchInfo) match_info=NULL;
+	GPtrArray *placeholders=g_ptr_array_new_with_free_func((GDestroyNotify)snippet_placeholder_free);
+	
+	g_regex_match(GLOBAL_REGEX_FIND_VARIABLES, text, 0, &match_info);
+	
+	while (g_match_info_matches(match_info))
+	{
+		gint start, end;
+		g_match_info_fetch_pos(match_info, 0, &start, &end);
+		
+		SnippetPlaceholder *placeholder=g_new0(SnippetPlaceholder,1);
+		placeholder->match=g_match_info_fetch(match_info, 0);
+		placeholder->start=start;
+		placeholder->end=end;
+		
+		const char *match=placeholder->match;
+		
+		if(match[1]=='{' && g_ascii_isdigit(match[2]))
+		{
+			const char *id_end=match+2+strspn(match+2,"0123456789");
+			const char *body=NULL;
+			const gssize body_len=*id_end==':'?get_match_body(match,id_end-match+1,'}',&body):-1;
+			
+			if(body_len>=0)
+			{
+				placeholder->default_text=g_strndup(body,body_len);
+				
+				if(strchr(placeholder->default_text,'$'))
+				{
+					placeholder->children=parse_snippet_placeholders(placeholder->default_text);
+				}
+			}
+		}
+		
+		g_ptr_array_add(placeholders,placeholder);
+		g_match_info_next(match_info, NULL);
+	}
+	
+	return placeholders;
+}
+
+/**
+	Returns the placeholder tree of a snippet text, parsed the first time the text is seen, so
+	expanding, finalizing and compiling a snippet again does not go over its text again.
+	Owned by the cache, which is emptied when the snippets are reloaded or change, see
+	mark_snippets_changed, so the texts of the previous ones do not pile up.
+*/
+GPtrArray *get_snippet_placeholders(const char *insertion)
+{
+	GHashTable *cache=GLOBAL_UNCACHED_PLACEHOLDERS?GLOBAL_UNCACHED_PLACEHOLDERS:GLOBAL_PLACEHOLDER_CACHE;
+	
+	if(cache==GLOBAL_PLACEHOLDER_CACHE && GLOBAL_PLACEHOLDER_GENERATION!=GLOBAL_SNIPPETS_GENERATION)
+	{
+		g_hash_table_remove_all(cache);
+		GLOBAL_PLACEHOLDER_GENERATION=GLOBAL_SNIPPETS_GENERATION;
+	}
+	
+	GPtrArray *placeholders=g_hash_table_lookup(cache,insertion);
+	
+	if(!placeholders)
+	{
+		placeholders=parse_snippet_placeholders(insertion);
+		g_hash_table_insert(cache,g_strdup(insertion),placeholders);
+	}
+	
+	return placeholders;
+}
+
+/**
+	Drops the placeholder tree of a text that no snippet has anymore, like the old text of one
+	edited in the manager.
+*/
+int template_forget_placeholders(const char *insertion)
+{
+	if(GLOBAL_PLACEHOLDER_CACHE)
+	{
+		g_hash_table_remove(GLOBAL_PLACEHOLDER_CACHE,insertion);
+	}
+	
+	return 0;
+}
+
+int gstring_append_reformatted_dollar_string(GString *includes, const char *const dinsertion, SnippetValueFunc get_value, gpointer user_data)
+{
+	g_autoptr(GMatchInfo) match_dollar_info=NULL;
+
+	//Analyze the input
+	if (g_regex_match(GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES, dinsertion, 0, &match_dollar_info))
+	{
+		const char *dcursor = dinsertion;
+		while (g_match_info_matches(match_dollar_info))
+		{
+			g_autofree char *dmatch = g_match_info_fetch(match_dollar_info, 1);
+			gint dstart, dend;
+			g_match_info_fetch_pos(match_dollar_info, 0, &dstart, &dend);
+			
+			size_t dcursor_len=dstart - (dcursor - dinsertion);
+			
+			g_string_append_len(includes,dcursor,dcursor_len);
+			
+			long long did_num=g_ascii_strtoll(dmatch,NULL,10);
+			
+			const char *value = get_value(did_num, user_data);
+			
+			if(value)
+			{
+				g_string_append(includes,"'");
+				g_string_append(includes,value);
+				g_string_append(includes,"'");
+			}
+			
+			dcursor = dinsertion + dend;
+			g_match_info_next(match_dollar_info, NULL);
+		}
+		
+		if (*dcursor)
+		{
+			g_string_append(includes,dcursor);
+		}
+		
+//		fprintf(stdout,"%s:%d INCLUDES [%s]\n",__FILE__,__LINE__,includes->str);
+	}
+	
+	return 0;
+}
+
+//value as a python string literal, NULL as ''
+static void append_python_string(GString *out, const char *value)
+{
+	g_string_append_c(out,'\'');
+	
+	for(const char *p=value?value:"";*p;p++)
+	{
+		if(*p=='\\' || *p=='\'')
+		{
+			g_string_append_c(out,'\\');
+			g_string_append_c(out,*p);
+		}
+		else if(*p=='\n')
+		{
+			g_string_append(out,"\\n");
+		}
+		else if(*p=='\r')
+		{
+			g_string_append(out,"\\r");
+		}
+		else
+		{
+			g_string_append_c(out,*p);
+		}
+	}
+	
+	g_string_append_c(out,'\'');
+}
+
+/**
+	The return code of a python block with every $N replaced by the variable _snippet_stop_N.
+	The code stays the same whatever the stops hold, so it is compiled once. When assignments
+	is not NULL, the python that sets those variables to the text of the stops is appended to
+	it, to run with the includes. Free with g_free.
+*/
+char *get_python_block_code(const char *return_code, GString *assignments, SnippetValueFunc get_value, gpointer user_data)
+{
+	g_autoptr(GMatchInfo) match_info=NULL;
+	GString *code=g_string_sized_new(strlen(return_code)+16);
+	const char *cursor=return_code;
+	
+	g_regex_match(GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES,return_code,0,&match_info);
+	
+	while(g_match_info_matches(match_info))
+	{
+		gint start, end;
+		g_match_info_fetch_pos(match_info,0,&start,&end);
+		
+		const long long id_num=g_ascii_strtoll(return_code+start+1,NULL,10);
+		
+		g_string_append_len(code,cursor,return_code+start-cursor);
+		g_string_append_printf(code,"_snippet_stop_%lld",id_num);
+		
+		if(assignments)
+		{
+			g_string_append_printf(assignments,"\n_snippet_stop_%lld=",id_num);
+			append_python_string(assignments,get_value(id_num,user_data));
+			g_string_append_c(assignments,'\n');
+		}
+		
+		cursor=return_code+end;
+		g_match_info_next(match_info,NULL);
+	}
+	
+	g_string_append(code,cursor);
+	
+	return g_string_free(code,FALSE);
+}
+
+//splits at the next '/' that is not escaped or inside braces, \/ becomes / when unescape is set
+static const char *read_transform_part(GString *out, const char *p, gboolean unescape)
+{
+	int braces=0;
+	
+	while(*p && (*p!='/' || braces>0))
+	{
+		if(*p=='\\' && p[1]!='\0')
+		{
+			if(!unescape || p[1]!='/')
+			{
+				g_string_append_c(out,*p);
+			}
+			p++;
+		}
+		else if(*p=='{')
+		{
+			braces++;
+		}
+		else if(*p=='}' && braces>0)
+		{
+			braces--;
+		}
+		
+		g_string_append_c(out,*p);
+		p++;
+	}
+	
+	return p;
+}
+
+//compiles the regex of "regex/format/flags" and puts the format in format
+static GRegex *compile_snippet_transform(const char *source, GString *format, gboolean *global, GError **error)
+{
+	g_autoptr(GString) pattern=g_string_sized_new(strlen(source));
+	
+	const char *p=read_transform_part(pattern,source,TRUE);
+	
+	if(*p=='/')
+	{
+		p=read_transform_part(format,p+1,FALSE);
+	}
+	
+	if(*p=='/')
+	{
+		p++;
+	}
+	
+	GRegexCompileFlags compile_flags=G_REGEX_OPTIMIZE;
+	*global=FALSE;
+	
+	for(;*p;p++)
+	{
+		switch(*p)
+		{
+			case 'g':
+				*global=TRUE;
+				break;
+			case 'i':
+				compile_flags|=G_REGEX_CASELESS;
+				break;
+			case 'm':
+				compile_flags|=G_REGEX_MULTILINE;
+				break;
+			case 's':
+				compile_flags|=G_REGEX_DOTALL;
+				break;
+			case 'x':
+				compile_flags|=G_REGEX_EXTENDED;
+				break;
+		}
+	}
+	
+	return g_regex_new(pattern->str, compile_flags, 0, error);
+}
+
+/**
+	Returns the compiled form of "regex/format/flags", compiled the first time it is seen.
+	NULL if the regex does not compile, which is also remembered.
+*/
+static SnippetTransform *get_snippet_transform(const char *source, size_t source_len)
+{
+	GHashTable *cache=GLOBAL_UNCACHED_TRANSFORMS?GLOBAL_UNCACHED_TRANSFORMS:GLOBAL_TRANSFORM_CACHE;
+	g_autofree char *key=g_strndup(source,source_len);
+	gpointer cached=NULL;
+	
+	if(g_hash_table_lookup_extended(cache,key,NULL,&cached))
+	{
+		return cached;
+	}
+	
+	g_autoptr(GString) format=g_string_sized_new(source_len);
+	g_autoptr(GError) error=NULL;
+	gboolean global=FALSE;
+	GRegex *regex=compile_snippet_transform(key,format,&global,&error);
+	SnippetTransform *transform=NULL;
+	
+	if(regex)
+	{
+		transform=g_new0(SnippetTransform,1);
+		transform->regex=regex;
+		transform->format=g_string_free(g_steal_pointer(&format),FALSE);
+		transform->global=global;
+	}
+	else
+	{
+		fprintf(stderr,"%s:%d Could not compile the transformation [%s]: %s\n",__FILE__,__LINE__,key,error->message);
+	}
+	
+	g_hash_table_insert(cache,g_steal_pointer(&key),transform);
+	
+	return transform;
+}
+
+/**
+	Returns the native form of the code of a $<[N]: code> block, compiled the first time it is
+	seen. NULL when the block needs python, which is also remembered.
+*/
+static SnippetExpression *get_snippet_expression(const char *return_code)
+{
+	GHashTable *cache=GLOBAL_UNCACHED_EXPRESSIONS?GLOBAL_UNCACHED_EXPRESSIONS:GLOBAL_EXPRESSION_CACHE;
+	gpointer cached=NULL;
+	
+	if(g_hash_table_lookup_extended(cache,return_code,NULL,&cached))
+	{
+		return cached;
+	}
+	
+	SnippetExpression *expression=snippet_expression_compile(return_code);
+	g_hash_table_insert(cache,g_strdup(return_code),expression);
+	
+	return expression;
+}
+
+typedef struct ExpressionShadowing
+{
+	const char *language;
+	const char *includes;
+	gboolean shadowed;
+}ExpressionShadowing;
+
+static void check_expression_shadowing(const char *name, gpointer user_data)
+{
+	ExpressionShadowing *shadowing=user_data;
+	
+	shadowing->shadowed=shadowing->shadowed || python_may_define_name(shadowing->language,shadowing->includes,name);
+}
+
+/**
+	Whether the includes or the helpers of language may define a function the expression calls,
+	like camelcase, which python would call instead of the one of the evaluator.
+*/
+static gboolean is_snippet_expression_shadowed(SnippetExpression *expression, const char *language, const char *includes)
+{
+	ExpressionShadowing shadowing={language,includes,FALSE};
+	
+	snippet_expression_foreach_function(expression,check_expression_shadowing,&shadowing);
+	
+	return shadowing.shadowed;
+}
+
+/**
+	Compiles the regex of a "regex/format/flags" without caching it or printing anything, so
+	any thread can check a snippet. Returns NULL when it compiles, else why not. Free with g_free.
+*/
+char *check_snippet_transform(const char *source, size_t source_len)
+{
+	g_autofree char *key=g_strndup(source,source_len);
+	g_autoptr(GString) format=g_string_new(NULL);
+	g_autoptr(GError) error=NULL;
+	gboolean global=FALSE;
+	GRegex *regex=compile_snippet_transform(key,format,&global,&error);
+	
+	if(!regex)
+	{
+		return g_strdup(error->message);
+	}
+	
+	g_regex_unref(regex);
+	
+	return NULL;
+}
+
+static gunichar apply_case(gunichar c, TransformCase transform_case)
+{
+	switch(transform_case)
+	{
+		case TRANSFORM_CASE_UPPER:
+			return g_unichar_toupper(c);
+		case TRANSFORM_CASE_LOWER:
+			return g_unichar_tolower(c);
+		default:
+			return c;
+	}
+}
+
+static void append_cased(GString *out, const char *text, gssize text_len, TransformCaseState *case_state)
+{
+	const char *end=text_len<0?text+strlen(text):text+text_len;
+	
+	for(const char *p=text;p<end;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+		
+		if(case_state->next!=TRANSFORM_CASE_NONE)
+		{
+			c=apply_case(c,case_state->next);
+			case_state->next=TRANSFORM_CASE_NONE;
+		}
+		else
+		{
+			c=apply_case(c,case_state->mode);
+		}
+		
+		g_string_append_unichar(out,c);
+	}
+}
+
+//the ${N:/camelcase} and ${N:/pascalcase} of VS Code, words are runs of letters and digits
+void append_joined_words(GString *out, const char *text, gboolean first_upper)
+{
+	gboolean word_start=TRUE;
+	gboolean any_word=FALSE;
+	
+	for(const char *p=text;*p;p=g_utf8_next_char(p))
+	{
+		gunichar c=g_utf8_get_char(p);
+		
+		if(!g_unichar_isalnum(c))
+		{
+			word_start=TRUE;
+			continue;
+		}
+		
+		if(word_start)
+		{
+			c=(any_word || first_upper)?g_unichar_toupper(c):g_unichar_tolower(c);
+			word_start=FALSE;
+			any_word=TRUE;
+		}
+		
+		g_string_append_unichar(out,c);
+	}
+}
+
+static void append_group_modified(GString *out, const char *group, const char *modifier, size_t modifier_len, TransformCaseState *case_state)
+{
+	if(modifier_len==6 && strncmp(modifier,"upcase",6)==0)
+	{
+		TransformCaseState upper={TRANSFORM_CASE_NONE,TRANSFORM_CASE_UPPER};
+		append_cased(out,group,-1,&upper);
+	}
+	else if(modifier_len==8 && strncmp(modifier,"downcase",8)==0)
+	{
+		TransformCaseState lower={TRANSFORM_CASE_NONE,TRANSFORM_CASE_LOWER};
+		append_cased(out,group,-1,&lower);
+	}
+	else if(modifier_len==10 && strncmp(modifier,"capitalize",10)==0)
+	{
+		TransformCaseState capital={TRANSFORM_CASE_UPPER,TRANSFORM_CASE_NONE};
+		append_cased(out,group,-1,&capital);
+	}
+	else if(modifier_len==9 && strncmp(modifier,"camelcase",9)==0)
+	{
+		append_joined_words(out,group,FALSE);
+	}
+	else if(modifier_len==10 && strncmp(modifier,"pascalcase",10)==0)
+	{
+		append_joined_words(out,group,TRUE);
+	}
+	else
+	{
+		append_cased(out,group,-1,case_state);
+	}
+}
+
+static const char *expand_transform_format(GString *out, const char *p, const char *stop_chars, const GMatchInfo *match_info, TransformCaseState *case_state);
+
+//p points right after "${N", handles "}", ":/modifier}", ":+if}", ":?if:else}", ":-else}" and ":else}"
+static const char *expand_braced_group(GString *out, const char *p, const char *group, const GMatchInfo *match_info, TransformCaseState *case_state)
+{
+	const gboolean has_group=group && group[0]!='\0';
+	
+	if(*p==':')
+	{
+		p++;
+		
+		if(*p=='/')
+		{
+			const char *modifier=p+1;
+			const size_t modifier_len=strcspn(modifier,"}");
+			
+			append_group_modified(out,has_group?group:"",modifier,modifier_len,case_state);
+			p=modifier+modifier_len;
+		}
+		else
+		{
+			g_autoptr(GString) if_text=g_string_new(NULL);
+			g_autoptr(GString) else_text=g_string_new(NULL);
+			TransformCaseState branch_state=*case_state;
+			
+			if(*p=='+')
+			{
+				p=expand_transform_format(if_text,p+1,"}",match_info,&branch_state);
+				g_string_append(out,has_group?if_text->str:"");
+			}
+			else if(*p=='?')
+			{
+				p=expand_transform_format(if_text,p+1,":}",match_info,&branch_state);
+				
+				if(*p==':')
+				{
+					branch_state=*case_state;
+					p=expand_transform_format(else_text,p+1,"}",match_info,&branch_state);
+				}
+				
+				g_string_append(out,has_group?if_text->str:else_text->str);
+			}
+			else
+			{
+				p=expand_transform_format(else_text,*p=='-'?p+1:p,"}",match_info,&branch_state);
+				
+				if(has_group)
+				{
+					append_cased(out,group,-1,case_state);
+				}
+				else
+				{
+					g_string_append(out,else_text->str);
+				}
+			}
+		}
+	}
+	else if(has_group)
+	{
+		append_cased(out,group,-1,case_state);
+	}
+	
+	while(*p && *p!='}')
+	{
+		p++;
+	}
+	
+	return *p?p+1:p;
+}
+
+/**
+	Expands the format of a transformation for one match: $N, ${N}, ${N:...},
+	the TextMate (?N:if:else) conditionals and the \u \l \U \L \E case changes.
+	Stops at one of stop_chars and returns a pointer to it.
+*/
+static const char *expand_transform_format(GString *out, const char *p, const char *stop_chars, const GMatchInfo *match_info, TransformCaseState *case_state)
+{
+	while(*p && !strchr(stop_chars,*p))
+	{
+		if(*p=='\\' && p[1]!='\0')
+		{
+			switch(p[1])
+			{
+				case 'u':
+					case_state->next=TRANSFORM_CASE_UPPER;
+					break;
+				case 'l':
+					case_state->next=TRANSFORM_CASE_LOWER;
+					break;
+				case 'U':
+					case_state->mode=TRANSFORM_CASE_UPPER;
+					break;
+				case 'L':
+					case_state->mode=TRANSFORM_CASE_LOWER;
+					break;
+				case 'E':
+					case_state->mode=TRANSFORM_CASE_NONE;
+					break;
+				case 'n':
+					g_string_append_c(out,'\n');
+					break;
+				case 't':
+					g_string_append_c(out,'\t');
+					break;
+				default:
+					append_cased(out,p+1,g_utf8_next_char(p+1)-(p+1),case_state);
+					break;
+			}
+			
+			p=g_utf8_next_char(p+1);
+		}
+		else if(*p=='$' && (g_ascii_isdigit(p[1]) || (p[1]=='{' && g_ascii_isdigit(p[2]))))
+		{
+			const gboolean braced=p[1]=='{';
+			char *end=NULL;
+			gint group_num=(gint)g_ascii_strtoll(p+(braced?2:1),&end,10);
+			
+			g_autofree char *group=g_match_info_fetch(match_info,group_num);
+			
+			if(braced)
+			{
+				p=expand_braced_group(out,end,group,match_info,case_state);
+			}
+			else
+			{
+				if(group)
+				{
+					append_cased(out,group,-1,case_state);
+				}
+				p=end;
+			}
+		}
+		else if(*p=='(' && p[1]=='?' && g_ascii_isdigit(p[2]))
+		{
+			char *end=NULL;
+			gint group_num=(gint)g_ascii_strtoll(p+2,&end,10);
+			p=end;
+			
+			g_autofree char *group=g_match_info_fetch(match_info,group_num);
+			g_autoptr(GString) if_text=g_string_new(NULL);
+			g_autoptr(GString) else_text=g_string_new(NULL);
+			TransformCaseState branch_state=*case_state;
+			
+			if(*p==':')
+			{
+				p=expand_transform_format(if_text,p+1,":)",match_info,&branch_state);
+			}
+			
+			if(*p==':')
+			{
+				branch_state=*case_state;
+				p=expand_transform_format(else_text,p+1,")",match_info,&branch_state);
+			}
+			
+			if(*p==')')
+			{
+				p++;
+			}
+			
+			g_string_append(out,(group && group[0]!='\0')?if_text->str:else_text->str);
+		}
+		else
+		{
+			const char *next=g_utf8_next_char(p);
+			append_cased(out,p,next-p,case_state);
+			p=next;
+		}
+	}
+	
+	return p;
+}
+
+static gboolean eval_transform_match(const GMatchInfo *match_info, GString *result, gpointer user_data)
+{
+	SnippetTransform *transform=user_data;
+	TransformCaseState case_state={TRANSFORM_CASE_NONE,TRANSFORM_CASE_NONE};
+	
+	expand_transform_format(result,transform->format,"",match_info,&case_state);
+	
+	//TRUE stops after the first match, the rest of the value is kept as is
+	return !transform->global;
+}
+
+/**
+	Appends value transformed by "regex/format/flags", the part of ${N/regex/format/flags}
+	after the first '/'. A regex that does not compile leaves the value unchanged.
+*/
+int append_transformed_value(GString *result, const char *source, size_t source_len, const char *value)
+{
+	SnippetTransform *transform=get_snippet_transform(source,source_len);
+	
+	if(!value)
+	{
+		value="";
+	}
+	
+	if(!transform)
+	{
+		report_template_error("Could not compile the transformation [%.*s]",(int)source_len,source);
+		g_string_append(result,value);
+		return -1;
+	}
+	
+	g_autoptr(GError) error=NULL;
+	g_autofree char *transformed=g_regex_replace_eval(transform->regex, value, -1, 0, 0, eval_transform_match, transform, &error);
+	
+	if(!transformed)
+	{
+		report_template_error("Transformation failed: %s",error->message);
+		g_string_append(result,value);
+		return -1;
+	}
+	
+	g_string_append(result,transformed);
+	
+	return 0;
+}
+
+//whether text reads the value of a tab stop with $N
+static gboolean reads_snippet_values(const char *text)
+{
+	return g_regex_match(GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES,text,0,NULL);
+}
+
+//block_outputs, when not NULL, keeps the output of the blocks that read no $N between renders, see render_snippet_template_reusing
+static void render_placeholders(GString *result, const char *insertion, GPtrArray *placeholders, SnippetValueFunc get_value, gpointer user_data, GHashTable *block_outputs)
+{
+	g_autoptr(GString) includes=g_string_sized_new(100);
+	gboolean includes_read_values=FALSE;
+	
+	const char *cursor = insertion;
+	for(guint i=0;i<placeholders->len;i++)
+	{
+		SnippetPlaceholder *placeholder=g_ptr_array_index(placeholders,i);
+		const char *match=placeholder->match;
+		
+		size_t cursor_len=placeholder->start - (cursor - insertion);
+		
+		// Print text before match
+//		printf("Text: %.*s\n", (int)cursor_len, cursor);
+		g_string_append_len(result,cursor,cursor_len);
+		
+//		printf("Match: %s\n",match);
+		
+		//get the ids of all matches. This will focus on $123 and $<[123]: ... > ${123: ... }
+		if(match[0]=='$')
+		{
+			if(match[1]>='0' && match[1]<='9')
+			{
+				long long id_num=g_ascii_strtoll(match+1,NULL,10);
+				
+				const char *value = get_value(id_num, user_data);
+				
+				if(value)
+				{
+					g_string_append(result,value);
+				}
+			}
+			else if(get_match_variable(match)>=0)
+			{
+				const char *value=GLOBAL_TEMPLATE_VARIABLE_FUNC?GLOBAL_TEMPLATE_VARIABLE_FUNC(get_match_variable(match),GLOBAL_TEMPLATE_VARIABLE_DATA):NULL;
+				
+				if(value)
+				{
+					g_string_append(result,value);
+				}
+			}
+			else if(match[1]=='G')
+			{
+				//an unknown $GEDIT_NAME stays as it is
+				g_string_append(result,match);
+			}
+			else if(match[1]=='(')
+			{
+				//the $N of a command are the shell's, so its output never depends on the tab stops
+				gpointer reused=NULL;
+				
+				if(block_outputs && g_hash_table_lookup_extended(block_outputs,placeholder,NULL,&reused))
+				{
+					if(reused)
+					{
+						g_string_append(result,reused);
+					}
+				}
+				else
+				{
+					g_autofree char *command=get_match_command(match);
+					
+					const char *output=command && GLOBAL_TEMPLATE_COMMAND_FUNC?GLOBAL_TEMPLATE_COMMAND_FUNC(command,GLOBAL_TEMPLATE_COMMAND_DATA):NULL;
+					
+					if(output)
+					{
+						g_string_append(result,output);
+					}
+					
+					if(block_outputs)
+					{
+						g_hash_table_insert(block_outputs,placeholder,g_strdup(output));
+					}
+				}
+			}
+			else if(match[1]=='<')
+			{
+				const char *body=NULL;
+				const gssize body_len=get_match_body(match,2,'>',&body);
+				const char *colon=body_len>0?memchr(body,':',body_len):NULL;
+				
+				//is return;
+				if(match[2]=='[')
+				{
+					if(colon)
+					{
+						g_autofree char *return_code=g_strndup(colon+1,body+body_len-colon-1);
+						
+						const char *language=GLOBAL_TEMPLATE_VARIABLE_FUNC?GLOBAL_TEMPLATE_VARIABLE_FUNC(SNIPPET_VARIABLE_LANGUAGE,GLOBAL_TEMPLATE_VARIABLE_DATA):NULL;
+						SnippetExpression *expression=get_snippet_expression(return_code);
+						
+						if(expression && is_snippet_expression_shadowed(expression,language,includes->str))
+						{
+							expression=NULL;
+						}
+						
+						if(expression)
+						{
+							g_autofree char *expression_error=NULL;
+							g_autofree char *return_str=snippet_expression_eval(expression,get_value,user_data,&expression_error);
+							
+							if(return_str)
+							{
+								g_string_append(result,return_str);
+							}
+							else
+							{
+								report_template_error("Expression block failed: %s",expression_error);
+							}
+						}
+						else
+						{
+							const gboolean reusable=block_outputs && !includes_read_values && !reads_snippet_values(return_code);
+							gpointer reused=NULL;
+							
+							if(reusable && g_hash_table_lookup_extended(block_outputs,placeholder,NULL,&reused))
+							{
+								//a block that failed was reported the first time
+								if(reused)
+								{
+									g_string_append(result,reused);
+								}
+							}
+							else
+							{
+								//the $N are variables in python, set after the includes
+								g_autoptr(GString) globals_code=g_string_new(includes->str);
+								g_autofree char *python_code=get_python_block_code(return_code,globals_code,get_value,user_data);
+								g_autofree char *return_str=translate_python_block(language,globals_code->str,python_code);
+								
+								if(return_str)
+								{
+									g_string_append(result,return_str);
+								}
+								else
+								{
+									g_autofree char *python_error=take_python_error();
+									report_template_error("Python block failed: %s",python_error?python_error:return_code);
+								}
+								
+								if(reusable)
+								{
+									g_hash_table_insert(block_outputs,placeholder,g_steal_pointer(&return_str));
+								}
+							}
+						}
+					}
+				}
+				//is include
+				else if(body_len>=0)
+				{
+					g_autofree char *includes_tmp=g_strndup(body,body_len);
+					
+					includes_read_values=includes_read_values || reads_snippet_values(includes_tmp);
+					gstring_append_reformatted_dollar_string(includes,includes_tmp,get_value,user_data);
+				}
+			}
+			else if(match[1]=='{' && (match[2]>='0' && match[2]<='9'))
+			{
+				char *id_end=NULL;
+				long long id_num=g_ascii_strtoll(match+2,&id_end,10);
+			
+				const char *value = get_value(id_num, user_data);
+				
+				//fprintf(stdout,"%s:%d STRLEN: [%zu]\n",__FILE__,__LINE__,strlen(value));
+			
+				//the regex (via id_end) only gets a '/' or ':' right after the number
+				const char *body=NULL;
+				const gssize body_len=get_match_body(match,id_end-match+1,'}',&body);
+				
+				if(*id_end=='/')
+				{
+					if(body_len>=0)
+					{
+						append_transformed_value(result,body,body_len,value);
+					}
+				}
+				else if(value && strlen(value)>0)
+				{
+					g_string_append(result,value);
+				}
+				else if(placeholder->children)
+				{
+					//the default may hold placeholders of its own
+					render_placeholders(result,placeholder->default_text,placeholder->children,get_value,user_data,block_outputs);
+				}
+				else if(placeholder->default_text)
+				{
+					g_string_append(result,placeholder->default_text);
+				}
+			}
+		}
+		
+		cursor = insertion + placeholder->end;
+	}
+
+	// Print remaining text after last match
+	if (*cursor)
+	{
+//		printf("Text: %s\n", cursor);
+		g_string_append(result,cursor);
+	}
+}
+
+/**
+	Renders the snippet text with the typed values of the tab stops, and runs the python blocks.
+	Text without any variables is appended as is.
+*/
+int render_snippet_template(GString *result, const char *insertion, SnippetValueFunc get_value, gpointer user_data)
+{
+	GPtrArray *placeholders=get_snippet_placeholders(insertion);
+	
+	if(placeholders->len==0)
+	{
+		g_string_append(result,insertion);
+		return 0;
+	}
+	
+	render_placeholders(result,insertion,placeholders,get_value,user_data,NULL);
+	
+	return 0;
+}
+
+/**
+	Like render_snippet_template, for rendering the same insertion many times with other values.
+	The python blocks whose code and includes read no $N and the $(command)s run the first time
+	only, block_outputs keeps their output for the next renders. Create it with
+	g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,g_free), empty, for one insertion.
+*/
+int render_snippet_template_reusing(GString *result, const char *insertion, SnippetValueFunc get_value, gpointer user_data, GHashTable *block_outputs)
+{
+	GPtrArray *placeholders=get_snippet_placeholders(insertion);
+	
+	if(placeholders->len==0)
+	{
+		g_string_append(result,insertion);
+		return 0;
+	}
+	
+	render_placeholders(result,insertion,placeholders,get_value,user_data,block_outputs);
+	
+	return 0;
+}
+
+//blocks also compiles the python of the $<[N]: ...> blocks, otherwise only the transformations and expression blocks
+static void prepare_template_parts(GPtrArray *placeholders, gboolean blocks)
+{
+	for(guint i=0;i<placeholders->len;i++)
+	{
+		SnippetPlaceholder *placeholder=g_ptr_array_index(placeholders,i);
+		const char *match=placeholder->match;
+		const char *body=NULL;
+		
+		if(match[1]=='{' && g_ascii_isdigit(match[2]))
+		{
+			const char *id_end=match+2+strspn(match+2,"0123456789");
+			const gssize body_len=*id_end=='/'?get_match_body(match,id_end-match+1,'}',&body):-1;
+			
+			if(body_len>=0)
+			{
+				get_snippet_transform(body,body_len);
+			}
+			else if(placeholder->children)
+			{
+				prepare_template_parts(placeholder->children,blocks);
+			}
+		}
+		else if(match[1]=='<' && match[2]=='[')
+		{
+			const gssize body_len=get_match_body(match,2,'>',&body);
+			const char *colon=body_len>0?memchr(body,':',body_len):NULL;
+			
+			if(colon)
+			{
+				g_autofree char *return_code=g_strndup(colon+1,body+body_len-colon-1);
+				
+				if(!get_snippet_expression(return_code) && blocks)
+				{
+					g_autofree char *python_code=get_python_block_code(return_code,NULL,NULL,NULL);
+					prepare_python_block(python_code);
+				}
+			}
+		}
+	}
+}
+
+/**
+	Compiles the transformations and python blocks of a snippet ahead of its first
+	expansion, without running anything.
+*/
+int prepare_snippet_template(const char *insertion)
+{
+	prepare_template_parts(get_snippet_placeholders(insertion),TRUE);
+	
+	return 0;
+}
+
+/**
+	Compiles only the transformations and expression blocks of a snippet, cheap enough for every
+	snippet that is loaded. Fits snippet_index_set_added_func, user_data is not used.
+*/
+void prepare_snippet_transforms(const char *insertion, gpointer user_data)
+{
+	//every transformation is in a ${N/...} and every expression block in a $<[N]: ...>
+	if(GLOBAL_TRANSFORM_CACHE && (strstr(insertion,"${") || strstr(insertion,"$<[")))
+	{
+		prepare_template_parts(get_snippet_placeholders(insertion),FALSE);
+	}
+}
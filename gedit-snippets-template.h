@@ -0,0 +1,86 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+	Returns the text typed for tab stop id, or NULL when there is none.
+*/
+typedef const char *(*SnippetValueFunc)(long long id, gpointer user_data);
+
+/**
+	Returns the output of a $(command), or NULL when there is none (yet).
+*/
+typedef const char *(*SnippetCommandFunc)(const char *command, gpointer user_data);
+
+/**
+	Returns the value of a SnippetVariable, or NULL when there is none.
+*/
+typedef const char *(*SnippetVariableFunc)(int variable, gpointer user_data);
+
+/**
+	Gets a problem met while rendering, like a python block that raised.
+*/
+typedef void (*SnippetErrorFunc)(const char *message, gpointer user_data);
+
+/**
+	A $... of a snippet text. The placeholders in the default of a ${N:default} are its children.
+*/
+typedef struct SnippetPlaceholder
+{
+	char *match; ///< the whole $..., like "${1:i}"
+	gsize start; ///< in bytes, where match begins in the text it was found in
+	gsize end; ///< in bytes, just after match
+	char *default_text; ///< of a ${N:default}, NULL for everything else
+	GPtrArray *children; ///< the placeholders of default_text, NULL when there is none
+}SnippetPlaceholder;
+
+extern GRegex *GLOBAL_REGEX_FIND_VARIABLES;
+extern GRegex *GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES;
+
+int template_init();
+int template_finalize();
+int template_begin_uncached();
+int template_end_uncached();
+int template_set_command_func(SnippetCommandFunc func, gpointer user_data);
+int template_set_variable_func(SnippetVariableFunc func, gpointer user_data);
+int template_set_error_func(SnippetErrorFunc func, gpointer user_data);
+SnippetCommandFunc template_get_command_func(gpointer *user_data);
+SnippetVariableFunc template_get_variable_func(gpointer *user_data);
+int get_match_variable(const char *match);
+gssize get_match_body(const char *match, size_t prefix_len, char closer, const char **body);
+char *get_match_command(const char *match);
+GPtrArray *get_snippet_placeholders(const char *insertion);
+int template_forget_placeholders(const char *insertion);
+
+int gstring_append_reformatted_dollar_string(GString *includes, const char *const dinsertion, SnippetValueFunc get_value, gpointer user_data);
+char *get_python_block_code(const char *return_code, GString *assignments, SnippetValueFunc get_value, gpointer user_data);
+int append_transformed_value(GString *result, const char *source, size_t source_len, const char *value);
+int render_snippet_template(GString *result, const char *insertion, SnippetValueFunc get_value, gpointer user_data);
+int render_snippet_template_reusing(GString *result, const char *insertion, SnippetValueFunc get_value, gpointer user_data, GHashTable *block_outputs);
+int prepare_snippet_template(const char *insertion);
+void prepare_snippet_transforms(const char *insertion, gpointer user_data);
+char *check_snippet_transform(const char *source, size_t source_len);
+void append_joined_words(GString *out, const char *text, gboolean first_upper);
+
+G_END_DECLS
@@ -0,0 +1,383 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Records what the plugin sees, the keys, the clicks and the edits of the user, so
+	snippets-replay can drive the engine the same way without gedit. Edits the engine makes
+	itself are left out, the replay makes them again.
+*/
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-trace.h"
+#include "gedit-snippets-engine.h"
+
+static FILE *GLOBAL_TRACE_FILE=NULL;
+static GtkTextBuffer *GLOBAL_TRACE_BUFFER=NULL; ///< the last buffer written as a B record, weak
+static char *GLOBAL_TRACE_LANGUAGE=NULL;
+static gint64 GLOBAL_TRACE_LAST_KEY=0;
+
+static void write_varint(guint64 value)
+{
+	guint8 bytes[10];
+	size_t len=0;
+	
+	do
+	{
+		bytes[len]=value&0x7F;
+		value>>=7;
+		
+		if(value)
+		{
+			bytes[len]|=0x80;
+		}
+		len++;
+	}
+	while(value);
+	
+	fwrite(bytes,1,len,GLOBAL_TRACE_FILE);
+}
+
+static void write_text(const char *text, gssize len)
+{
+	const size_t text_len=len<0?strlen(text):(size_t)len;
+	
+	write_varint(text_len);
+	fwrite(text,1,text_len,GLOBAL_TRACE_FILE);
+}
+
+static gint get_cursor_offset(GtkTextBuffer *buffer, GtkTextMark *mark)
+{
+	GtkTextIter iter;
+	gtk_text_buffer_get_iter_at_mark(buffer, &iter, mark);
+	
+	return gtk_text_iter_get_offset(&iter);
+}
+
+/**
+	Writes the whole buffer when the records are about another buffer than before.
+*/
+static void write_buffer_switch(GtkTextBuffer *buffer)
+{
+	if(buffer==GLOBAL_TRACE_BUFFER)
+	{
+		return;
+	}
+	
+	if(GLOBAL_TRACE_BUFFER)
+	{
+		g_object_remove_weak_pointer(G_OBJECT(GLOBAL_TRACE_BUFFER),(gpointer *)&GLOBAL_TRACE_BUFFER);
+	}
+	
+	GLOBAL_TRACE_BUFFER=buffer;
+	g_object_add_weak_pointer(G_OBJECT(buffer),(gpointer *)&GLOBAL_TRACE_BUFFER);
+	
+	GtkTextIter start, end;
+	gtk_text_buffer_get_bounds(buffer, &start, &end);
+	g_autofree char *text=gtk_text_buffer_get_text(buffer, &start, &end, TRUE);
+	
+	fputc(SNIPPET_TRACE_BUFFER,GLOBAL_TRACE_FILE);
+	write_text(text,-1);
+	write_varint(get_cursor_offset(buffer,gtk_text_buffer_get_insert(buffer)));
+}
+
+static void on_trace_insert_text(GtkTextBuffer *buffer, GtkTextIter *location, gchar *text, gint len, gpointer user_data)
+{
+	if(!GLOBAL_TRACE_FILE || snippet_engine_is_editing())
+	{
+		return;
+	}
+	
+	write_buffer_switch(buffer);
+	
+	fputc(SNIPPET_TRACE_INSERT,GLOBAL_TRACE_FILE);
+	write_varint(gtk_text_iter_get_offset(location));
+	write_text(text,len);
+}
+
+static void on_trace_delete_range(GtkTextBuffer *buffer, GtkTextIter *start, GtkTextIter *end, gpointer user_data)
+{
+	if(!GLOBAL_TRACE_FILE || snippet_engine_is_editing())
+	{
+		return;
+	}
+	
+	write_buffer_switch(buffer);
+	
+	fputc(SNIPPET_TRACE_DELETE,GLOBAL_TRACE_FILE);
+	write_varint(gtk_text_iter_get_offset(start));
+	write_varint(gtk_text_iter_get_offset(end));
+}
+
+int snippet_trace_open(const char *filename)
+{
+	snippet_trace_close();
+	
+	GLOBAL_TRACE_FILE=fopen(filename,"wb");
+	
+	if(!GLOBAL_TRACE_FILE)
+	{
+		fprintf(stderr,"%s:%d Could not open the trace %s: %s\n",__FILE__,__LINE__,filename,g_strerror(errno));
+		return -1;
+	}
+	
+	fwrite(SNIPPET_TRACE_MAGIC,1,strlen(SNIPPET_TRACE_MAGIC),GLOBAL_TRACE_FILE);
+	GLOBAL_TRACE_LAST_KEY=0;
+	
+	return 0;
+}
+
+int snippet_trace_close()
+{
+	if(GLOBAL_TRACE_BUFFER)
+	{
+		g_object_remove_weak_pointer(G_OBJECT(GLOBAL_TRACE_BUFFER),(gpointer *)&GLOBAL_TRACE_BUFFER);
+		GLOBAL_TRACE_BUFFER=NULL;
+	}
+	
+	g_clear_pointer(&GLOBAL_TRACE_LANGUAGE,g_free);
+	
+	if(GLOBAL_TRACE_FILE)
+	{
+		fclose(GLOBAL_TRACE_FILE);
+		GLOBAL_TRACE_FILE=NULL;
+	}
+	
+	return 0;
+}
+
+gboolean snippet_trace_is_open()
+{
+	return GLOBAL_TRACE_FILE!=NULL;
+}
+
+/**
+	Records the edits of buffer from now on. The handlers run before the edit is made,
+	so the offsets are the ones before it.
+*/
+int snippet_trace_watch_buffer(GtkTextBuffer *buffer)
+{
+	if(!GLOBAL_TRACE_FILE)
+	{
+		return 0;
+	}
+	
+	g_signal_connect(buffer, "insert-text", G_CALLBACK(on_trace_insert_text), NULL);
+	g_signal_connect(buffer, "delete-range", G_CALLBACK(on_trace_delete_range), NULL);
+	
+	return 0;
+}
+
+/**
+	Call before the engine gets the key, snippet_trace_key_result after.
+*/
+int snippet_trace_key(GtkTextBuffer *buffer, const char *language, guint keyval, gboolean is_modifier)
+{
+	if(!GLOBAL_TRACE_FILE)
+	{
+		return 0;
+	}
+	
+	write_buffer_switch(buffer);
+	
+	if(g_strcmp0(language,GLOBAL_TRACE_LANGUAGE)!=0)
+	{
+		g_free(GLOBAL_TRACE_LANGUAGE);
+		GLOBAL_TRACE_LANGUAGE=g_strdup(language);
+		
+		fputc(SNIPPET_TRACE_LANGUAGE,GLOBAL_TRACE_FILE);
+		write_text(language?language:"",-1);
+	}
+	
+	const gint64 now=g_get_monotonic_time();
+	
+	fputc(SNIPPET_TRACE_KEY,GLOBAL_TRACE_FILE);
+	write_varint(GLOBAL_TRACE_LAST_KEY?now-GLOBAL_TRACE_LAST_KEY:0);
+	write_varint(keyval);
+	write_varint(is_modifier?1:0);
+	write_varint(get_cursor_offset(buffer,gtk_text_buffer_get_insert(buffer)));
+	write_varint(get_cursor_offset(buffer,gtk_text_buffer_get_selection_bound(buffer)));
+	
+	GLOBAL_TRACE_LAST_KEY=now;
+	
+	return 0;
+}
+
+/**
+	The text is only hashed when the engine used the key, the other keys leave it as it was.
+*/
+int snippet_trace_key_result(GtkTextBuffer *buffer, gboolean handled, gint64 usec)
+{
+	if(!GLOBAL_TRACE_FILE)
+	{
+		return 0;
+	}
+	
+	fputc(SNIPPET_TRACE_RESULT,GLOBAL_TRACE_FILE);
+	write_varint(handled?1:0);
+	write_varint(handled?snippet_trace_hash_buffer(buffer):0);
+	write_varint(usec>0?usec:0);
+	
+	return 0;
+}
+
+int snippet_trace_button(GtkTextBuffer *buffer, guint button)
+{
+	if(!GLOBAL_TRACE_FILE)
+	{
+		return 0;
+	}
+	
+	write_buffer_switch(buffer);
+	
+	fputc(SNIPPET_TRACE_BUTTON,GLOBAL_TRACE_FILE);
+	write_varint(button);
+	
+	return 0;
+}
+
+guint snippet_trace_hash_buffer(GtkTextBuffer *buffer)
+{
+	GtkTextIter start, end;
+	gtk_text_buffer_get_bounds(buffer, &start, &end);
+	g_autofree char *text=gtk_text_buffer_get_text(buffer, &start, &end, TRUE);
+	
+	return g_str_hash(text);
+}
+
+/**
+	data has to stay valid while the events are read. Returns -1 when it is not a trace.
+*/
+int snippet_trace_reader_init(SnippetTraceReader *self, const char *data, gsize len)
+{
+	const size_t magic_len=strlen(SNIPPET_TRACE_MAGIC);
+	
+	if(len<magic_len || memcmp(data,SNIPPET_TRACE_MAGIC,magic_len)!=0)
+	{
+		return -1;
+	}
+	
+	self->data=(const guint8 *)data;
+	self->len=len;
+	self->pos=magic_len;
+	
+	return 0;
+}
+
+static gboolean read_varint(SnippetTraceReader *self, guint64 *value)
+{
+	*value=0;
+	
+	for(int shift=0;shift<64 && self->pos<self->len;shift+=7)
+	{
+		const guint8 byte=self->data[self->pos++];
+		*value|=(guint64)(byte&0x7F)<<shift;
+		
+		if(!(byte&0x80))
+		{
+			return TRUE;
+		}
+	}
+	
+	return FALSE;
+}
+
+static gboolean read_text(SnippetTraceReader *self, SnippetTraceEvent *event)
+{
+	guint64 text_len;
+	
+	if(!read_varint(self,&text_len) || text_len>self->len-self->pos)
+	{
+		return FALSE;
+	}
+	
+	event->text=(const char *)self->data+self->pos;
+	event->text_len=text_len;
+	self->pos+=text_len;
+	
+	return TRUE;
+}
+
+/**
+	Returns 1 for an event, 0 at the end of the trace and -1 when it is cut off or broken,
+	like after gedit crashed while recording.
+*/
+int snippet_trace_reader_next(SnippetTraceReader *self, SnippetTraceEvent *event)
+{
+	if(self->pos>=self->len)
+	{
+		return 0;
+	}
+	
+	memset(event,0,sizeof(SnippetTraceEvent));
+	event->type=self->data[self->pos++];
+	
+	//how many numbers follow, and if a text comes first
+	int values_len=0;
+	gboolean has_text=FALSE;
+	
+	switch(event->type)
+	{
+	case SNIPPET_TRACE_BUFFER:
+		has_text=TRUE;
+		values_len=1;
+		break;
+	case SNIPPET_TRACE_LANGUAGE:
+		has_text=TRUE;
+		break;
+	case SNIPPET_TRACE_KEY:
+		values_len=5;
+		break;
+	case SNIPPET_TRACE_RESULT:
+		values_len=3;
+		break;
+	case SNIPPET_TRACE_BUTTON:
+		values_len=1;
+		break;
+	case SNIPPET_TRACE_INSERT:
+		//the offset comes before the text
+		if(!read_varint(self,&event->values[0]) || !read_text(self,event))
+		{
+			return -1;
+		}
+		return 1;
+	case SNIPPET_TRACE_DELETE:
+		values_len=2;
+		break;
+	default:
+		return -1;
+	}
+	
+	if(has_text && !read_text(self,event))
+	{
+		return -1;
+	}
+	
+	for(int i=0;i<values_len;i++)
+	{
+		if(!read_varint(self,&event->values[i]))
+		{
+			return -1;
+		}
+	}
+	
+	return 1;
+}
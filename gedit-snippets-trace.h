@@ -0,0 +1,72 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define SNIPPET_TRACE_MAGIC "GSTRACE1"
+
+/**
+	One record of a trace. The numbers are LEB128 varints, a text is its length in bytes
+	followed by the bytes.
+*/
+typedef enum SnippetTraceType
+{
+	SNIPPET_TRACE_BUFFER='B', ///< the buffer the following records are about: text, cursor
+	SNIPPET_TRACE_LANGUAGE='L', ///< language of the following keys, empty for none
+	SNIPPET_TRACE_KEY='K', ///< usec since the last key, keyval, is_modifier, cursor, selection bound
+	SNIPPET_TRACE_RESULT='R', ///< handled, hash of the text when handled, usec the key took
+	SNIPPET_TRACE_BUTTON='C', ///< button
+	SNIPPET_TRACE_INSERT='I', ///< offset, text
+	SNIPPET_TRACE_DELETE='D' ///< start, end
+}SnippetTraceType;
+
+typedef struct SnippetTraceEvent
+{
+	SnippetTraceType type;
+	guint64 values[5]; ///< the numbers, in the order above
+	const char *text; ///< points into the trace, not NUL terminated
+	gsize text_len;
+}SnippetTraceEvent;
+
+typedef struct SnippetTraceReader
+{
+	const guint8 *data;
+	gsize len;
+	gsize pos;
+}SnippetTraceReader;
+
+int snippet_trace_open(const char *filename);
+int snippet_trace_close();
+gboolean snippet_trace_is_open();
+
+int snippet_trace_watch_buffer(GtkTextBuffer *buffer);
+int snippet_trace_key(GtkTextBuffer *buffer, const char *language, guint keyval, gboolean is_modifier);
+int snippet_trace_key_result(GtkTextBuffer *buffer, gboolean handled, gint64 usec);
+int snippet_trace_button(GtkTextBuffer *buffer, guint button);
+
+guint snippet_trace_hash_buffer(GtkTextBuffer *buffer);
+
+int snippet_trace_reader_init(SnippetTraceReader *self, const char *data, gsize len);
+int snippet_trace_reader_next(SnippetTraceReader *self, SnippetTraceEvent *event);
+
+G_END_DECLS
@@ -0,0 +1,308 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-snippets-usage.h"
+#include "gedit-snippets-template.h"
+
+//"language\ttag" -> SnippetUsage
+GHashTable *GLOBAL_SNIPPET_USAGE=NULL;
+char *GLOBAL_SNIPPET_USAGE_FILE=NULL;
+guint GLOBAL_SNIPPET_USAGE_FLUSH_ID=0;
+
+//a snippet is known by its tag and the first language of its file
+static char *get_snippet_usage_key(SnippetTranslation *sntran)
+{
+	const char *language=sntran->programming_languages && sntran->programming_languages[0]?sntran->programming_languages[0]:"";
+	
+	return g_strconcat(language,"\t",sntran->from,NULL);
+}
+
+/**
+	Reads $XDG_STATE_HOME/gedit/snippets-usage, lines of "expansions\tlast_used\tlanguage\ttag"
+	with the language and tag escaped like C strings.
+*/
+static int read_snippet_usage()
+{
+	g_autofree char *contents=NULL;
+	
+	if(!g_file_get_contents(GLOBAL_SNIPPET_USAGE_FILE,&contents,NULL,NULL))
+	{
+		return -1;
+	}
+	
+	g_auto(GStrv) lines=g_strsplit(contents,"\n",-1);
+	
+	for(guint i=0;lines[i];i++)
+	{
+		g_auto(GStrv) fields=g_strsplit(lines[i],"\t",4);
+		
+		if(g_strv_length(fields)!=4)
+		{
+			continue;
+		}
+		
+		SnippetUsage *usage=g_new0(SnippetUsage,1);
+		usage->expansions=strtoul(fields[0],NULL,10);
+		usage->last_used=g_ascii_strtoll(fields[1],NULL,10);
+		
+		g_autofree char *language=g_strcompress(fields[2]);
+		g_autofree char *tag=g_strcompress(fields[3]);
+		
+		g_hash_table_replace(GLOBAL_SNIPPET_USAGE,g_strconcat(language,"\t",tag,NULL),usage);
+	}
+	
+	return 0;
+}
+
+int snippet_usage_init()
+{
+	if(GLOBAL_SNIPPET_USAGE)
+	{
+		return 0;
+	}
+	
+	GLOBAL_SNIPPET_USAGE=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,g_free);
+	GLOBAL_SNIPPET_USAGE_FILE=g_build_filename(g_get_user_state_dir(),"gedit","snippets-usage",NULL);
+	
+	read_snippet_usage();
+	
+	return 0;
+}
+
+/**
+	Writes the counts if something was expanded since the last write.
+*/
+int snippet_usage_flush()
+{
+	g_clear_handle_id(&GLOBAL_SNIPPET_USAGE_FLUSH_ID,g_source_remove);
+	
+	if(!GLOBAL_SNIPPET_USAGE)
+	{
+		return -1;
+	}
+	
+	g_autoptr(GString) contents=g_string_sized_new(g_hash_table_size(GLOBAL_SNIPPET_USAGE)*32);
+	
+	GHashTableIter iter;
+	gpointer key, value;
+	g_hash_table_iter_init(&iter,GLOBAL_SNIPPET_USAGE);
+	
+	while(g_hash_table_iter_next(&iter,&key,&value))
+	{
+		SnippetUsage *usage=value;
+		const char *tab=strchr(key,'\t');
+		
+		g_autofree char *language=g_strndup(key,tab-(const char *)key);
+		g_autofree char *escaped_language=g_strescape(language,NULL);
+		g_autofree char *escaped_tag=g_strescape(tab+1,NULL);
+		
+		g_string_append_printf(contents,"%u\t%" G_GINT64_FORMAT "\t%s\t%s\n",usage->expansions,usage->last_used,escaped_language,escaped_tag);
+	}
+	
+	g_autofree char *dir=g_path_get_dirname(GLOBAL_SNIPPET_USAGE_FILE);
+	g_autoptr(GError) error=NULL;
+	
+	if(g_mkdir_with_parents(dir,0700)!=0 || !g_file_set_contents(GLOBAL_SNIPPET_USAGE_FILE,contents->str,contents->len,&error))
+	{
+		fprintf(stderr,"%s:%d Could not save %s: %s\n",__FILE__,__LINE__,GLOBAL_SNIPPET_USAGE_FILE,error?error->message:g_strerror(errno));
+		return -1;
+	}
+	
+	return 0;
+}
+
+static gboolean on_snippet_usage_flush(gpointer user_data)
+{
+	GLOBAL_SNIPPET_USAGE_FLUSH_ID=0;
+	snippet_usage_flush();
+	
+	return G_SOURCE_REMOVE;
+}
+
+int snippet_usage_finalize()
+{
+	if(!GLOBAL_SNIPPET_USAGE)
+	{
+		return 0;
+	}
+	
+	if(GLOBAL_SNIPPET_USAGE_FLUSH_ID)
+	{
+		snippet_usage_flush();
+	}
+	
+	g_clear_pointer(&GLOBAL_SNIPPET_USAGE,g_hash_table_destroy);
+	g_clear_pointer(&GLOBAL_SNIPPET_USAGE_FILE,g_free);
+	
+	return 0;
+}
+
+SnippetUsage *get_snippet_usage(SnippetTranslation *sntran)
+{
+	if(!GLOBAL_SNIPPET_USAGE)
+	{
+		return NULL;
+	}
+	
+	g_autofree char *key=get_snippet_usage_key(sntran);
+	
+	return g_hash_table_lookup(GLOBAL_SNIPPET_USAGE,key);
+}
+
+/**
+	Most expanded first.
+*/
+gint compare_snippet_usage(gconstpointer a, gconstpointer b)
+{
+	const SnippetTranslation *sntran_a=*(SnippetTranslation *const *)a;
+	const SnippetTranslation *sntran_b=*(SnippetTranslation *const *)b;
+	
+	if(sntran_a->expansions!=sntran_b->expansions)
+	{
+		return sntran_a->expansions<sntran_b->expansions?1:-1;
+	}
+	
+	return 0;
+}
+
+static gboolean prepare_hot_snippets(gpointer user_data)
+{
+	GPtrArray *hot=user_data;
+	
+	for(guint i=0;i<hot->len;i++)
+	{
+		prepare_snippet_template(g_ptr_array_index(hot,i));
+	}
+	
+	g_ptr_array_unref(hot);
+	
+	return G_SOURCE_REMOVE;
+}
+
+/**
+	Copies the counts to the loaded snippets and puts the most used first in their block,
+	the order the manager lists them in. The hot set gets its transformations and python compiled
+	once gedit is idle. Call it after every load_configuration.
+*/
+int apply_snippet_usage()
+{
+	if(!GLOBAL_SNIPPET_USAGE || !GLOBAL_SNIPPETS)
+	{
+		return -1;
+	}
+	
+	GPtrArray *hot=g_ptr_array_new();
+	
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		for(guint j=0;j<sblk->nodes->len;j++)
+		{
+			SnippetTranslation *sntran=g_ptr_array_index(sblk->nodes,j);
+			SnippetUsage *usage=get_snippet_usage(sntran);
+			
+			sntran->expansions=usage?usage->expansions:0;
+			
+			if(sntran->expansions>0)
+			{
+				g_ptr_array_add(hot,sntran);
+			}
+		}
+		
+		//stable, snippets used as often keep the order of the files
+		g_ptr_array_sort(sblk->nodes,compare_snippet_usage);
+		renumber_snippet_block(sblk,0);
+	}
+	
+	g_ptr_array_sort(hot,compare_snippet_usage);
+	
+	//copies, a reload can drop the snippets before the idle runs
+	GPtrArray *bodies=g_ptr_array_new_with_free_func(g_free);
+	
+	for(guint i=0;i<MIN(hot->len,SNIPPET_USAGE_HOT_SET);i++)
+	{
+		g_ptr_array_add(bodies,g_strdup(((SnippetTranslation *)g_ptr_array_index(hot,i))->to));
+	}
+	
+	g_ptr_array_unref(hot);
+	
+	g_idle_add(prepare_hot_snippets,bodies);
+	
+	return 0;
+}
+
+/**
+	Counts one expansion and moves the snippet in front of the less used ones of its
+	block. The file is written SNIPPET_USAGE_FLUSH_SECONDS later, with whatever else
+	was expanded in between.
+*/
+int record_snippet_usage(SnippetTranslation *sntran)
+{
+	if(!GLOBAL_SNIPPET_USAGE)
+	{
+		return -1;
+	}
+	
+	g_autofree char *key=get_snippet_usage_key(sntran);
+	SnippetUsage *usage=g_hash_table_lookup(GLOBAL_SNIPPET_USAGE,key);
+	
+	if(!usage)
+	{
+		usage=g_new0(SnippetUsage,1);
+		g_hash_table_insert(GLOBAL_SNIPPET_USAGE,g_steal_pointer(&key),usage);
+	}
+	
+	usage->expansions++;
+	usage->last_used=g_get_real_time()/G_USEC_PER_SEC;
+	sntran->expansions=usage->expansions;
+	
+	//the compiled snippets are in no block
+	if(sntran->handle)
+	{
+		SnippetBlock *sblk=get_or_create_block(strlen(sntran->from));
+		const guint index=sntran->node_index;
+		guint target=index;
+		
+		while(target>0 && ((SnippetTranslation *)g_ptr_array_index(sblk->nodes,target-1))->expansions<sntran->expansions)
+		{
+			target--;
+		}
+		
+		if(target!=index)
+		{
+			g_ptr_array_remove_index(sblk->nodes,index);
+			g_ptr_array_insert(sblk->nodes,target,sntran);
+			renumber_snippet_block(sblk,target);
+		}
+	}
+	
+	if(!GLOBAL_SNIPPET_USAGE_FLUSH_ID)
+	{
+		GLOBAL_SNIPPET_USAGE_FLUSH_ID=g_timeout_add_seconds(SNIPPET_USAGE_FLUSH_SECONDS,on_snippet_usage_flush,NULL);
+	}
+	
+	return 0;
+}
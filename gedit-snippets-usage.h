@@ -0,0 +1,46 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+#include "gedit-snippets-configuration.h"
+
+G_BEGIN_DECLS
+
+#define SNIPPET_USAGE_FLUSH_SECONDS 60
+#define SNIPPET_USAGE_HOT_SET 32 ///< snippets prepared at startup
+
+typedef struct SnippetUsage
+{
+	guint expansions;
+	gint64 last_used; ///< unix time in seconds
+}SnippetUsage;
+
+int snippet_usage_init();
+int snippet_usage_finalize();
+int snippet_usage_flush();
+
+int apply_snippet_usage();
+int record_snippet_usage(SnippetTranslation *sntran);
+SnippetUsage *get_snippet_usage(SnippetTranslation *sntran);
+gint compare_snippet_usage(gconstpointer a, gconstpointer b);
+
+G_END_DECLS
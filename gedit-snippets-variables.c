@@ -0,0 +1,129 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <glib.h>
+#include <string.h>
+
+#include "gedit-snippets-variables.h"
+
+static const char *const SNIPPET_VARIABLE_NAMES[SNIPPET_VARIABLE_COUNT]={
+	[SNIPPET_VARIABLE_FILENAME]="GEDIT_FILENAME",
+	[SNIPPET_VARIABLE_BASENAME]="GEDIT_BASENAME",
+	[SNIPPET_VARIABLE_PATH]="GEDIT_CURRENT_DOCUMENT_PATH",
+	[SNIPPET_VARIABLE_DIR]="GEDIT_CURRENT_DOCUMENT_DIR",
+	[SNIPPET_VARIABLE_LANGUAGE]="GEDIT_CURRENT_DOCUMENT_LANGUAGE",
+	[SNIPPET_VARIABLE_SELECTED_TEXT]="GEDIT_SELECTED_TEXT",
+	[SNIPPET_VARIABLE_CLIPBOARD]="GEDIT_CLIPBOARD",
+	[SNIPPET_VARIABLE_LINE_NUMBER]="GEDIT_CURRENT_LINE_NUMBER",
+	[SNIPPET_VARIABLE_DATE]="GEDIT_CURRENT_DATE",
+	[SNIPPET_VARIABLE_TIME]="GEDIT_CURRENT_TIME",
+	[SNIPPET_VARIABLE_YEAR]="GEDIT_CURRENT_YEAR"
+};
+
+/**
+	Returns the SnippetVariable called name, or -1 if there is none.
+*/
+int get_snippet_variable(const char *name, size_t name_len)
+{
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		if(strlen(SNIPPET_VARIABLE_NAMES[i])==name_len && strncmp(SNIPPET_VARIABLE_NAMES[i],name,name_len)==0)
+		{
+			return i;
+		}
+	}
+	
+	return -1;
+}
+
+const char *get_snippet_variable_name(SnippetVariable variable)
+{
+	return SNIPPET_VARIABLE_NAMES[variable];
+}
+
+/**
+	Returns a bit per variable the text refers to, computed once when a snippet is loaded
+	so expanding a snippet without variables does not look for any.
+*/
+guint32 get_snippet_variable_mask(const char *text)
+{
+	guint32 mask=0;
+	
+	for(const char *p=strstr(text,"GEDIT_");p;p=strstr(p+1,"GEDIT_"))
+	{
+		if(p==text || (p[-1]!='$' && p[-1]!='{'))
+		{
+			continue;
+		}
+		
+		size_t name_len=strspn(p,"ABCDEFGHIJKLMNOPQRSTUVWXYZ_");
+		int variable=get_snippet_variable(p,name_len);
+		
+		if(variable>=0)
+		{
+			mask|=SNIPPET_VARIABLE_BIT(variable);
+		}
+	}
+	
+	//python blocks get the helpers of the language
+	if(strstr(text,"$<["))
+	{
+		mask|=SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_LANGUAGE);
+	}
+	
+	return mask;
+}
+
+char *get_snippet_time_variable(SnippetVariable variable)
+{
+	g_autoptr(GDateTime) now=g_date_time_new_now_local();
+	
+	switch(variable)
+	{
+		case SNIPPET_VARIABLE_DATE:
+			return g_date_time_format(now,"%Y-%m-%d");
+		case SNIPPET_VARIABLE_TIME:
+			return g_date_time_format(now,"%H:%M:%S");
+		case SNIPPET_VARIABLE_YEAR:
+			return g_date_time_format(now,"%Y");
+		default:
+			return NULL;
+	}
+}
+
+/**
+	Fills the file name variables of values, indexed by SnippetVariable, from path.
+*/
+int set_snippet_file_variables(char **values, const char *path)
+{
+	if(!path)
+	{
+		return -1;
+	}
+	
+	char *filename=g_path_get_basename(path);
+	const char *extension=strrchr(filename,'.');
+	
+	values[SNIPPET_VARIABLE_PATH]=g_strdup(path);
+	values[SNIPPET_VARIABLE_DIR]=g_path_get_dirname(path);
+	values[SNIPPET_VARIABLE_BASENAME]=(extension && extension!=filename)?g_strndup(filename,extension-filename):g_strdup(filename);
+	values[SNIPPET_VARIABLE_FILENAME]=filename;
+	
+	return 0;
+}
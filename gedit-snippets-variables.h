@@ -0,0 +1,57 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+	The built-in variables, used as $GEDIT_NAME or ${GEDIT_NAME} in a snippet.
+*/
+typedef enum SnippetVariable
+{
+	SNIPPET_VARIABLE_FILENAME=0, ///< GEDIT_FILENAME, name of the file with extension
+	SNIPPET_VARIABLE_BASENAME, ///< GEDIT_BASENAME, name of the file without extension
+	SNIPPET_VARIABLE_PATH, ///< GEDIT_CURRENT_DOCUMENT_PATH
+	SNIPPET_VARIABLE_DIR, ///< GEDIT_CURRENT_DOCUMENT_DIR
+	SNIPPET_VARIABLE_LANGUAGE, ///< GEDIT_CURRENT_DOCUMENT_LANGUAGE
+	SNIPPET_VARIABLE_SELECTED_TEXT, ///< GEDIT_SELECTED_TEXT
+	SNIPPET_VARIABLE_CLIPBOARD, ///< GEDIT_CLIPBOARD
+	SNIPPET_VARIABLE_LINE_NUMBER, ///< GEDIT_CURRENT_LINE_NUMBER, starting at 1
+	SNIPPET_VARIABLE_DATE, ///< GEDIT_CURRENT_DATE, 2025-01-31
+	SNIPPET_VARIABLE_TIME, ///< GEDIT_CURRENT_TIME, 23:59:59
+	SNIPPET_VARIABLE_YEAR, ///< GEDIT_CURRENT_YEAR
+	SNIPPET_VARIABLE_COUNT
+}SnippetVariable;
+
+#define SNIPPET_VARIABLE_BIT(variable) (1u<<(variable))
+
+//the variables that only depend on the document, cached per buffer
+#define SNIPPET_VARIABLES_DOCUMENT (SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_FILENAME)|SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_BASENAME)|\
+	SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_PATH)|SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_DIR)|SNIPPET_VARIABLE_BIT(SNIPPET_VARIABLE_LANGUAGE))
+
+int get_snippet_variable(const char *name, size_t name_len);
+const char *get_snippet_variable_name(SnippetVariable variable);
+guint32 get_snippet_variable_mask(const char *text);
+char *get_snippet_time_variable(SnippetVariable variable);
+int set_snippet_file_variables(char **values, const char *path);
+
+G_END_DECLS
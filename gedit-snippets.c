@@ -31,17 +31,20 @@ freely, subject to the following restrictions:
 #include "gedit-snippets-python-handling.h"
 #include "gedit-snippets-configure-window.h"
 #include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-variables.h"
+#include "gedit-snippets-memory.h"
+#include "gedit-snippets-usage.h"
+#include "gedit-snippets-filter.h"
+#include "gedit-snippets-engine.h"
+#include "gedit-snippets-trace.h"
 
-size_t GLOBAL_SNIPPET_START_POS=0;
-size_t GLOBAL_SNIPPET_FILTERED_LEN=0;
-GHashTable *GLOBAL_POSITION_INFO_HASH_TABLE=NULL;
-SnippetTranslation *GLOBAL_CURRENT_SNIPPET_TRANSLATION=NULL;
-int GLOBAL_POSITION_STATE=0;
-int GLOBAL_EXPAND_INTERNAL_CODE=0;
+#define DOCUMENT_VARIABLES_KEY "snippets-document-variables"
 
-//define once
-GRegex *GLOBAL_REGEX_FIND_VARIABLES=NULL;
-GRegex *GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES=NULL;
+typedef struct DocumentVariables
+{
+	char *values[SNIPPET_VARIABLE_COUNT]; ///< only SNIPPET_VARIABLES_DOCUMENT are set
+}DocumentVariables;
 
 static void gedit_app_activatable_iface_init(GeditAppActivatableInterface *iface);
 static void gedit_window_activatable_iface_init(GeditWindowActivatableInterface *iface);
@@ -50,7 +53,10 @@ struct _GeditSnippetsPluginPrivate
 {
 	GeditWindow *window;
 	GSimpleAction *snippets_action;
+	GSimpleAction *expand_selection_action;
+	GSimpleAction *reset_python_action;
 	GeditApp *app;
+	SnippetPython *python; ///< the window's python blocks run here
 	GeditMenuExtension *menu_ext;
 	
 	//GtkTextIter start, end; /* selection */
@@ -70,653 +76,194 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED(GeditSnippetsPlugin, gedit_snippets_plugin, PEAS_
 
 //////////////////////////////////
 
-static gint g_int_compare(gconstpointer a, gconstpointer b)
+const char *get_programming_language(GeditWindow *window)
 {
-	int ia = GPOINTER_TO_INT(a);
-	int ib = GPOINTER_TO_INT(b);
-	
-	// Special case: 0 goes last
-	if (ia == 0 && ib != 0)
-		return 1;  // ia > ib
-	if (ib == 0 && ia != 0)
-		return -1; // ia < ib
+	GeditTab *tab= gedit_window_get_active_tab(window);
 	
-	if (ia < ib)
-	{
-		return -1;
-	}
-	else if (ia > ib)
+	if(tab)
 	{
-		return 1;
-	}
-	else
-	{
-		return 0;
+		GeditDocument *doc = gedit_tab_get_document(tab);
+	
+		GtkTextBuffer *buffer = GTK_TEXT_BUFFER(doc);
+		GtkSourceBuffer *sbuffer = GTK_SOURCE_BUFFER(buffer);
+		GtkSourceLanguage *language = gtk_source_buffer_get_language(sbuffer);
+		if (language)
+		{
+			return gtk_source_language_get_id(language);
+		}
 	}
+	
+	return NULL;
 }
 
-
-gpointer get_next_tab_position(GHashTable *table, guint index)
+static void document_variables_free(DocumentVariables *self)
 {
-	g_autoptr(GList) keys = g_hash_table_get_keys(table);
-	keys = g_list_sort(keys, (GCompareFunc)g_int_compare); // Sort keys numerically
-
-	gpointer value = NULL;
-
-	if (index >= 0 && index < g_list_length(keys))
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
 	{
-		gpointer key = g_list_nth_data(keys, index);
-		value = g_hash_table_lookup(table, key);
+		g_free(self->values[i]);
 	}
-
-	return value;
+	
+	g_free(self);
 }
 
-static void _tab_position_object_free(Tab_position_object *tpobj)
+static void on_document_variables_changed(GObject *object, GParamSpec *pspec, gpointer user_data)
 {
-	if (!tpobj)
-	{
-		return;
-	}
-	g_free(tpobj->content);
-	g_free(tpobj);
+	g_object_set_data(G_OBJECT(user_data), DOCUMENT_VARIABLES_KEY, NULL);
 }
 
-int reset_globals()
+/**
+	The file name and language of the document, cached on the buffer until the document
+	is saved somewhere else or gets another language.
+*/
+static DocumentVariables *get_document_variables(GtkTextBuffer *buffer)
 {
-	//dont free every time
-	if(GLOBAL_SNIPPET_FILTERED_LEN!=0)
+	DocumentVariables *self=g_object_get_data(G_OBJECT(buffer), DOCUMENT_VARIABLES_KEY);
+	
+	if(self)
 	{
-		GLOBAL_SNIPPET_START_POS=0;
-		GLOBAL_SNIPPET_FILTERED_LEN=0;
-		GLOBAL_POSITION_STATE=0;
-		GLOBAL_EXPAND_INTERNAL_CODE=0;
-		GLOBAL_CURRENT_SNIPPET_TRANSLATION=NULL;
-		if(GLOBAL_POSITION_INFO_HASH_TABLE)
-		{
-			g_hash_table_remove_all(GLOBAL_POSITION_INFO_HASH_TABLE);
-		}
+		return self;
 	}
 	
-	return 0;
-}
-
-int gstring_append_reformatted_dollar_string(GString *includes, const char *const dinsertion)
-{
-	g_autoptr(GMatchInfo) match_dollar_info=NULL;
-
-	//Analyze the input
-	if (g_regex_match(GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES, dinsertion, 0, &match_dollar_info))
+	self=g_new0(DocumentVariables,1);
+	
+	GtkSourceFile *file=gedit_document_get_file(GEDIT_DOCUMENT(buffer));
+	GFile *location=file?gtk_source_file_get_location(file):NULL;
+	
+	if(location)
 	{
-		const char *dcursor = dinsertion;
-		while (g_match_info_matches(match_dollar_info))
-		{
-			g_autofree char *dmatch = g_match_info_fetch(match_dollar_info, 1);
-			gint dstart, dend;
-			g_match_info_fetch_pos(match_dollar_info, 0, &dstart, &dend);
-			
-			size_t dcursor_len=dstart - (dcursor - dinsertion);
-			
-			g_string_append_len(includes,dcursor,dcursor_len);
-			
-			long long did_num=g_ascii_strtoll(dmatch,NULL,10);
-			
-			Tab_position_object *value = g_hash_table_lookup(GLOBAL_POSITION_INFO_HASH_TABLE, GINT_TO_POINTER(did_num));
-			
-			if(value)
-			{
-				g_string_append(includes,"'");
-				g_string_append(includes,value->content);
-				g_string_append(includes,"'");
-			}
-			
-			dcursor = dinsertion + dend;
-			g_match_info_next(match_dollar_info, NULL);
-		}
-		
-		if (*dcursor)
-		{
-			g_string_append(includes,dcursor);
-		}
-		
-//		fprintf(stdout,"%s:%d INCLUDES [%s]\n",__FILE__,__LINE__,includes->str);
+		g_autofree char *path=g_file_get_path(location);
+		set_snippet_file_variables(self->values,path);
 	}
 	
-	return 0;
-}
-
-int finalize_fancy_snippet(GtkTextBuffer *buffer)
-{
-	g_autoptr(GMatchInfo) match_info=NULL;
-
-//	fprintf(stdout,"%s:%d FINALIZE []\n",__FILE__,__LINE__);
+	GtkSourceLanguage *language=gtk_source_buffer_get_language(GTK_SOURCE_BUFFER(buffer));
 	
-	const char *const insertion=GLOBAL_CURRENT_SNIPPET_TRANSLATION->to;
+	if(language)
+	{
+		self->values[SNIPPET_VARIABLE_LANGUAGE]=g_strdup(gtk_source_language_get_id(language));
+	}
 	
-	g_autoptr(GString) includes=g_string_sized_new(100);
-	g_autoptr(GString) result=g_string_sized_new(100);
+	g_object_set_data_full(G_OBJECT(buffer), DOCUMENT_VARIABLES_KEY, self, (GDestroyNotify)document_variables_free);
 	
-	//Analyze the input
-	if (g_regex_match(GLOBAL_REGEX_FIND_VARIABLES, insertion, 0, &match_info))
+	if(!g_object_get_data(G_OBJECT(buffer), "snippets-document-variables-watched"))
 	{
-		const char *cursor = insertion;
-		while (g_match_info_matches(match_info))
-		{
-			g_autofree char *match = g_match_info_fetch(match_info, 0);
-			gint start, end;
-			g_match_info_fetch_pos(match_info, 0, &start, &end);
-			
-			size_t cursor_len=start - (cursor - insertion);
-			
-			// Print text before match
-//			printf("Text: %.*s\n", (int)cursor_len, cursor);
-			g_string_append_len(result,cursor,cursor_len);
-			
-//			printf("Match: %s\n",match);
-			
-			//get the ids of all matches. This will focus on $123 and $<[123]: ... > ${123: ... }
-			if(match[0]=='$')
-			{
-				if(match[1]>='0' && match[1]<='9')
-				{
-					long long id_num=g_ascii_strtoll(match+1,NULL,10);
-					
-					Tab_position_object *value = g_hash_table_lookup(GLOBAL_POSITION_INFO_HASH_TABLE, GINT_TO_POINTER(id_num));
-					
-					if(value)
-					{
-						g_string_append(result,value->content);
-					}
-				}
-				else if(match[1]=='<')
-				{
-					//is return;
-					if(match[2]=='[')
-					{
-						const char *tmp=match+3;
-						while((*tmp)!=':' && (*tmp)!='\0')
-						{
-							tmp++;
-						}
-						
-						if((*tmp)!='\0')
-						{
-							tmp++;
-							const size_t tmp_len=strlen(tmp);
-						
-							g_autoptr(GString) return_res=g_string_sized_new(100);
-							g_string_append_len(return_res,tmp,tmp_len-1);
-							
-							g_autofree char *return_str=translate_python_block(includes->str,return_res->str);
-							
-							g_string_append(result,return_str);
-						}
-					}
-					//is include
-					else
-					{
-						const size_t match_len=strlen(match);
-						
-						g_autoptr(GString) includes_tmp=g_string_sized_new(100);
-						g_string_append_len(includes_tmp,match+2,match_len-3);
-						//g_string_append(includes_tmp,"\n");
-						
-						gstring_append_reformatted_dollar_string(includes,includes_tmp->str);
-					}
-				}
-				else if(match[1]=='{' && (match[2]>='0' && match[2]<='9'))
-				{
-					long long id_num=g_ascii_strtoll(match+2,NULL,10);
-				
-					Tab_position_object *value = g_hash_table_lookup(GLOBAL_POSITION_INFO_HASH_TABLE, GINT_TO_POINTER(id_num));
-					
-					if(value)
-					{
-						//fprintf(stdout,"%s:%d STRLEN: [%zu]\n",__FILE__,__LINE__,strlen(value->content));
-					
-						if(value->content && strlen(value->content)>0)
-						{
-							g_string_append(result,value->content);
-						}
-						else
-						{
-							const char *tmp=match+2;
-							while((*tmp)!=':' && (*tmp)!='\0')
-							{
-								tmp++;
-							}
-						
-							if((*tmp)!='\0')
-							{
-								tmp++;
-							
-								g_string_append_len(result,tmp,strlen(tmp)-1);
-							}
-						}
-					}
-				}
-			}
-			
-			cursor = insertion + end;
-			g_match_info_next(match_info, NULL);
-		}
-
-		// Print remaining text after last match
-		if (*cursor)
-		{
-//			printf("Text: %s\n", cursor);
-			g_string_append(result,cursor);
-		}
-		
-		size_t insertion_len=GLOBAL_SNIPPET_FILTERED_LEN;
+		g_object_set_data(G_OBJECT(buffer), "snippets-document-variables-watched", "y");
 		
-		GHashTableIter iter;
-		gpointer key, value;
-
-		g_hash_table_iter_init(&iter, GLOBAL_POSITION_INFO_HASH_TABLE);
-		while (g_hash_table_iter_next(&iter, &key, &value))
+		if(file)
 		{
-			Tab_position_object *iobj = value;
-			
-			insertion_len+=strlen(iobj->content);
+			g_signal_connect_object(file, "notify::location", G_CALLBACK(on_document_variables_changed), buffer, 0);
 		}
-		
-//		fprintf(stdout,"%s:%d TOTAL RESULT= [%s] [%zu]\n",__FILE__,__LINE__,result->str,insertion_len);
-		
-		gtk_text_buffer_begin_user_action(buffer);
-		
-		GtkTextIter start_iter;
-
-		gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, GLOBAL_SNIPPET_START_POS);
-		
-		GtkTextIter end_iter=start_iter;
-		
-		gtk_text_iter_forward_chars(&end_iter, insertion_len);
-		
-		// Remove the previous
-		gtk_text_buffer_delete(buffer, &start_iter, &end_iter);
-
-		// Now insert your new pythonized string
-		gtk_text_buffer_insert(buffer, &start_iter, result->str, -1);
-		
-		gtk_text_buffer_end_user_action(buffer);
+		g_signal_connect(buffer, "notify::language", G_CALLBACK(on_document_variables_changed), buffer);
 	}
 	
-	return 0;
+	return self;
 }
 
-int init_globals()
+static const char *get_document_variable(GtkTextBuffer *buffer, SnippetVariable variable, gpointer user_data)
 {
-	if(GLOBAL_POSITION_INFO_HASH_TABLE==NULL)
-	{
-		GError *error = NULL;
+	return get_document_variables(buffer)->values[variable];
+}
+
+static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
+{
+	GeditSnippetsPlugin *const plugin=user_data;
+	GtkTextBuffer *buffer=gtk_text_view_get_buffer(GTK_TEXT_VIEW(widget));
 	
-		GLOBAL_POSITION_INFO_HASH_TABLE=g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,(GDestroyNotify)_tab_position_object_free);
-		
-		const char *pattern = "\\$([0-9]+|<[^>]*>|{[^}]*})";
-		
-		GLOBAL_REGEX_FIND_VARIABLES = g_regex_new(pattern, G_REGEX_EXTENDED, 0, &error);
-		
-		if (!GLOBAL_REGEX_FIND_VARIABLES)
-		{
-			fprintf(stderr, "Regex compilation failed: %s\n", error->message);
-			g_error_free(error);
-			return -1;
-		}
-		
-		GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES = g_regex_new("\\$([0-9]+)", G_REGEX_EXTENDED, 0, &error);
-		
-		if (!GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES)
-		{
-			fprintf(stderr, "Regex compilation failed: %s\n", error->message);
-			g_error_free(error);
-			return -1;
-		}
-	}
-	else
+	const char *const programming_language=get_programming_language(plugin->priv->window);
+	
+	snippet_python_set_current(plugin->priv->python);
+	snippet_trace_key(buffer, programming_language, event->keyval, event->is_modifier);
+	
+	const gint64 start_time=snippet_trace_is_open()?g_get_monotonic_time():0;
+	SnippetTranslation *expanded=NULL;
+	
+	const gboolean handled=snippet_engine_key_press(buffer, programming_language, event->keyval, event->is_modifier, &expanded);
+	
+	if(expanded)
 	{
-		return reset_globals();
+		record_snippet_usage(expanded);
 	}
 	
-	return 0;
+	snippet_trace_key_result(buffer, handled, start_time?g_get_monotonic_time()-start_time:0);
+	
+	return handled;
 }
 
-void move_cursor_n_chars(GtkTextBuffer *buffer, gint n)
+static gboolean on_button_press_event(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
 {
-	GtkTextIter iter;
-
-	// Get current cursor position
-	gtk_text_buffer_get_iter_at_mark(buffer, &iter,
-		gtk_text_buffer_get_insert(buffer));
-
-	// Move forward or backward N chars
-	if (n > 0)
-		gtk_text_iter_forward_chars(&iter, n);
-	else if (n < 0)
-		gtk_text_iter_backward_chars(&iter, -n);
-
-	// Place cursor at new position
-	gtk_text_buffer_place_cursor(buffer, &iter);
+	//GeditSnippetsPlugin *const plugin=user_data;
+	
+	snippet_trace_button(gtk_text_view_get_buffer(GTK_TEXT_VIEW(widget)), event->button);
+	snippet_engine_button_press(event->button);
 
-	// Optional: scroll so it's visible
-	//GtkTextMark *mark = gtk_text_buffer_get_insert(buffer);
-	//gtk_text_view_scroll_mark_onscreen(GTK_TEXT_VIEW(gtk_text_buffer_get_tag_table(buffer)), mark);
+	return FALSE; // let Gedit handle normal selection/cursor movement
 }
 
-size_t get_position_relative_start(GtkTextBuffer *buffer)
+static void snippets_cb(GAction *action, GVariant *parameter, GeditSnippetsPlugin *plugin)
 {
-	GtkTextIter iter;
-	gtk_text_buffer_get_iter_at_mark(buffer,
-		                             &iter,
-		                             gtk_text_buffer_get_insert(buffer));
-
-	return gtk_text_iter_get_offset(&iter);
+	create_snippet_dialog(GTK_WIDGET(plugin->priv->app));
 }
 
-/**
-	1. Add output as blob (no data). but remember the position of all first positions of the ids
-	2. Move cursor to the first position in the blob. Add a state for next tabbing (maybe add some special color to know that we are in a special state). 
-	   If clicking somewhere, simply cancel everything.
-	3. After typing text and press tab. Store the typed text in the ids struct. Move to the next id. If last id is typed, now parse all the text again and insert.
-	   this step will most likely need some basic python pre-processing
-*/
-static int handle_first_insertion(GtkTextBuffer *buffer, GtkTextIter *start, SnippetTranslation *sntran)
+static void expand_selection_cb(GAction *action, GVariant *parameter, GeditSnippetsPlugin *plugin)
 {
-	GMatchInfo *match_info;
-	GError *error = NULL;
-	const char *const insertion=sntran->to;
+	GeditView *view = gedit_window_get_active_view(plugin->priv->window);
 	
-	init_globals();
-	GLOBAL_CURRENT_SNIPPET_TRANSLATION=sntran;
-
-	g_autofree char *result = g_regex_replace(GLOBAL_REGEX_FIND_VARIABLES, insertion, -1, 0, "", 0, &error);
-
-	if (error)
+	if(!view)
 	{
-		fprintf(stderr, "Regex replacement failed: %s\n", error->message);
-		g_error_free(error);
-		return -1;
-	}
-
-	//Analyze the input
-	if (g_regex_match(GLOBAL_REGEX_FIND_VARIABLES, insertion, 0, &match_info))
-	{
-		size_t in_blob_pos=0;
-	
-		const char *cursor = insertion;
-		while (g_match_info_matches(match_info))
-		{
-			g_autofree char *match = g_match_info_fetch(match_info, 0);
-			gint start, end;
-			g_match_info_fetch_pos(match_info, 0, &start, &end);
-			
-			size_t cursor_len=start - (cursor - insertion);
-			in_blob_pos+=cursor_len;
-			
-			// Print text before match
-//			printf("Text: %.*s\n", (int)cursor_len, cursor);
-//			printf("Match[%zu]: %s\n", in_blob_pos,match);
-			
-			//get the ids of all matches. This will focus on $123 and $<[123]: ... > ${123: ... }
-			if(match[0]=='$')
-			{
-				int match_pos=-1;
-			
-				if(match[1]>='0' && match[1]<='9')
-				{
-					match_pos=1;
-				}
-				else if(match[1]=='<' && match[2]=='[' && (match[3]>='0' && match[3]<='9'))
-				{
-					match_pos=3;
-				}
-				else if(match[1]=='{' && (match[2]>='0' && match[2]<='9'))
-				{
-					match_pos=2;
-				}
-				
-				if(match[1]=='<' || match[1]=='{')
-				{
-//					fprintf(stdout,"%s:%d EXP []\n",__FILE__,__LINE__);
-					GLOBAL_EXPAND_INTERNAL_CODE=1;
-				}
-				
-				if(match_pos>=0)
-				{
-					long long id_num=g_ascii_strtoll(match+match_pos,NULL,10);
-					
-					if(!g_hash_table_contains(GLOBAL_POSITION_INFO_HASH_TABLE,GINT_TO_POINTER(id_num)))
-					{
-						Tab_position_object *iobj = g_new0(Tab_position_object, 1);
-						iobj->in_blob=in_blob_pos;
-						iobj->start=start;
-						iobj->end=end;
-						iobj->number_of_objects=1;
-						
-						g_hash_table_insert(GLOBAL_POSITION_INFO_HASH_TABLE,GINT_TO_POINTER(id_num),iobj);
-					}
-					else
-					{
-						//more than one variable exists, need to expand
-						GLOBAL_EXPAND_INTERNAL_CODE=1;
-						
-						Tab_position_object *iobj = g_hash_table_lookup(GLOBAL_POSITION_INFO_HASH_TABLE,GINT_TO_POINTER(id_num));
-						if(iobj)
-						{
-							iobj->number_of_objects++;
-						}
-					}
-				}
-			}
-			
-			
-			cursor = insertion + end;
-			g_match_info_next(match_info, NULL);
-		}
-
-		// Print remaining text after last match
-//		if (*cursor)
-//		{
-//			printf("Text: %s\n", cursor);
-//		}
+		return;
 	}
 	
+	GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(view));
 	
-	
-	size_t GLOBAL_POSITION_INFO_HASH_TABLE_len=g_hash_table_size(GLOBAL_POSITION_INFO_HASH_TABLE);
-	
-//	fprintf(stdout,"%s:%d NUMBER OF OBJECTS [%zu]\n",__FILE__,__LINE__,GLOBAL_POSITION_INFO_HASH_TABLE_len);
-
-	g_match_info_free(match_info);
-	
-	GLOBAL_SNIPPET_START_POS=get_position_relative_start(buffer);
-	
-	//current easy fix
-	gtk_text_buffer_insert(buffer, start, result, -1);
-	
-	GLOBAL_SNIPPET_FILTERED_LEN=strlen(result);
-	
-	Tab_position_object *first_id_obj=get_next_tab_position(GLOBAL_POSITION_INFO_HASH_TABLE,GLOBAL_POSITION_STATE);
-	
-	//if has $1 etc
-	if(first_id_obj)
+	if(!gtk_text_buffer_get_has_selection(buffer))
 	{
-		move_cursor_n_chars(buffer, -GLOBAL_SNIPPET_FILTERED_LEN+first_id_obj->in_blob);
-		
-		size_t current_abs_pos=get_position_relative_start(buffer);
-		
-		first_id_obj->abs_start=current_abs_pos;
+		return;
 	}
 	
-	if((size_t)(GLOBAL_POSITION_STATE+1)==GLOBAL_POSITION_INFO_HASH_TABLE_len && GLOBAL_EXPAND_INTERNAL_CODE)
-	{
-		GLOBAL_EXPAND_INTERNAL_CODE=2;
-	}
+	g_autofree char *tag=NULL;
+	g_autofree char *pattern=NULL;
 	
-	if((size_t)(GLOBAL_POSITION_STATE+1)<GLOBAL_POSITION_INFO_HASH_TABLE_len)
+	if(!run_expand_selection_dialog(GTK_WIDGET(plugin->priv->window), &tag, &pattern))
 	{
-		GLOBAL_POSITION_STATE++;
-//		fprintf(stdout,"%s:%d INCREASED GLOBAL POSITION STATE [%d]\n",__FILE__,__LINE__,GLOBAL_POSITION_STATE);
+		return;
 	}
 	
-	return 0;
-}
-
-gboolean language_exists_in_obj(SnippetTranslation *self, const gchar *target)
-{
-	GPtrArray *const array=self->programming_languages;
-
-	for (guint i = 0; i < array->len; i++)
+	SnippetTranslation *sntran=find_snippet_translation(tag, get_programming_language(plugin->priv->window));
+	
+	if(!sntran)
 	{
-		const gchar *item = g_ptr_array_index(array, i);
-		if (g_ascii_strcasecmp(item, target) == 0)
-		{
-			return TRUE;
-		}
+		fprintf(stderr,"%s:%d No snippet named %s for this language.\n",__FILE__,__LINE__,tag);
+		return;
 	}
-	return FALSE;
-}
-
-int set_content_from_now(GtkTextBuffer *buffer,Tab_position_object *prev_id_pos)
-{
-	const size_t current_relative_pos=get_position_relative_start(buffer);
-				
-	GtkTextIter start_iter;
-	GtkTextIter end_iter;
-
-	gtk_text_buffer_get_iter_at_offset(buffer, &start_iter, prev_id_pos->abs_start);
-	gtk_text_buffer_get_iter_at_offset(buffer, &end_iter, current_relative_pos);
-
-	gchar *text_between = gtk_text_buffer_get_text(buffer, &start_iter, &end_iter, FALSE);
-
-//	fprintf(stdout,"%s:%d Text Between [%s]\n",__FILE__,__LINE__,text_between);
 	
-	prev_id_pos->content=text_between;
+	g_autoptr(GRegex) regex=NULL;
 	
-	return 0;
-}
-
-static gboolean on_key_press_event(GtkWidget *widget, GdkEventKey *event, gpointer user_data)
-{
-	GeditSnippetsPlugin *const plugin=user_data;
-	
-	const char *const programming_language=get_programming_language(plugin->priv->window);
+	snippet_python_set_current(plugin->priv->python);
 	
-	//When you press tab
-	if (event->keyval == GDK_KEY_Tab)
+	if(pattern && pattern[0]!='\0')
 	{
-		GeditView *view = GEDIT_VIEW(widget);
-		GtkTextBuffer *buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(view));
-		GtkTextIter iter, start;
-
-		/* Get the current cursor position */
-		gtk_text_buffer_get_iter_at_mark(buffer, &iter, gtk_text_buffer_get_insert(buffer));
+		g_autoptr(GError) error=NULL;
+		regex=g_regex_new(pattern, 0, 0, &error);
 		
-		if(GLOBAL_SNIPPETS)
+		if(!regex)
 		{
-			if(GLOBAL_EXPAND_INTERNAL_CODE==2)
-			{
-				Tab_position_object *curr_id_pos=get_next_tab_position(GLOBAL_POSITION_INFO_HASH_TABLE,GLOBAL_POSITION_STATE);
-				set_content_from_now(buffer,curr_id_pos);
-				finalize_fancy_snippet(buffer);
-				reset_globals();
-				return TRUE;
-			}
-			else if(GLOBAL_POSITION_STATE<=0)
-			{
-				for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
-				{
-					SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
-					/* Move start to the beginning of the word before the cursor */
-					gtk_text_iter_assign(&start, &iter);
-					gtk_text_iter_backward_chars(&start,sblk->str_len);
-
-					/* Extract the word before the cursor */
-					g_autofree gchar *word = gtk_text_buffer_get_text(buffer, &start, &iter, FALSE);
-					
-					for(guint j=0;j<sblk->nodes->len;j++)
-					{
-						SnippetTranslation *tmp=g_ptr_array_index(sblk->nodes,j);
-						if (g_strcmp0(word, tmp->from) == 0 && language_exists_in_obj(tmp,programming_language))
-						{
-							/* Replace "std_head" with the snippet */
-							gtk_text_buffer_begin_user_action(buffer);
-							
-							gtk_text_buffer_delete(buffer, &start, &iter);
-							int ret_result=handle_first_insertion(buffer, &start, tmp);
-							
-							if(ret_result!=0)
-							{
-								fprintf(stderr,"%s:%d Something went wrong to handle the first insertion.\n",__FILE__,__LINE__);
-							}
-							
-							gtk_text_buffer_end_user_action(buffer);
-							return TRUE;  // Stop event propagation
-						}
-					}
-				}
-			}
-			else
-			{
-				gtk_text_buffer_begin_user_action(buffer);
-				
-				Tab_position_object *prev_id_pos=get_next_tab_position(GLOBAL_POSITION_INFO_HASH_TABLE,GLOBAL_POSITION_STATE-1);
-				Tab_position_object *curr_id_pos=get_next_tab_position(GLOBAL_POSITION_INFO_HASH_TABLE,GLOBAL_POSITION_STATE);
-				
-//				const size_t current_relative_pos=get_position_relative_start(buffer);
-				
-				set_content_from_now(buffer,prev_id_pos);
-				
-				move_cursor_n_chars(buffer, curr_id_pos->in_blob-prev_id_pos->in_blob);
-				
-				curr_id_pos->abs_start=get_position_relative_start(buffer);
-				
-				size_t GLOBAL_POSITION_INFO_HASH_TABLE_len=g_hash_table_size(GLOBAL_POSITION_INFO_HASH_TABLE);
-	
-//				fprintf(stdout,"%s:%d NUMBER OF OBJECTS [%zu] [%d %d]\n",__FILE__,__LINE__,GLOBAL_POSITION_INFO_HASH_TABLE_len,
-//					GLOBAL_POSITION_STATE,GLOBAL_EXPAND_INTERNAL_CODE);
-				
-				if((size_t)(GLOBAL_POSITION_STATE+1)==GLOBAL_POSITION_INFO_HASH_TABLE_len && GLOBAL_EXPAND_INTERNAL_CODE)
-				{
-					GLOBAL_EXPAND_INTERNAL_CODE=2;
-				}
-				
-				if((size_t)(GLOBAL_POSITION_STATE+1)<GLOBAL_POSITION_INFO_HASH_TABLE_len)
-				{
-					GLOBAL_POSITION_STATE++;
-//					fprintf(stdout,"%s:%d INCREASED GLOBAL POSITION STATE [%d]\n",__FILE__,__LINE__,GLOBAL_POSITION_STATE);
-				}
-				else if(GLOBAL_EXPAND_INTERNAL_CODE!=2)
-				{
-					reset_globals();
-				}
-				
-				gtk_text_buffer_end_user_action(buffer);
-			
-				return TRUE;  // Stop event propagation
-			}
+			fprintf(stderr,"%s:%d Regex compilation failed: %s\n",__FILE__,__LINE__,error->message);
+			return;
 		}
 	}
-	return FALSE;
-}
-
-static gboolean on_button_press_event(GtkWidget *widget, GdkEventButton *event, gpointer user_data)
-{
-	//GeditSnippetsPlugin *const plugin=user_data;
-
-	if (event->button == 1) // left click
+	
+	if(expand_snippet_over_selection(buffer, sntran, regex)==0)
 	{
-//		g_print("Clicked at %.1f, %.1f in active document window\n",event->x, event->y);
-
-		reset_globals();
+		record_snippet_usage(sntran);
 	}
-
-	return FALSE; // let Gedit handle normal selection/cursor movement
 }
 
-static void snippets_cb(GAction *action, GVariant *parameter, GeditSnippetsPlugin *plugin)
+static void reset_python_cb(GAction *action, GVariant *parameter, GeditSnippetsPlugin *plugin)
 {
-	create_snippet_dialog(GTK_WIDGET(plugin->priv->app));
+	//whatever the snippets imported or changed goes with the old interpreter
+	snippet_python_reset(plugin->priv->python);
+	
+	//the window is left with the main interpreter if no new one could be created
+	g_simple_action_set_enabled(plugin->priv->reset_python_action, snippet_python_can_reset(plugin->priv->python));
 }
 
 static void update_ui(GeditSnippetsPlugin *plugin)
@@ -725,7 +272,10 @@ static void update_ui(GeditSnippetsPlugin *plugin)
 
 	view = gedit_window_get_active_view(plugin->priv->window);
 
-	g_simple_action_set_enabled(plugin->priv->snippets_action, (view != NULL) && gtk_text_view_get_editable(GTK_TEXT_VIEW(view)));
+	const gboolean editable=(view != NULL) && gtk_text_view_get_editable(GTK_TEXT_VIEW(view));
+
+	g_simple_action_set_enabled(plugin->priv->snippets_action, editable);
+	g_simple_action_set_enabled(plugin->priv->expand_selection_action, editable);
 }
 
 static void gedit_snippets_plugin_app_activate(GeditAppActivatable *activatable)
@@ -740,6 +290,14 @@ static void gedit_snippets_plugin_app_activate(GeditAppActivatable *activatable)
 	item = g_menu_item_new(_("Snippets"), "win.snippets");
 	gedit_menu_extension_append_menu_item(priv->menu_ext, item);
 	g_object_unref(item);
+	
+	item = g_menu_item_new(_("Expand Snippet over Selection"), "win.snippets-expand-selection");
+	gedit_menu_extension_append_menu_item(priv->menu_ext, item);
+	g_object_unref(item);
+	
+	item = g_menu_item_new(_("Restart Snippet Python"), "win.snippets-reset-python");
+	gedit_menu_extension_append_menu_item(priv->menu_ext, item);
+	g_object_unref(item);
 }
 
 static void gedit_snippets_plugin_app_deactivate(GeditAppActivatable *activatable)
@@ -763,6 +321,8 @@ static void on_tab_changed(GeditWindow *window, gpointer user_data)
 			// Ensure each new tab gets the key-press-event handler
 			g_signal_connect(view, "key-press-event", G_CALLBACK(on_key_press_event), user_data);
 			g_signal_connect(view, "button-press-event",G_CALLBACK(on_button_press_event), user_data);
+			
+			snippet_trace_watch_buffer(gtk_text_view_get_buffer(GTK_TEXT_VIEW(view)));
 
 		}
 	}
@@ -780,6 +340,17 @@ static void gedit_snippets_plugin_window_activate(GeditWindowActivatable *activa
 	g_signal_connect(priv->snippets_action, "activate", G_CALLBACK(snippets_cb), activatable);
 	g_action_map_add_action(G_ACTION_MAP(priv->window), G_ACTION(priv->snippets_action));
 	
+	priv->expand_selection_action = g_simple_action_new("snippets-expand-selection", NULL);
+	g_signal_connect(priv->expand_selection_action, "activate", G_CALLBACK(expand_selection_cb), activatable);
+	g_action_map_add_action(G_ACTION_MAP(priv->window), G_ACTION(priv->expand_selection_action));
+	
+	priv->reset_python_action = g_simple_action_new("snippets-reset-python", NULL);
+	g_signal_connect(priv->reset_python_action, "activate", G_CALLBACK(reset_python_cb), activatable);
+	g_action_map_add_action(G_ACTION_MAP(priv->window), G_ACTION(priv->reset_python_action));
+	
+	priv->python = snippet_python_new();
+	g_simple_action_set_enabled(priv->reset_python_action, snippet_python_can_reset(priv->python));
+	
 	update_ui(GEDIT_SNIPPETS_PLUGIN(activatable));
 	
 	g_signal_connect(priv->window, "active-tab-changed", G_CALLBACK(on_tab_changed), plugin);
@@ -790,7 +361,22 @@ static void gedit_snippets_plugin_window_deactivate(GeditWindowActivatable *acti
 	GeditSnippetsPluginPrivate *priv;
 
 	priv = GEDIT_SNIPPETS_PLUGIN(activatable)->priv;
+	
+	//only an insertion into a document of this window, another window may be inserting one
+	GList *documents = gedit_window_get_documents(priv->window);
+	
+	for (GList *l = documents; l != NULL; l = l->next)
+	{
+		cancel_buffer_chunked_insertion(GTK_TEXT_BUFFER(l->data));
+	}
+	
+	g_list_free(documents);
+	
 	g_action_map_remove_action(G_ACTION_MAP(priv->window), "snippets");
+	g_action_map_remove_action(G_ACTION_MAP(priv->window), "snippets-expand-selection");
+	g_action_map_remove_action(G_ACTION_MAP(priv->window), "snippets-reset-python");
+	
+	g_clear_pointer(&priv->python, snippet_python_free);
 }
 
 static void gedit_snippets_plugin_window_update_state(GeditWindowActivatable *activatable)
@@ -808,6 +394,8 @@ static void gedit_snippets_plugin_dispose(GObject *object)
 	GeditSnippetsPlugin *plugin = GEDIT_SNIPPETS_PLUGIN(object);
 
 	g_clear_object(&plugin->priv->snippets_action);
+	g_clear_object(&plugin->priv->expand_selection_action);
+	g_clear_object(&plugin->priv->reset_python_action);
 	g_clear_object(&plugin->priv->window);
 	g_clear_object(&plugin->priv->menu_ext);
 	g_clear_object(&plugin->priv->app);
@@ -858,7 +446,7 @@ static void gedit_snippets_plugin_get_property(GObject *object, guint prop_id, G
 
 static void gedit_snippets_plugin_class_init(GeditSnippetsPluginClass *klass)
 {
-	Py_Initialize();
+	snippet_python_init();
 	
 	GObjectClass *object_class = G_OBJECT_CLASS(klass);
 
@@ -868,7 +456,25 @@ static void gedit_snippets_plugin_class_init(GeditSnippetsPluginClass *klass)
 	object_class->get_property = gedit_snippets_plugin_get_property;
 	
 	configuration_init();
+	template_init();
+	
+	//the transformations are compiled while loading, not on the first expansion
+	snippet_index_set_added_func(prepare_snippet_transforms,NULL);
 	load_configuration();
+	
+	snippet_usage_init();
+	snippet_filter_init();
+	apply_snippet_usage();
+	
+	snippet_memory_set_session_func(get_snippet_engine_memory,NULL);
+	snippet_engine_set_document_func(get_document_variable,NULL);
+	
+	const char *trace_filename=g_getenv("GEDIT_SNIPPETS_TRACE");
+	
+	if(trace_filename && trace_filename[0]!='\0')
+	{
+		snippet_trace_open(trace_filename);
+	}
 
 	g_object_class_override_property(object_class, PROP_WINDOW, "window");
 	g_object_class_override_property(object_class, PROP_APP, "app");
@@ -876,11 +482,15 @@ static void gedit_snippets_plugin_class_init(GeditSnippetsPluginClass *klass)
 
 static void gedit_snippets_plugin_class_finalize(GeditSnippetsPluginClass *klass)
 {
-	g_hash_table_destroy(GLOBAL_POSITION_INFO_HASH_TABLE);
+	snippet_trace_close();
+	snippet_engine_finalize();
 
+	snippet_usage_finalize();
+	snippet_filter_finalize();
+	snippet_index_set_added_func(NULL,NULL);
 	configuration_finalize();
-
-	Py_FinalizeEx();
+	template_finalize();
+	snippet_python_finalize();
 }
 
 static void gedit_app_activatable_iface_init(GeditAppActivatableInterface *iface)
@@ -21,6 +21,7 @@ freely, subject to the following restrictions:
 
 #include <libpeas/peas-extension-base.h>
 #include <libpeas/peas-object-module.h>
+#include <gedit/gedit-window.h>
 
 G_BEGIN_DECLS
 
@@ -47,14 +48,8 @@ struct _GeditSnippetsPluginClass
     PeasExtensionBaseClass parent_class;
 };
 
-typedef struct Tab_position_object
-{
-	size_t in_blob, start, end, abs_start;
-	char *content;
-	size_t number_of_objects; ///< number of $i found
-}Tab_position_object;
-
 GType gedit_snippets_plugin_get_type(void) G_GNUC_CONST;
+const char *get_programming_language(GeditWindow *window);
 
 G_MODULE_EXPORT
 void peas_register_types(PeasObjectModule *module);
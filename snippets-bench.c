@@ -0,0 +1,300 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Measures the throughput of loading, looking up and rendering snippets on a synthetic
+	corpus, and compares it with a baseline recorded on the same machine.
+
+	Every case runs several times and keeps its best run, so a busy machine rather shows
+	up as noise than as a slowdown. Exits with 1 when a case is slower than its baseline
+	minus the threshold or has none, and with 2 when there is no baseline at all, since
+	there is nothing to compare with until one was recorded with --record.
+*/
+#include "gedit-snippets-python-handling.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-corpus.h"
+
+#define BENCH_SNIPPETS 10000
+#define BENCH_RUNS 5
+
+typedef struct BenchCase
+{
+	const char *name;
+	guint (*run)(); ///< returns the number of operations it did
+	double ops_per_sec; ///< best run
+}BenchCase;
+
+static const char *const GLOBAL_BENCH_VALUES[]={NULL,"index","count","do_something_useful"};
+
+static const char *get_bench_value(long long id, gpointer user_data)
+{
+	return id>0 && id<(long long)G_N_ELEMENTS(GLOBAL_BENCH_VALUES)?GLOBAL_BENCH_VALUES[id]:NULL;
+}
+
+static guint bench_load()
+{
+	load_configuration();
+	
+	return BENCH_SNIPPETS;
+}
+
+static guint bench_lookup()
+{
+	char tag[32];
+	char language[32];
+	guint found=0;
+	
+	for(guint i=0;i<BENCH_SNIPPETS;i++)
+	{
+		//spread over the corpus, not in file order
+		const guint id=(i*7919)%BENCH_SNIPPETS;
+		
+		snprintf(tag,sizeof(tag),"snippet%u",id);
+		snprintf(language,sizeof(language),"lang%u",id/SNIPPET_CORPUS_SNIPPETS_PER_FILE);
+		
+		found+=find_snippet_translation(tag,language)!=NULL;
+	}
+	
+	if(found!=BENCH_SNIPPETS)
+	{
+		fprintf(stderr,"%s:%d Only found %u of %u snippets\n",__FILE__,__LINE__,found,BENCH_SNIPPETS);
+	}
+	
+	return BENCH_SNIPPETS;
+}
+
+static guint bench_render()
+{
+	g_autoptr(GString) result=g_string_sized_new(256);
+	guint rendered=0;
+	
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		for(guint j=0;j<sblk->nodes->len;j++)
+		{
+			SnippetTranslation *sntran=g_ptr_array_index(sblk->nodes,j);
+			
+			g_string_truncate(result,0);
+			render_snippet_template(result,sntran->to,get_bench_value,NULL);
+			rendered++;
+		}
+	}
+	
+	return rendered;
+}
+
+static guint bench_transform()
+{
+	g_autoptr(GString) result=g_string_sized_new(256);
+	
+	for(guint i=0;i<BENCH_SNIPPETS;i++)
+	{
+		g_string_truncate(result,0);
+		render_snippet_template(result,"struct ${3/(\\w+)/${1:/pascalcase}/} ${3/_/-/g} ${1:/upcase}",get_bench_value,NULL);
+	}
+	
+	return BENCH_SNIPPETS;
+}
+
+//python blocks of the common kind, which run natively
+static guint bench_expression()
+{
+	g_autoptr(GString) result=g_string_sized_new(256);
+	
+	for(guint i=0;i<BENCH_SNIPPETS;i++)
+	{
+		g_string_truncate(result,0);
+		render_snippet_template(result,"$<[1]: return $1.upper() + '_' + str(len($2))>\n$<[1]: return '=' * len($1)>",get_bench_value,NULL);
+	}
+	
+	return BENCH_SNIPPETS;
+}
+
+static BenchCase GLOBAL_BENCH_CASES[]={
+	{"load",bench_load,0},
+	{"lookup",bench_lookup,0},
+	{"render",bench_render,0},
+	{"transform",bench_transform,0},
+	{"expression",bench_expression,0},
+};
+
+/**
+	Lines of "name ops_per_sec", # starts a comment. NULL when the file can not be read.
+*/
+static GHashTable *read_baseline(const char *filename)
+{
+	g_autofree char *contents=NULL;
+	g_autoptr(GError) error=NULL;
+	
+	if(!g_file_get_contents(filename,&contents,NULL,&error))
+	{
+		fprintf(stderr,"%s:%d Could not read the baseline: %s\n",__FILE__,__LINE__,error->message);
+		return NULL;
+	}
+	
+	GHashTable *baseline=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,g_free);
+	
+	g_auto(GStrv) lines=g_strsplit(contents,"\n",-1);
+	
+	for(guint i=0;lines[i];i++)
+	{
+		char name[64];
+		double ops_per_sec;
+		
+		if(lines[i][0]!='#' && sscanf(lines[i],"%63s %lf",name,&ops_per_sec)==2)
+		{
+			g_hash_table_insert(baseline,g_strdup(name),g_memdup2(&ops_per_sec,sizeof(ops_per_sec)));
+		}
+	}
+	
+	return baseline;
+}
+
+static int write_baseline(const char *filename)
+{
+	g_autoptr(GString) contents=g_string_new("# name operations_per_second, only valid on the machine that recorded it\n# rewrite with: make bench RECORD=1\n");
+	
+	for(size_t i=0;i<G_N_ELEMENTS(GLOBAL_BENCH_CASES);i++)
+	{
+		g_string_append_printf(contents,"%s %.0f\n",GLOBAL_BENCH_CASES[i].name,GLOBAL_BENCH_CASES[i].ops_per_sec);
+	}
+	
+	g_autoptr(GError) error=NULL;
+	
+	if(!g_file_set_contents(filename,contents->str,contents->len,&error))
+	{
+		fprintf(stderr,"%s:%d Could not write %s: %s\n",__FILE__,__LINE__,filename,error->message);
+		return -1;
+	}
+	
+	return 0;
+}
+
+static void run_bench_case(BenchCase *bench_case)
+{
+	for(int run=0;run<BENCH_RUNS;run++)
+	{
+		const gint64 start=g_get_monotonic_time();
+		const guint ops=bench_case->run();
+		const gint64 elapsed=MAX(g_get_monotonic_time()-start,1);
+		
+		bench_case->ops_per_sec=MAX(bench_case->ops_per_sec,ops*(double)G_USEC_PER_SEC/elapsed);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	g_autofree char *baseline_filename=NULL;
+	gboolean record=FALSE;
+	gint threshold=20;
+	
+	GOptionEntry entries[]={
+		{"baseline",'b',0,G_OPTION_ARG_FILENAME,&baseline_filename,"Baseline to compare with, bench.baseline by default","FILE"},
+		{"record",'r',0,G_OPTION_ARG_NONE,&record,"Write the measured throughput as the new baseline",NULL},
+		{"threshold",'t',0,G_OPTION_ARG_INT,&threshold,"Percent slower than the baseline that still passes, 20 by default","PERCENT"},
+		G_OPTION_ENTRY_NULL
+	};
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("- check the speed of loading and expanding snippets");
+	g_option_context_add_main_entries(context,entries,NULL);
+	
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+	
+	if(!baseline_filename)
+	{
+		baseline_filename=g_strdup("bench.baseline");
+	}
+	
+	//recording does not need one, anything else would pass without comparing
+	GHashTable *baseline=record?g_hash_table_new(g_str_hash,g_str_equal):read_baseline(baseline_filename);
+	
+	if(!baseline)
+	{
+		fprintf(stderr,"%s:%d There is no baseline to compare with, record one on this machine with: make bench RECORD=1\n",__FILE__,__LINE__);
+		return 2;
+	}
+	
+	char *home=snippet_corpus_new(BENCH_SNIPPETS);
+	
+	if(!home)
+	{
+		g_hash_table_destroy(baseline);
+		return 2;
+	}
+	
+	//the configuration only looks in $HOME and the system directories
+	g_setenv("HOME",home,TRUE);
+	
+	snippet_python_init();
+	configuration_init();
+	template_init();
+	
+	//like the plugin, so load includes compiling the transformations
+	snippet_index_set_added_func(prepare_snippet_transforms,NULL);
+	
+	int exit_status=0;
+	
+	printf("%-10s %14s %14s\n","case","ops/s","baseline");
+	
+	for(size_t i=0;i<G_N_ELEMENTS(GLOBAL_BENCH_CASES);i++)
+	{
+		BenchCase *bench_case=&GLOBAL_BENCH_CASES[i];
+		run_bench_case(bench_case);
+		
+		const double *baseline_ops=g_hash_table_lookup(baseline,bench_case->name);
+		const gboolean missing=!record && !baseline_ops;
+		const gboolean slower=!record && baseline_ops && bench_case->ops_per_sec*100<*baseline_ops*(100-threshold);
+		
+		printf("%-10s %14.0f %14.0f%s\n",bench_case->name,bench_case->ops_per_sec,baseline_ops?*baseline_ops:0,slower?"  SLOWER":missing?"  NO BASELINE":"");
+		
+		if(slower || missing)
+		{
+			exit_status=1;
+		}
+	}
+	
+	g_hash_table_destroy(baseline);
+	
+	template_finalize();
+	configuration_finalize();
+	snippet_python_finalize();
+	
+	snippet_corpus_free(home);
+	
+	if(record && write_baseline(baseline_filename)!=0)
+	{
+		return 2;
+	}
+	
+	return exit_status;
+}
@@ -0,0 +1,478 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Compiles snippet directories into a C source that holds the snippets as static data,
+	with every string stored once and a minimal perfect hash over language and trigger.
+	Linked into the plugin, those snippets need no file and no parsing at startup, the
+	snippet files are still read on top of them. See SNIPPETS_BUILTIN_DIRS in the Makefile.
+*/
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-builtin.h"
+
+//keys per bucket on average, smaller buckets take longer to place
+#define SNIPPET_COMPILE_BUCKET_SIZE 4
+#define SNIPPET_COMPILE_MAX_SEED (1u<<24)
+
+typedef struct CompileKey
+{
+	char *language; ///< lowercase
+	const char *trigger;
+	guint snippet;
+}CompileKey;
+
+typedef struct SnippetCompiler
+{
+	GString *strings; ///< source of the string pool, one string per line
+	gsize strings_size; ///< bytes in the pool, with the NULs
+	GHashTable *string_offsets; ///< string -> its offset in the pool
+	GString *languages; ///< source of the language lists
+	GHashTable *language_lists; ///< the list joined with '\n' -> its index
+	GString *snippets; ///< source of the SnippetTranslation initializers
+	guint snippets_len;
+	GArray *keys; ///< CompileKey
+	GHashTable *seen_keys; ///< "language\ntrigger", the first snippet of a key wins like in find_snippet_translation
+	GHashTable *trigger_lens;
+}SnippetCompiler;
+
+static void compile_key_clear(CompileKey *self)
+{
+	g_free(self->language);
+}
+
+static SnippetCompiler *snippet_compiler_new()
+{
+	SnippetCompiler *self=g_new0(SnippetCompiler,1);
+	self->strings=g_string_new(NULL);
+	self->string_offsets=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	self->languages=g_string_new(NULL);
+	self->language_lists=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	self->snippets=g_string_new(NULL);
+	self->keys=g_array_new(FALSE,TRUE,sizeof(CompileKey));
+	g_array_set_clear_func(self->keys,(GDestroyNotify)compile_key_clear);
+	self->seen_keys=g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+	self->trigger_lens=g_hash_table_new(g_direct_hash,g_direct_equal);
+	
+	return self;
+}
+
+static void snippet_compiler_free(SnippetCompiler *self)
+{
+	g_string_free(self->strings,TRUE);
+	g_hash_table_destroy(self->string_offsets);
+	g_string_free(self->languages,TRUE);
+	g_hash_table_destroy(self->language_lists);
+	g_string_free(self->snippets,TRUE);
+	g_array_free(self->keys,TRUE);
+	g_hash_table_destroy(self->seen_keys);
+	g_hash_table_destroy(self->trigger_lens);
+	g_free(self);
+}
+
+static void append_c_string(GString *out, const char *str)
+{
+	g_string_append_c(out,'"');
+	
+	for(const guchar *p=(const guchar *)str;*p;p++)
+	{
+		if(*p=='"' || *p=='\\' || *p=='?')
+		{
+			g_string_append_printf(out,"\\%c",*p);
+		}
+		else if(*p=='\n')
+		{
+			g_string_append(out,"\\n");
+		}
+		else if(*p=='\t')
+		{
+			g_string_append(out,"\\t");
+		}
+		else if(*p<0x20 || *p>=0x7f)
+		{
+			//always three digits, so a digit after it is not read as part of it
+			g_string_append_printf(out,"\\%03o",*p);
+		}
+		else
+		{
+			g_string_append_c(out,*p);
+		}
+	}
+	
+	g_string_append(out,"\\000\"");
+}
+
+//appends a pointer into the string pool, or NULL
+static void append_string_ref(SnippetCompiler *self, GString *out, const char *str)
+{
+	if(!str)
+	{
+		g_string_append(out,"NULL");
+		return;
+	}
+	
+	gpointer offset=NULL;
+	
+	if(!g_hash_table_lookup_extended(self->string_offsets,str,NULL,&offset))
+	{
+		offset=GSIZE_TO_POINTER(self->strings_size);
+		g_hash_table_insert(self->string_offsets,g_strdup(str),offset);
+		
+		g_string_append_c(self->strings,'\t');
+		append_c_string(self->strings,str);
+		g_string_append_c(self->strings,'\n');
+		self->strings_size+=strlen(str)+1;
+	}
+	
+	g_string_append_printf(out,"BUILTIN_STRINGS+%zu",GPOINTER_TO_SIZE(offset));
+}
+
+//the files share their language lists, so do the compiled snippets
+static guint add_language_list(SnippetCompiler *self, const char **languages)
+{
+	g_autofree char *joined=g_strjoinv("\n",(char **)languages);
+	gpointer index=NULL;
+	
+	if(g_hash_table_lookup_extended(self->language_lists,joined,NULL,&index))
+	{
+		return GPOINTER_TO_UINT(index);
+	}
+	
+	const guint new_index=g_hash_table_size(self->language_lists);
+	
+	g_string_append_printf(self->languages,"static const char *BUILTIN_LANGUAGES_%u[]={",new_index);
+	
+	for(guint i=0;languages[i];i++)
+	{
+		append_string_ref(self,self->languages,languages[i]);
+		g_string_append_c(self->languages,',');
+	}
+	
+	g_string_append(self->languages,"NULL};\n");
+	g_hash_table_insert(self->language_lists,g_steal_pointer(&joined),GUINT_TO_POINTER(new_index));
+	
+	return new_index;
+}
+
+static void add_snippet(SnippetCompiler *self, SnippetTranslation *sntran)
+{
+	const guint languages=add_language_list(self,sntran->programming_languages);
+	
+	g_string_append(self->snippets,"\t{.from=");
+	append_string_ref(self,self->snippets,sntran->from);
+	g_string_append(self->snippets,",.to=");
+	append_string_ref(self,self->snippets,sntran->to);
+	g_string_append(self->snippets,",.description=");
+	append_string_ref(self,self->snippets,sntran->description);
+	g_string_append_printf(self->snippets,",.programming_languages=BUILTIN_LANGUAGES_%u,.variables=0x%xu},\n",languages,sntran->variables);
+	
+	self->snippets_len++;
+}
+
+/**
+	Takes the snippets in the order the lookup sees them, the longest triggers first.
+	A snippet gets one key per language, and is only compiled if one of them is new.
+*/
+static void add_loaded_snippets(SnippetCompiler *self)
+{
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *block=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		for(guint j=0;j<block->nodes->len;j++)
+		{
+			SnippetTranslation *sntran=g_ptr_array_index(block->nodes,j);
+			gboolean added=FALSE;
+			
+			for(guint k=0;sntran->programming_languages[k];k++)
+			{
+				CompileKey key={g_ascii_strdown(sntran->programming_languages[k],-1),sntran->from,self->snippets_len};
+				
+				if(!g_hash_table_add(self->seen_keys,g_strdup_printf("%s\n%s",key.language,key.trigger)))
+				{
+					g_free(key.language);
+					continue;
+				}
+				
+				g_array_append_val(self->keys,key);
+				g_hash_table_add(self->trigger_lens,GSIZE_TO_POINTER(g_utf8_strlen(key.trigger,-1)));
+				added=TRUE;
+			}
+			
+			if(added)
+			{
+				add_snippet(self,sntran);
+			}
+		}
+	}
+}
+
+static gint compare_bucket_size(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GPtrArray *buckets=user_data;
+	const guint index_a=*(const guint *)a;
+	const guint index_b=*(const guint *)b;
+	const guint len_a=((GArray *)g_ptr_array_index(buckets,index_a))->len;
+	const guint len_b=((GArray *)g_ptr_array_index(buckets,index_b))->len;
+	
+	if(len_a!=len_b)
+	{
+		return len_a<len_b?1:-1;
+	}
+	
+	return index_a<index_b?-1:index_a>index_b;
+}
+
+/**
+	Hash and displace: the keys are split into buckets, and the biggest buckets are placed
+	first, each with the first seed that puts all of its keys in free slots. slots gets the
+	key of every slot, seeds the seed of every bucket.
+*/
+static int place_keys(GArray *keys, GArray *seeds, GArray *slots)
+{
+	const guint keys_len=keys->len;
+	const guint buckets_len=MAX(1,keys_len/SNIPPET_COMPILE_BUCKET_SIZE);
+	
+	g_array_set_size(seeds,buckets_len);
+	g_array_set_size(slots,keys_len);
+	
+	for(guint i=0;i<keys_len;i++)
+	{
+		g_array_index(slots,guint,i)=G_MAXUINT;
+	}
+	
+	g_autoptr(GPtrArray) buckets=g_ptr_array_new_with_free_func((GDestroyNotify)g_array_unref);
+	g_autoptr(GArray) order=g_array_sized_new(FALSE,FALSE,sizeof(guint),buckets_len);
+	
+	for(guint i=0;i<buckets_len;i++)
+	{
+		g_ptr_array_add(buckets,g_array_new(FALSE,FALSE,sizeof(guint)));
+		g_array_append_val(order,i);
+	}
+	
+	for(guint i=0;i<keys_len;i++)
+	{
+		CompileKey *key=&g_array_index(keys,CompileKey,i);
+		g_array_append_val(g_ptr_array_index(buckets,snippet_builtin_hash(key->language,key->trigger,0)%buckets_len),i);
+	}
+	
+	g_array_sort_with_data(order,compare_bucket_size,buckets);
+	
+	g_autoptr(GArray) bucket_slots=g_array_new(FALSE,FALSE,sizeof(guint));
+	
+	for(guint i=0;i<buckets_len;i++)
+	{
+		const guint bucket_index=g_array_index(order,guint,i);
+		GArray *bucket=g_ptr_array_index(buckets,bucket_index);
+		guint32 seed=1;
+		
+		g_array_set_size(bucket_slots,bucket->len);
+		
+		for(;seed<SNIPPET_COMPILE_MAX_SEED;seed++)
+		{
+			gboolean placed=TRUE;
+			
+			for(guint j=0;j<bucket->len && placed;j++)
+			{
+				CompileKey *key=&g_array_index(keys,CompileKey,g_array_index(bucket,guint,j));
+				const guint slot=snippet_builtin_hash(key->language,key->trigger,seed)%keys_len;
+				
+				placed=g_array_index(slots,guint,slot)==G_MAXUINT;
+				
+				for(guint k=0;k<j && placed;k++)
+				{
+					placed=g_array_index(bucket_slots,guint,k)!=slot;
+				}
+				
+				g_array_index(bucket_slots,guint,j)=slot;
+			}
+			
+			if(placed)
+			{
+				break;
+			}
+		}
+		
+		if(seed==SNIPPET_COMPILE_MAX_SEED)
+		{
+			fprintf(stderr,"%s:%d No seed places the %u keys of bucket %u\n",__FILE__,__LINE__,bucket->len,bucket_index);
+			return -1;
+		}
+		
+		g_array_index(seeds,guint32,bucket_index)=seed;
+		
+		for(guint j=0;j<bucket->len;j++)
+		{
+			g_array_index(slots,guint,g_array_index(bucket_slots,guint,j))=g_array_index(bucket,guint,j);
+		}
+	}
+	
+	return 0;
+}
+
+static gint compare_trigger_len(gconstpointer a, gconstpointer b)
+{
+	const guint len_a=*(const guint *)a;
+	const guint len_b=*(const guint *)b;
+	
+	return len_a<len_b?1:len_a>len_b?-1:0;
+}
+
+static int write_table(SnippetCompiler *self, GString *source, const char *const *dirs)
+{
+	g_autoptr(GArray) seeds=g_array_new(FALSE,TRUE,sizeof(guint32));
+	g_autoptr(GArray) slots=g_array_new(FALSE,FALSE,sizeof(guint));
+	
+	if(place_keys(self->keys,seeds,slots)!=0)
+	{
+		return -1;
+	}
+	
+	g_autoptr(GString) keys=g_string_new(NULL);
+	
+	for(guint i=0;i<slots->len;i++)
+	{
+		CompileKey *key=&g_array_index(self->keys,CompileKey,g_array_index(slots,guint,i));
+		
+		g_string_append(keys,"\t{");
+		append_string_ref(self,keys,key->language);
+		g_string_append_c(keys,',');
+		append_string_ref(self,keys,key->trigger);
+		g_string_append_printf(keys,",%u},\n",key->snippet);
+	}
+	
+	g_autoptr(GArray) trigger_lens=g_array_new(FALSE,FALSE,sizeof(guint));
+	GHashTableIter iter;
+	gpointer len;
+	g_hash_table_iter_init(&iter,self->trigger_lens);
+	
+	while(g_hash_table_iter_next(&iter,&len,NULL))
+	{
+		const guint trigger_len=GPOINTER_TO_UINT(len);
+		g_array_append_val(trigger_lens,trigger_len);
+	}
+	
+	g_array_sort(trigger_lens,compare_trigger_len);
+	
+	g_string_append(source,"//generated by snippets-compile from");
+	
+	for(guint i=0;dirs[i];i++)
+	{
+		g_string_append_printf(source," %s",dirs[i]);
+	}
+	
+	g_string_append(source,", do not edit\n#include \"gedit-snippets-builtin.h\"\n\nstatic const char BUILTIN_STRINGS[]=\n");
+	g_string_append_len(source,self->strings->str,self->strings->len);
+	g_string_append(source,"\t\"\";\n\n");
+	g_string_append_len(source,self->languages->str,self->languages->len);
+	g_string_append(source,"\nstatic SnippetTranslation BUILTIN_SNIPPETS[]={\n");
+	g_string_append_len(source,self->snippets->str,self->snippets->len);
+	g_string_append(source,"};\n\nstatic const SnippetBuiltinKey BUILTIN_KEYS[]={\n");
+	g_string_append_len(source,keys->str,keys->len);
+	g_string_append(source,"};\n\nstatic const guint32 BUILTIN_SEEDS[]={");
+	
+	for(guint i=0;i<seeds->len;i++)
+	{
+		g_string_append_printf(source,"%s%u",i%16==0?"\n\t":"",g_array_index(seeds,guint32,i));
+		g_string_append_c(source,',');
+	}
+	
+	g_string_append(source,"\n};\n\nstatic const guint BUILTIN_TRIGGER_LENS[]={");
+	
+	for(guint i=0;i<trigger_lens->len;i++)
+	{
+		g_string_append_printf(source,"%u,",g_array_index(trigger_lens,guint,i));
+	}
+	
+	g_string_append_printf(source,"};\n\nstatic const SnippetBuiltinTable BUILTIN_TABLE={BUILTIN_SNIPPETS,%u,BUILTIN_KEYS,%u,BUILTIN_SEEDS,%u,BUILTIN_TRIGGER_LENS,%u};\n\n",
+		self->snippets_len,slots->len,seeds->len,trigger_lens->len);
+	g_string_append(source,"const SnippetBuiltinTable *GLOBAL_SNIPPET_BUILTIN_TABLE=&BUILTIN_TABLE;\n");
+	
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	g_autofree char *output=NULL;
+	
+	GOptionEntry entries[]={
+		{"output",'o',0,G_OPTION_ARG_FILENAME,&output,"C source to write, stdout by default","FILE"},
+		G_OPTION_ENTRY_NULL
+	};
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("DIRECTORY... - compile snippet directories into a C table");
+	g_option_context_add_main_entries(context,entries,NULL);
+	
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+	
+	if(argc<2)
+	{
+		fprintf(stderr,"No snippet directory given\n");
+		return 2;
+	}
+	
+	const char *const *dirs=(const char *const *)argv+1;
+	
+	configuration_init();
+	load_snippet_directories(dirs);
+	
+	SnippetCompiler *compiler=snippet_compiler_new();
+	add_loaded_snippets(compiler);
+	
+	g_autoptr(GString) source=g_string_new(NULL);
+	int exit_status=0;
+	
+	if(compiler->keys->len==0)
+	{
+		fprintf(stderr,"No snippets found\n");
+		exit_status=1;
+	}
+	else if(write_table(compiler,source,dirs)!=0)
+	{
+		exit_status=1;
+	}
+	else if(output && !g_file_set_contents(output,source->str,source->len,&error))
+	{
+		fprintf(stderr,"%s:%d Could not write %s: %s\n",__FILE__,__LINE__,output,error->message);
+		exit_status=1;
+	}
+	else if(!output)
+	{
+		fwrite(source->str,1,source->len,stdout);
+	}
+	
+	if(exit_status==0)
+	{
+		fprintf(stderr,"%u snippets, %u keys, %zu bytes of strings\n",compiler->snippets_len,compiler->keys->len,compiler->strings_size);
+	}
+	
+	snippet_compiler_free(compiler);
+	configuration_finalize();
+	
+	return exit_status;
+}
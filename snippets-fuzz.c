@@ -0,0 +1,167 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Fuzzes the snippet file loader and the template renderer, built with -fsanitize=fuzzer.
+
+	Every input is loaded as a snippet file, and the text of every snippet it has is compiled
+	and rendered. The input itself is also rendered as a snippet text, so the seeds of
+	fuzz-corpus cover both. Python is never run: the python blocks that the expression
+	blocks do not cover render as failed, and $(command) renders as nothing.
+*/
+#include "gedit-snippets-python-handling.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libxml/parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+
+static char *GLOBAL_FUZZ_DIR=NULL;
+static char *GLOBAL_FUZZ_FILE=NULL;
+
+static const char *const GLOBAL_FUZZ_VALUES[]={NULL,"index","Count_of_things","do-something useful",""};
+
+//instead of gedit-snippets-python-handling.c, a fuzzer should not write python
+char *translate_python_block(const char *language, const char *globals_code, const char *return_code)
+{
+	return NULL;
+}
+
+int prepare_python_block(const char *return_code)
+{
+	return 0;
+}
+
+gboolean python_may_define_name(const char *language, const char *globals_code, const char *name)
+{
+	return FALSE;
+}
+
+char *take_python_error()
+{
+	return NULL;
+}
+
+int snippet_python_begin_uncached()
+{
+	return 0;
+}
+
+int snippet_python_end_uncached()
+{
+	return 0;
+}
+
+static const char *get_fuzz_value(long long id, gpointer user_data)
+{
+	return id>0 && id<(long long)G_N_ELEMENTS(GLOBAL_FUZZ_VALUES)?GLOBAL_FUZZ_VALUES[id]:NULL;
+}
+
+static void on_fuzz_xml_error(void *user_data, const char *message, ...)
+{
+}
+
+//libFuzzer has no teardown, only exit
+static void remove_fuzz_dir()
+{
+	g_unlink(GLOBAL_FUZZ_FILE);
+	g_rmdir(GLOBAL_FUZZ_DIR);
+}
+
+static void fuzz_template(GString *result, const char *text)
+{
+	prepare_snippet_template(text);
+	
+	g_string_truncate(result,0);
+	render_snippet_template(result,text,get_fuzz_value,NULL);
+	
+	//and like the preview
+	template_begin_uncached();
+	g_string_truncate(result,0);
+	render_snippet_template(result,text,get_fuzz_value,NULL);
+	template_end_uncached();
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	GLOBAL_FUZZ_DIR=g_dir_make_tmp("snippets-fuzz-XXXXXX",NULL);
+	
+	if(!GLOBAL_FUZZ_DIR)
+	{
+		fprintf(stderr,"%s:%d Could not make a temporary directory\n",__FILE__,__LINE__);
+		return -1;
+	}
+	
+	GLOBAL_FUZZ_FILE=g_build_filename(GLOBAL_FUZZ_DIR,"c.xml",NULL);
+	atexit(remove_fuzz_dir);
+	
+	//nothing of the user is loaded or written
+	g_setenv("HOME",GLOBAL_FUZZ_DIR,TRUE);
+	
+	configuration_init();
+	template_init();
+	xmlSetGenericErrorFunc(NULL,on_fuzz_xml_error);
+	
+	//like the plugin, so loading compiles the transformations
+	snippet_index_set_added_func(prepare_snippet_transforms,NULL);
+	
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const guint8 *data, size_t size)
+{
+	g_autofree char *text=g_strndup((const char *)data,size);
+	g_autoptr(GString) result=g_string_sized_new(256);
+	
+	//the editor only gets UTF-8, like the loader checks
+	if(strlen(text)==size && g_utf8_validate(text,-1,NULL))
+	{
+		fuzz_template(result,text);
+	}
+	
+	if(!g_file_set_contents(GLOBAL_FUZZ_FILE,(const char *)data,size,NULL))
+	{
+		return 0;
+	}
+	
+	const char *const dirs[]={GLOBAL_FUZZ_DIR,NULL};
+	load_snippet_directories(dirs);
+	
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *sblk=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		for(guint j=0;j<sblk->nodes->len;j++)
+		{
+			SnippetTranslation *sntran=g_ptr_array_index(sblk->nodes,j);
+			
+			fuzz_template(result,sntran->to);
+		}
+	}
+	
+	g_unlink(GLOBAL_FUZZ_FILE);
+	
+	return 0;
+}
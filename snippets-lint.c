@@ -0,0 +1,609 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Checks snippet directories without gedit, for example in a pre-commit hook.
+
+	The files are loaded by the same code as the plugin, then checked on a thread pool with
+	one thread per core: the xml, unclosed ${, $< and $(, python blocks and transformations
+	that refer to a tab stop the snippet does not have, unknown variables, regexes that do
+	not compile, python blocks and <language>.py helpers that do not compile, and triggers
+	that are in the same directory twice. Python is only compiled, never run.
+
+	Problems are printed as file:line: message, in the order of the files. Exits with 1 when
+	there was any.
+*/
+#include "gedit-snippets-python-handling.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-expression.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-variables.h"
+
+typedef struct LintFile
+{
+	char *filepath;
+	XmlFileInformation *fileinf; ///< NULL for the files that did not load and the python helpers
+	GArray *messages; ///< LintMessage
+}LintFile;
+
+typedef struct LintMessage
+{
+	long line;
+	guint order; ///< keeps messages of the same line in the order they were found
+	char *text; ///< "file:line: message"
+}LintMessage;
+
+//what one snippet body has and refers to, $N inside defaults included
+typedef struct LintSnippet
+{
+	LintFile *file;
+	const char *text; ///< the whole body, offsets are into it
+	long line; ///< of the start of text
+	GHashTable *stops; ///< id of every $N, ${N} and ${N:default}
+	GArray *references; ///< LintReference
+}LintSnippet;
+
+//a $N read by a native expression block
+typedef struct LintExpressionStop
+{
+	LintSnippet *snippet;
+	gsize offset;
+}LintExpressionStop;
+
+typedef struct LintReference
+{
+	long long id;
+	long line;
+	const char *kind; ///< for the message
+}LintReference;
+
+static void lint_message_clear(LintMessage *self)
+{
+	g_free(self->text);
+}
+
+static void lint_file_free(LintFile *self)
+{
+	g_free(self->filepath);
+	g_array_free(self->messages,TRUE);
+	g_free(self);
+}
+
+static gint compare_lint_message(gconstpointer a, gconstpointer b)
+{
+	const LintMessage *message1=a;
+	const LintMessage *message2=b;
+	
+	if(message1->line!=message2->line)
+	{
+		return message1->line<message2->line?-1:1;
+	}
+	
+	return message1->order<message2->order?-1:message1->order>message2->order;
+}
+
+static LintFile *lint_file_new(const char *filepath, XmlFileInformation *fileinf)
+{
+	LintFile *self=g_new0(LintFile,1);
+	self->filepath=g_strdup(filepath);
+	self->fileinf=fileinf;
+	self->messages=g_array_new(FALSE,FALSE,sizeof(LintMessage));
+	g_array_set_clear_func(self->messages,(GDestroyNotify)lint_message_clear);
+	
+	return self;
+}
+
+static void add_lint_message(LintFile *self, long line, const char *format, ...) G_GNUC_PRINTF(3,4);
+
+static void add_lint_message(LintFile *self, long line, const char *format, ...)
+{
+	va_list args;
+	va_start(args,format);
+	g_autofree char *message=g_strdup_vprintf(format,args);
+	va_end(args);
+	
+	LintMessage lint_message={.line=line,.order=self->messages->len,.text=g_strdup_printf("%s:%ld: %s",self->filepath,line,message)};
+	g_array_append_val(self->messages,lint_message);
+}
+
+static long get_lint_line(LintSnippet *self, gsize offset)
+{
+	long line=self->line;
+	
+	for(gsize i=0;i<offset && self->text[i];i++)
+	{
+		line+=self->text[i]=='\n';
+	}
+	
+	return line;
+}
+
+static void add_lint_reference(LintSnippet *self, long long id, gsize offset, const char *kind)
+{
+	//the line now, a default has offsets of its own
+	LintReference reference={.id=id,.line=get_lint_line(self,offset),.kind=kind};
+	g_array_append_val(self->references,reference);
+}
+
+static void lint_python(LintSnippet *self, gsize offset, const char *code)
+{
+	long error_line=0;
+	g_autofree char *error=check_python_code(code,"<snippet>",&error_line);
+	
+	if(error)
+	{
+		add_lint_message(self->file,get_lint_line(self,offset)+MAX(error_line-1,0),"python block does not compile: %s",error);
+	}
+}
+
+static void add_lint_expression_reference(long long id, gpointer user_data)
+{
+	LintExpressionStop *stop=user_data;
+	add_lint_reference(stop->snippet,id,stop->offset,"expression block");
+}
+
+//the includes get the values of the tab stops as strings, like when they run
+static const char *get_lint_value(long long id, gpointer user_data)
+{
+	return "";
+}
+
+static void lint_segment(LintSnippet *self, const char *segment);
+
+//one match of GLOBAL_REGEX_FIND_VARIABLES, at offset in the body
+static void lint_match(LintSnippet *self, const char *match, gsize offset)
+{
+	const char *body=NULL;
+	
+	if(g_ascii_isdigit(match[1]))
+	{
+		g_hash_table_add(self->stops,GINT_TO_POINTER(g_ascii_strtoll(match+1,NULL,10)));
+	}
+	else if(match[1]=='{' && g_ascii_isdigit(match[2]))
+	{
+		char *id_end=NULL;
+		const long long id_num=g_ascii_strtoll(match+2,&id_end,10);
+		const gssize body_len=get_match_body(match,id_end-match+1,'}',&body);
+		
+		if(*id_end=='/' && body_len>=0)
+		{
+			g_autofree char *error=check_snippet_transform(body,body_len);
+			
+			if(error)
+			{
+				add_lint_message(self->file,get_lint_line(self,offset),"transformation of $%lld does not compile: %s",id_num,error);
+			}
+			
+			add_lint_reference(self,id_num,offset,"transformation");
+		}
+		else if(*id_end==':' && body_len>=0)
+		{
+			g_hash_table_add(self->stops,GINT_TO_POINTER(id_num));
+			
+			//the default is walked with offsets of its own, it shares the stops and references
+			g_autofree char *default_text=g_strndup(body,body_len);
+			LintSnippet nested=*self;
+			nested.text=default_text;
+			nested.line=get_lint_line(self,offset+(body-match));
+			lint_segment(&nested,default_text);
+		}
+		else if(*id_end=='}')
+		{
+			g_hash_table_add(self->stops,GINT_TO_POINTER(id_num));
+		}
+		else
+		{
+			add_lint_message(self->file,get_lint_line(self,offset),"unknown placeholder %s",match);
+		}
+	}
+	else if(match[1]=='<')
+	{
+		const gssize body_len=get_match_body(match,2,'>',&body);
+		
+		if(match[2]=='[')
+		{
+			const char *colon=body_len>0?memchr(body,':',body_len):NULL;
+			
+			if(!colon || !g_ascii_isdigit(match[3]))
+			{
+				add_lint_message(self->file,get_lint_line(self,offset),"python block needs the form $<[N]: code>");
+				return;
+			}
+			
+			add_lint_reference(self,g_ascii_strtoll(match+3,NULL,10),offset,"python block");
+			
+			g_autofree char *return_code=g_strndup(colon+1,body+body_len-colon-1);
+			SnippetExpression *expression=snippet_expression_compile(return_code);
+			
+			//a native block never reaches python
+			if(expression)
+			{
+				LintExpressionStop stop={.snippet=self,.offset=offset};
+				snippet_expression_foreach_stop(expression,add_lint_expression_reference,&stop);
+				snippet_expression_free(expression);
+				return;
+			}
+			
+			g_autofree char *python_code=get_python_block_code(return_code,NULL,NULL,NULL);
+			g_autofree char *wrapped_code=g_strdup_printf("def __tempfunc(): %s\n",python_code);
+			lint_python(self,offset,wrapped_code);
+		}
+		else if(body_len>=0)
+		{
+			g_autofree char *include=g_strndup(body,body_len);
+			g_autoptr(GMatchInfo) match_info=NULL;
+			
+			g_regex_match(GLOBAL_REGEX_FIND_ONLY_DOLLAR_VARIABLES,include,0,&match_info);
+			
+			while(g_match_info_matches(match_info))
+			{
+				g_autofree char *id=g_match_info_fetch(match_info,1);
+				add_lint_reference(self,g_ascii_strtoll(id,NULL,10),offset,"python include");
+				g_match_info_next(match_info,NULL);
+			}
+			
+			g_autoptr(GString) code=g_string_new(NULL);
+			gstring_append_reformatted_dollar_string(code,include,get_lint_value,NULL);
+			
+			//without any $N it is left out of code
+			lint_python(self,offset,code->len>0?code->str:include);
+		}
+	}
+	else if(match[1]=='G' || (match[1]=='{' && match[2]=='G'))
+	{
+		if(get_match_variable(match)<0)
+		{
+			add_lint_message(self->file,get_lint_line(self,offset),"unknown variable %s",match);
+		}
+	}
+	else if(match[1]=='{')
+	{
+		add_lint_message(self->file,get_lint_line(self,offset),"unknown placeholder %s",match);
+	}
+}
+
+//text between two matches, anything that opens a placeholder there was never closed
+static void lint_gap(LintSnippet *self, gsize offset, const char *gap, gsize gap_len)
+{
+	for(gsize i=0;i+1<gap_len;i++)
+	{
+		if(gap[i]=='$' && strchr("{<(",gap[i+1]))
+		{
+			add_lint_message(self->file,get_lint_line(self,offset+i),"$%c is never closed",gap[i+1]);
+		}
+	}
+}
+
+static void lint_segment(LintSnippet *self, const char *segment)
+{
+	g_autoptr(GMatchInfo) match_info=NULL;
+	gsize cursor=0;
+	
+	g_regex_match(GLOBAL_REGEX_FIND_VARIABLES,segment,0,&match_info);
+	
+	while(g_match_info_matches(match_info))
+	{
+		g_autofree char *match=g_match_info_fetch(match_info,0);
+		gint start, end;
+		g_match_info_fetch_pos(match_info,0,&start,&end);
+		
+		lint_gap(self,cursor,segment+cursor,start-cursor);
+		lint_match(self,match,start);
+		
+		cursor=end;
+		g_match_info_next(match_info,NULL);
+	}
+	
+	lint_gap(self,cursor,segment+cursor,strlen(segment+cursor));
+}
+
+static void lint_snippet_text(LintFile *file, const char *text, long line)
+{
+	LintSnippet snippet={
+		.file=file,
+		.text=text,
+		.line=line,
+		.stops=g_hash_table_new(g_direct_hash,g_direct_equal),
+		.references=g_array_new(FALSE,FALSE,sizeof(LintReference)),
+	};
+	
+	lint_segment(&snippet,text);
+	
+	for(guint i=0;i<snippet.references->len;i++)
+	{
+		LintReference *reference=&g_array_index(snippet.references,LintReference,i);
+		
+		if(!g_hash_table_contains(snippet.stops,GINT_TO_POINTER(reference->id)))
+		{
+			add_lint_message(file,reference->line,"%s refers to $%lld, which is not a tab stop of the snippet",reference->kind,reference->id);
+		}
+	}
+	
+	g_hash_table_destroy(snippet.stops);
+	g_array_free(snippet.references,TRUE);
+}
+
+static xmlNode *get_snippet_field(xmlNode *node, const char *name)
+{
+	for(xmlNode *child=node->children;child;child=child->next)
+	{
+		if(child->type==XML_ELEMENT_NODE && g_strcmp0((const char *)child->name,name)==0)
+		{
+			return child;
+		}
+	}
+	
+	return NULL;
+}
+
+static void lint_snippet_node(LintFile *self, xmlNode *node)
+{
+	xmlNode *tag_node=get_snippet_field(node,"tag");
+	xmlNode *text_node=get_snippet_field(node,"text");
+	
+	g_autofree char *tag=tag_node?(char *)xmlNodeGetContent(tag_node):NULL;
+	g_autofree char *text=text_node?(char *)xmlNodeGetContent(text_node):NULL;
+	
+	if(!tag || !text)
+	{
+		add_lint_message(self,xmlGetLineNo(node),"snippet without <%s>, it is not loaded",tag?"text":"tag");
+	}
+	else if(!g_utf8_validate(tag,-1,NULL) || !g_utf8_validate(text,-1,NULL))
+	{
+		add_lint_message(self,xmlGetLineNo(node),"snippet is not valid UTF-8, it is not loaded");
+	}
+	else if(tag[0]=='\0')
+	{
+		add_lint_message(self,xmlGetLineNo(tag_node),"empty <tag>, the snippet can never be expanded");
+	}
+	else
+	{
+		lint_snippet_text(self,text,xmlGetLineNo(text_node));
+	}
+}
+
+//for the files the loader could not read
+static void lint_unloaded_file(LintFile *self)
+{
+	xmlParserCtxtPtr ctxt=xmlNewParserCtxt();
+	xmlDocPtr doc=ctxt?xmlCtxtReadFile(ctxt,self->filepath,NULL,XML_PARSE_NONET|XML_PARSE_NOERROR|XML_PARSE_NOWARNING):NULL;
+	
+	if(doc)
+	{
+		//changed since it was loaded
+		xmlFreeDoc(doc);
+	}
+	else
+	{
+		const xmlError *error=ctxt?xmlCtxtGetLastError(ctxt):NULL;
+		g_autofree char *message=g_strdup(error && error->message?error->message:"could not be read");
+		
+		add_lint_message(self,error?error->line:0,"%s, the file is not loaded",g_strchomp(message));
+	}
+	
+	xmlFreeParserCtxt(ctxt);
+}
+
+static void lint_python_helpers(LintFile *self)
+{
+	g_autofree char *source=NULL;
+	g_autoptr(GError) error=NULL;
+	
+	if(!g_file_get_contents(self->filepath,&source,NULL,&error))
+	{
+		add_lint_message(self,0,"%s",error->message);
+		return;
+	}
+	
+	long error_line=0;
+	g_autofree char *python_error=check_python_code(source,self->filepath,&error_line);
+	
+	if(python_error)
+	{
+		add_lint_message(self,error_line,"python helpers do not compile: %s",python_error);
+	}
+}
+
+static void lint_file(gpointer data, gpointer user_data)
+{
+	LintFile *self=data;
+	
+	if(g_str_has_suffix(self->filepath,".py"))
+	{
+		lint_python_helpers(self);
+		return;
+	}
+	else if(!self->fileinf)
+	{
+		lint_unloaded_file(self);
+		return;
+	}
+	
+	xmlNode *root=xmlDocGetRootElement(self->fileinf->doc);
+	
+	for(xmlNode *node=root?root->children:NULL;node;node=node->next)
+	{
+		if(node->type==XML_ELEMENT_NODE && g_strcmp0((const char *)node->name,"snippet")==0)
+		{
+			lint_snippet_node(self,node);
+		}
+	}
+}
+
+/**
+	Triggers a directory has twice for a language. Across directories it is an override, which
+	the loader resolves the same way, so those are left alone.
+*/
+static void lint_duplicate(GHashTable *files_by_info, SnippetTranslation *sntran)
+{
+	SnippetTranslation *winner=sntran->shadowed_by;
+	
+	if(!winner || !sntran->fileinf || !winner->fileinf || sntran->fileinf->layer!=winner->fileinf->layer)
+	{
+		return;
+	}
+	
+	LintFile *file=g_hash_table_lookup(files_by_info,sntran->fileinf);
+	
+	if(file)
+	{
+		add_lint_message(file,xmlGetLineNo(sntran->child),"duplicate tag \"%s\", %s:%ld has it first",sntran->from,winner->fileinf->filename,xmlGetLineNo(winner->child));
+	}
+}
+
+static void add_directory_files(GPtrArray *files, GHashTable *files_by_info, const char *directory)
+{
+	g_autoptr(GDir) dir=g_dir_open(directory,0,NULL);
+	
+	if(!dir)
+	{
+		return;
+	}
+	
+	g_autoptr(GPtrArray) filenames=g_ptr_array_new_with_free_func(g_free);
+	const char *filename;
+	
+	while((filename=g_dir_read_name(dir)))
+	{
+		if(g_str_has_suffix(filename,".xml") || g_str_has_suffix(filename,".py"))
+		{
+			g_ptr_array_add(filenames,g_strdup(filename));
+		}
+	}
+	
+	g_ptr_array_sort(filenames,(GCompareFunc)g_strcmp0);
+	
+	for(guint i=0;i<filenames->len;i++)
+	{
+		g_autofree char *filepath=g_build_filename(directory,g_ptr_array_index(filenames,i),NULL);
+		XmlFileInformation *fileinf=g_hash_table_lookup(GLOBAL_XML_FILE_INFO,filepath);
+		LintFile *file=lint_file_new(filepath,fileinf);
+		
+		g_ptr_array_add(files,file);
+		
+		if(fileinf)
+		{
+			g_hash_table_insert(files_by_info,fileinf,file);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	gint jobs_count=0;
+	
+	GOptionEntry entries[]={
+		{"jobs",'j',0,G_OPTION_ARG_INT,&jobs_count,"Number of threads, the number of cores by default","N"},
+		G_OPTION_ENTRY_NULL
+	};
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("[DIRECTORY...] - check snippet directories, the ones gedit reads by default");
+	g_option_context_add_main_entries(context,entries,NULL);
+	
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+	
+	g_auto(GStrv) default_dirs=argc<2?get_snippet_directories():NULL;
+	const char *const *dirs=default_dirs?(const char *const *)default_dirs:(const char *const *)argv+1;
+	
+	configuration_init();
+	template_init();
+	load_snippet_directories(dirs);
+	
+	g_autoptr(GPtrArray) files=g_ptr_array_new_with_free_func((GDestroyNotify)lint_file_free);
+	g_autoptr(GHashTable) files_by_info=g_hash_table_new(g_direct_hash,g_direct_equal);
+	
+	for(size_t i=0;dirs[i];i++)
+	{
+		add_directory_files(files,files_by_info,dirs[i]);
+	}
+	
+	for(guint i=0;i<GLOBAL_SNIPPETS->len;i++)
+	{
+		SnippetBlock *block=g_ptr_array_index(GLOBAL_SNIPPETS,i);
+		
+		for(guint j=0;j<block->nodes->len;j++)
+		{
+			lint_duplicate(files_by_info,g_ptr_array_index(block->nodes,j));
+		}
+	}
+	
+	for(guint i=0;i<GLOBAL_SHADOWED_SNIPPETS->len;i++)
+	{
+		lint_duplicate(files_by_info,g_ptr_array_index(GLOBAL_SHADOWED_SNIPPETS,i));
+	}
+	
+	//the threads take the GIL only to compile
+	snippet_python_init();
+	
+	const guint threads_len=jobs_count>0?(guint)jobs_count:g_get_num_processors();
+	GThreadPool *pool=threads_len>1?g_thread_pool_new(lint_file,NULL,threads_len,FALSE,NULL):NULL;
+	
+	for(guint i=0;i<files->len;i++)
+	{
+		if(pool)
+		{
+			g_thread_pool_push(pool,g_ptr_array_index(files,i),NULL);
+		}
+		else
+		{
+			lint_file(g_ptr_array_index(files,i),NULL);
+		}
+	}
+	
+	if(pool)
+	{
+		//waits for the queued files
+		g_thread_pool_free(pool,FALSE,TRUE);
+	}
+	
+	snippet_python_finalize();
+	
+	guint problems=0;
+	
+	for(guint i=0;i<files->len;i++)
+	{
+		LintFile *file=g_ptr_array_index(files,i);
+		g_array_sort(file->messages,compare_lint_message);
+		
+		for(guint j=0;j<file->messages->len;j++)
+		{
+			printf("%s\n",g_array_index(file->messages,LintMessage,j).text);
+		}
+		
+		problems+=file->messages->len;
+	}
+	
+	fprintf(stderr,"%u files, %u problems\n",files->len,problems);
+	
+	template_finalize();
+	configuration_finalize();
+	
+	return problems>0?1:0;
+}
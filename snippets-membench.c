@@ -0,0 +1,256 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Loads synthetic snippet corpora of set sizes, without gedit, and compares how much
+	the memory of the process grows while loading against a recorded budget.
+
+	Each corpus is written to a temporary $HOME and loaded in a forked process, so the
+	peak resident size of one size does not hide the next. Exits with 1 when a corpus
+	takes more than its budget plus the tolerance.
+*/
+#include <glib.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-memory.h"
+#include "gedit-snippets-corpus.h"
+
+static const guint GLOBAL_MEMBENCH_SIZES[]={1000,10000,50000};
+
+typedef struct MembenchResult
+{
+	guint snippets;
+	long peak_kb; ///< growth of the peak resident size while loading
+	size_t index_bytes;
+	size_t xml_bytes;
+}MembenchResult;
+
+static long get_peak_kb()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF,&usage);
+	
+	return usage.ru_maxrss;
+}
+
+/**
+	Runs in the forked process: loads the corpus and writes the result to fd.
+*/
+static int load_corpus(guint snippets, int fd)
+{
+	MembenchResult result={snippets,0,0,0};
+	
+	const long before_kb=get_peak_kb();
+	
+	configuration_init();
+	load_configuration();
+	
+	result.peak_kb=get_peak_kb()-before_kb;
+	
+	SnippetMemoryReport *report=snippet_memory_report_new();
+	result.index_bytes=report->bytes[SNIPPET_MEMORY_INDEX];
+	result.xml_bytes=report->bytes[SNIPPET_MEMORY_XML];
+	snippet_memory_report_free(report);
+	
+	configuration_finalize();
+	
+	if(write(fd,&result,sizeof(result))!=sizeof(result))
+	{
+		return 1;
+	}
+	
+	return 0;
+}
+
+static int run_corpus(guint snippets, MembenchResult *result)
+{
+	char *home=snippet_corpus_new(snippets);
+	int status=-1;
+	int result_pipe[2];
+	
+	if(!home)
+	{
+		return -1;
+	}
+	
+	if(pipe(result_pipe)!=0)
+	{
+		fprintf(stderr,"%s:%d Could not create a pipe: %s\n",__FILE__,__LINE__,g_strerror(errno));
+		snippet_corpus_free(home);
+		return -1;
+	}
+	
+	fflush(stdout);
+	
+	pid_t pid=fork();
+	
+	if(pid==0)
+	{
+		close(result_pipe[0]);
+		
+		//the configuration only looks in $HOME and the system directories
+		g_setenv("HOME",home,TRUE);
+		
+		_exit(load_corpus(snippets,result_pipe[1]));
+	}
+	
+	close(result_pipe[1]);
+	
+	if(pid<0)
+	{
+		fprintf(stderr,"%s:%d Could not fork: %s\n",__FILE__,__LINE__,g_strerror(errno));
+	}
+	else if(read(result_pipe[0],result,sizeof(*result))==sizeof(*result))
+	{
+		status=0;
+	}
+	
+	close(result_pipe[0]);
+	
+	if(pid>0)
+	{
+		waitpid(pid,NULL,0);
+	}
+	
+	snippet_corpus_free(home);
+	
+	return status;
+}
+
+/**
+	Lines of "snippets peak_kb", # starts a comment.
+*/
+static GHashTable *read_budget(const char *filename)
+{
+	GHashTable *budget=g_hash_table_new(g_direct_hash,g_direct_equal);
+	g_autofree char *contents=NULL;
+	
+	if(!g_file_get_contents(filename,&contents,NULL,NULL))
+	{
+		return budget;
+	}
+	
+	g_auto(GStrv) lines=g_strsplit(contents,"\n",-1);
+	
+	for(guint i=0;lines[i];i++)
+	{
+		guint snippets;
+		long peak_kb;
+		
+		if(lines[i][0]!='#' && sscanf(lines[i],"%u %ld",&snippets,&peak_kb)==2)
+		{
+			g_hash_table_insert(budget,GUINT_TO_POINTER(snippets),GSIZE_TO_POINTER(peak_kb));
+		}
+	}
+	
+	return budget;
+}
+
+static int write_budget(const char *filename, MembenchResult *results, size_t results_len)
+{
+	g_autoptr(GString) contents=g_string_new("# snippets peak_kb, the growth of the peak resident size while loading\n# rewrite with: make membench RECORD=1\n");
+	
+	for(size_t i=0;i<results_len;i++)
+	{
+		g_string_append_printf(contents,"%u %ld\n",results[i].snippets,results[i].peak_kb);
+	}
+	
+	g_autoptr(GError) error=NULL;
+	
+	if(!g_file_set_contents(filename,contents->str,contents->len,&error))
+	{
+		fprintf(stderr,"%s:%d Could not write %s: %s\n",__FILE__,__LINE__,filename,error->message);
+		return -1;
+	}
+	
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	g_autofree char *budget_filename=NULL;
+	gboolean record=FALSE;
+	gint tolerance=10;
+	
+	GOptionEntry entries[]={
+		{"budget",'b',0,G_OPTION_ARG_FILENAME,&budget_filename,"Budget to compare with, membench.budget by default","FILE"},
+		{"record",'r',0,G_OPTION_ARG_NONE,&record,"Write the measured sizes as the new budget",NULL},
+		{"tolerance",'t',0,G_OPTION_ARG_INT,&tolerance,"Percent over the budget that still passes, 10 by default","PERCENT"},
+		G_OPTION_ENTRY_NULL
+	};
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("- check the memory used to load snippets");
+	g_option_context_add_main_entries(context,entries,NULL);
+	
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+	
+	if(!budget_filename)
+	{
+		budget_filename=g_strdup("membench.budget");
+	}
+	
+	GHashTable *budget=read_budget(budget_filename);
+	MembenchResult results[G_N_ELEMENTS(GLOBAL_MEMBENCH_SIZES)];
+	int exit_status=0;
+	
+	printf("%10s %10s %10s %12s %12s\n","snippets","peak kB","budget kB","index","xml");
+	
+	for(size_t i=0;i<G_N_ELEMENTS(GLOBAL_MEMBENCH_SIZES);i++)
+	{
+		if(run_corpus(GLOBAL_MEMBENCH_SIZES[i],&results[i])!=0)
+		{
+			fprintf(stderr,"Could not load the corpus of %u snippets\n",GLOBAL_MEMBENCH_SIZES[i]);
+			g_hash_table_destroy(budget);
+			return 2;
+		}
+		
+		const long budget_kb=GPOINTER_TO_SIZE(g_hash_table_lookup(budget,GUINT_TO_POINTER(results[i].snippets)));
+		const gboolean over=!record && budget_kb>0 && results[i].peak_kb*100>budget_kb*(100+tolerance);
+		
+		printf("%10u %10ld %10ld %12zu %12zu%s\n",results[i].snippets,results[i].peak_kb,budget_kb,
+			results[i].index_bytes,results[i].xml_bytes,over?"  OVER BUDGET":"");
+		
+		if(over)
+		{
+			exit_status=1;
+		}
+	}
+	
+	g_hash_table_destroy(budget);
+	
+	if(record && write_budget(budget_filename,results,G_N_ELEMENTS(results))!=0)
+	{
+		return 2;
+	}
+	
+	return exit_status;
+}
@@ -0,0 +1,623 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Renders snippets outside of gedit, for code generation in builds.
+
+	Jobs are read as JSON lines from stdin or a manifest file:
+	{"trigger":"for","language":"c","values":{"1":"i","2":"n"},"output":"loop.c"}
+	"values" can also be an array, where the first element is $1. Jobs without
+	"output" are written to stdout, in the order they were read. The file variables
+	like $GEDIT_FILENAME come from "output", $GEDIT_CURRENT_DOCUMENT_LANGUAGE from
+	"language", the ones that need an editor render as nothing.
+
+	The snippet directories are loaded once, then the jobs are spread over forked
+	worker processes, each with its own python interpreter for the $<...> blocks.
+*/
+#include "gedit-snippets-python-handling.h"
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-shell.h"
+#include "gedit-snippets-variables.h"
+#include "gedit-snippets-memory.h"
+
+#define RENDER_JOBS_PER_WORKER 4
+
+typedef struct RenderWorker
+{
+	pid_t pid;
+	int job_fd; ///< parent -> worker, "index\tjson\n"
+	int result_fd; ///< worker -> parent, "index\tstatus\tlength\n" followed by the bytes
+	GString *incoming;
+	guint outstanding;
+}RenderWorker;
+
+typedef struct RenderResult
+{
+	int status;
+	GString *output;
+}RenderResult;
+
+//$(command) runs in the current directory, a build waits for it anyway
+static const char *get_command_output(const char *command, gpointer user_data)
+{
+	return run_shell_command_sync(command,NULL);
+}
+
+static const char *get_job_variable(int variable, gpointer user_data)
+{
+	char **variables=user_data;
+
+	return variables[variable];
+}
+
+static const char *get_job_value(long long id, gpointer user_data)
+{
+	GPtrArray *values=user_data;
+
+	if(id<0 || (guint64)id>=values->len)
+	{
+		return NULL;
+	}
+
+	return g_ptr_array_index(values,id);
+}
+
+//values[N] is $N
+static GPtrArray *get_job_values(JsonObject *job)
+{
+	GPtrArray *values=g_ptr_array_new();
+	JsonNode *node=json_object_get_member(job,"values");
+
+	if(!node)
+	{
+		return values;
+	}
+
+	if(JSON_NODE_HOLDS_ARRAY(node))
+	{
+		JsonArray *array=json_node_get_array(node);
+		const guint array_len=json_array_get_length(array);
+
+		g_ptr_array_set_size(values,array_len+1);
+
+		for(guint i=0;i<array_len;i++)
+		{
+			JsonNode *element=json_array_get_element(array,i);
+
+			if(JSON_NODE_HOLDS_VALUE(element) && json_node_get_value_type(element)==G_TYPE_STRING)
+			{
+				g_ptr_array_index(values,i+1)=(gpointer)json_node_get_string(element);
+			}
+		}
+	}
+	else if(JSON_NODE_HOLDS_OBJECT(node))
+	{
+		JsonObject *object=json_node_get_object(node);
+		g_autoptr(GList) members=json_object_get_members(object);
+
+		for(GList *l=members;l;l=l->next)
+		{
+			const char *member=l->data;
+			JsonNode *element=json_object_get_member(object,member);
+			long long id_num=g_ascii_strtoll(member,NULL,10);
+
+			if(id_num<0 || id_num>G_MAXINT || !JSON_NODE_HOLDS_VALUE(element) || json_node_get_value_type(element)!=G_TYPE_STRING)
+			{
+				continue;
+			}
+
+			if((guint64)id_num>=values->len)
+			{
+				g_ptr_array_set_size(values,id_num+1);
+			}
+
+			g_ptr_array_index(values,id_num)=(gpointer)json_node_get_string(element);
+		}
+	}
+
+	return values;
+}
+
+static int render_job(const char *job_json, GString *output)
+{
+	g_autoptr(GError) error=NULL;
+	g_autoptr(JsonParser) parser=json_parser_new_immutable();
+
+	if(!json_parser_load_from_data(parser,job_json,-1,&error))
+	{
+		g_string_printf(output,"invalid job: %s",error->message);
+		return 1;
+	}
+
+	JsonNode *root=json_parser_get_root(parser);
+
+	if(!root || !JSON_NODE_HOLDS_OBJECT(root))
+	{
+		g_string_assign(output,"invalid job: not an object");
+		return 1;
+	}
+
+	JsonObject *job=json_node_get_object(root);
+	const char *trigger=json_object_get_string_member_with_default(job,"trigger",NULL);
+	const char *language=json_object_get_string_member_with_default(job,"language",NULL);
+	const char *output_path=json_object_get_string_member_with_default(job,"output",NULL);
+
+	if(!trigger || !language)
+	{
+		g_string_assign(output,"invalid job: trigger and language are needed");
+		return 1;
+	}
+
+	SnippetTranslation *sntran=find_snippet_translation(trigger,language);
+
+	if(!sntran)
+	{
+		g_string_printf(output,"no snippet %s for %s",trigger,language);
+		return 1;
+	}
+
+	g_autoptr(GPtrArray) values=get_job_values(job);
+
+	char *variables[SNIPPET_VARIABLE_COUNT]={NULL};
+
+	if(sntran->variables)
+	{
+		set_snippet_file_variables(variables,output_path);
+		variables[SNIPPET_VARIABLE_LANGUAGE]=g_strdup(language);
+		variables[SNIPPET_VARIABLE_DATE]=get_snippet_time_variable(SNIPPET_VARIABLE_DATE);
+		variables[SNIPPET_VARIABLE_TIME]=get_snippet_time_variable(SNIPPET_VARIABLE_TIME);
+		variables[SNIPPET_VARIABLE_YEAR]=get_snippet_time_variable(SNIPPET_VARIABLE_YEAR);
+	}
+
+	template_set_variable_func(get_job_variable,variables);
+	render_snippet_template(output,sntran->to,get_job_value,values);
+	template_set_variable_func(NULL,NULL);
+
+	for(int i=0;i<SNIPPET_VARIABLE_COUNT;i++)
+	{
+		g_free(variables[i]);
+	}
+
+	if(output_path)
+	{
+		if(!g_file_set_contents(output_path,output->str,output->len,&error))
+		{
+			g_string_printf(output,"could not write %s: %s",output_path,error->message);
+			return 1;
+		}
+
+		g_string_truncate(output,0);
+	}
+	else if(output->len==0 || output->str[output->len-1]!='\n')
+	{
+		g_string_append_c(output,'\n');
+	}
+
+	return 0;
+}
+
+static int write_all(int fd, const char *data, size_t len)
+{
+	while(len>0)
+	{
+		ssize_t written=write(fd,data,len);
+
+		if(written<0)
+		{
+			if(errno==EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+
+		data+=written;
+		len-=written;
+	}
+
+	return 0;
+}
+
+static int run_worker(int job_fd, int result_fd)
+{
+	snippet_python_init();
+	shell_commands_init();
+	template_set_command_func(get_command_output,NULL);
+
+	FILE *jobs=fdopen(job_fd,"r");
+	g_autoptr(GString) output=g_string_sized_new(4096);
+	g_autoptr(GString) header=g_string_sized_new(64);
+
+	char *line=NULL;
+	size_t line_size=0;
+	ssize_t line_len;
+
+	while((line_len=getline(&line,&line_size,jobs))>0)
+	{
+		char *job_json=strchr(line,'\t');
+
+		if(!job_json)
+		{
+			continue;
+		}
+
+		*job_json++='\0';
+
+		g_string_truncate(output,0);
+		int status=render_job(job_json,output);
+
+		g_string_printf(header,"%s\t%d\t%" G_GSIZE_FORMAT "\n",line,status,output->len);
+
+		if(write_all(result_fd,header->str,header->len)!=0 || write_all(result_fd,output->str,output->len)!=0)
+		{
+			break;
+		}
+	}
+
+	free(line);
+	fclose(jobs);
+	close(result_fd);
+
+	shell_commands_finalize();
+	snippet_python_finalize();
+
+	return 0;
+}
+
+static int start_worker(RenderWorker *worker, RenderWorker *workers, guint workers_len)
+{
+	int job_pipe[2];
+	int result_pipe[2];
+
+	if(pipe(job_pipe)!=0 || pipe(result_pipe)!=0)
+	{
+		fprintf(stderr,"%s:%d Could not create pipes: %s\n",__FILE__,__LINE__,g_strerror(errno));
+		return -1;
+	}
+
+	fflush(stdout);
+
+	pid_t pid=fork();
+
+	if(pid<0)
+	{
+		fprintf(stderr,"%s:%d Could not fork: %s\n",__FILE__,__LINE__,g_strerror(errno));
+		close(job_pipe[0]);
+		close(job_pipe[1]);
+		close(result_pipe[0]);
+		close(result_pipe[1]);
+		return -1;
+	}
+
+	if(pid==0)
+	{
+		//the pipes of the workers started before belong to the parent
+		for(guint i=0;i<workers_len;i++)
+		{
+			if(workers[i].pid>0)
+			{
+				close(workers[i].job_fd);
+				close(workers[i].result_fd);
+			}
+		}
+
+		close(job_pipe[1]);
+		close(result_pipe[0]);
+
+		_exit(run_worker(job_pipe[0],result_pipe[1]));
+	}
+
+	close(job_pipe[0]);
+	close(result_pipe[1]);
+
+	worker->pid=pid;
+	worker->job_fd=job_pipe[1];
+	worker->result_fd=result_pipe[0];
+	worker->incoming=g_string_sized_new(4096);
+
+	return 0;
+}
+
+//moves every complete result of the worker into results
+static guint collect_results(RenderWorker *worker, GHashTable *results)
+{
+	guint collected=0;
+
+	while(TRUE)
+	{
+		char *header_end=memchr(worker->incoming->str,'\n',worker->incoming->len);
+
+		if(!header_end)
+		{
+			break;
+		}
+
+		char *end=NULL;
+		guint64 index=g_ascii_strtoull(worker->incoming->str,&end,10);
+		int status=(int)g_ascii_strtoll(end+1,&end,10);
+		gsize output_len=g_ascii_strtoull(end+1,NULL,10);
+
+		const gsize header_len=header_end-worker->incoming->str+1;
+
+		if(worker->incoming->len<header_len+output_len)
+		{
+			break;
+		}
+
+		RenderResult *result=g_new0(RenderResult,1);
+		result->status=status;
+		result->output=g_string_new_len(worker->incoming->str+header_len,output_len);
+
+		g_hash_table_insert(results,GSIZE_TO_POINTER(index),result);
+		g_string_erase(worker->incoming,0,header_len+output_len);
+
+		worker->outstanding--;
+		collected++;
+	}
+
+	return collected;
+}
+
+//closes the pipes of the started workers and waits for them, after killing them unless they are done
+static void stop_workers(RenderWorker *workers, guint workers_len, gboolean kill_them)
+{
+	for(guint i=0;i<workers_len;i++)
+	{
+		if(workers[i].pid<=0)
+		{
+			continue;
+		}
+
+		close(workers[i].job_fd);
+		close(workers[i].result_fd);
+
+		if(kill_them)
+		{
+			kill(workers[i].pid,SIGTERM);
+		}
+
+		waitpid(workers[i].pid,NULL,0);
+		g_string_free(workers[i].incoming,TRUE);
+		workers[i].pid=0;
+	}
+}
+
+static void render_result_free(RenderResult *self)
+{
+	g_string_free(self->output,TRUE);
+	g_free(self);
+}
+
+int main(int argc, char **argv)
+{
+	g_autofree char *manifest=NULL;
+	gint jobs_count=0;
+	gboolean memory_report=FALSE;
+
+	GOptionEntry entries[]={
+		{"manifest",'m',0,G_OPTION_ARG_FILENAME,&manifest,"Read the jobs from FILE instead of stdin","FILE"},
+		{"jobs",'j',0,G_OPTION_ARG_INT,&jobs_count,"Number of worker processes, the number of cores by default","N"},
+		{"memory-report",0,0,G_OPTION_ARG_NONE,&memory_report,"Print the memory used by the loaded snippets as JSON and exit",NULL},
+		G_OPTION_ENTRY_NULL
+	};
+
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("- render gedit snippets from JSON lines");
+	g_option_context_add_main_entries(context,entries,NULL);
+
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+
+	if(memory_report)
+	{
+		configuration_init();
+		load_configuration();
+
+		SnippetMemoryReport *report=snippet_memory_report_new();
+		g_autofree char *json=snippet_memory_report_to_json(report);
+		printf("%s\n",json);
+
+		snippet_memory_report_free(report);
+		configuration_finalize();
+
+		return 0;
+	}
+
+	FILE *input=stdin;
+
+	if(manifest && !(input=fopen(manifest,"r")))
+	{
+		fprintf(stderr,"Could not open %s: %s\n",manifest,g_strerror(errno));
+		return 2;
+	}
+
+	const guint workers_len=jobs_count>0?(guint)jobs_count:g_get_num_processors();
+
+	//a worker that died shows as a failed write, not as a signal that ends the parent too
+	signal(SIGPIPE,SIG_IGN);
+
+	//loaded once, the workers get it through fork, which is only safe while there are no threads
+	configuration_init();
+	configuration_set_parser_threads(1);
+	template_init();
+	snippet_index_set_added_func(prepare_snippet_transforms,NULL);
+	load_configuration();
+
+	RenderWorker *workers=g_new0(RenderWorker,workers_len);
+
+	for(guint i=0;i<workers_len;i++)
+	{
+		if(start_worker(&workers[i],workers,workers_len)!=0)
+		{
+			stop_workers(workers,workers_len,TRUE);
+			return 2;
+		}
+	}
+
+	GHashTable *results=g_hash_table_new_full(g_direct_hash,g_direct_equal,NULL,(GDestroyNotify)render_result_free);
+	struct pollfd *pollfds=g_new0(struct pollfd,workers_len);
+
+	gsize jobs_sent=0;
+	gsize jobs_done=0;
+	gsize next_to_write=0;
+	gboolean input_done=FALSE;
+	int exit_status=0;
+
+	char *line=NULL;
+	size_t line_size=0;
+	g_autoptr(GString) job_line=g_string_sized_new(256);
+
+	while(!input_done || jobs_done<jobs_sent)
+	{
+		//keep every worker busy, but do not read the input further ahead than that
+		for(guint i=0;i<workers_len && !input_done;i++)
+		{
+			RenderWorker *worker=&workers[i];
+
+			while(worker->outstanding<RENDER_JOBS_PER_WORKER)
+			{
+				ssize_t line_len=getline(&line,&line_size,input);
+
+				if(line_len<0)
+				{
+					input_done=TRUE;
+					break;
+				}
+
+				g_strstrip(line);
+
+				if(line[0]=='\0')
+				{
+					continue;
+				}
+
+				g_string_printf(job_line,"%" G_GSIZE_FORMAT "\t%s\n",jobs_sent,line);
+
+				if(write_all(worker->job_fd,job_line->str,job_line->len)!=0)
+				{
+					fprintf(stderr,"%s:%d Worker %d died\n",__FILE__,__LINE__,(int)worker->pid);
+					stop_workers(workers,workers_len,TRUE);
+					return 2;
+				}
+
+				worker->outstanding++;
+				jobs_sent++;
+			}
+		}
+
+		if(jobs_done==jobs_sent)
+		{
+			continue;
+		}
+
+		for(guint i=0;i<workers_len;i++)
+		{
+			pollfds[i].fd=workers[i].outstanding>0?workers[i].result_fd:-1;
+			pollfds[i].events=POLLIN;
+			pollfds[i].revents=0;
+		}
+
+		if(poll(pollfds,workers_len,-1)<0)
+		{
+			if(errno==EINTR)
+			{
+				continue;
+			}
+
+			fprintf(stderr,"%s:%d Could not wait for the workers: %s\n",__FILE__,__LINE__,g_strerror(errno));
+			stop_workers(workers,workers_len,TRUE);
+			return 2;
+		}
+
+		for(guint i=0;i<workers_len;i++)
+		{
+			if(!(pollfds[i].revents&(POLLIN|POLLHUP)))
+			{
+				continue;
+			}
+
+			char buffer[65536];
+			ssize_t read_len=read(workers[i].result_fd,buffer,sizeof(buffer));
+
+			if(read_len<=0)
+			{
+				fprintf(stderr,"%s:%d Worker %d died\n",__FILE__,__LINE__,(int)workers[i].pid);
+				stop_workers(workers,workers_len,TRUE);
+				return 2;
+			}
+
+			g_string_append_len(workers[i].incoming,buffer,read_len);
+			jobs_done+=collect_results(&workers[i],results);
+		}
+
+		//stream the finished results in input order
+		RenderResult *result;
+		while((result=g_hash_table_lookup(results,GSIZE_TO_POINTER(next_to_write))))
+		{
+			if(result->status==0)
+			{
+				fwrite(result->output->str,1,result->output->len,stdout);
+			}
+			else
+			{
+				fprintf(stderr,"job %" G_GSIZE_FORMAT ": %s\n",next_to_write,result->output->str);
+				exit_status=1;
+			}
+
+			g_hash_table_remove(results,GSIZE_TO_POINTER(next_to_write));
+			next_to_write++;
+		}
+	}
+
+	fflush(stdout);
+	free(line);
+
+	stop_workers(workers,workers_len,FALSE);
+
+	if(input!=stdin)
+	{
+		fclose(input);
+	}
+
+	g_free(pollfds);
+	g_free(workers);
+	g_hash_table_destroy(results);
+
+	configuration_finalize();
+	template_finalize();
+
+	return exit_status;
+}
@@ -0,0 +1,271 @@
+/**
+Copyright (c) 2025 Florian Evaldsson
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/**
+	Replays traces recorded with GEDIT_SNIPPETS_TRACE=file against an in-memory buffer,
+	with the snippets of the current user, and prints how long the Tabs took.
+
+	After every key the text is compared with the one gedit had, then the idle sources
+	and the $(command)s of the engine are run, the recorded edits that follow did not wait
+	for them either. Exits with 1 when the replay ended up with another text than gedit.
+*/
+#include "gedit-snippets-python-handling.h"
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gedit-snippets-configuration.h"
+#include "gedit-snippets-template.h"
+#include "gedit-snippets-filter.h"
+#include "gedit-snippets-engine.h"
+#include "gedit-snippets-trace.h"
+
+typedef struct ReplayStats
+{
+	GArray *tab_usec; ///< gint64, how long each Tab took in the engine
+	guint keys;
+	guint mismatches;
+}ReplayStats;
+
+static void set_replay_cursor(GtkTextBuffer *buffer, guint64 cursor, guint64 bound)
+{
+	GtkTextIter cursor_iter, bound_iter;
+	gtk_text_buffer_get_iter_at_offset(buffer, &cursor_iter, (gint)cursor);
+	gtk_text_buffer_get_iter_at_offset(buffer, &bound_iter, (gint)bound);
+	gtk_text_buffer_select_range(buffer, &cursor_iter, &bound_iter);
+}
+
+static void drain_main_context()
+{
+	while(g_main_context_iteration(NULL,FALSE))
+	{
+	}
+}
+
+/**
+	Returns -1 when the trace is broken, the events before that are replayed anyway.
+*/
+static int replay_trace(const char *filename, const char *data, gsize len, ReplayStats *stats)
+{
+	SnippetTraceReader reader;
+	
+	if(snippet_trace_reader_init(&reader,data,len)!=0)
+	{
+		fprintf(stderr,"%s: not a snippets trace\n",filename);
+		return -1;
+	}
+	
+	GtkTextBuffer *buffer=gtk_text_buffer_new(NULL);
+	g_autofree char *language=NULL;
+	SnippetTraceEvent event;
+	gboolean handled=FALSE;
+	guint record=0;
+	int status;
+	
+	while((status=snippet_trace_reader_next(&reader,&event))>0)
+	{
+		record++;
+		
+		GtkTextIter start, end;
+		
+		switch(event.type)
+		{
+		case SNIPPET_TRACE_BUFFER:
+			//another document, what the engine knew about the last one is gone
+			snippet_engine_button_press(1);
+			gtk_text_buffer_set_text(buffer, event.text, event.text_len);
+			set_replay_cursor(buffer, event.values[0], event.values[0]);
+			break;
+		case SNIPPET_TRACE_LANGUAGE:
+			g_free(language);
+			language=event.text_len>0?g_strndup(event.text,event.text_len):NULL;
+			break;
+		case SNIPPET_TRACE_KEY:
+		{
+			set_replay_cursor(buffer, event.values[3], event.values[4]);
+			
+			SnippetTranslation *expanded=NULL;
+			const gint64 start_time=g_get_monotonic_time();
+			
+			handled=snippet_engine_key_press(buffer, language, (guint)event.values[1], event.values[2]!=0, &expanded);
+			
+			const gint64 usec=g_get_monotonic_time()-start_time;
+			
+			if(event.values[1]==GDK_KEY_Tab)
+			{
+				g_array_append_val(stats->tab_usec,usec);
+			}
+			stats->keys++;
+			break;
+		}
+		case SNIPPET_TRACE_RESULT:
+			if(handled!=(event.values[0]!=0))
+			{
+				fprintf(stderr,"%s: record %u: the key was %s, gedit %s it\n",filename,record,
+					handled?"used":"not used",event.values[0]?"used":"did not use");
+				stats->mismatches++;
+			}
+			else if(handled && snippet_trace_hash_buffer(buffer)!=(guint)event.values[1])
+			{
+				fprintf(stderr,"%s: record %u: the text after the key differs from gedit\n",filename,record);
+				stats->mismatches++;
+			}
+			
+			drain_main_context();
+			break;
+		case SNIPPET_TRACE_BUTTON:
+			snippet_engine_button_press((guint)event.values[0]);
+			break;
+		case SNIPPET_TRACE_INSERT:
+			gtk_text_buffer_get_iter_at_offset(buffer, &start, (gint)event.values[0]);
+			gtk_text_buffer_insert(buffer, &start, event.text, event.text_len);
+			break;
+		case SNIPPET_TRACE_DELETE:
+			gtk_text_buffer_get_iter_at_offset(buffer, &start, (gint)event.values[0]);
+			gtk_text_buffer_get_iter_at_offset(buffer, &end, (gint)event.values[1]);
+			gtk_text_buffer_delete(buffer, &start, &end);
+			break;
+		}
+	}
+	
+	if(status<0)
+	{
+		fprintf(stderr,"%s: the trace is cut off after record %u\n",filename,record);
+	}
+	
+	snippet_engine_button_press(1);
+	drain_main_context();
+	g_object_unref(buffer);
+	
+	return status<0?-1:0;
+}
+
+static gint compare_usec(gconstpointer a, gconstpointer b)
+{
+	const gint64 ia=*(const gint64 *)a;
+	const gint64 ib=*(const gint64 *)b;
+	
+	return ia<ib?-1:ia>ib;
+}
+
+static void print_stats(const char *name, ReplayStats *stats)
+{
+	GArray *tab_usec=stats->tab_usec;
+	
+	if(tab_usec->len==0)
+	{
+		printf("%-24s %8u keys %8u tabs\n",name,stats->keys,0u);
+		return;
+	}
+	
+	g_array_sort(tab_usec,compare_usec);
+	
+	gint64 total=0;
+	
+	for(guint i=0;i<tab_usec->len;i++)
+	{
+		total+=g_array_index(tab_usec,gint64,i);
+	}
+	
+	printf("%-24s %8u keys %8u tabs  mean %8.1f us  p50 %6" G_GINT64_FORMAT " us  p99 %6" G_GINT64_FORMAT " us  max %6" G_GINT64_FORMAT " us\n",
+		name,stats->keys,tab_usec->len,(double)total/tab_usec->len,
+		g_array_index(tab_usec,gint64,tab_usec->len/2),
+		g_array_index(tab_usec,gint64,(tab_usec->len*99)/100),
+		g_array_index(tab_usec,gint64,tab_usec->len-1));
+}
+
+int main(int argc, char **argv)
+{
+	gint repeat=1;
+	
+	GOptionEntry entries[]={
+		{"repeat",'r',0,G_OPTION_ARG_INT,&repeat,"Replay every trace N times, the stats cover all of them","N"},
+		G_OPTION_ENTRY_NULL
+	};
+	
+	g_autoptr(GError) error=NULL;
+	g_autoptr(GOptionContext) context=g_option_context_new("TRACE... - replay snippet traces without gedit");
+	g_option_context_add_main_entries(context,entries,NULL);
+	
+	if(!g_option_context_parse(context,&argc,&argv,&error))
+	{
+		fprintf(stderr,"%s\n",error->message);
+		return 2;
+	}
+	
+	if(argc<2)
+	{
+		fprintf(stderr,"No trace given, record one with GEDIT_SNIPPETS_TRACE=FILE gedit\n");
+		return 2;
+	}
+	
+	snippet_python_init();
+	configuration_init();
+	template_init();
+	snippet_index_set_added_func(prepare_snippet_transforms,NULL);
+	load_configuration();
+	snippet_filter_init();
+	init_globals();
+	
+	int exit_status=0;
+	
+	for(int i=1;i<argc;i++)
+	{
+		g_autofree char *data=NULL;
+		gsize len=0;
+		
+		if(!g_file_get_contents(argv[i],&data,&len,&error))
+		{
+			fprintf(stderr,"%s\n",error->message);
+			g_clear_error(&error);
+			exit_status=2;
+			continue;
+		}
+		
+		ReplayStats stats={g_array_new(FALSE,FALSE,sizeof(gint64)),0,0};
+		
+		for(gint j=0;j<MAX(repeat,1);j++)
+		{
+			if(replay_trace(argv[i],data,len,&stats)!=0 && exit_status==0)
+			{
+				exit_status=2;
+			}
+		}
+		
+		print_stats(argv[i],&stats);
+		
+		if(stats.mismatches>0)
+		{
+			exit_status=1;
+		}
+		
+		g_array_unref(stats.tab_usec);
+	}
+	
+	snippet_engine_finalize();
+	snippet_filter_finalize();
+	template_finalize();
+	configuration_finalize();
+	snippet_python_finalize();
+	
+	return exit_status;
+}